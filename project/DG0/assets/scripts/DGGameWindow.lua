@@ -20,6 +20,8 @@ MakeDialog
 			h=600,
 			rows=gRows,
 			columns=gColumns,
+			hudfont=standardFont,
+			hudfontsize=16,
 		},
 		SetStyle(LongButtonStyle),
 		Button
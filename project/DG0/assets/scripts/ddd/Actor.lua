@@ -3,7 +3,12 @@ require( "scripts/ddd/ilua.lua" );
 
 --------------------------------------------------------------------------------
 
-Actor = { owner = nil }
+-- animation_ is the animated texture the level draws the actor with and fx_
+-- the particle spec, "" for none; x_, y_ is where in the level window and
+-- layer_ what it's drawn over, lowest first, by y on the layers given to
+-- setLayerYSorted. Set them in onInit, or later with setActorAnimation,
+-- setActorFx, setActorPosition and setActorLayer.
+Actor = { owner = nil, animation_ = "", msPerFrame_ = 100, loop_ = true, fx_ = "", x_ = 0, y_ = 0, layer_ = 0 }
 
 classInheritance( Actor, ILua )
 
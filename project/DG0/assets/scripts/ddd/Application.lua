@@ -23,6 +23,9 @@ classInheritance( Application, ILua )
 
 function Application:onInit()
 	createGame( "game", GT_DEFENCE_GARDEN );
+	-- warm the level up while the menus are showing; a level can preload the
+	-- next one the same way and release its own manifest when it ends
+	preloadAssets( "levels/mainlevel.txt" );
 	return true;
 end
 
@@ -30,3 +33,11 @@ function Application:onCreateLevelTable(levelID, gameID)
 	createLevel(levelID, gameID);
 	return true;
 end
+
+--------------------------------------------------------------------------------
+-- params: { manifest, loaded, total }; called each frame the manifest made
+-- progress, drive a loading screen from here
+
+function Application:onAssetProgress( params )
+	return true;
+end
@@ -2,6 +2,7 @@
 require( "scripts/ddd/ilua.lua" );
 require( "scripts/ddd/Factory.lua" );
 require( "scripts/ddd/Constants.lua" );
+require( "scripts/levels.lua" );
 
 --------------------------------------------------------------------------------
 
@@ -12,6 +13,24 @@ classInheritance( Level, ILua )
 --------------------------------------------------------------------------------
 
 function Level:onInit()
-	createActor(0, "actor", GT_DEFENCE_GARDEN, LT_MAIN_LEVEL);
+	if not loadCompiledLevel( self.gameID_, self.ID_ ) then
+		describeLevel( self.gameID_, self.ID_ );
+	end
+	return true;
+end
+
+--------------------------------------------------------------------------------
+-- params: { x, y, column, row, item, actor }; column and row are nil off the
+-- picking grid, item is nil when nothing was hit and actor, the ID of the actor
+-- whose frame was hit, is nil when the item isn't an actor's
+
+function Level:onMouseDown( params )
+	return true;
+end
+
+--------------------------------------------------------------------------------
+-- called when the item under the mouse changes; params as for onMouseDown
+
+function Level:onHover( params )
 	return true;
 end
\ No newline at end of file
@@ -0,0 +1,521 @@
+-- ------------------------------------------------------------
+-- Particle spec compiler for TFxParticleKernel.
+--
+-- A particle spec (fx/*.lua) is run against stand-ins for the
+-- particle system API. Instead of building particle functions, the
+-- stand-ins record each rule's expression and lower it into the
+-- flat instruction streams the native kernel executes over whole
+-- particle columns at once.
+--
+-- Anything the kernel can't run sets gKernelUnsupported; the sprite
+-- then falls back to TLuaParticleSystem.
+-- ------------------------------------------------------------
+
+-- Opcodes; keep in sync with TFxParticleKernel::EOp.
+local kOpUniConst = 1		-- u value
+local kOpUniTime = 2		-- u scale          u = scale * ms
+local kOpUniSource = 3		-- u component
+local kOpUniAdd = 4			-- u a b
+local kOpUniSub = 5			-- u a b
+local kOpUniMul = 6			-- u a b
+local kOpUniNeg = 7			-- u a
+local kOpFill = 8			-- c u
+local kOpCopy = 9			-- c a
+local kOpAdd = 10			-- c a b
+local kOpSub = 11			-- c a b
+local kOpMul = 12			-- c a b
+local kOpAddUni = 13		-- c a u
+local kOpSubUni = 14		-- c a u            c = a - u
+local kOpUniSubCol = 15		-- c u a            c = u - a
+local kOpMulUni = 16		-- c a u
+local kOpNeg = 17			-- c a
+local kOpRange = 18			-- c ulo uhi
+local kOpPickIndex = 19		-- c count
+local kOpSelect = 20		-- c index count u1..un
+local kOpFade = 21			-- c age count (utime uvalue)..
+local kOpGreater = 22		-- c a b
+local kOpGreaterUni = 23	-- c a u
+local kOpUniGreater = 24	-- c u a
+local kOpSin = 25			-- c a
+local kOpCos = 26			-- c a
+local kOpExpire = 27		-- a
+
+-- Temporary columns are numbered from here; the kernel places them
+-- after the particle members.
+local kTempBase = 1000
+
+-- Match TRenderer::EBlendMode.
+kBlendNormal = 0
+kBlendOpaque = 1
+kBlendAdditiveAlpha = 2
+kBlendSubtractive = 3
+kBlendMultiplicative = 4
+
+gKernelUniformProgram = { n=0 }
+gKernelInitProgram = { n=0 }
+gKernelAnimProgram = { n=0 }
+gKernelMembers = 0
+gKernelTemps = 0
+gKernelUniforms = 0
+gKernelTexture = ""
+gKernelBlendMode = kBlendNormal
+gKernelParticles = 0
+gKernelUnsupported = nil
+
+local gTempNext = 0
+local gUniformCache = {}
+
+local function Unsupported( what )
+	if not gKernelUnsupported then
+		gKernelUnsupported = tostring(what)
+	end
+end
+
+local function Emit( program, ... )
+	for i=1,arg.n do
+		program.n = program.n+1
+		program[program.n] = arg[i]
+	end
+end
+
+-- ------------------------------------------------------------
+-- Registers
+
+local function Uniform( key, op, a, b )
+	local u = gUniformCache[key]
+	if u then
+		return u
+	end
+	u = gKernelUniforms
+	gKernelUniforms = u+1
+	if b then
+		Emit( gKernelUniformProgram, op, u, a, b )
+	else
+		Emit( gKernelUniformProgram, op, u, a )
+	end
+	gUniformCache[key] = u
+	return u
+end
+
+local function Const( value )
+	return Uniform( "c"..value, kOpUniConst, value )
+end
+
+local function Time( scale )
+	return Uniform( "t"..scale, kOpUniTime, scale )
+end
+
+local function NewTemp()
+	local c = kTempBase+gTempNext
+	gTempNext = gTempNext+1
+	if gTempNext > gKernelTemps then
+		gKernelTemps = gTempNext
+	end
+	return c
+end
+
+-- A lowered component is either { u=uniform } or { c=column }.
+local function Column( comp, program )
+	if comp.c then
+		return comp.c
+	end
+	local c = NewTemp()
+	Emit( program, kOpFill, c, comp.u )
+	return c
+end
+
+local function Target( hint, i )
+	if hint and hint[i] then
+		return hint[i]
+	end
+	return NewTemp()
+end
+
+-- Component i of a lowered value, broadcasting scalars.
+local function Comp( value, i )
+	if value.n == 1 then
+		return value[1]
+	end
+	return value[i]
+end
+
+-- ------------------------------------------------------------
+-- Expression graph
+
+local Node = {}
+Node.__index = Node
+
+local function MakeNode( t )
+	return setmetatable( t, Node )
+end
+
+Node.__add = function( a, b ) return MakeNode{ kind="add", a=a, b=b } end
+Node.__sub = function( a, b ) return MakeNode{ kind="sub", a=a, b=b } end
+Node.__mul = function( a, b ) return MakeNode{ kind="mul", a=a, b=b } end
+Node.__unm = function( a ) return MakeNode{ kind="neg", a=a } end
+Node.__div = function( a, b ) return MakeNode{ kind="div", a=a, b=b } end
+
+local Lower
+
+local gUniformOps = { add=kOpUniAdd, sub=kOpUniSub, mul=kOpUniMul }
+local gColumnOps = { add=kOpAdd, sub=kOpSub, mul=kOpMul }
+
+local function Combine( kind, a, b, program, dst )
+	if a.u and b.u then
+		return { u=Uniform( kind.."("..a.u..","..b.u..")", gUniformOps[kind], a.u, b.u ) }
+	end
+	local c = dst or NewTemp()
+	if a.c and b.c then
+		Emit( program, gColumnOps[kind], c, a.c, b.c )
+	elseif a.c then
+		if kind == "add" then
+			Emit( program, kOpAddUni, c, a.c, b.u )
+		elseif kind == "sub" then
+			Emit( program, kOpSubUni, c, a.c, b.u )
+		else
+			Emit( program, kOpMulUni, c, a.c, b.u )
+		end
+	else
+		if kind == "add" then
+			Emit( program, kOpAddUni, c, b.c, a.u )
+		elseif kind == "sub" then
+			Emit( program, kOpUniSubCol, c, a.u, b.c )
+		else
+			Emit( program, kOpMulUni, c, b.c, a.u )
+		end
+	end
+	return { c=c }
+end
+
+local function Binary( kind, A, B, program, hint )
+	local n = A.n
+	if B.n > n then
+		n = B.n
+	end
+	if A.n ~= B.n and A.n ~= 1 and B.n ~= 1 then
+		Unsupported( "mismatched sizes in "..kind )
+	end
+	local result = { n=n }
+	for i=1,n do
+		result[i] = Combine( kind, Comp(A,i), Comp(B,i), program, hint and hint[i] )
+	end
+	return result
+end
+
+-- Lowering of the particle functions the kernel knows.
+local gCalls = {}
+
+gCalls.fTimeScale = function( args, program, hint )
+	return Binary( "mul", Lower( args[1], program ), { n=1, { u=Time(0.001) } }, program, hint )
+end
+
+gCalls.fAge = function( args, program, hint )
+	return { n=1, { u=Time(1) } }
+end
+
+gCalls.fRange = function( args, program, hint )
+	local A = Lower( args[1], program )
+	local B = Lower( args[2], program )
+	local n = A.n
+	if B.n > n then
+		n = B.n
+	end
+	local result = { n=n }
+	for i=1,n do
+		local a = Comp(A,i)
+		local b = Comp(B,i)
+		if not a.u or not b.u then
+			Unsupported( "fRange of particle values" )
+			return result
+		end
+		local c = Target( hint, i )
+		Emit( program, kOpRange, c, a.u, b.u )
+		result[i] = { c=c }
+	end
+	return result
+end
+
+gCalls.fPick = function( args, program, hint )
+	local values = {}
+	local n = 1
+	for k=1,args.n do
+		values[k] = Lower( args[k], program )
+		if values[k].n > n then
+			n = values[k].n
+		end
+	end
+	local index = NewTemp()
+	Emit( program, kOpPickIndex, index, args.n )
+	local result = { n=n }
+	for i=1,n do
+		local c = Target( hint, i )
+		Emit( program, kOpSelect, c, index, args.n )
+		for k=1,args.n do
+			local v = Comp( values[k], i )
+			if not v.u then
+				Unsupported( "fPick of particle values" )
+				return result
+			end
+			Emit( program, v.u )
+		end
+		result[i] = { c=c }
+	end
+	return result
+end
+
+gCalls.fFade = function( args, program, hint )
+	local age = Lower( args[1], program )
+	if age.n ~= 1 then
+		Unsupported( "fFade age size" )
+		return { n=1, { u=Const(0) } }
+	end
+	local ageColumn = Column( age[1], program )
+
+	-- Colors sit at 2,4,..; the time to fade to the next one follows each.
+	local keys = {}
+	local times = {}
+	local count = 0
+	local time = Const(0)
+	local n = 1
+	local k = 2
+	while k <= args.n do
+		count = count+1
+		keys[count] = Lower( args[k], program )
+		times[count] = time
+		if keys[count].n > n then
+			n = keys[count].n
+		end
+		if k+1 <= args.n then
+			local step = Lower( args[k+1], program )
+			if not step[1].u then
+				Unsupported( "fFade time from particle values" )
+				return { n=1, { u=Const(0) } }
+			end
+			time = Uniform( "add("..time..","..step[1].u..")", kOpUniAdd, time, step[1].u )
+		end
+		k = k+2
+	end
+
+	local result = { n=n }
+	for i=1,n do
+		local c = Target( hint, i )
+		Emit( program, kOpFade, c, ageColumn, count )
+		for key=1,count do
+			local v = Comp( keys[key], i )
+			if not v.u then
+				Unsupported( "fFade of particle values" )
+				return result
+			end
+			Emit( program, times[key], v.u )
+		end
+		result[i] = { c=c }
+	end
+	return result
+end
+
+gCalls.fGreater = function( args, program, hint )
+	local a = Lower( args[1], program )[1]
+	local b = Lower( args[2], program )[1]
+	local c = Target( hint, 1 )
+	if a.c and b.c then
+		Emit( program, kOpGreater, c, a.c, b.c )
+	elseif a.c then
+		Emit( program, kOpGreaterUni, c, a.c, b.u )
+	elseif b.c then
+		Emit( program, kOpUniGreater, c, a.u, b.c )
+	else
+		Emit( program, kOpGreaterUni, c, Column( a, program ), b.u )
+	end
+	return { n=1, { c=c } }
+end
+
+-- Rotates the ( 0, -1 ) up vector by the angle.
+gCalls.f2dRotation = function( args, program, hint )
+	local angle = Column( Lower( args[1], program )[1], program )
+	local x = Target( hint, 1 )
+	local y = Target( hint, 2 )
+	Emit( program, kOpSin, x, angle )
+	Emit( program, kOpCos, y, angle )
+	Emit( program, kOpNeg, y, y )
+	return { n=2, { c=x }, { c=y } }
+end
+
+Lower = function( node, program, hint )
+	if type(node) == "number" then
+		return { n=1, { u=Const(node) } }
+	end
+	if type(node) ~= "table" or getmetatable(node) ~= Node then
+		Unsupported( "value "..tostring(node) )
+		return { n=1, { u=Const(0) } }
+	end
+
+	local kind = node.kind
+	if kind == "member" then
+		local result = { n=node.n }
+		for i=1,node.n do
+			result[i] = { c=node.base+i-1 }
+		end
+		return result
+	elseif kind == "source" then
+		local result = { n=node.n }
+		for i=1,node.n do
+			local component = node.base+i-1
+			result[i] = { u=Uniform( "s"..component, kOpUniSource, component ) }
+		end
+		return result
+	elseif kind == "pack" then
+		local result = { n=node.args.n }
+		for i=1,node.args.n do
+			local value = Lower( node.args[i], program )
+			if value.n ~= 1 then
+				Unsupported( "vector inside a vector" )
+			end
+			result[i] = value[1]
+		end
+		return result
+	elseif gColumnOps[kind] then
+		return Binary( kind, Lower( node.a, program ), Lower( node.b, program ), program, hint )
+	elseif kind == "neg" then
+		local A = Lower( node.a, program )
+		local result = { n=A.n }
+		for i=1,A.n do
+			if A[i].u then
+				result[i] = { u=Uniform( "neg("..A[i].u..")", kOpUniNeg, A[i].u ) }
+			else
+				local c = Target( hint, i )
+				Emit( program, kOpNeg, c, A[i].c )
+				result[i] = { c=c }
+			end
+		end
+		return result
+	elseif kind == "call" then
+		local lower = gCalls[node.name]
+		if lower then
+			return lower( node.args, program, hint )
+		end
+		Unsupported( node.name )
+	else
+		Unsupported( kind )
+	end
+	return { n=1, { u=Const(0) } }
+end
+
+-- ------------------------------------------------------------
+-- Rules
+
+local function Assign( program, member, expr )
+	gTempNext = 0
+	local hint = {}
+	for i=1,member.n do
+		hint[i] = member.base+i-1
+	end
+	local value = Lower( expr, program, hint )
+	if value.n ~= member.n and value.n ~= 1 then
+		Unsupported( "rule size" )
+		return
+	end
+	for i=1,member.n do
+		local v = Comp( value, i )
+		local c = member.base+i-1
+		if v.u then
+			Emit( program, kOpFill, c, v.u )
+		elseif v.c ~= c then
+			Emit( program, kOpCopy, c, v.c )
+		end
+	end
+end
+
+local function Rule( program, expr )
+	gTempNext = 0
+	if type(expr) == "table" and expr.kind == "call" and expr.name == "fExpire" then
+		local value = Lower( expr.args[1], program )
+		Emit( program, kOpExpire, Column( value[1], program ) )
+	else
+		Unsupported( "rule without a target" )
+	end
+end
+
+function Node:Init( expr )
+	if self.kind ~= "member" then
+		Unsupported( "Init on an expression" )
+		return
+	end
+	Assign( gKernelInitProgram, self, expr )
+end
+
+function Node:Anim( expr )
+	if self.kind ~= "member" then
+		Unsupported( "Anim on an expression" )
+		return
+	end
+	Assign( gKernelAnimProgram, self, expr )
+end
+
+function Init( expr )
+	Rule( gKernelInitProgram, expr )
+end
+
+function Anim( expr )
+	Rule( gKernelAnimProgram, expr )
+end
+
+-- ------------------------------------------------------------
+-- Particle system API
+
+function Allocate( size )
+	local member = MakeNode{ kind="member", base=gKernelMembers, n=size }
+	gKernelMembers = gKernelMembers+size
+	return member
+end
+
+function Vec2( ... )
+	return MakeNode{ kind="pack", args=arg }
+end
+
+function Color( ... )
+	return MakeNode{ kind="pack", args=arg }
+end
+
+function SetTexture( texture )
+	gKernelTexture = texture
+end
+
+function SetBlendMode( mode )
+	gKernelBlendMode = mode
+end
+
+function SetNumParticles( count )
+	gKernelParticles = count
+end
+
+-- The data sources TFxSprite registers.
+dLocus = MakeNode{ kind="source", base=0, n=2 }
+dUp = MakeNode{ kind="source", base=2, n=2 }
+
+local function Call( name )
+	return function( ... )
+		return MakeNode{ kind="call", name=name, args=arg }
+	end
+end
+
+for name in pairs(gCalls) do
+	_G[name] = Call(name)
+end
+_G.fExpire = Call("fExpire")
+
+-- While the spec runs, unknown particle functions and API calls are
+-- recorded instead of failing, and GUI_ tweakables take their default.
+setmetatable( _G, { __index = function( t, name )
+	if string.find( name, "^GUI_" ) then
+		return function( value ) return value end
+	elseif string.find( name, "^f%u" ) then
+		return Call( name )
+	elseif string.find( name, "^%u" ) then
+		return function() Unsupported( name ) end
+	end
+	return nil
+end } )
+
+function gKernelFinish()
+	setmetatable( _G, nil )
+end
@@ -0,0 +1,23 @@
+require( "scripts/ddd/Constants.lua" );
+
+--------------------------------------------------------------------------------
+-- One description per level, called as description( gameID, levelID ). They
+-- place actors with createActor and may call
+--	setTileGrid( columns, rows, tileSize, tiles, gameID, levelID )
+--	addWave( time, actorType, count, interval, gameID, levelID )
+-- Run the game with -compilelevels to turn them into levels/level_*.lvl;
+-- without a compiled file, or with one compiled before the last edit to this
+-- script, Level:onInit runs the description instead.
+
+levelDescriptions = {}
+levelDescriptions[ GT_DEFENCE_GARDEN ] = {}
+
+levelDescriptions[ GT_DEFENCE_GARDEN ][ LT_MAIN_LEVEL ] = function( gameID, levelID )
+	createActor( 0, "actor", gameID, levelID );
+end
+
+--------------------------------------------------------------------------------
+
+function describeLevel( gameID, levelID )
+	levelDescriptions[ gameID ][ levelID ]( gameID, levelID );
+end
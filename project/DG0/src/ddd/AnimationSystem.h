@@ -0,0 +1,188 @@
+#pragma once
+
+#include <vector>
+#include <pf/animatedtexture.h>
+#include <pf/drawspec.h>
+#include <pf/rect.h>
+#include <pf/point.h>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	class SnapshotReader;
+	class SnapshotWriter;
+
+	//Shared clock animation of sprite sheet clips.
+	//Clip frame rects and registration points are copied once into flat
+	//tables, every animated instance keeps only ( clip, start time, rate ),
+	//and update() computes the current frame of all instances in one sweep.
+	class AnimationSystem
+	{
+	public:
+
+		AnimationSystem();
+		~AnimationSystem();
+
+		//clips interface
+		const unsigned long addClip( const char* animationName,
+				const unsigned long msPerFrame,
+				const bool loop );
+		const unsigned long addClip( TAnimatedTextureRef texture,
+				const unsigned long firstFrame,
+				const unsigned long frameCount,
+				const unsigned long msPerFrame,
+				const bool loop );
+		inline const size_t getClipCount()const;
+		inline const unsigned long getClipFrameCount( const unsigned long clipID )const;
+
+		//instances interface; rates below 0 are taken as 0, the instance
+		//holds its frame
+		const unsigned long addInstance( const unsigned long clipID,
+				const unsigned long startTime,
+				const TReal rate = 1 );
+		void removeInstance( const unsigned long instanceID );
+		void removeAllInstances();
+		inline void setClip( const unsigned long instanceID, const unsigned long clipID, const unsigned long startTime );
+		inline void setRate( const unsigned long instanceID, const TReal rate );
+		inline void restart( const unsigned long instanceID, const unsigned long startTime );
+		inline const size_t getInstanceCount()const;
+
+		void update( const unsigned long time );
+
+		//per instance results of the last update
+		inline const unsigned long getFrame( const unsigned long instanceID )const;
+		inline const TRect& getFrameRect( const unsigned long instanceID )const;
+		inline const TPoint& getRegistrationPoint( const unsigned long instanceID )const;
+		void draw( const unsigned long instanceID, const TDrawSpec& drawSpec )const;
+
+		void release();
+
+		//snapshot interface, see LevelSnapshot
+		void save( SnapshotWriter& writer )const;
+		//false, and no instances left, if the data doesn't fit
+		const bool load( SnapshotReader& reader );
+
+	private:
+
+		struct Clip
+		{
+			TAnimatedTextureRef texture_;
+			unsigned long textureFirstFrame_;
+			unsigned long tableOffset_;
+			unsigned long frameCount_;
+			unsigned long msPerFrame_;
+			bool loop_;
+		};
+
+		inline const unsigned long getDenseIndex( const unsigned long instanceID )const;
+		//update() turns elapsed * rate into an unsigned frame step
+		static inline const TReal clampRate( const TReal rate );
+
+	private:
+
+		//clip tables
+		std::vector< Clip > clips_;
+		std::vector< TRect > frameRects_;
+		std::vector< TPoint > registrationPoints_;
+
+		//packed instance data, indexed by dense index
+		std::vector< unsigned long > clipIDs_;
+		std::vector< unsigned long > startTimes_;
+		std::vector< TReal > rates_;
+		std::vector< unsigned long > frames_;
+		std::vector< unsigned long > instanceIDs_;
+
+		//instance ID to dense index, MAX_UNSIGN_LONG for free slots
+		std::vector< unsigned long > denseIndices_;
+		std::vector< unsigned long > freeInstanceIDs_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t AnimationSystem::getClipCount()const
+	{
+		return clips_.size();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long AnimationSystem::getClipFrameCount( const unsigned long clipID )const
+	{
+		assert( clipID < clips_.size() );
+		return clips_[ clipID ].frameCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void AnimationSystem::setClip( const unsigned long instanceID,
+			const unsigned long clipID,
+			const unsigned long startTime )
+	{
+		assert( clipID < clips_.size() );
+		const unsigned long index( getDenseIndex( instanceID ) );
+		clipIDs_[ index ] = clipID;
+		startTimes_[ index ] = startTime;
+		frames_[ index ] = clips_[ clipID ].tableOffset_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void AnimationSystem::setRate( const unsigned long instanceID, const TReal rate )
+	{
+		rates_[ getDenseIndex( instanceID ) ] = clampRate( rate );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void AnimationSystem::restart( const unsigned long instanceID, const unsigned long startTime )
+	{
+		startTimes_[ getDenseIndex( instanceID ) ] = startTime;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t AnimationSystem::getInstanceCount()const
+	{
+		return clipIDs_.size();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long AnimationSystem::getFrame( const unsigned long instanceID )const
+	{
+		const unsigned long index( getDenseIndex( instanceID ) );
+		return frames_[ index ] - clips_[ clipIDs_[ index ] ].tableOffset_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TRect& AnimationSystem::getFrameRect( const unsigned long instanceID )const
+	{
+		return frameRects_[ frames_[ getDenseIndex( instanceID ) ] ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TPoint& AnimationSystem::getRegistrationPoint( const unsigned long instanceID )const
+	{
+		return registrationPoints_[ frames_[ getDenseIndex( instanceID ) ] ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long AnimationSystem::getDenseIndex( const unsigned long instanceID )const
+	{
+		assert( instanceID < denseIndices_.size() );
+		assert( MAX_UNSIGN_LONG != denseIndices_[ instanceID ] );
+		return denseIndices_[ instanceID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal AnimationSystem::clampRate( const TReal rate )
+	{
+		return rate > 0 ? rate : 0;
+	}
+
+	//-------------------------------------------------------------------------
+}
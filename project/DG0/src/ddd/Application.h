@@ -6,6 +6,12 @@
 #include "boost/serialization/singleton.hpp"
 #include "ddd/ILua.h"
 #include "ddd/Container.h"
+#include "ddd/AssetPreloader.h"
+#include "ddd/HiscoreClient.h"
+#include "ddd/MetricsLog.h"
+#include "ddd/ScriptBundle.h"
+#include "ddd/ScriptCache.h"
+#include "ddd/StartupProfiler.h"
 
 class TPlatform;
 
@@ -40,6 +46,85 @@ namespace ddd
 				const unsigned long gameID, 
 				const unsigned long levelID );
 
+		//Lua: level description calls, also recorded by LevelCompiler
+		void setTileGrid( const unsigned long columns,
+				const unsigned long rows,
+				const unsigned long tileSize,
+				TLuaTable* tiles,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		void addWave( const unsigned long time,
+				str actorType,
+				const unsigned long count,
+				const unsigned long interval,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		//Lua: builds the level from CompiledLevel::getFileName, false if
+		//there is no valid compiled file, or it is older than the
+		//description script, and the description has to run
+		bool loadCompiledLevel( const unsigned long gameID, const unsigned long levelID );
+		//Lua: the actor's progress bar, progress 0..1 anchored at x, y
+		void setProgress( const unsigned long actorID,
+				const TReal progress,
+				const TReal x,
+				const TReal y,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		void removeProgress( const unsigned long actorID,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		//Lua: what the actor is drawn as and where, see
+		//RenderLevelComponent::addActor for the Actor table fields
+		void setActorAnimation( const unsigned long actorID,
+				str animationName,
+				const unsigned long msPerFrame,
+				const bool loop,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		void setActorFx( const unsigned long actorID,
+				str spec,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		void setActorPosition( const unsigned long actorID,
+				const TReal x,
+				const TReal y,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		void setActorLayer( const unsigned long actorID,
+				const long layer,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		//Lua: the layer's actors are drawn by ascending y
+		void setLayerYSorted( const long layer,
+				const bool ySorted,
+				const unsigned long gameID,
+				const unsigned long levelID );
+
+		inline AssetPreloader& getAssetPreloader();
+		inline StartupProfiler& getStartupProfiler();
+		//for Lua strings and scripts the UI runs again and again
+		inline ScriptCache& getScriptCache();
+		inline HiscoreClient& getHiscoreClient();
+		//game thread only
+		inline MetricsLog& getMetrics();
+
+		//Lua: start loading a manifest; progress goes to onAssetProgress
+		bool preloadAssets( str manifest );
+		void releaseAssets( str manifest );
+		bool isAssetsLoaded( str manifest );
+
+		//Lua: level snapshots, see LevelSnapshot. rewindLevel goes ms of
+		//level time back; suspendLevel and resumeLevel keep the level in
+		//a file, so it can go on in the next run
+		bool rewindLevel( const unsigned long ms,
+				const unsigned long gameID,
+				const unsigned long levelID );
+		bool suspendLevel( const unsigned long gameID, const unsigned long levelID );
+		bool resumeLevel( const unsigned long gameID, const unsigned long levelID );
+
+		//Lua: per-wave and per-level figures for the metrics log
+		void recordMetric( str name, const long value );
+
 	protected:
 
 		void initGameStates();
@@ -51,8 +136,19 @@ namespace ddd
 	private:
 		
 		void initApplication( TLuaTable* luaTable );
+
+		static void onAssetProgress( void* owner,
+				const std::string& manifest,
+				const unsigned long loaded,
+				const unsigned long total );
 		
 		Factory* factory_;
+		AssetPreloader assetPreloader_;
+		ScriptBundle scriptBundle_;
+		StartupProfiler startupProfiler_;
+		ScriptCache scriptCache_;
+		HiscoreClient hiscoreClient_;
+		MetricsLog metrics_;
 	};
 
 	//-------------------------------------------------------------------------
@@ -77,4 +173,39 @@ namespace ddd
 	}
 
 	//-------------------------------------------------------------------------
+
+	inline AssetPreloader& Application::getAssetPreloader()
+	{
+		return assetPreloader_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline StartupProfiler& Application::getStartupProfiler()
+	{
+		return startupProfiler_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline ScriptCache& Application::getScriptCache()
+	{
+		return scriptCache_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline HiscoreClient& Application::getHiscoreClient()
+	{
+		return hiscoreClient_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline MetricsLog& Application::getMetrics()
+	{
+		return metrics_;
+	}
+
+	//-------------------------------------------------------------------------
 }
\ No newline at end of file
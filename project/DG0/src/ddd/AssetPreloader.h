@@ -0,0 +1,143 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <pf/texture.h>
+#include <pf/animatedtexture.h>
+#include <pf/sound.h>
+#include "boost/noncopyable.hpp"
+#include "ddd/Types.h"
+#include "ddd/WorkerPool.h"
+
+namespace ddd
+{
+	//Loads the assets listed in a manifest ahead of use.
+	//Worker threads read the files into memory; the main thread hands
+	//the bytes to Playground as memory files and creates the textures
+	//and sounds in slices of at most the update budget per call.
+	//The created refs stay alive until the manifest is released, so
+	//later Get calls for the same names hit the Playground cache.
+	//
+	//A manifest is a text file with one asset per line:
+	//	texture backgrounds/game_back
+	//	animation anim/cardinal
+	//	sound audio/sfx/buttonclick
+	//Names are given as the game passes them to Get; blank lines and
+	//lines starting with # are skipped.
+	class AssetPreloader
+		: private boost::noncopyable
+	{
+	public:
+		enum AssetType
+		{
+			AT_TEXTURE = 0,
+			AT_ANIMATION,
+			AT_SOUND,
+			AT_COUNT
+		};
+
+		//called on the main thread whenever a manifest made progress
+		typedef void ( *ProgressCallback )( void* owner,
+				const std::string& manifest,
+				const unsigned long loaded,
+				const unsigned long total );
+
+		AssetPreloader();
+		~AssetPreloader();
+
+		void start( const unsigned long threadCount = 2 );
+		void stop();
+
+		inline const bool isStarted()const;
+		inline void setProgressCallback( ProgressCallback callback, void* owner );
+
+		//returns false when the manifest can't be read; preloading a
+		//manifest that is already loaded or loading does nothing
+		const bool preload( const std::string& manifest );
+		void release( const std::string& manifest );
+		void releaseAll();
+
+		const bool isLoaded( const std::string& manifest )const;
+		const unsigned long getLoadedCount( const std::string& manifest )const;
+		const unsigned long getTotalCount( const std::string& manifest )const;
+		inline const bool isLoading()const;
+
+		//main thread; creates ready assets until budget ms are spent
+		void update( const unsigned long budget );
+
+	private:
+
+		class Task;
+
+		struct File
+		{
+			std::string name_;
+			std::string path_;
+			std::vector< char > data_;
+		};
+
+		struct Asset
+		{
+			AssetType type_;
+			std::string name_;
+			std::vector< File > files_;
+			//set by the worker once files_ hold their data
+			volatile long read_;
+		};
+
+		struct Batch
+		{
+			std::vector< Asset* > assets_;
+			unsigned long loaded_;
+			std::vector< TTextureRef > textures_;
+			std::vector< TAnimatedTextureRef > animations_;
+			std::vector< TSoundRef > sounds_;
+		};
+
+		typedef std::map< std::string, Batch* > Batches;
+
+		const bool readManifest( const std::string& manifest, Batch& batch )const;
+		void addFiles( Asset& asset )const;
+		static const bool addFile( Asset& asset,
+				const std::string& name,
+				const std::string& base,
+				const char* const* extensions );
+		void read( Asset* asset );
+		void create( Batch& batch, Asset& asset );
+		void releaseBatch( Batch* batch );
+
+	private:
+
+		Batches batches_;
+		unsigned long loadingCount_;
+		WorkerPool workers_;
+		Task* task_;
+		ProgressCallback callback_;
+		void* callbackOwner_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool AssetPreloader::isStarted()const
+	{
+		return 0 != task_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void AssetPreloader::setProgressCallback( ProgressCallback callback, void* owner )
+	{
+		callback_ = callback;
+		callbackOwner_ = owner;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool AssetPreloader::isLoading()const
+	{
+		return 0 != loadingCount_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include <pf/pftypes.h>
+#include "boost/noncopyable.hpp"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Read only view of a level compiled by LevelCompiler, mapped straight
+	//from the file. All fields are little endian 32 bit words:
+	//	Header
+	//	ActorRecord[ actorCount_ ]
+	//	uint16_t tiles[ tileColumns_ * tileRows_ ], padded to 4 bytes
+	//	WaveRecord[ waveCount_ ]
+	//	string pool of zero terminated strings
+	//String fields are byte offsets into the pool. The checksum is the
+	//Adler-32 of everything after the header; sourceHash_ is the one of
+	//the description script the level was compiled from, so a file left
+	//behind by an edit to the script is turned down.
+	class CompiledLevel
+		: private boost::noncopyable
+	{
+	public:
+		//"DDDL"
+		static const uint32_t MAGIC = 0x4C444444;
+		//bump whenever a record changes
+		static const uint32_t VERSION = 2;
+		//the level descriptions, run by LevelCompiler and Level:onInit
+		static const char* const DESCRIPTION_SCRIPT;
+
+		struct Header
+		{
+			uint32_t magic_;
+			uint32_t version_;
+			uint32_t checksum_;
+			uint32_t sourceHash_;
+			uint32_t size_;
+			uint32_t gameID_;
+			uint32_t levelID_;
+			uint32_t actorOffset_;
+			uint32_t actorCount_;
+			uint32_t tileOffset_;
+			uint32_t tileColumns_;
+			uint32_t tileRows_;
+			uint32_t tileSize_;
+			uint32_t waveOffset_;
+			uint32_t waveCount_;
+			uint32_t stringOffset_;
+			uint32_t stringSize_;
+		};
+
+		struct ActorRecord
+		{
+			uint32_t id_;
+			uint32_t type_;
+		};
+
+		struct WaveRecord
+		{
+			uint32_t time_;
+			uint32_t type_;
+			uint32_t count_;
+			uint32_t interval_;
+		};
+
+		CompiledLevel();
+		~CompiledLevel();
+
+		//false if the file is missing, truncated, from another schema
+		//version or fails the checksum
+		const bool open( const char* fileName );
+		void close();
+
+		inline const bool isOpen()const;
+		inline const Header& getHeader()const;
+
+		inline const unsigned long getActorCount()const;
+		inline const ActorRecord* getActors()const;
+		inline const uint16_t* getTiles()const;
+		inline const unsigned long getWaveCount()const;
+		inline const WaveRecord* getWaves()const;
+		inline const char* getString( const uint32_t offset )const;
+
+		//the resource the game looks for, e.g. "levels/level_0_0.lvl"
+		static const std::string getFileName( const unsigned long gameID, const unsigned long levelID );
+		static const uint32_t checksum( const char* data, const unsigned long size );
+		//checksum of the script's source on disk; false if the script is
+		//only in a mounted ScriptBundle or can't be read
+		static const bool hashSource( const char* script, uint32_t& hash );
+
+	private:
+
+		struct Impl;
+
+		const bool validate( const unsigned long size )const;
+
+	private:
+
+		Impl* impl_;
+		const char* data_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool CompiledLevel::isOpen()const
+	{
+		return 0 != data_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const CompiledLevel::Header& CompiledLevel::getHeader()const
+	{
+		assert( isOpen() );
+		return *reinterpret_cast< const Header* >( data_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long CompiledLevel::getActorCount()const
+	{
+		return getHeader().actorCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const CompiledLevel::ActorRecord* CompiledLevel::getActors()const
+	{
+		return reinterpret_cast< const ActorRecord* >( data_ + getHeader().actorOffset_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const uint16_t* CompiledLevel::getTiles()const
+	{
+		return reinterpret_cast< const uint16_t* >( data_ + getHeader().tileOffset_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long CompiledLevel::getWaveCount()const
+	{
+		return getHeader().waveCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const CompiledLevel::WaveRecord* CompiledLevel::getWaves()const
+	{
+		return reinterpret_cast< const WaveRecord* >( data_ + getHeader().waveOffset_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const char* CompiledLevel::getString( const uint32_t offset )const
+	{
+		assert( offset < getHeader().stringSize_ );
+		return data_ + getHeader().stringOffset_ + offset;
+	}
+
+	//-------------------------------------------------------------------------
+}
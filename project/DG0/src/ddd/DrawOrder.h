@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vector>
+#include <pf/pftypes.h>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	class SnapshotReader;
+	class SnapshotWriter;
+
+	//Draw order of level items by layer, lowest layer first.
+	//Items live in one bucket per layer, so adding, removing or moving an
+	//item touches only its bucket and nothing is re-sorted; removal leaves
+	//a hole that is compacted on the next rebuild, which keeps the order
+	//within a layer stable. The flat draw list is rebuilt only when a
+	//bucket changed.
+	//A layer can be y-sorted for the pseudo-isometric view: its items are
+	//drawn by ascending y, ties keeping their previous order, with a radix
+	//sort over packed keys whenever one of their y values changed.
+	class DrawOrder
+	{
+	public:
+
+		DrawOrder();
+		~DrawOrder();
+
+		//items interface
+		const unsigned long addItem( const long layer, const TReal y = 0 );
+		void removeItem( const unsigned long itemID );
+		void removeAllItems();
+		void setLayer( const unsigned long itemID, const long layer );
+		inline void setY( const unsigned long itemID, const TReal y );
+		inline const long getLayer( const unsigned long itemID )const;
+		inline const TReal getY( const unsigned long itemID )const;
+		inline const size_t getItemCount()const;
+
+		//layers interface
+		void setYSorted( const long layer, const bool ySorted );
+		const bool isYSorted( const long layer )const;
+
+		//item IDs, back to front
+		const std::vector< unsigned long >& getDrawList();
+
+		void release();
+
+		//snapshot interface, see LevelSnapshot
+		void save( SnapshotWriter& writer )const;
+		//false, and no items left, if the data doesn't fit
+		const bool load( SnapshotReader& reader );
+
+	private:
+
+		struct Bucket
+		{
+			long layer_;
+			bool ySorted_;
+			//the bucket's items or its draw order changed
+			bool dirty_;
+			unsigned long holes_;
+			//item IDs, MAX_UNSIGN_LONG for removed ones
+			std::vector< unsigned long > items_;
+		};
+
+		const unsigned long getBucket( const long layer );
+		const unsigned long findBucket( const long layer )const;
+		void insert( const unsigned long itemID, const unsigned long bucket );
+		void erase( const unsigned long itemID );
+		void compact( Bucket& bucket );
+		void sortByY( Bucket& bucket );
+		inline const bool isItem( const unsigned long itemID )const;
+
+	private:
+
+		//sorted by layer
+		std::vector< Bucket > buckets_;
+
+		//item tables, indexed by item ID
+		std::vector< long > layers_;
+		std::vector< TReal > ys_;
+		std::vector< unsigned long > slots_;
+		std::vector< unsigned char > used_;
+		std::vector< unsigned long > freeItemIDs_;
+		size_t itemCount_;
+
+		std::vector< unsigned long > drawList_;
+		bool drawListDirty_;
+
+		//radix sort scratch
+		std::vector< uint32_t > keys_;
+		std::vector< uint32_t > sortedKeys_;
+		std::vector< unsigned long > sortedItems_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline void DrawOrder::setY( const unsigned long itemID, const TReal y )
+	{
+		assert( isItem( itemID ) );
+		if ( ys_[ itemID ] == y )
+		{
+			return;
+		}
+		ys_[ itemID ] = y;
+
+		Bucket& bucket( buckets_[ findBucket( layers_[ itemID ] ) ] );
+		if ( bucket.ySorted_ && !bucket.dirty_ )
+		{
+			bucket.dirty_ = true;
+			drawListDirty_ = true;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const long DrawOrder::getLayer( const unsigned long itemID )const
+	{
+		assert( isItem( itemID ) );
+		return layers_[ itemID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal DrawOrder::getY( const unsigned long itemID )const
+	{
+		assert( isItem( itemID ) );
+		return ys_[ itemID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t DrawOrder::getItemCount()const
+	{
+		return itemCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool DrawOrder::isItem( const unsigned long itemID )const
+	{
+		return itemID < used_.size() && 0 != used_[ itemID ];
+	}
+
+	//-------------------------------------------------------------------------
+}
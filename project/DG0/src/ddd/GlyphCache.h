@@ -0,0 +1,202 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <pf/pflib.h>
+#include "boost/noncopyable.hpp"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//A run of text laid out in pixels from its top left corner. Only
+	//glyphs that draw something get a quad; spaces just move the pen.
+	struct TextLayout
+	{
+		struct Quad
+		{
+			unsigned long codepoint_;
+			TReal x_;
+			TReal y_;
+		};
+
+		struct Line
+		{
+			//range in quads_
+			size_t first_;
+			size_t count_;
+			TReal width_;
+		};
+
+		std::vector< Quad > quads_;
+		std::vector< Line > lines_;
+		TReal width_;
+		TReal height_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	//Glyphs of one font and size, each rasterized once by TTextGraphic
+	//into alpha atlas pages of PAGE_SIZE squared, and the layouts of the
+	//strings drawn with them, memoized by string and wrap width.
+	//Images can be copied into the same pages, and every page starts with
+	//a small solid white square for flat colored quads, so a HUD can draw
+	//its text, icons and bars from one texture.
+	//Rasterizing renders to a texture, which Playground does not allow
+	//inside a Draw(): prepare(), layout() and addImage() have to be called
+	//from update code, the getters are safe anywhere.
+	class GlyphCache
+		: private boost::noncopyable
+	{
+	public:
+		static const unsigned long PAGE_SIZE = 512;
+		//layouts kept before the cache starts over
+		static const unsigned long MAX_LAYOUTS = 256;
+		static const unsigned long NO_PAGE = MAX_UNSIGN_LONG;
+		//side of the white square at the top left of every page
+		static const unsigned long SOLID_SIZE = 4;
+		//quads one indexed draw can take with 16 bit indices
+		static const unsigned long MAX_BATCH_QUADS = 4096;
+
+		struct Glyph
+		{
+			//NO_PAGE for glyphs that draw nothing
+			unsigned long page_;
+			TVec2 uv0_;
+			TVec2 uv1_;
+			TReal width_;
+			TReal height_;
+			TReal advance_;
+		};
+
+		//the shared cache of a font and size, created on first use
+		static GlyphCache& get( const std::string& font, const unsigned long lineHeight );
+		//drops every cache with its pages; layouts handed out go with them
+		static void releaseAll();
+
+		GlyphCache( const std::string& font, const unsigned long lineHeight );
+		~GlyphCache();
+
+		//rasterizes the glyphs of text, UTF-8, that are not cached yet
+		void prepare( const std::string& text );
+		//text broken at '\n' and, when width is not 0, wrapped at the
+		//last space before width; valid until the next layout() call
+		const TextLayout& layout( const std::string& text, const unsigned long width = 0 );
+
+		//copies the image asset into the pages under its own name; false
+		//if it can't be loaded or is larger than a page
+		const bool addImage( const std::string& name );
+
+		//true if every glyph of text is rasterized, so laying it out
+		//renders nothing
+		const bool isPrepared( const std::string& text )const;
+		//0 for a glyph that has not been prepared
+		inline const Glyph* findGlyph( const unsigned long codepoint )const;
+		//0 for an image that has not been added
+		inline const Glyph* findImage( const std::string& name )const;
+		//texture coordinate inside the solid white square of any page
+		inline const TVec2 getSolidUV()const;
+		inline TTextureRef getPage( const unsigned long page )const;
+		inline const unsigned long getPageCount()const;
+		inline const unsigned long getLineHeight()const;
+		inline const std::string& getFont()const;
+
+		//UTF-8 decoding: the codepoint at text[ index ], index moved past it
+		static const unsigned long nextCodepoint( const std::string& text, size_t& index );
+		//MAX_BATCH_QUADS quads of two triangles each, quad i being
+		//vertices 4i to 4i + 3 clockwise from the top left
+		static uint16_t* getQuadIndices();
+
+	private:
+
+		typedef std::map< unsigned long, Glyph > Glyphs;
+		typedef std::map< std::string, Glyph > Images;
+		typedef std::map< std::pair< std::string, unsigned long >, TextLayout > Layouts;
+		typedef std::map< std::pair< std::string, unsigned long >, GlyphCache* > Caches;
+
+		void rasterize( const unsigned long codepoint, const std::string& character );
+		const TReal measure( const std::string& text );
+		//finds room for a width x height cell, adding a page if needed
+		const bool allocate( const unsigned long width,
+				const unsigned long height,
+				unsigned long& x,
+				unsigned long& y );
+		const bool addPage();
+
+	private:
+
+		static Caches caches_;
+
+		std::string font_;
+		unsigned long lineHeight_;
+		//rasterized cell height, descenders included
+		unsigned long cellHeight_;
+		Glyphs glyphs_;
+		Images images_;
+		Layouts layouts_;
+		std::vector< TTextureRef > pages_;
+		//shelf packing of the last page
+		unsigned long penX_;
+		unsigned long penY_;
+		unsigned long shelfHeight_;
+		//reused for measuring and rasterizing
+		TTextGraphic* graphic_;
+		//right edge of ADVANCE_PROBE drawn alone
+		long probeRight_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const GlyphCache::Glyph* GlyphCache::findGlyph( const unsigned long codepoint )const
+	{
+		Glyphs::const_iterator it( glyphs_.find( codepoint ) );
+		return glyphs_.end() != it ? &it->second : 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const GlyphCache::Glyph* GlyphCache::findImage( const std::string& name )const
+	{
+		Images::const_iterator it( images_.find( name ) );
+		return images_.end() != it ? &it->second : 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TVec2 GlyphCache::getSolidUV()const
+	{
+		const TReal center( static_cast< TReal >( SOLID_SIZE ) / ( 2 * PAGE_SIZE ) );
+		return TVec2( center, center );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline TTextureRef GlyphCache::getPage( const unsigned long page )const
+	{
+		assert( page < pages_.size() );
+		return pages_[ page ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long GlyphCache::getPageCount()const
+	{
+		return static_cast< unsigned long >( pages_.size() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long GlyphCache::getLineHeight()const
+	{
+		return lineHeight_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const std::string& GlyphCache::getFont()const
+	{
+		return font_;
+	}
+
+	//-------------------------------------------------------------------------
+}
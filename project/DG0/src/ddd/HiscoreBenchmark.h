@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Load test of HiscoreClient against a HiscoreStandIn: queues
+	//thousands of scores and medals for a few hundred players, then runs
+	//the client until the queue has drained into the stand-in, which
+	//turns every tenth request away to make the client retry.
+	//Reports how long queueing and draining took and how far the
+	//submissions coalesced into requests.
+	class HiscoreBenchmark
+	{
+	public:
+		//ms the queue gets to drain before the run counts as failed
+		static const unsigned long DRAIN_TIMEOUT = 120 * 1000;
+
+		HiscoreBenchmark( const unsigned long submissions = 5000, const unsigned long players = 250 );
+
+		//false if the stand-in could not start or the queue did not drain
+		const bool run();
+		//comma separated, one header line, one line per figure
+		const bool write( const char* fileName )const;
+
+	private:
+
+		unsigned long submissions_;
+		unsigned long players_;
+
+		double queueSeconds_;
+		double drainSeconds_;
+		unsigned long coalesced_;
+		unsigned long requests_;
+		unsigned long retries_;
+		unsigned long accepted_;
+		unsigned long serverRequests_;
+		unsigned long serverFailures_;
+		unsigned long serverEntries_;
+	};
+}
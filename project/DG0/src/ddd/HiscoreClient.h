@@ -0,0 +1,218 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "boost/noncopyable.hpp"
+#include "ddd/Types.h"
+
+class TSimpleHttp;
+
+namespace ddd
+{
+	//Score and medal submissions that never make the UI wait.
+	//submitScore() and submitMedal() only queue; update(), run from an
+	//anim task, coalesces what is queued per player and posts it with
+	//TSimpleHttp, polling the requests instead of blocking on them.
+	//A player's scores for one game mode collapse into the best one and
+	//a medal is sent once, so a session of games is one request.
+	//Failed requests go back into the queue and are retried after a delay
+	//doubling from RETRY_DELAY up to MAX_RETRY_DELAY. The queue is kept
+	//in an outbox file, so what could not be sent goes out next run.
+	//
+	//Requests are form posts: player, count, and for each entry i kind<i>
+	//("score" or "medal"), mode<i> and value<i>, the score or the medal
+	//name. A reply starting with "ok" accepts the batch, one starting
+	//with "reject" drops it, anything else or no reply is retried.
+	//Passwords stay in memory and are never written to the outbox.
+	class HiscoreClient
+		: private boost::noncopyable
+	{
+	public:
+		//requests in flight at once
+		static const unsigned long MAX_REQUESTS = 4;
+		//entries posted in one request
+		static const unsigned long MAX_BATCH = 32;
+		//ms
+		static const unsigned long RETRY_DELAY = 1000;
+		static const unsigned long MAX_RETRY_DELAY = 5 * 60 * 1000;
+		//ms a request may wait for its reply before it counts as failed
+		static const unsigned long REQUEST_TIMEOUT = 30 * 1000;
+		//ms between outbox writes while the queue keeps changing
+		static const unsigned long SAVE_DELAY = 2000;
+
+		HiscoreClient();
+		~HiscoreClient();
+
+		//an empty url keeps everything queued in the outbox
+		void start( const std::string& url, const std::string& outbox );
+		//writes the outbox; requests in flight are sent again next run
+		void stop();
+
+		inline const bool isStarted()const;
+		//false while submissions only go to the outbox
+		inline const bool hasUrl()const;
+		//nothing queued and nothing in flight
+		inline const bool isIdle()const;
+
+		void submitScore( const std::string& player,
+				const std::string& password,
+				const std::string& mode,
+				const long score );
+		void submitMedal( const std::string& player,
+				const std::string& password,
+				const std::string& mode,
+				const std::string& medal );
+
+		void update();
+
+		inline const unsigned long getQueuedCount()const;
+		inline const unsigned long getSubmitted()const;
+		inline const unsigned long getCoalesced()const;
+		inline const unsigned long getRequests()const;
+		inline const unsigned long getRetries()const;
+		inline const unsigned long getAccepted()const;
+		inline const unsigned long getRejected()const;
+
+	private:
+
+		class Task;
+
+		enum Kind
+		{
+			K_SCORE = 0,
+			K_MEDAL
+		};
+
+		struct Entry
+		{
+			Kind kind_;
+			std::string mode_;
+			//score or medal name
+			std::string value_;
+		};
+
+		struct Player
+		{
+			std::string password_;
+			std::vector< Entry > entries_;
+			//failed requests in a row
+			unsigned long failures_;
+			//tick count before which nothing is sent
+			unsigned long retryAt_;
+			bool inFlight_;
+		};
+
+		struct Request
+		{
+			TSimpleHttp* http_;
+			std::string player_;
+			std::vector< Entry > entries_;
+			unsigned long sentAt_;
+		};
+
+		typedef std::map< std::string, Player > Players;
+
+		void add( const std::string& player, const std::string& password, const Entry& entry );
+		//false if entry folded into one the player already has
+		const bool merge( Player& player, const Entry& entry );
+		void send( const unsigned long now );
+		void poll( const unsigned long now );
+		void finish( Request& request, const unsigned long now, const bool sent );
+		const bool load();
+		const bool save();
+
+	private:
+
+		std::string url_;
+		std::string outbox_;
+		Players players_;
+		std::vector< Request > requests_;
+		//players in the order they got something to send
+		std::deque< std::string > order_;
+		unsigned long queuedCount_;
+		bool dirty_;
+		unsigned long savedAt_;
+		Task* task_;
+
+		unsigned long submitted_;
+		unsigned long coalesced_;
+		unsigned long requestCount_;
+		unsigned long retries_;
+		unsigned long accepted_;
+		unsigned long rejected_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool HiscoreClient::isStarted()const
+	{
+		return 0 != task_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool HiscoreClient::hasUrl()const
+	{
+		return !url_.empty();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool HiscoreClient::isIdle()const
+	{
+		return 0 == queuedCount_ && requests_.empty();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HiscoreClient::getQueuedCount()const
+	{
+		return queuedCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HiscoreClient::getSubmitted()const
+	{
+		return submitted_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HiscoreClient::getCoalesced()const
+	{
+		return coalesced_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HiscoreClient::getRequests()const
+	{
+		return requestCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HiscoreClient::getRetries()const
+	{
+		return retries_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HiscoreClient::getAccepted()const
+	{
+		return accepted_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HiscoreClient::getRejected()const
+	{
+		return rejected_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <pf/pftypes.h>
+#include "boost/noncopyable.hpp"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//A hiscore server on the loopback interface, enough to drive
+	//HiscoreClient without the network: one thread accepts connections,
+	//reads a form post and answers "ok", or a 503 for every failEvery-th
+	//request so retries get exercised. It keeps count of what came in
+	//and stores nothing.
+	//Winsock stays out of this header, as Win32 does for WorkerPool.
+	class HiscoreStandIn
+		: private boost::noncopyable
+	{
+	public:
+		HiscoreStandIn();
+		~HiscoreStandIn();
+
+		//port 0 takes any free one; false if the socket can't be opened
+		const bool start( const unsigned short port = 0, const unsigned long failEvery = 0 );
+		void stop();
+
+		inline const bool isStarted()const;
+		inline const unsigned short getPort()const;
+		//what HiscoreClient::start takes
+		const std::string getUrl()const;
+
+		const unsigned long getRequests()const;
+		const unsigned long getFailures()const;
+		//entries of the requests answered "ok"
+		const unsigned long getEntries()const;
+
+	private:
+
+		struct Impl;
+
+		static unsigned int __stdcall threadProc( void* param );
+		void run();
+		void serve( const uintptr_t connection );
+
+	private:
+
+		Impl* impl_;
+		unsigned short port_;
+		bool started_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool HiscoreStandIn::isStarted()const
+	{
+		return started_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned short HiscoreStandIn::getPort()const
+	{
+		return port_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <pf/vertexset.h>
+#include "boost/noncopyable.hpp"
+#include "ddd/GlyphCache.h"
+
+namespace ddd
+{
+	//Immediate mode HUD: every frame the owner calls begin(), then one
+	//call per bar, icon or counter, then end(). Everything is quads on
+	//the pages of one GlyphCache, which holds the font, the images added
+	//with addImage() and a white square for flat bars, so the whole HUD
+	//usually goes out in a single indexed draw.
+	//Text whose glyphs are not in the atlas yet is skipped for the frame
+	//and rasterized by update(), which has to run outside Draw(); the
+	//digits are prepared by init() so counters never miss a frame.
+	class HudLayer
+		: private boost::noncopyable
+	{
+	public:
+
+		enum Align
+		{
+			ALIGN_LEFT,
+			ALIGN_CENTER,
+			ALIGN_RIGHT
+		};
+
+		HudLayer();
+		~HudLayer();
+
+		//not from inside a Draw()
+		void init( const std::string& font, const unsigned long fontSize );
+		const bool addImage( const std::string& name );
+		void update();
+		void release();
+
+		inline const bool isInited()const;
+
+		//inside a Draw()
+		void begin();
+		void image( const std::string& name, const TReal x, const TReal y, const TColor& color = TColor( 1, 1, 1, 1 ) );
+		void rect( const TReal x, const TReal y, const TReal width, const TReal height, const TColor& color );
+		//fraction, clamped to 0..1, of width filled from the left
+		void bar( const TReal x,
+				const TReal y,
+				const TReal width,
+				const TReal height,
+				const TReal fraction,
+				const TColor& fill,
+				const TColor& back );
+		//count bars of width x height, each centered above its anchor
+		//point; the arrays are parallel, as the logic component keeps them
+		void bars( const size_t count,
+				const TReal* xs,
+				const TReal* ys,
+				const TReal* fractions,
+				const TReal width,
+				const TReal height,
+				const TColor& fill,
+				const TColor& back );
+		//y is the top of the first line, x its left, center or right end
+		void text( const TReal x, const TReal y, const std::string& text, const TColor& color, const Align align = ALIGN_LEFT );
+		void number( const TReal x, const TReal y, const long number, const TColor& color, const Align align = ALIGN_LEFT );
+		void end();
+
+		//of the last frame
+		inline const unsigned long getQuadCount()const;
+		inline const unsigned long getDrawCount()const;
+
+	private:
+
+		void addQuad( const unsigned long page,
+				const TReal x0,
+				const TReal y0,
+				const TReal x1,
+				const TReal y1,
+				const TVec2& uv0,
+				const TVec2& uv1,
+				const TColor32& color );
+		void flush( const unsigned long page );
+
+	private:
+
+		GlyphCache* glyphs_;
+		//vertices per atlas page, four per quad
+		std::vector< std::vector< TTransformedLitVert > > batches_;
+		//text seen in Draw() before its glyphs were ready
+		std::vector< std::string > pending_;
+		unsigned long quadCount_;
+		unsigned long drawCount_;
+		unsigned long frameQuads_;
+		unsigned long frameDraws_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool HudLayer::isInited()const
+	{
+		return 0 != glyphs_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HudLayer::getQuadCount()const
+	{
+		return quadCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long HudLayer::getDrawCount()const
+	{
+		return drawCount_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Times loading a generated level of actorCount_ actors, tileColumns_ x
+	//tileRows_ tiles and waveCount_ waves through its Lua description and
+	//through its CompiledLevel file. Both paths stop at the actor tables:
+	//creating the C++ actors and running Actor:onInit costs the same on
+	//either path and is left out.
+	class LevelBenchmark
+	{
+	public:
+
+		struct Result
+		{
+			//"lua" or "compiled"
+			std::string path_;
+			double seconds_;
+			//size of the description source or of the compiled file
+			unsigned long bytes_;
+		};
+
+		LevelBenchmark( const unsigned long actorCount = 2000,
+				const unsigned long iterations = 20 );
+
+		//false if the generated level could not be written or compiled
+		const bool run();
+
+		inline const std::vector< Result >& getResults()const;
+		//comma separated, one header line then one line per path
+		const bool write( const char* fileName )const;
+
+	private:
+
+		const std::string generate()const;
+		void add( const char* path, const double start, const unsigned long bytes );
+
+	private:
+
+		std::vector< Result > results_;
+		unsigned long actorCount_;
+		unsigned long iterations_;
+		unsigned long tileColumns_;
+		unsigned long tileRows_;
+		unsigned long waveCount_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const std::vector< LevelBenchmark::Result >& LevelBenchmark::getResults()const
+	{
+		return results_;
+	}
+
+	//-------------------------------------------------------------------------
+}
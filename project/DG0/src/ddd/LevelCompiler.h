@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <pf/pftypes.h>
+#include "ddd/Types.h"
+#include "ddd/LogicLevelComponent.h"
+
+struct lua_State;
+
+namespace ddd
+{
+	//Turns the Lua level descriptions into CompiledLevel files.
+	//The description script fills levelDescriptions[ gameID ][ levelID ]
+	//with functions taking ( gameID, levelID ); each one is run against
+	//recording versions of createActor, setTileGrid and addWave.
+	class LevelCompiler
+	{
+	public:
+
+		struct ActorEntry
+		{
+			unsigned long id_;
+			std::string type_;
+		};
+
+		struct Level
+		{
+			unsigned long gameID_;
+			unsigned long levelID_;
+			//CompiledLevel::hashSource of the script it came from
+			uint32_t sourceHash_;
+			std::vector< ActorEntry > actors_;
+			unsigned long tileColumns_;
+			unsigned long tileRows_;
+			unsigned long tileSize_;
+			std::vector< uint16_t > tiles_;
+			std::vector< LevelWave > waves_;
+		};
+
+		//false if the script can't be hashed, or it or one of its
+		//descriptions fails
+		const bool run( const char* script );
+		inline const std::vector< Level >& getLevels()const;
+
+		//writes each level to CompiledLevel::getFileName under the asset
+		//folder the script was found in; returns the number written
+		const unsigned long writeAll( const char* script )const;
+
+		//path is a native file name
+		static const bool write( const Level& level, const char* path );
+		static void build( const Level& level, std::vector< char >& image );
+
+	private:
+
+		static int recordActor( lua_State* L );
+		static int recordTileGrid( lua_State* L );
+		static int recordWave( lua_State* L );
+		static Level& getRecordedLevel( lua_State* L );
+
+	private:
+
+		std::vector< Level > levels_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const std::vector< LevelCompiler::Level >& LevelCompiler::getLevels()const
+	{
+		return levels_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+#include <pf/pftypes.h>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	class LevelWindow;
+
+	//The state of a running level as one flat blob: the actors' Lua
+	//tables, the logic and render components, the picking items, the
+	//level's random generator and its clock. Tables go in as whole
+	//blocks through SnapshotWriter and restore() rebuilds the actors the
+	//way Application::loadCompiledLevel does, so both take milliseconds
+	//even for thousands of actors. Clips, masks and textures belong to
+	//the level rather than to its state and are left as they are.
+	//Actor tables keep booleans, numbers, strings and nested tables with
+	//number or string keys. Functions come back from the Actor prototype,
+	//and a table met twice is only written the first time.
+	class LevelSnapshot
+	{
+	public:
+		//"DDDS"
+		static const uint32_t MAGIC = 0x53444444;
+		//bump whenever anything written changes
+		static const uint32_t VERSION = 5;
+		//actor tables nested deeper than this are left out
+		static const unsigned long MAX_DEPTH = 8;
+
+		LevelSnapshot();
+
+		//keeps the memory of the last capture, so taking snapshots
+		//over and over allocates nothing once it has grown
+		void capture( LevelWindow& level );
+		//false if empty, of another version or level, or broken; the
+		//level is only touched once the whole blob has parsed
+		const bool restore( LevelWindow& level )const;
+		void clear();
+
+		inline const bool isEmpty()const;
+		inline const size_t getSize()const;
+		//the level's clock when captured, ms
+		inline const unsigned long getTime()const;
+
+		//for suspend and resume across runs; the file carries an Adler-32
+		//of the snapshot
+		const bool save( const char* fileName )const;
+		const bool load( const char* fileName );
+
+	private:
+
+		struct Header
+		{
+			uint32_t magic_;
+			uint32_t version_;
+			uint32_t gameID_;
+			uint32_t levelID_;
+			uint32_t time_;
+		};
+
+	private:
+
+		std::vector< char > data_;
+		unsigned long time_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool LevelSnapshot::isEmpty()const
+	{
+		return data_.empty();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t LevelSnapshot::getSize()const
+	{
+		return data_.size();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long LevelSnapshot::getTime()const
+	{
+		return time_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -7,6 +7,11 @@
 
 #include "ddd/LogicLevelComponent.h"
 #include "ddd/RenderLevelComponent.h"
+#include "ddd/PickingGrid.h"
+#include "ddd/HudLayer.h"
+#include "ddd/LuaUtils.h"
+#include "ddd/SnapshotRing.h"
+#include <pf/random.h>
 
 namespace ddd
 {
@@ -18,6 +23,8 @@ namespace ddd
 	{
 		PFTYPEDEF_DC( LevelWindow, TWindow )
 
+		friend class LevelSnapshot;
+
 		//Enumerate level window standart components
 		enum ELevelWindowComponents
 		{
@@ -40,28 +47,95 @@ namespace ddd
 
 		void Draw();
 		virtual bool OnTaskAnimate();
+		//picks through the grid and calls the level's onMouseDown/onHover;
+		//every actor with an animation is a picking item over its frame
+		virtual bool OnMouseDown( const TPoint& point );
+		virtual bool OnMouseMove( const TPoint& point );
 
 		//logic level interface
 		inline void addActor( Actor& actor );
 		inline Actor& getActor( const unsigned long actorID );
 		inline const Actor& getActorConst( const unsigned long actorID );
 		inline void removeActor(  const unsigned long actorID  );
+		inline void reserveActors( const size_t count );
+		inline void setTileGrid( const unsigned long columns,
+				const unsigned long rows,
+				const unsigned long tileSize,
+				const uint16_t* tiles );
+		inline const unsigned long getTile( const unsigned long column, const unsigned long row )const;
+		inline void addWave( const LevelWave& wave );
+		inline const std::vector< LevelWave >& getWaves()const;
+		inline void setProgress( const unsigned long actorID,
+				const TReal progress,
+				const TReal x,
+				const TReal y );
+		inline void removeProgress( const unsigned long actorID );
 
 		inline const unsigned long getGameID()const;
 
+		//render level interface
+		inline void setActorAnimation( const unsigned long actorID,
+				const char* animationName,
+				const unsigned long msPerFrame,
+				const bool loop );
+		inline void setActorFx( const unsigned long actorID, const char* spec );
+		inline void setActorPosition( const unsigned long actorID, const Vec2& position );
+		inline void setActorLayer( const unsigned long actorID, const long layer );
+		inline AnimationSystem& getAnimationSystem();
+		inline TransformSystem& getTransformSystem();
+		inline DrawOrder& getDrawOrder();
+
+		//picking interface, the grid covers the client rect
+		inline PickingGrid& getPickingGrid();
+
+		//HUD drawn over the level, style keys hudfont and hudfontsize;
+		//not inited without a hudfont
+		inline HudLayer& getHudLayer();
+
+		//level clock, ms; stops with the level and goes back on a rewind
+		inline const unsigned long getTime();
+		//level logic draws from this one so snapshots bring it back too
+		inline TRandom& getRandom();
+		//a snapshot every SnapshotRing::INTERVAL ms, for rewinding
+		inline SnapshotRing& getSnapshots();
+
 		//lua object realization
 		virtual void onInit();
 		virtual void onRelease();
+
+	protected:
+
+		//the game's HUD widgets, drawn in the same batch as the
+		//progress bars after the level
+		virtual void drawHud( HudLayer& hud );
+
 	private:
 		
 		//Level window interface
 		inline LogicLevelComponent& getLogicComponent();
+		inline const LogicLevelComponent& getLogicComponent()const;
 		inline RenderLevelComponent& getRenderComponent();
 
+		void initPickingGrid();
+		//adds, moves or removes the actor's picking item to match it
+		void updateActorPick( const unsigned long actorID );
+		void removeActorPick( const unsigned long actorID );
+		void executePickFunction( const unsigned long functionID,
+				const TPoint& point,
+				const unsigned long itemID );
+
 	private:
 
 		LogicLevelComponent logicComponent_;
 		RenderLevelComponent renderComponent_;
+		PickingGrid pickingGrid_;
+		//actor ID to picking item and back, MAX_UNSIGN_LONG for none
+		std::vector< unsigned long > actorPickItems_;
+		std::vector< unsigned long > pickItemActors_;
+		HudLayer hudLayer_;
+		unsigned long hoverItemID_;
+		TRandom random_;
+		SnapshotRing snapshots_;
 	};
 
 	//-------------------------------------------------------------------------
@@ -73,6 +147,13 @@ namespace ddd
 
 	//-------------------------------------------------------------------------
 
+	inline const LogicLevelComponent& LevelWindow::getLogicComponent()const
+	{
+		return logicComponent_;
+	}
+
+	//-------------------------------------------------------------------------
+
 	inline RenderLevelComponent& LevelWindow::getRenderComponent()
 	{
 		return renderComponent_;
@@ -83,6 +164,9 @@ namespace ddd
 	inline void LevelWindow::addActor( Actor& actor )
 	{
 		getLogicComponent().addActor(actor);
+		const unsigned long actorID( getULong( actor.getLuaTable(), "ID_" ) );
+		getRenderComponent().addActor( actorID, actor.getLuaTable() );
+		updateActorPick( actorID );
 	}
 
 	//-------------------------------------------------------------------------
@@ -104,6 +188,157 @@ namespace ddd
 	inline void LevelWindow::removeActor(  const unsigned long actorID  )
 	{
 		getLogicComponent().removeActor(actorID);
+		getRenderComponent().removeActor( actorID );
+		removeActorPick( actorID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::reserveActors( const size_t count )
+	{
+		getLogicComponent().reserveActors( count );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::setTileGrid( const unsigned long columns,
+				const unsigned long rows,
+				const unsigned long tileSize,
+				const uint16_t* tiles )
+	{
+		getLogicComponent().setTileGrid( columns, rows, tileSize, tiles );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long LevelWindow::getTile( const unsigned long column, const unsigned long row )const
+	{
+		return getLogicComponent().getTile( column, row );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::addWave( const LevelWave& wave )
+	{
+		getLogicComponent().addWave( wave );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const std::vector< LevelWave >& LevelWindow::getWaves()const
+	{
+		return getLogicComponent().getWaves();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::setProgress( const unsigned long actorID,
+				const TReal progress,
+				const TReal x,
+				const TReal y )
+	{
+		getLogicComponent().setProgress( actorID, progress, x, y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::removeProgress( const unsigned long actorID )
+	{
+		getLogicComponent().removeProgress( actorID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::setActorAnimation( const unsigned long actorID,
+				const char* animationName,
+				const unsigned long msPerFrame,
+				const bool loop )
+	{
+		getRenderComponent().setActorAnimation( actorID, animationName, msPerFrame, loop );
+		updateActorPick( actorID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::setActorFx( const unsigned long actorID, const char* spec )
+	{
+		getRenderComponent().setActorFx( actorID, spec );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::setActorPosition( const unsigned long actorID, const Vec2& position )
+	{
+		getRenderComponent().setActorPosition( actorID, position );
+		updateActorPick( actorID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LevelWindow::setActorLayer( const unsigned long actorID, const long layer )
+	{
+		getRenderComponent().setActorLayer( actorID, layer );
+		updateActorPick( actorID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline AnimationSystem& LevelWindow::getAnimationSystem()
+	{
+		return getRenderComponent().getAnimationSystem();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline TransformSystem& LevelWindow::getTransformSystem()
+	{
+		return getRenderComponent().getTransformSystem();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline DrawOrder& LevelWindow::getDrawOrder()
+	{
+		return getRenderComponent().getDrawOrder();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline PickingGrid& LevelWindow::getPickingGrid()
+	{
+		if ( !pickingGrid_.isInited() )
+		{
+			initPickingGrid();
+		}
+		return pickingGrid_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline HudLayer& LevelWindow::getHudLayer()
+	{
+		return hudLayer_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long LevelWindow::getTime()
+	{
+		return getRenderComponent().getTime();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline TRandom& LevelWindow::getRandom()
+	{
+		return random_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline SnapshotRing& LevelWindow::getSnapshots()
+	{
+		return snapshots_;
 	}
 
 	//-------------------------------------------------------------------------
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <string>
 #include <vector>
+#include <pf/pftypes.h>
 
 #include "ddd/ILevelComponent.h"
 #include "ddd/Container.h"
@@ -9,6 +11,17 @@ namespace ddd
 {
 	class LevelWindow;
 	class Actor;
+	class SnapshotReader;
+	class SnapshotWriter;
+
+	//spawns count actors of actorType, interval ms apart, from time ms on
+	struct LevelWave
+	{
+		unsigned long time_;
+		std::string actorType_;
+		unsigned long count_;
+		unsigned long interval_;
+	};
 
 	class LogicLevelComponent
 		: public ILevelComponent
@@ -29,6 +42,41 @@ namespace ddd
 		inline void removeAllActors();
 
 		inline const size_t getActorCount()const;
+		inline void reserveActors( const size_t count );
+
+		//tiles are row major, columns * rows of them
+		void setTileGrid( const unsigned long columns,
+				const unsigned long rows,
+				const unsigned long tileSize,
+				const uint16_t* tiles );
+		inline const unsigned long getTile( const unsigned long column, const unsigned long row )const;
+		inline const unsigned long getTileColumns()const;
+		inline const unsigned long getTileRows()const;
+		inline const unsigned long getTileSize()const;
+
+		inline void addWave( const LevelWave& wave );
+		inline const std::vector< LevelWave >& getWaves()const;
+
+		//progress of the actors that show a bar, kept as parallel arrays
+		//the HUD draws straight from; x, y is the bar's anchor in window
+		//coordinates, the middle of its bottom edge
+		void setProgress( const unsigned long actorID,
+				const TReal progress,
+				const TReal x,
+				const TReal y );
+		void removeProgress( const unsigned long actorID );
+		inline const size_t getProgressCount()const;
+		inline const TReal* getProgressValues()const;
+		inline const TReal* getProgressXs()const;
+		inline const TReal* getProgressYs()const;
+
+		//snapshot interface, see LevelSnapshot; tiles, waves and
+		//progress bars, the actors are the caller's
+		void save( SnapshotWriter& writer )const;
+		const bool load( SnapshotReader& reader );
+		//swaps the tiles, waves and progress bars with other's, e.g. a
+		//scratch component load() filled; the actors stay
+		void swapState( LogicLevelComponent& other );
 
 	private:
 		
@@ -39,6 +87,18 @@ namespace ddd
 	private:
 
 		std::vector< Actor* > actorArray_;
+		std::vector< uint16_t > tiles_;
+		unsigned long tileColumns_;
+		unsigned long tileRows_;
+		unsigned long tileSize_;
+		std::vector< LevelWave > waves_;
+
+		//progress bars, dense; progressSlots_ maps actor IDs to slots
+		std::vector< unsigned long > progressActors_;
+		std::vector< TReal > progressValues_;
+		std::vector< TReal > progressXs_;
+		std::vector< TReal > progressYs_;
+		std::vector< unsigned long > progressSlots_;
 	};
 
 	//-------------------------------------------------------------------------
@@ -95,4 +155,83 @@ namespace ddd
 	}
 
 	//-------------------------------------------------------------------------
+
+	inline void LogicLevelComponent::reserveActors( const size_t count )
+	{
+		actorArray_.reserve( count );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long LogicLevelComponent::getTile( const unsigned long column, const unsigned long row )const
+	{
+		assert( column < tileColumns_ );
+		assert( row < tileRows_ );
+		return tiles_[ row * tileColumns_ + column ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long LogicLevelComponent::getTileColumns()const
+	{
+		return tileColumns_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long LogicLevelComponent::getTileRows()const
+	{
+		return tileRows_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long LogicLevelComponent::getTileSize()const
+	{
+		return tileSize_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void LogicLevelComponent::addWave( const LevelWave& wave )
+	{
+		waves_.push_back( wave );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const std::vector< LevelWave >& LogicLevelComponent::getWaves()const
+	{
+		return waves_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t LogicLevelComponent::getProgressCount()const
+	{
+		return progressActors_.size();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal* LogicLevelComponent::getProgressValues()const
+	{
+		return progressValues_.empty() ? 0 : &progressValues_[ 0 ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal* LogicLevelComponent::getProgressXs()const
+	{
+		return progressXs_.empty() ? 0 : &progressXs_[ 0 ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal* LogicLevelComponent::getProgressYs()const
+	{
+		return progressYs_.empty() ? 0 : &progressYs_[ 0 ];
+	}
+
+	//-------------------------------------------------------------------------
 }
\ No newline at end of file
@@ -18,4 +18,28 @@ namespace ddd
 		return static_cast< unsigned long >( const_cast< TLuaTable & >( luaTable ).GetNumber( key ) );
 	}
 
+	//pushes a deep copy of the table at index, as cloneTable in
+	//functionality.lua does for ILua:new
+	inline void cloneTable( lua_State* L, const int index )
+	{
+		const int source( index > 0 ? index : lua_gettop( L ) + index + 1 );
+		lua_newtable( L );
+		const int copy( lua_gettop( L ) );
+		lua_pushnil( L );
+		while ( 0 != lua_next( L, source ) )
+		{
+			lua_pushvalue( L, -2 );
+			if ( lua_istable( L, -2 ) )
+			{
+				cloneTable( L, -2 );
+			}
+			else
+			{
+				lua_pushvalue( L, -2 );
+			}
+			lua_settable( L, copy );
+			lua_pop( L, 1 );
+		}
+	}
+
 }
\ No newline at end of file
@@ -0,0 +1,596 @@
+#pragma once
+
+#include <math.h>
+#include <emmintrin.h>
+#include <pf/vec.h>
+#include <pf/mat.h>
+#include "boost/static_assert.hpp"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Inline stand-ins for TVec2, TVec3 and TMat3, whose operators all live
+	//out of line in pflib.dll. The types share the pf layout, so a value
+	//or an array of either converts by reference with toPf/fromPf and
+	//nothing is copied at an API boundary. Even the pf constructors are
+	//exported calls, so keep pf values out of hot loops altogether.
+	//
+	//Single values use plain inline arithmetic, which the compiler keeps
+	//in registers; the batch functions below sweep whole arrays with SSE2.
+
+	struct Vec2
+	{
+		TReal x;
+		TReal y;
+
+		inline Vec2();
+		inline Vec2( const TReal x, const TReal y );
+
+		inline Vec2& operator+=( const Vec2& rhs );
+		inline Vec2& operator-=( const Vec2& rhs );
+		inline Vec2& operator*=( const TReal s );
+		inline Vec2& operator/=( const TReal s );
+		inline const Vec2 operator-()const;
+
+		inline const TReal lengthSquared()const;
+		inline const TReal length()const;
+		inline Vec2& normalize();
+	};
+
+	//-------------------------------------------------------------------------
+
+	struct Vec3
+	{
+		TReal x;
+		TReal y;
+		TReal z;
+
+		inline Vec3();
+		inline Vec3( const TReal x, const TReal y, const TReal z );
+		//a point: z is 1 so the translation of a Mat3 applies
+		inline explicit Vec3( const Vec2& v );
+
+		inline Vec3& operator+=( const Vec3& rhs );
+		inline Vec3& operator-=( const Vec3& rhs );
+		inline Vec3& operator*=( const TReal s );
+		inline Vec3& operator/=( const TReal s );
+		inline const Vec3 operator-()const;
+
+		inline const TReal lengthSquared()const;
+		inline const TReal length()const;
+		inline Vec3& normalize();
+	};
+
+	//-------------------------------------------------------------------------
+
+	//Like TMat3 the matrix is stored as three columns, the third holding
+	//the 2d translation, so m[ 2 ] of a TDrawSpec matrix is its position.
+	struct Mat3
+	{
+		Vec3 m[ 3 ];
+
+		//identity
+		inline Mat3();
+		inline Mat3( const Vec3& c0, const Vec3& c1, const Vec3& c2 );
+
+		inline Vec3& operator[]( const unsigned long i );
+		inline const Vec3& operator[]( const unsigned long i )const;
+
+		static inline const Mat3 translation( const Vec2& v );
+		static inline const Mat3 rotation( const TReal radians );
+		static inline const Mat3 scale( const TReal sx, const TReal sy );
+	};
+
+	BOOST_STATIC_ASSERT( sizeof( Vec2 ) == sizeof( TVec2 ) );
+	BOOST_STATIC_ASSERT( sizeof( Vec3 ) == sizeof( TVec3 ) );
+	BOOST_STATIC_ASSERT( sizeof( Mat3 ) == sizeof( TMat3 ) );
+
+	//-------------------------------------------------------------------------
+	//conversions
+
+	inline TVec2& toPf( Vec2& v ) { return reinterpret_cast< TVec2& >( v ); }
+	inline const TVec2& toPf( const Vec2& v ) { return reinterpret_cast< const TVec2& >( v ); }
+	inline TVec3& toPf( Vec3& v ) { return reinterpret_cast< TVec3& >( v ); }
+	inline const TVec3& toPf( const Vec3& v ) { return reinterpret_cast< const TVec3& >( v ); }
+	inline TMat3& toPf( Mat3& m ) { return reinterpret_cast< TMat3& >( m ); }
+	inline const TMat3& toPf( const Mat3& m ) { return reinterpret_cast< const TMat3& >( m ); }
+
+	inline Vec2& fromPf( TVec2& v ) { return reinterpret_cast< Vec2& >( v ); }
+	inline const Vec2& fromPf( const TVec2& v ) { return reinterpret_cast< const Vec2& >( v ); }
+	inline Vec3& fromPf( TVec3& v ) { return reinterpret_cast< Vec3& >( v ); }
+	inline const Vec3& fromPf( const TVec3& v ) { return reinterpret_cast< const Vec3& >( v ); }
+	inline Mat3& fromPf( TMat3& m ) { return reinterpret_cast< Mat3& >( m ); }
+	inline const Mat3& fromPf( const TMat3& m ) { return reinterpret_cast< const Mat3& >( m ); }
+
+	inline Vec2* fromPf( TVec2* v ) { return reinterpret_cast< Vec2* >( v ); }
+	inline const Vec2* fromPf( const TVec2* v ) { return reinterpret_cast< const Vec2* >( v ); }
+	inline TVec2* toPf( Vec2* v ) { return reinterpret_cast< TVec2* >( v ); }
+	inline const TVec2* toPf( const Vec2* v ) { return reinterpret_cast< const TVec2* >( v ); }
+
+	//-------------------------------------------------------------------------
+	//Vec2
+
+	inline Vec2::Vec2()
+		: x( 0 )
+		, y( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec2::Vec2( const TReal x, const TReal y )
+		: x( x )
+		, y( y )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec2& Vec2::operator+=( const Vec2& rhs )
+	{
+		x += rhs.x;
+		y += rhs.y;
+		return *this;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec2& Vec2::operator-=( const Vec2& rhs )
+	{
+		x -= rhs.x;
+		y -= rhs.y;
+		return *this;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec2& Vec2::operator*=( const TReal s )
+	{
+		x *= s;
+		y *= s;
+		return *this;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec2& Vec2::operator/=( const TReal s )
+	{
+		assert( 0 != s );
+		return *this *= 1 / s;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec2 Vec2::operator-()const
+	{
+		return Vec2( -x, -y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal Vec2::lengthSquared()const
+	{
+		return x * x + y * y;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal Vec2::length()const
+	{
+		return sqrtf( lengthSquared() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec2& Vec2::normalize()
+	{
+		const TReal len( length() );
+		if ( 0 != len )
+		{
+			*this /= len;
+		}
+		return *this;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec2 operator+( const Vec2& lhs, const Vec2& rhs )
+	{
+		return Vec2( lhs.x + rhs.x, lhs.y + rhs.y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec2 operator-( const Vec2& lhs, const Vec2& rhs )
+	{
+		return Vec2( lhs.x - rhs.x, lhs.y - rhs.y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	//member-wise, as TVec2 does it
+	inline const Vec2 operator*( const Vec2& lhs, const Vec2& rhs )
+	{
+		return Vec2( lhs.x * rhs.x, lhs.y * rhs.y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec2 operator*( const Vec2& lhs, const TReal s )
+	{
+		return Vec2( lhs.x * s, lhs.y * s );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec2 operator*( const TReal s, const Vec2& rhs )
+	{
+		return rhs * s;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec2 operator/( const Vec2& lhs, const TReal s )
+	{
+		assert( 0 != s );
+		return lhs * ( 1 / s );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool operator==( const Vec2& lhs, const Vec2& rhs )
+	{
+		return lhs.x == rhs.x && lhs.y == rhs.y;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool operator!=( const Vec2& lhs, const Vec2& rhs )
+	{
+		return !( lhs == rhs );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal dot( const Vec2& lhs, const Vec2& rhs )
+	{
+		return lhs.x * rhs.x + lhs.y * rhs.y;
+	}
+
+	//-------------------------------------------------------------------------
+	//Vec3
+
+	inline Vec3::Vec3()
+		: x( 0 )
+		, y( 0 )
+		, z( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec3::Vec3( const TReal x, const TReal y, const TReal z )
+		: x( x )
+		, y( y )
+		, z( z )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec3::Vec3( const Vec2& v )
+		: x( v.x )
+		, y( v.y )
+		, z( 1 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec3& Vec3::operator+=( const Vec3& rhs )
+	{
+		x += rhs.x;
+		y += rhs.y;
+		z += rhs.z;
+		return *this;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec3& Vec3::operator-=( const Vec3& rhs )
+	{
+		x -= rhs.x;
+		y -= rhs.y;
+		z -= rhs.z;
+		return *this;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec3& Vec3::operator*=( const TReal s )
+	{
+		x *= s;
+		y *= s;
+		z *= s;
+		return *this;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec3& Vec3::operator/=( const TReal s )
+	{
+		assert( 0 != s );
+		return *this *= 1 / s;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec3 Vec3::operator-()const
+	{
+		return Vec3( -x, -y, -z );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal Vec3::lengthSquared()const
+	{
+		return x * x + y * y + z * z;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal Vec3::length()const
+	{
+		return sqrtf( lengthSquared() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec3& Vec3::normalize()
+	{
+		const TReal len( length() );
+		if ( 0 != len )
+		{
+			*this /= len;
+		}
+		return *this;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec3 operator+( const Vec3& lhs, const Vec3& rhs )
+	{
+		return Vec3( lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec3 operator-( const Vec3& lhs, const Vec3& rhs )
+	{
+		return Vec3( lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec3 operator*( const Vec3& lhs, const TReal s )
+	{
+		return Vec3( lhs.x * s, lhs.y * s, lhs.z * s );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec3 operator*( const TReal s, const Vec3& rhs )
+	{
+		return rhs * s;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec3 operator/( const Vec3& lhs, const TReal s )
+	{
+		assert( 0 != s );
+		return lhs * ( 1 / s );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool operator==( const Vec3& lhs, const Vec3& rhs )
+	{
+		return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool operator!=( const Vec3& lhs, const Vec3& rhs )
+	{
+		return !( lhs == rhs );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal dot( const Vec3& lhs, const Vec3& rhs )
+	{
+		return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec3 cross( const Vec3& lhs, const Vec3& rhs )
+	{
+		return Vec3( lhs.y * rhs.z - lhs.z * rhs.y,
+				lhs.z * rhs.x - lhs.x * rhs.z,
+				lhs.x * rhs.y - lhs.y * rhs.x );
+	}
+
+	//-------------------------------------------------------------------------
+	//Mat3
+
+	inline Mat3::Mat3()
+	{
+		m[ 0 ] = Vec3( 1, 0, 0 );
+		m[ 1 ] = Vec3( 0, 1, 0 );
+		m[ 2 ] = Vec3( 0, 0, 1 );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Mat3::Mat3( const Vec3& c0, const Vec3& c1, const Vec3& c2 )
+	{
+		m[ 0 ] = c0;
+		m[ 1 ] = c1;
+		m[ 2 ] = c2;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline Vec3& Mat3::operator[]( const unsigned long i )
+	{
+		assert( i < 3 );
+		return m[ i ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec3& Mat3::operator[]( const unsigned long i )const
+	{
+		assert( i < 3 );
+		return m[ i ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Mat3 Mat3::translation( const Vec2& v )
+	{
+		return Mat3( Vec3( 1, 0, 0 ), Vec3( 0, 1, 0 ), Vec3( v ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Mat3 Mat3::rotation( const TReal radians )
+	{
+		const TReal c( cosf( radians ) );
+		const TReal s( sinf( radians ) );
+		return Mat3( Vec3( c, s, 0 ), Vec3( -s, c, 0 ), Vec3( 0, 0, 1 ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Mat3 Mat3::scale( const TReal sx, const TReal sy )
+	{
+		return Mat3( Vec3( sx, 0, 0 ), Vec3( 0, sy, 0 ), Vec3( 0, 0, 1 ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	//M*v
+	inline const Vec3 operator*( const Mat3& lhs, const Vec3& rhs )
+	{
+		return lhs.m[ 0 ] * rhs.x + lhs.m[ 1 ] * rhs.y + lhs.m[ 2 ] * rhs.z;
+	}
+
+	//-------------------------------------------------------------------------
+
+	//M*v for the point v, translation included
+	inline const Vec2 operator*( const Mat3& lhs, const Vec2& rhs )
+	{
+		return Vec2( lhs.m[ 0 ].x * rhs.x + lhs.m[ 1 ].x * rhs.y + lhs.m[ 2 ].x,
+				lhs.m[ 0 ].y * rhs.x + lhs.m[ 1 ].y * rhs.y + lhs.m[ 2 ].y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	//the 2x2 part of M times v: rotation and scale without translation
+	inline const Vec2 multiply2x2( const Mat3& lhs, const Vec2& rhs )
+	{
+		return Vec2( lhs.m[ 0 ].x * rhs.x + lhs.m[ 1 ].x * rhs.y,
+				lhs.m[ 0 ].y * rhs.x + lhs.m[ 1 ].y * rhs.y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Mat3 operator*( const Mat3& lhs, const Mat3& rhs )
+	{
+		return Mat3( lhs * rhs.m[ 0 ], lhs * rhs.m[ 1 ], lhs * rhs.m[ 2 ] );
+	}
+
+	//-------------------------------------------------------------------------
+	//batches
+	//
+	//Inputs and outputs may be unaligned; out may alias in.
+
+	//out[ i ] = m * in[ i ], translation included
+	inline void transformPoints( const Mat3& m, const Vec2* in, Vec2* out, const unsigned long count )
+	{
+		const __m128 c0( _mm_setr_ps( m.m[ 0 ].x, m.m[ 0 ].y, m.m[ 0 ].x, m.m[ 0 ].y ) );
+		const __m128 c1( _mm_setr_ps( m.m[ 1 ].x, m.m[ 1 ].y, m.m[ 1 ].x, m.m[ 1 ].y ) );
+		const __m128 c2( _mm_setr_ps( m.m[ 2 ].x, m.m[ 2 ].y, m.m[ 2 ].x, m.m[ 2 ].y ) );
+
+		unsigned long i = 0;
+		for ( ; i + 2 <= count; i += 2 )
+		{
+			//two points per register: x0 y0 x1 y1
+			const __m128 p( _mm_loadu_ps( &in[ i ].x ) );
+			const __m128 xs( _mm_shuffle_ps( p, p, _MM_SHUFFLE( 2, 2, 0, 0 ) ) );
+			const __m128 ys( _mm_shuffle_ps( p, p, _MM_SHUFFLE( 3, 3, 1, 1 ) ) );
+			_mm_storeu_ps( &out[ i ].x, _mm_add_ps( _mm_add_ps( _mm_mul_ps( xs, c0 ), _mm_mul_ps( ys, c1 ) ), c2 ) );
+		}
+		if ( i < count )
+		{
+			out[ i ] = m * in[ i ];
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	//out[ i ] = dot( a[ i ], b[ i ] )
+	inline void dot( const Vec2* a, const Vec2* b, TReal* out, const unsigned long count )
+	{
+		unsigned long i = 0;
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			const __m128 p0( _mm_mul_ps( _mm_loadu_ps( &a[ i ].x ), _mm_loadu_ps( &b[ i ].x ) ) );
+			const __m128 p1( _mm_mul_ps( _mm_loadu_ps( &a[ i + 2 ].x ), _mm_loadu_ps( &b[ i + 2 ].x ) ) );
+			const __m128 xs( _mm_shuffle_ps( p0, p1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+			const __m128 ys( _mm_shuffle_ps( p0, p1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+			_mm_storeu_ps( &out[ i ], _mm_add_ps( xs, ys ) );
+		}
+		for ( ; i < count; i++ )
+		{
+			out[ i ] = dot( a[ i ], b[ i ] );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	//p[ i ] += v[ i ] * s, the usual position += velocity * seconds step
+	inline void addScaled( Vec2* p, const Vec2* v, const TReal s, const unsigned long count )
+	{
+		TReal* pr( &p[ 0 ].x );
+		const TReal* vr( &v[ 0 ].x );
+		const unsigned long n( count * 2 );
+		const __m128 s4( _mm_set1_ps( s ) );
+
+		unsigned long i = 0;
+		for ( ; i + 4 <= n; i += 4 )
+		{
+			_mm_storeu_ps( pr + i, _mm_add_ps( _mm_loadu_ps( pr + i ), _mm_mul_ps( _mm_loadu_ps( vr + i ), s4 ) ) );
+		}
+		for ( ; i < n; i++ )
+		{
+			pr[ i ] += vr[ i ] * s;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	//out[ i ] = m * in[ i ]
+	inline void transform( const Mat3& m, const Vec3* in, Vec3* out, const unsigned long count )
+	{
+		for ( unsigned long i = 0; i < count; i++ )
+		{
+			out[ i ] = m * in[ i ];
+		}
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Times the ddd/Math.h batch functions against the same work done with
+	//the exported pf operators, over arrays of pointCount_ points.
+	class MathBenchmark
+	{
+	public:
+
+		struct Result
+		{
+			std::string op_;
+			//"pf" for the pflib.dll operators, "ddd" for ddd/Math.h
+			std::string backend_;
+			double seconds_;
+			//checksum of the output, so both backends can be compared
+			double sum_;
+		};
+
+		MathBenchmark( const unsigned long pointCount = 4096,
+				const unsigned long iterations = 1000 );
+
+		void run();
+
+		inline const std::vector< Result >& getResults()const;
+		//comma separated, one header line then one line per op and backend
+		const bool write( const char* fileName )const;
+
+	private:
+
+		void add( const char* op, const char* backend, const double start, const double sum );
+
+	private:
+
+		std::vector< Result > results_;
+		unsigned long pointCount_;
+		unsigned long iterations_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const std::vector< MathBenchmark::Result >& MathBenchmark::getResults()const
+	{
+		return results_;
+	}
+
+	//-------------------------------------------------------------------------
+}
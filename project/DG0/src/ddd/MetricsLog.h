@@ -0,0 +1,133 @@
+#pragma once
+
+#include "boost/noncopyable.hpp"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Session metrics that never make the game thread wait on the disk.
+	//record() copies an event into a fixed ring of CAPACITY slots and
+	//returns; a writer thread takes what has piled up every WRITE_DELAY
+	//ms, or once WAKE_COUNT events wait, and appends it to the log in one
+	//write. The ring is single producer, single consumer and lock free:
+	//only the game thread may record. When the ring is full events are
+	//dropped and counted, and the count goes into the log as an
+	//EVENT_DROPPED record once there is room again.
+	//
+	//The log starts with "DGM1"; each record after it is, little endian,
+	//a 4 byte tick in ms since start(), a 1 byte EventType, a 1 byte name
+	//length, a 4 byte signed value and the name without terminator.
+	//Every run appends an EVENT_SESSION record holding time( 0 ).
+	class MetricsLog
+		: private boost::noncopyable
+	{
+	public:
+		enum EventType
+		{
+			EVENT_SESSION,
+			//value is added to the named counter
+			EVENT_COUNT,
+			//the named figure is set to value
+			EVENT_VALUE,
+			//a status line, such as a game or a level completed
+			EVENT_STATUS,
+			//value is the level ID
+			EVENT_LEVEL_BEGIN,
+			EVENT_LEVEL_END,
+			//value is the number of events lost to a full ring
+			EVENT_DROPPED
+		};
+
+		//slots in the ring, a power of two
+		static const unsigned long CAPACITY = 1024;
+		//longer names are cut
+		static const unsigned long MAX_NAME = 31;
+		//ms
+		static const unsigned long WRITE_DELAY = 1000;
+		static const unsigned long WAKE_COUNT = CAPACITY / 4;
+
+		MetricsLog();
+		~MetricsLog();
+
+		void start( const char* fileName );
+		//writes whatever is still in the ring
+		void stop();
+
+		inline const bool isStarted()const;
+
+		//false if the event was dropped
+		const bool record( const EventType type, const char* name, const long value );
+		inline const bool count( const char* name, const long amount = 1 );
+		inline const bool value( const char* name, const long value );
+		inline const bool status( const char* name, const long value = 0 );
+
+		inline const unsigned long getRecorded()const;
+		inline const unsigned long getDropped()const;
+		const unsigned long getWritten()const;
+		const unsigned long getBatches()const;
+
+	private:
+
+		struct Event;
+		struct Impl;
+
+		static unsigned int __stdcall threadProc( void* param );
+		void run();
+		//writes the events between the read and the write index
+		void drain();
+		const bool push( const EventType type, const char* name, const long value );
+
+	private:
+
+		Impl* impl_;
+		bool started_;
+		unsigned long recorded_;
+		unsigned long dropped_;
+		//dropped but not in the log yet
+		unsigned long unreported_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool MetricsLog::isStarted()const
+	{
+		return started_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool MetricsLog::count( const char* name, const long amount )
+	{
+		return record( EVENT_COUNT, name, amount );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool MetricsLog::value( const char* name, const long value )
+	{
+		return record( EVENT_VALUE, name, value );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool MetricsLog::status( const char* name, const long value )
+	{
+		return record( EVENT_STATUS, name, value );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long MetricsLog::getRecorded()const
+	{
+		return recorded_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long MetricsLog::getDropped()const
+	{
+		return dropped_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+#include <pf/particlerenderer.h>
+#include <pf/2dparticlerenderer.h>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Particle renderer that draws nothing and loads no textures, for
+	//running particle systems headless. Particles keep the
+	//T2dParticleRenderer layout, so every 2d spec loads unchanged.
+	class NullParticleRenderer
+		: public TParticleRenderer
+	{
+	public:
+
+		NullParticleRenderer();
+		virtual ~NullParticleRenderer();
+
+		virtual void Draw( const TVec3& at, TReal alpha, const ParticleList& particles, int maxParticles );
+		virtual void SetTexture( TTextureRef texture );
+		virtual void SetRendererOption( str option, const TReal (& value)[4] );
+		virtual TReal* GetPrototypeParticle();
+		virtual uint32_t GetPrototypeParticleSize();
+		virtual str GetLuaInitString();
+
+	private:
+
+		std::vector< TReal > prototype_;
+		str luaInitString_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline NullParticleRenderer::NullParticleRenderer()
+	{
+		T2dParticleRenderer layout;
+		prototype_.assign( layout.GetPrototypeParticle(), layout.GetPrototypeParticle() + layout.GetPrototypeParticleSize() );
+		luaInitString_ = layout.GetLuaInitString();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline NullParticleRenderer::~NullParticleRenderer()
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void NullParticleRenderer::Draw( const TVec3& /*at*/, TReal /*alpha*/, const ParticleList& /*particles*/, int /*maxParticles*/ )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void NullParticleRenderer::SetTexture( TTextureRef /*texture*/ )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void NullParticleRenderer::SetRendererOption( str /*option*/, const TReal (& /*value*/)[4] )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline TReal* NullParticleRenderer::GetPrototypeParticle()
+	{
+		return &prototype_[ 0 ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline uint32_t NullParticleRenderer::GetPrototypeParticleSize()
+	{
+		return static_cast< uint32_t >( prototype_.size() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline str NullParticleRenderer::GetLuaInitString()
+	{
+		return luaInitString_;
+	}
+
+	//-------------------------------------------------------------------------
+}
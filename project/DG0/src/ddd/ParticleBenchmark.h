@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ddd/Types.h"
+#include "ddd/NullParticleRenderer.h"
+
+namespace ddd
+{
+	//Headless cost measurement of particle specs under both particle
+	//backends: the TLuaParticleSystem rule VM and the native
+	//TFxParticleKernel. Each spec runs as a batch of instances on a
+	//NullParticleRenderer, stepped with a fixed frame time for a fixed
+	//duration, so emission is the same on every run.
+	class ParticleBenchmark
+	{
+	public:
+
+		struct Result
+		{
+			std::string spec_;
+			bool native_;
+			//false when the backend couldn't load the spec
+			bool supported_;
+			unsigned long frames_;
+			double seconds_;
+			//particles alive summed over every update of every instance
+			double particleUpdates_;
+			//most particles alive in one instance
+			unsigned long peakLive_;
+			//process private bytes grown by loading and running the batch
+			unsigned long memory_;
+
+			inline const double getParticlesPerSecond()const;
+			inline const double getNanosecondsPerParticle()const;
+		};
+
+		ParticleBenchmark( const unsigned long instanceCount = 32,
+				const unsigned long duration = 10000,
+				const unsigned long msPerFrame = 16 );
+
+		void addSpec( const char* spec );
+		//the fx/*.lua specs the game ships, batch scripts excluded
+		void addShippedSpecs();
+
+		void run();
+
+		inline const std::vector< Result >& getResults()const;
+		//comma separated, one header line then one line per spec and backend
+		const bool write( const char* fileName )const;
+
+	private:
+
+		template< class System >
+		void runSystems( std::vector< System* >& systems, Result& result );
+
+		static const double getSeconds();
+		static const unsigned long getPrivateBytes();
+
+	private:
+
+		std::vector< std::string > specs_;
+		std::vector< Result > results_;
+		NullParticleRenderer renderer_;
+		unsigned long instanceCount_;
+		unsigned long frameCount_;
+		unsigned long msPerFrame_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const double ParticleBenchmark::Result::getParticlesPerSecond()const
+	{
+		return seconds_ > 0 ? particleUpdates_ / seconds_ : 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const double ParticleBenchmark::Result::getNanosecondsPerParticle()const
+	{
+		return particleUpdates_ > 0 ? seconds_ * 1e9 / particleUpdates_ : 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const std::vector< ParticleBenchmark::Result >& ParticleBenchmark::getResults()const
+	{
+		return results_;
+	}
+
+	//-------------------------------------------------------------------------
+}
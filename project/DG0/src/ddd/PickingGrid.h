@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vector>
+#include <pf/texture.h>
+#include <pf/rect.h>
+#include <pf/point.h>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	class SnapshotReader;
+	class SnapshotWriter;
+
+	//Point picking over level items by grid cell.
+	//The level area is cut into square cells and every cell lists the
+	//items whose rect overlaps it, so a pick only looks at the few
+	//candidates in the cell under the point, however many items the level
+	//holds. Candidates are tested against their rect, then against a 1-bit
+	//alpha mask built once per texture, so a pick never locks a texture.
+	//The topmost hit wins: highest priority, then the latest added.
+	class PickingGrid
+	{
+	public:
+
+		PickingGrid();
+		~PickingGrid();
+
+		//bounds are in the coordinates items and picks use
+		void init( const TRect& bounds, const unsigned long cellSize );
+		inline const bool isInited()const;
+
+		//masks interface
+		//a pixel is solid at alpha >= threshold
+		const unsigned long addMask( TTextureRef texture, const unsigned long threshold = 128 );
+		inline const size_t getMaskCount()const;
+
+		//items interface
+		const unsigned long addItem( const TRect& rect,
+				const long priority = 0,
+				const unsigned long maskID = MAX_UNSIGN_LONG );
+		void removeItem( const unsigned long itemID );
+		void removeAllItems();
+		void moveItem( const unsigned long itemID, const TRect& rect );
+		inline void setPriority( const unsigned long itemID, const long priority );
+		inline const TRect& getRect( const unsigned long itemID )const;
+		inline const size_t getItemCount()const;
+
+		//queries
+		//false outside the bounds
+		const bool getCell( const TPoint& point, unsigned long& column, unsigned long& row )const;
+		inline const size_t getCellItemCount( const unsigned long column, const unsigned long row )const;
+		//topmost item under the point, MAX_UNSIGN_LONG for none
+		const unsigned long pick( const TPoint& point )const;
+
+		void release();
+
+		//snapshot interface, see LevelSnapshot
+		void save( SnapshotWriter& writer )const;
+		//false, and no items left, if the data doesn't fit
+		const bool load( SnapshotReader& reader );
+
+	private:
+
+		struct Mask
+		{
+			unsigned long width_;
+			unsigned long height_;
+			unsigned long wordsPerRow_;
+			std::vector< uint32_t > bits_;
+		};
+
+		const bool hitTest( const unsigned long itemID, const TPoint& point )const;
+		void getCellRange( const TRect& rect,
+				unsigned long& column1, unsigned long& row1,
+				unsigned long& column2, unsigned long& row2 )const;
+		void insert( const unsigned long itemID );
+		void erase( const unsigned long itemID );
+		inline const bool isItem( const unsigned long itemID )const;
+
+	private:
+
+		TRect bounds_;
+		unsigned long cellSize_;
+		unsigned long columns_;
+		unsigned long rows_;
+		//item IDs overlapping each cell, row by row
+		std::vector< std::vector< unsigned long > > cells_;
+
+		std::vector< Mask > masks_;
+
+		//item tables, indexed by item ID
+		std::vector< TRect > rects_;
+		std::vector< long > priorities_;
+		std::vector< unsigned long > maskIDs_;
+		//raised on every add, so later items win priority ties
+		std::vector< unsigned long > orders_;
+		std::vector< unsigned char > used_;
+		std::vector< unsigned long > freeItemIDs_;
+		size_t itemCount_;
+		unsigned long nextOrder_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool PickingGrid::isInited()const
+	{
+		return 0 != cellSize_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t PickingGrid::getMaskCount()const
+	{
+		return masks_.size();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void PickingGrid::setPriority( const unsigned long itemID, const long priority )
+	{
+		assert( isItem( itemID ) );
+		priorities_[ itemID ] = priority;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TRect& PickingGrid::getRect( const unsigned long itemID )const
+	{
+		assert( isItem( itemID ) );
+		return rects_[ itemID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t PickingGrid::getItemCount()const
+	{
+		return itemCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t PickingGrid::getCellItemCount( const unsigned long column, const unsigned long row )const
+	{
+		assert( column < columns_ );
+		assert( row < rows_ );
+		return cells_[ row * columns_ + column ].size();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool PickingGrid::isItem( const unsigned long itemID )const
+	{
+		return itemID < used_.size() && 0 != used_[ itemID ];
+	}
+
+	//-------------------------------------------------------------------------
+}
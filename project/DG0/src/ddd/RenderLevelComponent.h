@@ -1,10 +1,21 @@
 #pragma once
 
+#include <map>
+#include <string>
+#include <vector>
 #include "ddd/ILevelComponent.h"
+#include "ddd/AnimationSystem.h"
+#include "ddd/DrawOrder.h"
+#include "ddd/TransformSystem.h"
+#include "pf/addons/fxsprite/fxsprite.h"
+
+class TLuaTable;
 
 namespace ddd
 {
 	class LevelWindow;
+	class SnapshotReader;
+	class SnapshotWriter;
 
 	class RenderLevelComponent
 		: public ILevelComponent
@@ -16,10 +27,117 @@ namespace ddd
 
 		void render( LevelWindow* owner );
 
+		//actors drawn by the level. addActor reads the Actor table:
+		//animation_ names an animated texture, played at msPerFrame_ and
+		//looped if loop_; fx_ names a particle spec; "" for neither. Each
+		//actor is a root node of the transform system at x_, y_, in
+		//window coordinates, and both are drawn from its cached world
+		//transform. Each is also a draw order item on layer_, with its y
+		//for the y-sorted layers, and render() draws in that order
+		void addActor( const unsigned long actorID, TLuaTable& actorTable );
+		void removeActor( const unsigned long actorID );
+		//"" stops drawing the animation
+		void setActorAnimation( const unsigned long actorID,
+				const char* animationName,
+				const unsigned long msPerFrame,
+				const bool loop );
+		//"" removes the particles
+		void setActorFx( const unsigned long actorID, const char* spec );
+		void setActorPosition( const unsigned long actorID, const Vec2& position );
+		void setActorLayer( const unsigned long actorID, const long layer );
+		//window rect of the actor's current frame, drawn with its
+		//registration point on the actor's position, and its layer;
+		//false for an actor without an animation
+		const bool getActorBounds( const unsigned long actorID, TRect& rect, long& layer )const;
+
+		inline AnimationSystem& getAnimationSystem();
+		inline TransformSystem& getTransformSystem();
+		inline DrawOrder& getDrawOrder();
+		inline const unsigned long getTime();
+
+		//snapshot interface, see LevelSnapshot; the clock, the
+		//systems' instances and the actors' ones, the clips stay as
+		//they are and particles start over. load() leaves the level
+		//untouched if the data doesn't fit; read() parses into loaded
+		//without touching it either, commit() then takes it over
+		struct Loaded
+		{
+			uint32_t time_;
+			AnimationSystem animationSystem_;
+			TransformSystem transformSystem_;
+			DrawOrder drawOrder_;
+			std::vector< unsigned long > actorInstances_;
+			std::vector< unsigned long > actorNodes_;
+			std::vector< unsigned long > actorItems_;
+			std::vector< unsigned long > itemActors_;
+			std::vector< std::string > actorFx_;
+		};
+		void save( SnapshotWriter& writer );
+		const bool load( SnapshotReader& reader );
+		const bool read( SnapshotReader& reader, Loaded& loaded )const;
+		void commit( Loaded& loaded );
+
 	private:
 		
 		virtual void onCreate();
 		virtual void onInit();
 		virtual void onRelease();
+
+		void growActors( const unsigned long actorID );
+		//the actor's node, and its draw order item along with it
+		const unsigned long getActorNode( const unsigned long actorID );
+		void releaseActorFx();
+		//one clip per animation, frame time and looping
+		const unsigned long getClip( const char* animationName,
+				const unsigned long msPerFrame,
+				const bool loop );
+
+	private:
+
+		TClock clock_;
+		AnimationSystem animationSystem_;
+		TransformSystem transformSystem_;
+		DrawOrder drawOrder_;
+
+		//indexed by actor ID; MAX_UNSIGN_LONG and empty refs for what
+		//an actor hasn't got
+		std::vector< unsigned long > actorInstances_;
+		std::vector< unsigned long > actorNodes_;
+		std::vector< TFxSpriteRef > actorFx_;
+		std::vector< unsigned long > actorItems_;
+		//indexed by draw order item ID, MAX_UNSIGN_LONG for items that
+		//aren't an actor's
+		std::vector< unsigned long > itemActors_;
+		std::map< std::string, unsigned long > clipIDs_;
 	};
+
+	//-------------------------------------------------------------------------
+
+	inline AnimationSystem& RenderLevelComponent::getAnimationSystem()
+	{
+		return animationSystem_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline TransformSystem& RenderLevelComponent::getTransformSystem()
+	{
+		return transformSystem_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline DrawOrder& RenderLevelComponent::getDrawOrder()
+	{
+		return drawOrder_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long RenderLevelComponent::getTime()
+	{
+		return clock_.GetTime();
+	}
+
+	//-------------------------------------------------------------------------
 }
\ No newline at end of file
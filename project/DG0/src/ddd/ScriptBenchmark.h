@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Times loading every script below a folder from source and from the
+	//bytecode ScriptBundle would pack for it. Only lua_load is timed:
+	//running a chunk costs the same either way. The rows for mainloop.lua
+	//and the scripts it requires make up cold start; each modal's row is
+	//its open cost.
+	class ScriptBenchmark
+	{
+	public:
+
+		struct Result
+		{
+			std::string script_;
+			unsigned long sourceBytes_;
+			unsigned long bytecodeBytes_;
+			double sourceSeconds_;
+			double bytecodeSeconds_;
+		};
+
+		ScriptBenchmark( const unsigned long iterations = 100 );
+
+		//false if a script failed to compile
+		const bool run( const char* folder );
+
+		inline const std::vector< Result >& getResults()const;
+		//comma separated, one header line, one line per script, then a total line
+		const bool write( const char* fileName )const;
+
+	private:
+
+		std::vector< Result > results_;
+		unsigned long iterations_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const std::vector< ScriptBenchmark::Result >& ScriptBenchmark::getResults()const
+	{
+		return results_;
+	}
+
+	//-------------------------------------------------------------------------
+}
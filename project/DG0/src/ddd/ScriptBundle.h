@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <pf/pftypes.h>
+#include "boost/noncopyable.hpp"
+#include "ddd/Types.h"
+
+struct lua_State;
+
+namespace ddd
+{
+	//Precompiled Lua chunks packed into one indexed file. Mounting it
+	//adds a TFile memory file per script under the script's own name, so
+	//RunScript and require load the bytecode without knowing about it;
+	//lua_load tells precompiled chunks from source by their signature.
+	//Each entry keeps the Adler-32 of the source it was compiled from, so
+	//a bundle left behind by an edit to a script isn't mounted over it.
+	//
+	//Layout, little endian 32 bit words, offsets from the start of the file:
+	//	Header
+	//	Entry[ count_ ]
+	//	zero terminated names
+	//	chunks
+	class ScriptBundle
+		: private boost::noncopyable
+	{
+	public:
+		//"DDSB"
+		static const uint32_t MAGIC = 0x42534444;
+		static const uint32_t VERSION = 2;
+
+		struct Header
+		{
+			uint32_t magic_;
+			uint32_t version_;
+			uint32_t count_;
+			uint32_t size_;
+		};
+
+		struct Entry
+		{
+			uint32_t name_;
+			uint32_t offset_;
+			uint32_t size_;
+			uint32_t sourceHash_;
+		};
+
+		ScriptBundle();
+		~ScriptBundle();
+
+		//false if the bundle is missing, damaged, or older than one of the
+		//sources on disk; nothing is mounted then and the sources are read
+		const bool mount( const char* fileName );
+		void unmount();
+
+		inline const bool isMounted()const;
+		inline const unsigned long getScriptCount()const;
+
+		//build step: compiles every .lua below folder, a resource name
+		//such as "scripts", and writes the bundle to the native path.
+		//Returns the number of scripts packed, 0 on any failure.
+		static const unsigned long build( lua_State* L, const char* folder, const char* path );
+
+		//resource names and native paths of every .lua below folder
+		static void listScripts( const char* folder,
+				std::vector< std::string >& names,
+				std::vector< std::string >& paths );
+		static const bool readFile( const char* path, std::vector< char >& data );
+		//false on a syntax error
+		static const bool compile( lua_State* L,
+				const char* name,
+				const std::vector< char >& source,
+				std::vector< char >& bytecode );
+
+	private:
+
+		const bool validate()const;
+		//every entry matches its source on disk, or has none there
+		const bool isCurrent()const;
+
+	private:
+
+		std::vector< char > data_;
+		std::vector< std::string > names_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool ScriptBundle::isMounted()const
+	{
+		return !names_.empty();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long ScriptBundle::getScriptCount()const
+	{
+		return static_cast< unsigned long >( names_.size() );
+	}
+
+	//-------------------------------------------------------------------------
+}
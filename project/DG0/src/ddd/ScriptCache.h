@@ -0,0 +1,83 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <pf/script.h>
+#include "boost/noncopyable.hpp"
+
+class TLuaFunction;
+
+namespace ddd
+{
+	//Keeps what the UI would otherwise compile again on every call.
+	//doString() parses a source string once and keeps the chunk in the
+	//registry, so "UpdateButtons();" from a hot path is a registry
+	//lookup and a call. runScript() and retain() hold the TScriptCode
+	//of a script file, which makes Playground's loader hand out the
+	//compiled copy instead of reading and parsing the file again; that
+	//covers files loaded from Lua too, as by DoModal.
+	//Chunks belong to the lua_State they were compiled in and have to be
+	//dropped with clear() before it closes.
+	class ScriptCache
+		: private boost::noncopyable
+	{
+	public:
+		//distinct strings kept; past that doString() just runs them,
+		//so formatted one-off strings can't grow the cache
+		static const unsigned long MAX_CHUNKS = 64;
+
+		ScriptCache();
+		~ScriptCache();
+
+		//as TScript::DoLuaString: runs at once, not as a thread
+		const bool doString( TScript* script, const std::string& source );
+		//as TScript::RunScript, with the code kept compiled
+		const bool runScript( TScript* script, const char* fileName );
+		//compiles fileName now, if needed, and keeps it compiled
+		void retain( const char* fileName );
+		void clear();
+
+		inline const unsigned long getHits()const;
+		inline const unsigned long getMisses()const;
+		inline const unsigned long getChunkCount()const;
+
+	private:
+
+		typedef std::map< std::string, TLuaFunction* > Chunks;
+		typedef std::map< std::string, TScriptCodeRef > Codes;
+
+		TLuaFunction* findChunk( lua_State* L, const std::string& source );
+		void releaseChunks();
+
+	private:
+
+		lua_State* state_;
+		Chunks chunks_;
+		Codes codes_;
+		unsigned long hits_;
+		unsigned long misses_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long ScriptCache::getHits()const
+	{
+		return hits_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long ScriptCache::getMisses()const
+	{
+		return misses_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long ScriptCache::getChunkCount()const
+	{
+		return static_cast< unsigned long >( chunks_.size() );
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <pf/pftypes.h>
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Flat binary archive for level snapshots. Plain values and vectors of
+	//plain values are copied as their bytes, a vector as its size then
+	//its elements in one block, so writing and reading a level's tables
+	//is a handful of memcpy calls. Native byte order and layout: a
+	//snapshot is only read back by the build that wrote it.
+	class SnapshotWriter
+	{
+	public:
+
+		//appends to data
+		inline explicit SnapshotWriter( std::vector< char >& data );
+
+		template< typename T >
+		inline void put( const T& value );
+		template< typename T >
+		inline void putVector( const std::vector< T >& values );
+		inline void putBytes( const void* bytes, const size_t size );
+		inline void putString( const std::string& value );
+
+	private:
+
+		std::vector< char >& data_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	//Reads what SnapshotWriter wrote. Reading past the end fails the
+	//reader once and for all; every get returns false from then on.
+	class SnapshotReader
+	{
+	public:
+
+		inline SnapshotReader( const char* data, const size_t size );
+
+		template< typename T >
+		inline const bool get( T& value );
+		template< typename T >
+		inline const bool getVector( std::vector< T >& values );
+		inline const bool getBytes( void* bytes, const size_t size );
+		inline const bool getString( std::string& value );
+
+		inline const bool isFailed()const;
+		inline const bool isAtEnd()const;
+
+	private:
+
+		const char* data_;
+		size_t size_;
+		size_t offset_;
+		bool failed_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline SnapshotWriter::SnapshotWriter( std::vector< char >& data )
+		: data_( data )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	template< typename T >
+	inline void SnapshotWriter::put( const T& value )
+	{
+		putBytes( &value, sizeof( T ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	template< typename T >
+	inline void SnapshotWriter::putVector( const std::vector< T >& values )
+	{
+		put( static_cast< uint32_t >( values.size() ) );
+		if ( !values.empty() )
+		{
+			putBytes( &values[ 0 ], values.size() * sizeof( T ) );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void SnapshotWriter::putBytes( const void* bytes, const size_t size )
+	{
+		const char* begin( static_cast< const char* >( bytes ) );
+		data_.insert( data_.end(), begin, begin + size );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void SnapshotWriter::putString( const std::string& value )
+	{
+		put( static_cast< uint32_t >( value.length() ) );
+		putBytes( value.data(), value.length() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline SnapshotReader::SnapshotReader( const char* data, const size_t size )
+		: data_( data )
+		, size_( size )
+		, offset_( 0 )
+		, failed_( false )
+	{
+		assert( 0 != data_ || 0 == size_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	template< typename T >
+	inline const bool SnapshotReader::get( T& value )
+	{
+		return getBytes( &value, sizeof( T ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	template< typename T >
+	inline const bool SnapshotReader::getVector( std::vector< T >& values )
+	{
+		uint32_t count( 0 );
+		if ( !get( count ) || count > ( size_ - offset_ ) / sizeof( T ) )
+		{
+			failed_ = true;
+			return false;
+		}
+		values.resize( count );
+		return 0 == count || getBytes( &values[ 0 ], count * sizeof( T ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool SnapshotReader::getBytes( void* bytes, const size_t size )
+	{
+		if ( failed_ || size > size_ - offset_ )
+		{
+			failed_ = true;
+			return false;
+		}
+		memcpy( bytes, data_ + offset_, size );
+		offset_ += size;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool SnapshotReader::getString( std::string& value )
+	{
+		uint32_t length( 0 );
+		if ( !get( length ) || length > size_ - offset_ )
+		{
+			failed_ = true;
+			return false;
+		}
+		value.assign( data_ + offset_, length );
+		offset_ += length;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool SnapshotReader::isFailed()const
+	{
+		return failed_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool SnapshotReader::isAtEnd()const
+	{
+		return offset_ == size_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include "boost/noncopyable.hpp"
+#include "ddd/LevelSnapshot.h"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	class LevelWindow;
+
+	//The last SLOT_COUNT snapshots of a level, one every INTERVAL ms of
+	//level time, kept in memory for rewinding. Slots are reused oldest
+	//first and keep their memory, so once the ring has gone round a
+	//capture allocates nothing.
+	class SnapshotRing
+		: private boost::noncopyable
+	{
+	public:
+		static const unsigned long SLOT_COUNT = 16;
+		//ms of level time
+		static const unsigned long INTERVAL = 1000;
+
+		SnapshotRing();
+
+		//captures if INTERVAL ms passed since the last capture
+		void update( LevelWindow& level );
+		//restores the newest snapshot taken at least ms before the
+		//level's clock, or the oldest one if none is that old, and
+		//drops those after it; false if there is none or it fails
+		const bool rewind( LevelWindow& level, const unsigned long ms );
+		void clear();
+
+		inline const size_t getCount()const;
+		//0 while empty
+		const LevelSnapshot* getNewest()const;
+
+	private:
+
+		//index of the slot count steps back from the newest
+		inline const size_t getSlot( const size_t back )const;
+
+	private:
+
+		std::vector< LevelSnapshot > slots_;
+		//the slot the next capture goes to
+		size_t next_;
+		size_t count_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t SnapshotRing::getCount()const
+	{
+		return count_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t SnapshotRing::getSlot( const size_t back )const
+	{
+		assert( back < count_ );
+		return ( next_ + SLOT_COUNT - 1 - back ) % SLOT_COUNT;
+	}
+
+	//-------------------------------------------------------------------------
+}
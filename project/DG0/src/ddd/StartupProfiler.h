@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "boost/noncopyable.hpp"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Timeline of the startup phases, from Main() to the first frame of the
+	//main menu. Phases may nest; each one records its start and length in
+	//milliseconds from start(). finish() closes the timeline and writes
+	//the report once, later calls are ignored so a window can call it
+	//from every Draw.
+	class StartupProfiler
+		: private boost::noncopyable
+	{
+	public:
+
+		struct Phase
+		{
+			std::string name_;
+			//nesting level, 0 for the outermost phases
+			unsigned long depth_;
+			double start_;
+			//-1 while the phase is open, 0 for a mark
+			double length_;
+		};
+
+		//times a phase for the life of the scope
+		class Scope
+			: private boost::noncopyable
+		{
+		public:
+			inline Scope( StartupProfiler& profiler, const char* name );
+			inline ~Scope();
+
+		private:
+			StartupProfiler& profiler_;
+		};
+
+		StartupProfiler();
+
+		void start();
+		void beginPhase( const char* name );
+		void endPhase();
+		//a point on the timeline, such as the first frame
+		void mark( const char* name );
+		//marks name, closes any open phase and writes the report to
+		//fileName; does nothing once finished or if never started
+		void finish( const char* name, const char* fileName );
+
+		inline const bool isRecording()const;
+		inline const std::vector< Phase >& getPhases()const;
+		//comma separated, one header line then one line per phase
+		const bool write( const char* fileName )const;
+
+	private:
+
+		const double getMilliseconds()const;
+
+	private:
+
+		std::vector< Phase > phases_;
+		//indices into phases_ of the phases still open
+		std::vector< size_t > open_;
+		double origin_;
+		bool recording_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline StartupProfiler::Scope::Scope( StartupProfiler& profiler, const char* name )
+		: profiler_( profiler )
+	{
+		profiler_.beginPhase( name );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline StartupProfiler::Scope::~Scope()
+	{
+		profiler_.endPhase();
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool StartupProfiler::isRecording()const
+	{
+		return recording_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const std::vector< StartupProfiler::Phase >& StartupProfiler::getPhases()const
+	{
+		return phases_;
+	}
+
+	//-------------------------------------------------------------------------
+}
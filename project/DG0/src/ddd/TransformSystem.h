@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <pf/drawspec.h>
+#include "ddd/Math.h"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	class SnapshotReader;
+	class SnapshotWriter;
+
+	//Cached world transforms for a hierarchy of drawn things.
+	//Every node keeps its local transform and a cached world transform.
+	//Changing a node only flags it and its subtree dirty, stopping at
+	//nodes that are already dirty; world transforms are recomputed when
+	//read or in update(), top down, so a node that never moves, and
+	//whose parents never move, costs nothing per frame.
+	//World = parent world * local, the same product TDrawSpec::GetRelative
+	//builds for sprites.
+	class TransformSystem
+	{
+	public:
+
+		TransformSystem();
+		~TransformSystem();
+
+		//nodes interface
+		const unsigned long addNode( const unsigned long parentID = MAX_UNSIGN_LONG,
+				const Mat3& local = Mat3(),
+				const TReal alpha = 1 );
+		//the node must have no children left
+		void removeNode( const unsigned long nodeID );
+		void removeAllNodes();
+		//MAX_UNSIGN_LONG makes the node a root
+		void setParent( const unsigned long nodeID, const unsigned long parentID );
+		inline const unsigned long getParent( const unsigned long nodeID )const;
+		inline const size_t getNodeCount()const;
+
+		//local transforms
+		inline void setLocal( const unsigned long nodeID, const Mat3& local );
+		inline void setPosition( const unsigned long nodeID, const Vec2& position );
+		inline void setAlpha( const unsigned long nodeID, const TReal alpha );
+		inline const Mat3& getLocal( const unsigned long nodeID )const;
+		inline const Vec2 getPosition( const unsigned long nodeID )const;
+
+		//world transforms, recomputed first if dirty
+		inline const Mat3& getWorld( const unsigned long nodeID );
+		inline const TReal getWorldAlpha( const unsigned long nodeID );
+		//a draw spec with the world matrix and alpha of the node
+		void getDrawSpec( const unsigned long nodeID, TDrawSpec& drawSpec );
+
+		//recomputes every dirty node
+		void update();
+		inline const size_t getDirtyCount()const;
+
+		void release();
+
+		//snapshot interface, see LevelSnapshot
+		void save( SnapshotWriter& writer )const;
+		//false, and no nodes left, if the data doesn't fit
+		const bool load( SnapshotReader& reader );
+
+	private:
+
+		inline const bool isNode( const unsigned long nodeID )const;
+		void markDirty( const unsigned long nodeID );
+		void resolve( const unsigned long nodeID );
+		void link( const unsigned long nodeID, const unsigned long parentID );
+		void unlink( const unsigned long nodeID );
+
+	private:
+
+		//node tables, indexed by node ID
+		std::vector< Mat3 > locals_;
+		std::vector< Mat3 > worlds_;
+		std::vector< TReal > alphas_;
+		std::vector< TReal > worldAlphas_;
+		std::vector< unsigned long > parents_;
+		std::vector< unsigned long > firstChildren_;
+		std::vector< unsigned long > nextSiblings_;
+		std::vector< unsigned char > dirty_;
+		std::vector< unsigned char > used_;
+
+		//dirty nodes under a clean parent, or with no parent
+		std::vector< unsigned long > dirtyRoots_;
+		std::vector< unsigned long > freeNodeIDs_;
+		size_t nodeCount_;
+		size_t dirtyCount_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long TransformSystem::getParent( const unsigned long nodeID )const
+	{
+		assert( isNode( nodeID ) );
+		return parents_[ nodeID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t TransformSystem::getNodeCount()const
+	{
+		return nodeCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void TransformSystem::setLocal( const unsigned long nodeID, const Mat3& local )
+	{
+		assert( isNode( nodeID ) );
+		locals_[ nodeID ] = local;
+		markDirty( nodeID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void TransformSystem::setPosition( const unsigned long nodeID, const Vec2& position )
+	{
+		assert( isNode( nodeID ) );
+		locals_[ nodeID ].m[ 2 ] = Vec3( position );
+		markDirty( nodeID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline void TransformSystem::setAlpha( const unsigned long nodeID, const TReal alpha )
+	{
+		assert( isNode( nodeID ) );
+		alphas_[ nodeID ] = alpha;
+		markDirty( nodeID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Mat3& TransformSystem::getLocal( const unsigned long nodeID )const
+	{
+		assert( isNode( nodeID ) );
+		return locals_[ nodeID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Vec2 TransformSystem::getPosition( const unsigned long nodeID )const
+	{
+		assert( isNode( nodeID ) );
+		return Vec2( locals_[ nodeID ].m[ 2 ].x, locals_[ nodeID ].m[ 2 ].y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const Mat3& TransformSystem::getWorld( const unsigned long nodeID )
+	{
+		assert( isNode( nodeID ) );
+		if ( dirty_[ nodeID ] )
+		{
+			resolve( nodeID );
+		}
+		return worlds_[ nodeID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const TReal TransformSystem::getWorldAlpha( const unsigned long nodeID )
+	{
+		assert( isNode( nodeID ) );
+		if ( dirty_[ nodeID ] )
+		{
+			resolve( nodeID );
+		}
+		return worldAlphas_[ nodeID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const size_t TransformSystem::getDirtyCount()const
+	{
+		return dirtyCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const bool TransformSystem::isNode( const unsigned long nodeID )const
+	{
+		return nodeID < used_.size() && 0 != used_[ nodeID ];
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "boost/noncopyable.hpp"
+#include "boost/function.hpp"
+#include "ddd/Types.h"
+
+namespace ddd
+{
+	//Fixed set of worker threads running posted jobs in FIFO order.
+	//Jobs must not touch the renderer, the window manager or the GUI
+	//Lua state; only the main thread owns those.
+	//Playground builds boost with threads disabled, so the pool sits
+	//directly on Win32 threads kept out of this header.
+	class WorkerPool
+		: private boost::noncopyable
+	{
+	public:
+		typedef boost::function< void () > Job;
+
+		WorkerPool();
+		~WorkerPool();
+
+		//0 threads picks one per core beside the main thread
+		void start( const unsigned long threadCount = 0 );
+		void stop();
+
+		inline const bool isStarted()const;
+		inline const unsigned long getThreadCount()const;
+
+		void post( const Job& job );
+		//blocks until every posted job has finished
+		void wait();
+
+		static const unsigned long getDefaultThreadCount();
+
+	private:
+
+		struct Impl;
+
+		static unsigned int __stdcall threadProc( void* param );
+		void run();
+
+	private:
+
+		Impl* impl_;
+		unsigned long threadCount_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	inline const bool WorkerPool::isStarted()const
+	{
+		return 0 != threadCount_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	inline const unsigned long WorkerPool::getThreadCount()const
+	{
+		return threadCount_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,231 @@
+#include "ddd/AnimationSystem.h"
+#include "ddd/SnapshotArchive.h"
+
+namespace ddd
+{
+	//-------------------------------------------------------------------------
+
+	AnimationSystem::AnimationSystem()
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	AnimationSystem::~AnimationSystem()
+	{
+		release();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long AnimationSystem::addClip( const char* animationName,
+			const unsigned long msPerFrame,
+			const bool loop )
+	{
+		assert( 0 != animationName );
+		TAnimatedTextureRef texture( TAnimatedTexture::Get( animationName ) );
+		assert( texture );
+		return addClip( texture, 0, texture->GetNumFrames(), msPerFrame, loop );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long AnimationSystem::addClip( TAnimatedTextureRef texture,
+			const unsigned long firstFrame,
+			const unsigned long frameCount,
+			const unsigned long msPerFrame,
+			const bool loop )
+	{
+		assert( texture );
+		assert( 0 != frameCount );
+		assert( 0 != msPerFrame );
+		assert( firstFrame + frameCount <= texture->GetNumFrames() );
+
+		Clip clip;
+		clip.texture_ = texture;
+		clip.textureFirstFrame_ = firstFrame;
+		clip.tableOffset_ = static_cast< unsigned long >( frameRects_.size() );
+		clip.frameCount_ = frameCount;
+		clip.msPerFrame_ = msPerFrame;
+		clip.loop_ = loop;
+
+		for ( unsigned long i = 0; i < frameCount; i++ )
+		{
+			const int32_t frame( static_cast< int32_t >( firstFrame + i ) );
+			frameRects_.push_back( texture->GetFrameRect( frame ) );
+			registrationPoints_.push_back( texture->GetRegistrationPoint( frame ) );
+		}
+
+		clips_.push_back( clip );
+		return static_cast< unsigned long >( clips_.size() - 1 );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long AnimationSystem::addInstance( const unsigned long clipID,
+			const unsigned long startTime,
+			const TReal rate )
+	{
+		assert( clipID < clips_.size() );
+
+		unsigned long instanceID( 0 );
+		if ( freeInstanceIDs_.empty() )
+		{
+			instanceID = static_cast< unsigned long >( denseIndices_.size() );
+			denseIndices_.push_back( MAX_UNSIGN_LONG );
+		}else
+		{
+			instanceID = freeInstanceIDs_.back();
+			freeInstanceIDs_.pop_back();
+		}
+
+		denseIndices_[ instanceID ] = static_cast< unsigned long >( clipIDs_.size() );
+		clipIDs_.push_back( clipID );
+		startTimes_.push_back( startTime );
+		rates_.push_back( clampRate( rate ) );
+		frames_.push_back( clips_[ clipID ].tableOffset_ );
+		instanceIDs_.push_back( instanceID );
+		return instanceID;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AnimationSystem::removeInstance( const unsigned long instanceID )
+	{
+		const unsigned long index( getDenseIndex( instanceID ) );
+		const unsigned long last( static_cast< unsigned long >( clipIDs_.size() - 1 ) );
+
+		//swap the last instance into the freed slot to keep arrays packed
+		clipIDs_[ index ] = clipIDs_[ last ];
+		startTimes_[ index ] = startTimes_[ last ];
+		rates_[ index ] = rates_[ last ];
+		frames_[ index ] = frames_[ last ];
+		instanceIDs_[ index ] = instanceIDs_[ last ];
+		denseIndices_[ instanceIDs_[ index ] ] = index;
+
+		clipIDs_.pop_back();
+		startTimes_.pop_back();
+		rates_.pop_back();
+		frames_.pop_back();
+		instanceIDs_.pop_back();
+
+		denseIndices_[ instanceID ] = MAX_UNSIGN_LONG;
+		freeInstanceIDs_.push_back( instanceID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AnimationSystem::removeAllInstances()
+	{
+		clipIDs_.clear();
+		startTimes_.clear();
+		rates_.clear();
+		frames_.clear();
+		instanceIDs_.clear();
+		denseIndices_.clear();
+		freeInstanceIDs_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AnimationSystem::update( const unsigned long time )
+	{
+		const size_t count( clipIDs_.size() );
+		if ( 0 == count )
+		{
+			return;
+		}
+
+		const Clip* clips( &clips_[ 0 ] );
+		const unsigned long* clipIDs( &clipIDs_[ 0 ] );
+		const unsigned long* startTimes( &startTimes_[ 0 ] );
+		const TReal* rates( &rates_[ 0 ] );
+		unsigned long* frames( &frames_[ 0 ] );
+
+		for ( size_t i = 0; i < count; i++ )
+		{
+			const Clip& clip( clips[ clipIDs[ i ] ] );
+			//instances started in the future stay on their first frame
+			const unsigned long elapsed( time > startTimes[ i ] ? time - startTimes[ i ] : 0 );
+			unsigned long step( static_cast< unsigned long >( elapsed * rates[ i ] ) / clip.msPerFrame_ );
+			if ( clip.loop_ )
+			{
+				step %= clip.frameCount_;
+			}else if ( step >= clip.frameCount_ )
+			{
+				step = clip.frameCount_ - 1;
+			}
+			frames[ i ] = clip.tableOffset_ + step;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AnimationSystem::draw( const unsigned long instanceID, const TDrawSpec& drawSpec )const
+	{
+		const unsigned long index( getDenseIndex( instanceID ) );
+		const Clip& clip( clips_[ clipIDs_[ index ] ] );
+		//clips share one texture, so the frame is only selected right before drawing
+		clip.texture_->SetCurrentFrame( static_cast< int32_t >( clip.textureFirstFrame_ + frames_[ index ] - clip.tableOffset_ ) );
+		clip.texture_->DrawSprite( drawSpec );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AnimationSystem::release()
+	{
+		removeAllInstances();
+		clips_.clear();
+		frameRects_.clear();
+		registrationPoints_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+	void AnimationSystem::save( SnapshotWriter& writer )const
+	{
+		//clips hold textures and are set up with the level, so only
+		//the instances go in
+		writer.put( static_cast< uint32_t >( clips_.size() ) );
+		writer.putVector( clipIDs_ );
+		writer.putVector( startTimes_ );
+		writer.putVector( rates_ );
+		writer.putVector( frames_ );
+		writer.putVector( instanceIDs_ );
+		writer.putVector( denseIndices_ );
+		writer.putVector( freeInstanceIDs_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool AnimationSystem::load( SnapshotReader& reader )
+	{
+		uint32_t clipCount( 0 );
+		reader.get( clipCount );
+		reader.getVector( clipIDs_ );
+		reader.getVector( startTimes_ );
+		reader.getVector( rates_ );
+		reader.getVector( frames_ );
+		reader.getVector( instanceIDs_ );
+		reader.getVector( denseIndices_ );
+		reader.getVector( freeInstanceIDs_ );
+
+		const size_t count( clipIDs_.size() );
+		bool valid( !reader.isFailed()
+			&& clips_.size() == clipCount
+			&& count == startTimes_.size()
+			&& count == rates_.size()
+			&& count == frames_.size()
+			&& count == instanceIDs_.size() );
+		for ( size_t i = 0; valid && i < count; i++ )
+		{
+			valid = clipIDs_[ i ] < clips_.size() && frames_[ i ] < frameRects_.size() && rates_[ i ] >= 0;
+		}
+		if ( !valid )
+		{
+			removeAllInstances();
+		}
+		return valid;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -4,17 +4,34 @@
 
 #include <pf/windowmanager.h>
 #include <pf/event.h>
+#include <pf/file.h>
 #include <pf/script.h>
+#include "pf/addons/fxsprite/fxsprite.h"
 
 #include "ddd/Game.h"
 #include "ddd/Factory.h"
 #include "ddd/Actor.h"
 #include "ddd/LevelWindow.h"
+#include "ddd/LevelSnapshot.h"
+#include "ddd/CompiledLevel.h"
+#include "ddd/GlyphCache.h"
+#include "ddd/LuaUtils.h"
 
 namespace ddd
 {
 	static LevelWindow* sBufferBaseWindow = 0;
 
+	//built by running the game with -bundlescripts
+	static const char* const SCRIPT_BUNDLE = "scripts.luab";
+	//submissions not sent yet, carried over to the next run
+	static const char* const HISCORE_OUTBOX = "user:hiscore_outbox.txt";
+	//config setting with the url of the hiscore server
+	static const char* const HISCORE_URL = "hiscoreurl";
+	//appended to every run, see MetricsLog for the format
+	static const char* const METRICS_LOG = "user:metrics.dat";
+	//the level suspendLevel left for resumeLevel
+	static const char* const SUSPEND_FILE = "user:suspend.snap";
+
 	void Application::initApplication( TLuaTable* luaTable )
 	{
 		ddd::Application::get_mutable_instance().init( luaTable );
@@ -31,7 +48,11 @@ namespace ddd
 	void Application::initPlayground(TPlatform* pPlatform)
 	{
 		setFactory( 0 );
+		StartupProfiler::Scope phase( startupProfiler_, "initPlayground" );
+		startupProfiler_.beginPhase( "game states" );
+		metrics_.start( METRICS_LOG );
 		initGameStates();
+		startupProfiler_.endPhase();
 		initWindows(pPlatform);
 	}
 
@@ -40,10 +61,27 @@ namespace ddd
 	void Application::run( TPlatform* pPlatform )
 	{
 		TWindowManager * wm = TWindowManager::GetInstance();
+#ifndef _DEBUG
+		// Serve scripts/ from precompiled chunks; debug builds keep
+		// reading the sources so script edits show up at once, and a
+		// bundle older than the sources next to it isn't mounted.
+		startupProfiler_.beginPhase( "script bundle" );
+		scriptBundle_.mount( SCRIPT_BUNDLE );
+		startupProfiler_.endPhase();
+#endif
+		// Specs the native kernel can run are stepped on worker threads
+		// for the rest of the run; the rest stay in Lua on this thread.
+		TFxSprite::SetNativeKernels( true );
+		TFxSprite::GetAnimTask()->StartWorkers();
+
 		// Start the Lua GUI script; this script will never exit
 		// in a typical Playground application.
+		startupProfiler_.beginPhase( "mainloop script" );
 		ScriptRegisterMemberDirect( wm->GetScript(),"initApplication", this, Application::initApplication );
 		wm->GetScript()->RunScript("scripts/mainloop.lua");
+		startupProfiler_.endPhase();
+
+		hiscoreClient_.start( TPlatform::GetConfig( HISCORE_URL ).c_str(), HISCORE_OUTBOX );
 
 		// The main C++ loop
 		TEvent event;
@@ -57,7 +95,7 @@ namespace ddd
 
 			if (event.mType == TEvent::kClose)
 			{
-				TWindowManager::GetInstance()->GetScript()->RunScript("scripts/quitverify.lua");
+				scriptCache_.runScript( TWindowManager::GetInstance()->GetScript(), "scripts/quitverify.lua" );
 			}
 
 			if (event.mType == TEvent::kFullScreenToggle)
@@ -69,7 +107,13 @@ namespace ddd
 			TPlatform::GetInstance()->GetWindowManager()->HandleEvent(&event);
 		}
 
+		hiscoreClient_.stop();
 		release();
+		TFxSprite::Shutdown();
+		metrics_.stop();
+		scriptCache_.clear();
+		GlyphCache::releaseAll();
+		scriptBundle_.unmount();
 		TSettings::DeleteSettings();
 	}
 
@@ -77,6 +121,7 @@ namespace ddd
 
 	void Application::onInit()
 	{
+		StartupProfiler::Scope phase( startupProfiler_, "Application:onInit" );
 		removeAllEntity();
 		setFactory( new Factory() );
 		getFactory()->init( TWindowManager::GetInstance()->GetScript(), this );
@@ -84,9 +129,29 @@ namespace ddd
 		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"addGame", this, Application::addGame );
 		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"addLevel", this, Application::addLevel );
 		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"addActor", this, Application::addActor );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"setTileGrid", this, Application::setTileGrid );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"addWave", this, Application::addWave );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"loadCompiledLevel", this, Application::loadCompiledLevel );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"setProgress", this, Application::setProgress );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"removeProgress", this, Application::removeProgress );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"setActorAnimation", this, Application::setActorAnimation );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"setActorFx", this, Application::setActorFx );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"setActorPosition", this, Application::setActorPosition );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"setActorLayer", this, Application::setActorLayer );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"setLayerYSorted", this, Application::setLayerYSorted );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"preloadAssets", this, Application::preloadAssets );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"releaseAssets", this, Application::releaseAssets );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"isAssetsLoaded", this, Application::isAssetsLoaded );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"rewindLevel", this, Application::rewindLevel );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"suspendLevel", this, Application::suspendLevel );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"resumeLevel", this, Application::resumeLevel );
+		ScriptRegisterMemberDirect( TWindowManager::GetInstance()->GetScript(),"recordMetric", this, Application::recordMetric );
 		
 		initLuaFunction( 0, "onInit" );
 		initLuaFunction( 1, "onCreateLevelTable" );
+		initLuaFunction( 2, "onAssetProgress" );
+		assetPreloader_.setProgressCallback( &Application::onAssetProgress, this );
+		assetPreloader_.start();
 		executeLuaFunction( 0 );
 	}
 
@@ -97,9 +162,29 @@ namespace ddd
 		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "addGame" );
 		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "addLevel" );
 		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "addActor" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "setTileGrid" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "addWave" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "loadCompiledLevel" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "setProgress" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "removeProgress" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "setActorAnimation" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "setActorFx" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "setActorPosition" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "setActorLayer" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "setLayerYSorted" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "preloadAssets" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "releaseAssets" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "isAssetsLoaded" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "rewindLevel" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "suspendLevel" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "resumeLevel" );
+		ScriptUnregisterFunction( TWindowManager::GetInstance()->GetScript(), "recordMetric" );
 
+		assetPreloader_.stop();
+		assetPreloader_.setProgressCallback( 0, 0 );
 		releaseLuaFunction( 0 );
 		releaseLuaFunction( 1 );
+		releaseLuaFunction( 2 );
 		getFactory()->release();
 		Factory* factory( getFactory() );
 		setFactory( 0 );
@@ -143,6 +228,175 @@ namespace ddd
 
 	//-------------------------------------------------------------------------
 
+	void Application::setTileGrid( const unsigned long columns,
+					const unsigned long rows,
+					const unsigned long tileSize,
+					TLuaTable* tiles,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		assert( 0 != tiles );
+		std::vector< uint16_t > grid( columns * rows );
+		for ( size_t i = 0; i < grid.size(); i++ )
+		{
+			grid[ i ] = static_cast< uint16_t >( tiles->GetNumber( static_cast< lua_Number >( i + 1 ) ) );
+		}
+		getEntity( gameID ).getEntity( levelID ).setTileGrid( columns, rows, tileSize, grid.empty() ? 0 : &grid[ 0 ] );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::addWave( const unsigned long time,
+					str actorType,
+					const unsigned long count,
+					const unsigned long interval,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		LevelWave wave;
+		wave.time_ = time;
+		wave.actorType_ = actorType.c_str();
+		wave.count_ = count;
+		wave.interval_ = interval;
+		getEntity( gameID ).getEntity( levelID ).addWave( wave );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::setProgress( const unsigned long actorID,
+					const TReal progress,
+					const TReal x,
+					const TReal y,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		getEntity( gameID ).getEntity( levelID ).setProgress( actorID, progress, x, y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::removeProgress( const unsigned long actorID,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		getEntity( gameID ).getEntity( levelID ).removeProgress( actorID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::setActorAnimation( const unsigned long actorID,
+					str animationName,
+					const unsigned long msPerFrame,
+					const bool loop,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		getEntity( gameID ).getEntity( levelID ).setActorAnimation( actorID, animationName.c_str(), msPerFrame, loop );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::setActorFx( const unsigned long actorID,
+					str spec,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		getEntity( gameID ).getEntity( levelID ).setActorFx( actorID, spec.c_str() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::setActorPosition( const unsigned long actorID,
+					const TReal x,
+					const TReal y,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		getEntity( gameID ).getEntity( levelID ).setActorPosition( actorID, Vec2( x, y ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::setActorLayer( const unsigned long actorID,
+					const long layer,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		getEntity( gameID ).getEntity( levelID ).setActorLayer( actorID, layer );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::setLayerYSorted( const long layer,
+					const bool ySorted,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		getEntity( gameID ).getEntity( levelID ).getDrawOrder().setYSorted( layer, ySorted );
+	}
+
+	//-------------------------------------------------------------------------
+
+	bool Application::loadCompiledLevel( const unsigned long gameID, const unsigned long levelID )
+	{
+		CompiledLevel compiled;
+		if ( !compiled.open( CompiledLevel::getFileName( gameID, levelID ).c_str() ) )
+		{
+			return false;
+		}
+		const CompiledLevel::Header& header( compiled.getHeader() );
+		if ( gameID != header.gameID_ || levelID != header.levelID_ )
+		{
+			return false;
+		}
+		//compiled before the last edit to the descriptions; a release
+		//serving the scripts from the bundle ships them with the files
+		uint32_t sourceHash( 0 );
+		if ( CompiledLevel::hashSource( CompiledLevel::DESCRIPTION_SCRIPT, sourceHash )
+			&& sourceHash != header.sourceHash_ )
+		{
+			return false;
+		}
+
+		LevelWindow& level( getEntity( gameID ).getEntity( levelID ) );
+		level.setTileGrid( header.tileColumns_, header.tileRows_, header.tileSize_, compiled.getTiles() );
+		const CompiledLevel::WaveRecord* waves( compiled.getWaves() );
+		for ( unsigned long i = 0; i < compiled.getWaveCount(); i++ )
+		{
+			LevelWave wave;
+			wave.time_ = waves[ i ].time_;
+			wave.actorType_ = compiled.getString( waves[ i ].type_ );
+			wave.count_ = waves[ i ].count_;
+			wave.interval_ = waves[ i ].interval_;
+			level.addWave( wave );
+		}
+
+		//each actor gets the table Actor:new() would have made for it
+		lua_State* L( TWindowManager::GetInstance()->GetScript()->GetState() );
+		lua_getglobal( L, "Actor" );
+		assert( lua_istable( L, -1 ) );
+		const int prototype( lua_gettop( L ) );
+		const CompiledLevel::ActorRecord* actors( compiled.getActors() );
+		level.reserveActors( compiled.getActorCount() );
+		for ( unsigned long i = 0; i < compiled.getActorCount(); i++ )
+		{
+			const char* type( compiled.getString( actors[ i ].type_ ) );
+			cloneTable( L, prototype );
+			TLuaTable actorTable( L );
+			setULong( actorTable, "ID_", actors[ i ].id_ );
+			actorTable.Assign( "type_", str( type ) );
+
+			Actor* actor = getFactory()->createActor( type );
+			assert( 0 != actor );
+			actor->init( &actorTable );
+			level.addActor( *actor );
+		}
+		lua_pop( L, 1 );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
 	void Application::addLevel( TLuaTable* gameTable )
 	{
 		assert( 0 != sBufferBaseWindow );
@@ -165,5 +419,84 @@ namespace ddd
 		executeLuaFunction( 1, pTable );
 	}
 
+	//-------------------------------------------------------------------------
+	bool Application::preloadAssets( str manifest )
+	{
+		return assetPreloader_.preload( manifest.c_str() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::releaseAssets( str manifest )
+	{
+		assetPreloader_.release( manifest.c_str() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	bool Application::isAssetsLoaded( str manifest )
+	{
+		return assetPreloader_.isLoaded( manifest.c_str() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	bool Application::rewindLevel( const unsigned long ms,
+					const unsigned long gameID,
+					const unsigned long levelID )
+	{
+		LevelWindow& level( getEntity( gameID ).getEntity( levelID ) );
+		return level.getSnapshots().rewind( level, ms );
+	}
+
+	//-------------------------------------------------------------------------
+
+	bool Application::suspendLevel( const unsigned long gameID, const unsigned long levelID )
+	{
+		LevelSnapshot snapshot;
+		snapshot.capture( getEntity( gameID ).getEntity( levelID ) );
+		return snapshot.save( SUSPEND_FILE );
+	}
+
+	//-------------------------------------------------------------------------
+
+	bool Application::resumeLevel( const unsigned long gameID, const unsigned long levelID )
+	{
+		LevelSnapshot snapshot;
+		LevelWindow& level( getEntity( gameID ).getEntity( levelID ) );
+		if ( !snapshot.load( SUSPEND_FILE ) || !snapshot.restore( level ) )
+		{
+			return false;
+		}
+		//rewinding must not go back to before the resume
+		level.getSnapshots().clear();
+		TFile::DeleteFile( SUSPEND_FILE );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::recordMetric( str name, const long value )
+	{
+		metrics_.value( name.c_str(), value );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void Application::onAssetProgress( void* owner,
+					const std::string& manifest,
+					const unsigned long loaded,
+					const unsigned long total )
+	{
+		Application* application( static_cast< Application* >( owner ) );
+		TScript * pScript( TWindowManager::GetInstance()->GetScript() );
+		TLuaTable * pTable( TLuaTable::Create( pScript->GetState() ) );
+		pTable->Assign( "manifest", str( manifest.c_str() ) );
+		pTable->Assign( "loaded", static_cast<lua_Number>(loaded) );
+		pTable->Assign( "total", static_cast<lua_Number>(total) );
+		application->executeLuaFunction( 2, pTable );
+		delete pTable;
+	}
+
 	//-------------------------------------------------------------------------
 }
\ No newline at end of file
@@ -0,0 +1,436 @@
+#include "ddd/AssetPreloader.h"
+
+#include <pf/animtask.h>
+#include <pf/file.h>
+#include <pf/platform.h>
+#include <windows.h>
+#include "boost/bind.hpp"
+
+namespace ddd
+{
+	//ms of texture and sound creation allowed per frame
+	static const unsigned long ASSET_UPLOAD_BUDGET = 4;
+
+	static const char* const TEXTURE_EXTENSIONS[] = { ".png", ".jpg", 0 };
+	static const char* const ANIMATION_EXTENSIONS[] = { ".xml", ".anm", 0 };
+	static const char* const SOUND_EXTENSIONS[] = { ".ogg", ".wav", 0 };
+
+	static const char* const ASSET_TYPE_NAMES[ AssetPreloader::AT_COUNT ] =
+	{
+		"texture",
+		"animation",
+		"sound"
+	};
+
+	//-------------------------------------------------------------------------
+
+	class AssetPreloader::Task
+		: public TAnimTask
+	{
+	public:
+		Task( AssetPreloader* owner )
+			: owner_( owner )
+		{
+		}
+
+		void detach()
+		{
+			owner_ = 0;
+		}
+
+		virtual bool Animate()
+		{
+			if ( 0 == owner_ )
+			{
+				return false;
+			}
+			owner_->update( ASSET_UPLOAD_BUDGET );
+			return true;
+		}
+
+	private:
+		AssetPreloader* owner_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	AssetPreloader::AssetPreloader()
+		: loadingCount_( 0 )
+		, task_( 0 )
+		, callback_( 0 )
+		, callbackOwner_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	AssetPreloader::~AssetPreloader()
+	{
+		stop();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::start( const unsigned long threadCount )
+	{
+		assert( !isStarted() );
+		workers_.start( threadCount );
+		task_ = new Task( this );
+		TPlatform::GetInstance()->AdoptTask( task_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::stop()
+	{
+		if ( !isStarted() )
+		{
+			return;
+		}
+
+		releaseAll();
+		workers_.stop();
+		//the platform owns the task and deletes it once it returns false
+		task_->detach();
+		task_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool AssetPreloader::preload( const std::string& manifest )
+	{
+		assert( isStarted() );
+		if ( batches_.end() != batches_.find( manifest ) )
+		{
+			return true;
+		}
+
+		Batch* batch( new Batch );
+		batch->loaded_ = 0;
+		if ( !readManifest( manifest, *batch ) )
+		{
+			delete batch;
+			return false;
+		}
+		batches_[ manifest ] = batch;
+
+		for ( size_t i = 0; i < batch->assets_.size(); i++ )
+		{
+			Asset* asset( batch->assets_[ i ] );
+			addFiles( *asset );
+			if ( asset->files_.empty() )
+			{
+				//packed or missing; Playground loads it the usual way
+				asset->read_ = 1;
+			}
+			else
+			{
+				workers_.post( boost::bind( &AssetPreloader::read, this, asset ) );
+			}
+		}
+
+		if ( !batch->assets_.empty() )
+		{
+			loadingCount_++;
+		}
+		if ( 0 != callback_ )
+		{
+			callback_( callbackOwner_, manifest, 0, static_cast< unsigned long >( batch->assets_.size() ) );
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::release( const std::string& manifest )
+	{
+		Batches::iterator it( batches_.find( manifest ) );
+		if ( batches_.end() == it )
+		{
+			return;
+		}
+		releaseBatch( it->second );
+		batches_.erase( it );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::releaseAll()
+	{
+		for ( Batches::iterator it = batches_.begin(); it != batches_.end(); ++it )
+		{
+			releaseBatch( it->second );
+		}
+		batches_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool AssetPreloader::isLoaded( const std::string& manifest )const
+	{
+		Batches::const_iterator it( batches_.find( manifest ) );
+		return batches_.end() != it && it->second->loaded_ == it->second->assets_.size();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long AssetPreloader::getLoadedCount( const std::string& manifest )const
+	{
+		Batches::const_iterator it( batches_.find( manifest ) );
+		return batches_.end() != it ? it->second->loaded_ : 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long AssetPreloader::getTotalCount( const std::string& manifest )const
+	{
+		Batches::const_iterator it( batches_.find( manifest ) );
+		return batches_.end() != it ? static_cast< unsigned long >( it->second->assets_.size() ) : 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::update( const unsigned long budget )
+	{
+		if ( !isLoading() )
+		{
+			return;
+		}
+
+		TPlatform* platform( TPlatform::GetInstance() );
+		const unsigned long startTime( platform->Timer() );
+		bool outOfTime( false );
+
+		for ( Batches::iterator it = batches_.begin(); it != batches_.end() && !outOfTime; ++it )
+		{
+			Batch& batch( *it->second );
+			const unsigned long total( static_cast< unsigned long >( batch.assets_.size() ) );
+			const unsigned long loaded( batch.loaded_ );
+
+			//assets are created in manifest order, the order the workers read them
+			while ( batch.loaded_ < total && 0 != batch.assets_[ batch.loaded_ ]->read_ )
+			{
+				create( batch, *batch.assets_[ batch.loaded_ ] );
+				batch.loaded_++;
+				if ( platform->Timer() - startTime >= budget )
+				{
+					outOfTime = true;
+					break;
+				}
+			}
+
+			if ( loaded == batch.loaded_ )
+			{
+				continue;
+			}
+			if ( total == batch.loaded_ )
+			{
+				loadingCount_--;
+			}
+			if ( 0 != callback_ )
+			{
+				callback_( callbackOwner_, it->first, batch.loaded_, total );
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool AssetPreloader::readManifest( const std::string& manifest, Batch& batch )const
+	{
+		TFile file;
+		if ( !file.Open( manifest.c_str(), kReadText ) )
+		{
+			return false;
+		}
+
+		std::string text( file.Size(), '\0' );
+		const long bytesRead( text.empty() ? 0 : file.Read( &text[ 0 ], static_cast< unsigned long >( text.size() ) ) );
+		if ( bytesRead < 0 )
+		{
+			return false;
+		}
+		text.resize( bytesRead );
+
+		size_t lineStart( 0 );
+		while ( lineStart < text.size() )
+		{
+			size_t lineEnd( text.find_first_of( "\r\n", lineStart ) );
+			if ( std::string::npos == lineEnd )
+			{
+				lineEnd = text.size();
+			}
+			const std::string line( text, lineStart, lineEnd - lineStart );
+			lineStart = lineEnd + 1;
+
+			const size_t typeStart( line.find_first_not_of( " \t" ) );
+			if ( std::string::npos == typeStart || '#' == line[ typeStart ] )
+			{
+				continue;
+			}
+			const size_t typeEnd( line.find_first_of( " \t", typeStart ) );
+			const size_t nameStart( std::string::npos != typeEnd ? line.find_first_not_of( " \t", typeEnd ) : std::string::npos );
+			if ( std::string::npos == nameStart )
+			{
+				continue;
+			}
+			const size_t nameEnd( line.find_last_not_of( " \t" ) + 1 );
+			const std::string type( line, typeStart, typeEnd - typeStart );
+
+			for ( unsigned long t = 0; t < AT_COUNT; t++ )
+			{
+				if ( type == ASSET_TYPE_NAMES[ t ] )
+				{
+					Asset* asset( new Asset );
+					asset->type_ = static_cast< AssetType >( t );
+					asset->name_.assign( line, nameStart, nameEnd - nameStart );
+					asset->read_ = 0;
+					batch.assets_.push_back( asset );
+					break;
+				}
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::addFiles( Asset& asset )const
+	{
+		//flags such as "?slow" are not part of the file name
+		const std::string name( asset.name_, 0, asset.name_.find( '?' ) );
+		const std::string base( name, 0, name.find( '.', name.find_last_of( '/' ) + 1 ) );
+		switch ( asset.type_ )
+		{
+		case AT_TEXTURE:
+			addFile( asset, name, base, TEXTURE_EXTENSIONS );
+			break;
+		case AT_ANIMATION:
+			addFile( asset, name, base, ANIMATION_EXTENSIONS );
+			//the frames usually sit beside the description under the same name
+			addFile( asset, base, base, TEXTURE_EXTENSIONS );
+			break;
+		case AT_SOUND:
+			addFile( asset, name, base, SOUND_EXTENSIONS );
+			break;
+		default:
+			assert( false );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool AssetPreloader::addFile( Asset& asset,
+				const std::string& name,
+				const std::string& base,
+				const char* const* extensions )
+	{
+		//a name with an extension is taken as is, otherwise the extensions
+		//are tried in the order Playground searches them
+		for ( unsigned long i = 0; name != base || 0 != extensions[ i ]; i++ )
+		{
+			const std::string fileName( name != base ? name : base + extensions[ i ] );
+			const str path( TFile::TranslateResource( fileName.c_str(), true ) );
+			if ( !path.empty() )
+			{
+				File file;
+				file.name_ = fileName;
+				file.path_ = path.c_str();
+				asset.files_.push_back( file );
+				return true;
+			}
+			if ( name != base )
+			{
+				break;
+			}
+		}
+		return false;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::read( Asset* asset )
+	{
+		//worker thread; only touches the asset and the native file system
+		for ( size_t i = 0; i < asset->files_.size(); i++ )
+		{
+			File& file( asset->files_[ i ] );
+			HANDLE handle( CreateFileA( file.path_.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
+					OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0 ) );
+			if ( INVALID_HANDLE_VALUE == handle )
+			{
+				continue;
+			}
+			const DWORD size( GetFileSize( handle, 0 ) );
+			DWORD bytesRead( 0 );
+			if ( INVALID_FILE_SIZE != size && 0 != size )
+			{
+				file.data_.resize( size );
+				if ( !ReadFile( handle, &file.data_[ 0 ], size, &bytesRead, 0 ) || bytesRead != size )
+				{
+					std::vector< char >().swap( file.data_ );
+				}
+			}
+			CloseHandle( handle );
+		}
+		InterlockedExchange( &asset->read_, 1 );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::create( Batch& batch, Asset& asset )
+	{
+		for ( size_t i = 0; i < asset.files_.size(); i++ )
+		{
+			File& file( asset.files_[ i ] );
+			if ( !file.data_.empty() )
+			{
+				TFile::AddMemoryFile( file.name_.c_str(), &file.data_[ 0 ], static_cast< uint32_t >( file.data_.size() ) );
+			}
+		}
+
+		switch ( asset.type_ )
+		{
+		case AT_TEXTURE:
+			batch.textures_.push_back( TTexture::Get( asset.name_.c_str() ) );
+			break;
+		case AT_ANIMATION:
+			batch.animations_.push_back( TAnimatedTexture::Get( asset.name_.c_str() ) );
+			break;
+		case AT_SOUND:
+			batch.sounds_.push_back( TSound::Get( asset.name_.c_str() ) );
+			break;
+		default:
+			assert( false );
+		}
+
+		for ( size_t i = 0; i < asset.files_.size(); i++ )
+		{
+			File& file( asset.files_[ i ] );
+			if ( !file.data_.empty() )
+			{
+				TFile::AddMemoryFile( file.name_.c_str(), 0, 0 );
+				std::vector< char >().swap( file.data_ );
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void AssetPreloader::releaseBatch( Batch* batch )
+	{
+		if ( batch->loaded_ < batch->assets_.size() )
+		{
+			//reads still queued point into the assets
+			workers_.wait();
+			loadingCount_--;
+		}
+		for ( size_t i = 0; i < batch->assets_.size(); i++ )
+		{
+			delete batch->assets_[ i ];
+		}
+		delete batch;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,224 @@
+#include "ddd/CompiledLevel.h"
+
+#include <stdio.h>
+#include <vector>
+#include <pf/file.h>
+#include <pf/str.h>
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+namespace ddd
+{
+	const char* const CompiledLevel::DESCRIPTION_SCRIPT = "scripts/levels.lua";
+
+	//-------------------------------------------------------------------------
+
+	struct CompiledLevel::Impl
+	{
+		boost::interprocess::file_mapping mapping_;
+		boost::interprocess::mapped_region region_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	CompiledLevel::CompiledLevel()
+		: impl_( 0 )
+		, data_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	CompiledLevel::~CompiledLevel()
+	{
+		close();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool CompiledLevel::open( const char* fileName )
+	{
+		assert( 0 != fileName );
+		close();
+
+		//only files on disk can be mapped; packed levels take the Lua path
+		const str path( TFile::TranslateResource( fileName, true ) );
+		if ( path.empty() )
+		{
+			return false;
+		}
+
+		impl_ = new Impl;
+		try
+		{
+			boost::interprocess::file_mapping mapping( path.c_str(), boost::interprocess::read_only );
+			boost::interprocess::mapped_region region( mapping, boost::interprocess::read_only );
+			impl_->mapping_.swap( mapping );
+			impl_->region_.swap( region );
+		}
+		catch ( const boost::interprocess::interprocess_exception& )
+		{
+			close();
+			return false;
+		}
+
+		data_ = static_cast< const char* >( impl_->region_.get_address() );
+		if ( !validate( static_cast< unsigned long >( impl_->region_.get_size() ) ) )
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void CompiledLevel::close()
+	{
+		delete impl_;
+		impl_ = 0;
+		data_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const std::string CompiledLevel::getFileName( const unsigned long gameID, const unsigned long levelID )
+	{
+		return str::getFormatted( "levels/level_%lu_%lu.lvl", gameID, levelID ).c_str();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const uint32_t CompiledLevel::checksum( const char* data, const unsigned long size )
+	{
+		//Adler-32; 5552 is the longest run before the sums can overflow
+		static const unsigned long MOD_ADLER = 65521;
+		static const unsigned long MAX_RUN = 5552;
+
+		const unsigned char* bytes( reinterpret_cast< const unsigned char* >( data ) );
+		unsigned long a( 1 );
+		unsigned long b( 0 );
+		unsigned long left( size );
+		while ( 0 != left )
+		{
+			const unsigned long run( left < MAX_RUN ? left : MAX_RUN );
+			for ( unsigned long i = 0; i < run; i++ )
+			{
+				a += *bytes++;
+				b += a;
+			}
+			a %= MOD_ADLER;
+			b %= MOD_ADLER;
+			left -= run;
+		}
+		return static_cast< uint32_t >( ( b << 16 ) | a );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool CompiledLevel::hashSource( const char* script, uint32_t& hash )
+	{
+		assert( 0 != script );
+		//the native file, not the bytecode a bundle may serve under its name
+		const str path( TFile::TranslateResource( script, true ) );
+		if ( path.empty() )
+		{
+			return false;
+		}
+		FILE* file( fopen( path.c_str(), "rb" ) );
+		if ( 0 == file )
+		{
+			return false;
+		}
+
+		std::vector< char > source;
+		char buffer[ 4096 ];
+		size_t read( 0 );
+		while ( 0 != ( read = fread( buffer, 1, sizeof( buffer ), file ) ) )
+		{
+			source.insert( source.end(), buffer, buffer + read );
+		}
+		const bool success( 0 == ferror( file ) );
+		fclose( file );
+		if ( !success )
+		{
+			return false;
+		}
+		hash = checksum( source.empty() ? 0 : &source[ 0 ], static_cast< unsigned long >( source.size() ) );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool CompiledLevel::validate( const unsigned long size )const
+	{
+		if ( size < sizeof( Header ) )
+		{
+			return false;
+		}
+
+		const Header& header( getHeader() );
+		if ( MAGIC != header.magic_ || VERSION != header.version_ || size != header.size_ )
+		{
+			return false;
+		}
+
+		//every section has to lie inside the file; counts are checked
+		//against the room left so the products can't overflow
+		const unsigned long tileCount( header.tileColumns_ * header.tileRows_ );
+		if ( 0 != header.tileColumns_ && tileCount / header.tileColumns_ != header.tileRows_ )
+		{
+			return false;
+		}
+		if ( header.actorOffset_ < sizeof( Header ) || header.actorOffset_ > size
+			|| header.actorCount_ > ( size - header.actorOffset_ ) / sizeof( ActorRecord ) )
+		{
+			return false;
+		}
+		if ( header.tileOffset_ < sizeof( Header ) || header.tileOffset_ > size
+			|| tileCount > ( size - header.tileOffset_ ) / sizeof( uint16_t ) )
+		{
+			return false;
+		}
+		if ( header.waveOffset_ < sizeof( Header ) || header.waveOffset_ > size
+			|| header.waveCount_ > ( size - header.waveOffset_ ) / sizeof( WaveRecord ) )
+		{
+			return false;
+		}
+		if ( header.stringOffset_ < sizeof( Header ) || header.stringOffset_ > size
+			|| header.stringSize_ > size - header.stringOffset_ )
+		{
+			return false;
+		}
+		if ( 0 != ( header.actorOffset_ | header.tileOffset_ | header.waveOffset_ ) % sizeof( uint32_t ) )
+		{
+			return false;
+		}
+
+		//the pool must end in a terminator so no string runs off the end
+		if ( 0 != header.stringSize_ && '\0' != data_[ header.stringOffset_ + header.stringSize_ - 1 ] )
+		{
+			return false;
+		}
+		const ActorRecord* actors( getActors() );
+		for ( unsigned long i = 0; i < header.actorCount_; i++ )
+		{
+			if ( actors[ i ].type_ >= header.stringSize_ )
+			{
+				return false;
+			}
+		}
+		const WaveRecord* waves( getWaves() );
+		for ( unsigned long i = 0; i < header.waveCount_; i++ )
+		{
+			if ( waves[ i ].type_ >= header.stringSize_ )
+			{
+				return false;
+			}
+		}
+
+		return header.checksum_ == checksum( data_ + sizeof( Header ), size - sizeof( Header ) );
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,398 @@
+#include "ddd/DrawOrder.h"
+#include "ddd/SnapshotArchive.h"
+
+#include <string.h>
+
+namespace ddd
+{
+	//below this many items a y-sorted bucket is insertion sorted
+	static const size_t RADIX_SORT_MIN = 32;
+
+	//-------------------------------------------------------------------------
+
+	//maps a float to an unsigned key with the same order
+	static inline const uint32_t getSortKey( const TReal y )
+	{
+		uint32_t bits( 0 );
+		memcpy( &bits, &y, sizeof( bits ) );
+		return ( bits & 0x80000000 ) ? ~bits : ( bits | 0x80000000 );
+	}
+
+	//-------------------------------------------------------------------------
+
+	DrawOrder::DrawOrder()
+		: itemCount_( 0 )
+		, drawListDirty_( false )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	DrawOrder::~DrawOrder()
+	{
+		release();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long DrawOrder::addItem( const long layer, const TReal y )
+	{
+		unsigned long itemID( 0 );
+		if ( freeItemIDs_.empty() )
+		{
+			itemID = static_cast< unsigned long >( used_.size() );
+			layers_.push_back( layer );
+			ys_.push_back( y );
+			slots_.push_back( MAX_UNSIGN_LONG );
+			used_.push_back( 1 );
+		}else
+		{
+			itemID = freeItemIDs_.back();
+			freeItemIDs_.pop_back();
+			layers_[ itemID ] = layer;
+			ys_[ itemID ] = y;
+			used_[ itemID ] = 1;
+		}
+		itemCount_++;
+
+		insert( itemID, getBucket( layer ) );
+		return itemID;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::removeItem( const unsigned long itemID )
+	{
+		assert( isItem( itemID ) );
+		erase( itemID );
+		used_[ itemID ] = 0;
+		freeItemIDs_.push_back( itemID );
+		itemCount_--;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::removeAllItems()
+	{
+		buckets_.clear();
+		layers_.clear();
+		ys_.clear();
+		slots_.clear();
+		used_.clear();
+		freeItemIDs_.clear();
+		itemCount_ = 0;
+		drawList_.clear();
+		drawListDirty_ = false;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::setLayer( const unsigned long itemID, const long layer )
+	{
+		assert( isItem( itemID ) );
+		if ( layers_[ itemID ] == layer )
+		{
+			return;
+		}
+		erase( itemID );
+		layers_[ itemID ] = layer;
+		insert( itemID, getBucket( layer ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::setYSorted( const long layer, const bool ySorted )
+	{
+		Bucket& bucket( buckets_[ getBucket( layer ) ] );
+		if ( bucket.ySorted_ != ySorted )
+		{
+			bucket.ySorted_ = ySorted;
+			bucket.dirty_ = true;
+			drawListDirty_ = true;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool DrawOrder::isYSorted( const long layer )const
+	{
+		const unsigned long bucket( findBucket( layer ) );
+		return MAX_UNSIGN_LONG != bucket && buckets_[ bucket ].ySorted_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const std::vector< unsigned long >& DrawOrder::getDrawList()
+	{
+		if ( !drawListDirty_ )
+		{
+			return drawList_;
+		}
+
+		drawList_.clear();
+		for ( size_t i = 0; i < buckets_.size(); i++ )
+		{
+			Bucket& bucket( buckets_[ i ] );
+			if ( bucket.dirty_ )
+			{
+				compact( bucket );
+				if ( bucket.ySorted_ )
+				{
+					sortByY( bucket );
+				}
+				bucket.dirty_ = false;
+			}
+			drawList_.insert( drawList_.end(), bucket.items_.begin(), bucket.items_.end() );
+		}
+		drawListDirty_ = false;
+		return drawList_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::release()
+	{
+		removeAllItems();
+		keys_.clear();
+		sortedKeys_.clear();
+		sortedItems_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long DrawOrder::getBucket( const long layer )
+	{
+		size_t first( 0 );
+		size_t last( buckets_.size() );
+		while ( first < last )
+		{
+			const size_t middle( ( first + last ) / 2 );
+			if ( buckets_[ middle ].layer_ < layer )
+			{
+				first = middle + 1;
+			}else
+			{
+				last = middle;
+			}
+		}
+
+		if ( first == buckets_.size() || buckets_[ first ].layer_ != layer )
+		{
+			//a new layer; empty buckets are kept for reuse
+			Bucket bucket;
+			bucket.layer_ = layer;
+			bucket.ySorted_ = false;
+			bucket.dirty_ = false;
+			bucket.holes_ = 0;
+			buckets_.insert( buckets_.begin() + first, bucket );
+		}
+		return static_cast< unsigned long >( first );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long DrawOrder::findBucket( const long layer )const
+	{
+		size_t first( 0 );
+		size_t last( buckets_.size() );
+		while ( first < last )
+		{
+			const size_t middle( ( first + last ) / 2 );
+			if ( buckets_[ middle ].layer_ < layer )
+			{
+				first = middle + 1;
+			}else
+			{
+				last = middle;
+			}
+		}
+		return first < buckets_.size() && buckets_[ first ].layer_ == layer
+				? static_cast< unsigned long >( first )
+				: MAX_UNSIGN_LONG;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::insert( const unsigned long itemID, const unsigned long bucketIndex )
+	{
+		Bucket& bucket( buckets_[ bucketIndex ] );
+		slots_[ itemID ] = static_cast< unsigned long >( bucket.items_.size() );
+		bucket.items_.push_back( itemID );
+		bucket.dirty_ = true;
+		drawListDirty_ = true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::erase( const unsigned long itemID )
+	{
+		const unsigned long bucketIndex( findBucket( layers_[ itemID ] ) );
+		assert( MAX_UNSIGN_LONG != bucketIndex );
+		Bucket& bucket( buckets_[ bucketIndex ] );
+		assert( bucket.items_[ slots_[ itemID ] ] == itemID );
+
+		bucket.items_[ slots_[ itemID ] ] = MAX_UNSIGN_LONG;
+		bucket.holes_++;
+		slots_[ itemID ] = MAX_UNSIGN_LONG;
+		bucket.dirty_ = true;
+		drawListDirty_ = true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::compact( Bucket& bucket )
+	{
+		if ( 0 == bucket.holes_ )
+		{
+			return;
+		}
+
+		size_t count( 0 );
+		for ( size_t i = 0; i < bucket.items_.size(); i++ )
+		{
+			const unsigned long itemID( bucket.items_[ i ] );
+			if ( MAX_UNSIGN_LONG != itemID )
+			{
+				slots_[ itemID ] = static_cast< unsigned long >( count );
+				bucket.items_[ count++ ] = itemID;
+			}
+		}
+		bucket.items_.resize( count );
+		bucket.holes_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void DrawOrder::sortByY( Bucket& bucket )
+	{
+		std::vector< unsigned long >& items( bucket.items_ );
+		const size_t count( items.size() );
+
+		keys_.resize( count );
+		for ( size_t i = 0; i < count; i++ )
+		{
+			keys_[ i ] = getSortKey( ys_[ items[ i ] ] );
+		}
+
+		if ( count < RADIX_SORT_MIN )
+		{
+			for ( size_t i = 1; i < count; i++ )
+			{
+				const uint32_t key( keys_[ i ] );
+				const unsigned long itemID( items[ i ] );
+				size_t j( i );
+				for ( ; j > 0 && keys_[ j - 1 ] > key; j-- )
+				{
+					keys_[ j ] = keys_[ j - 1 ];
+					items[ j ] = items[ j - 1 ];
+				}
+				keys_[ j ] = key;
+				items[ j ] = itemID;
+			}
+		}else
+		{
+			//least significant byte first; every pass is stable
+			sortedKeys_.resize( count );
+			sortedItems_.resize( count );
+			for ( unsigned long shift = 0; shift < 32; shift += 8 )
+			{
+				size_t offsets[ 256 ];
+				memset( offsets, 0, sizeof( offsets ) );
+				for ( size_t i = 0; i < count; i++ )
+				{
+					offsets[ ( keys_[ i ] >> shift ) & 0xFF ]++;
+				}
+				//all keys share this byte
+				if ( count == offsets[ ( keys_[ 0 ] >> shift ) & 0xFF ] )
+				{
+					continue;
+				}
+
+				size_t sum( 0 );
+				for ( size_t b = 0; b < 256; b++ )
+				{
+					const size_t n( offsets[ b ] );
+					offsets[ b ] = sum;
+					sum += n;
+				}
+				for ( size_t i = 0; i < count; i++ )
+				{
+					const size_t to( offsets[ ( keys_[ i ] >> shift ) & 0xFF ]++ );
+					sortedKeys_[ to ] = keys_[ i ];
+					sortedItems_[ to ] = items[ i ];
+				}
+				keys_.swap( sortedKeys_ );
+				items.swap( sortedItems_ );
+			}
+		}
+
+		for ( size_t i = 0; i < count; i++ )
+		{
+			slots_[ items[ i ] ] = static_cast< unsigned long >( i );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	void DrawOrder::save( SnapshotWriter& writer )const
+	{
+		writer.put( static_cast< uint32_t >( buckets_.size() ) );
+		for ( size_t i = 0; i < buckets_.size(); i++ )
+		{
+			const Bucket& bucket( buckets_[ i ] );
+			writer.put( bucket.layer_ );
+			writer.put( bucket.ySorted_ );
+			writer.put( bucket.dirty_ );
+			writer.put( bucket.holes_ );
+			writer.putVector( bucket.items_ );
+		}
+		writer.putVector( layers_ );
+		writer.putVector( ys_ );
+		writer.putVector( slots_ );
+		writer.putVector( used_ );
+		writer.putVector( freeItemIDs_ );
+		writer.put( static_cast< uint32_t >( itemCount_ ) );
+		writer.putVector( drawList_ );
+		writer.put( drawListDirty_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool DrawOrder::load( SnapshotReader& reader )
+	{
+		uint32_t bucketCount( 0 );
+		reader.get( bucketCount );
+		buckets_.resize( reader.isFailed() ? 0 : bucketCount );
+		for ( size_t i = 0; i < buckets_.size() && !reader.isFailed(); i++ )
+		{
+			Bucket& bucket( buckets_[ i ] );
+			reader.get( bucket.layer_ );
+			reader.get( bucket.ySorted_ );
+			reader.get( bucket.dirty_ );
+			reader.get( bucket.holes_ );
+			reader.getVector( bucket.items_ );
+		}
+		uint32_t itemCount( 0 );
+		reader.getVector( layers_ );
+		reader.getVector( ys_ );
+		reader.getVector( slots_ );
+		reader.getVector( used_ );
+		reader.getVector( freeItemIDs_ );
+		reader.get( itemCount );
+		reader.getVector( drawList_ );
+		reader.get( drawListDirty_ );
+		itemCount_ = itemCount;
+
+		const size_t size( used_.size() );
+		if ( reader.isFailed()
+			|| size != layers_.size()
+			|| size != ys_.size()
+			|| size != slots_.size() )
+		{
+			removeAllItems();
+			return false;
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,419 @@
+#include "ddd/GlyphCache.h"
+
+#include <algorithm>
+#include <pf/textgraphic.h>
+#include <pf/texture.h>
+
+namespace ddd
+{
+	//gap around each cell so filtering never picks up a neighbour
+	static const unsigned long GLYPH_PADDING = 1;
+	//drawn after a character to find its advance, see measure()
+	static const char* const ADVANCE_PROBE = "|";
+
+	GlyphCache::Caches GlyphCache::caches_;
+
+	static std::vector< uint16_t > sQuadIndices;
+
+	//-------------------------------------------------------------------------
+
+	GlyphCache& GlyphCache::get( const std::string& font, const unsigned long lineHeight )
+	{
+		const Caches::key_type key( font, lineHeight );
+		Caches::iterator it( caches_.find( key ) );
+		if ( caches_.end() == it )
+		{
+			it = caches_.insert( Caches::value_type( key, new GlyphCache( font, lineHeight ) ) ).first;
+		}
+		return *it->second;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void GlyphCache::releaseAll()
+	{
+		for ( Caches::iterator it = caches_.begin(); caches_.end() != it; ++it )
+		{
+			delete it->second;
+		}
+		caches_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	GlyphCache::GlyphCache( const std::string& font, const unsigned long lineHeight )
+		: font_( font )
+		, lineHeight_( lineHeight )
+		, cellHeight_( lineHeight )
+		, penX_( 0 )
+		, penY_( 0 )
+		, shelfHeight_( 0 )
+		, graphic_( 0 )
+		, probeRight_( 0 )
+	{
+		assert( 0 != lineHeight_ );
+		graphic_ = TTextGraphic::Create( "", PAGE_SIZE, PAGE_SIZE,
+				TTextGraphic::kHAlignLeft | TTextGraphic::kVAlignTop,
+				font_.c_str(), lineHeight_, TColor( 1, 1, 1, 1 ) );
+		graphic_->SetNoBlend();
+
+		//tall enough for accents and descenders
+		graphic_->SetText( "\xc3\x85gjy" );
+		TRect bounds;
+		graphic_->GetTextBounds( &bounds );
+		if ( bounds.y2 > 0 && static_cast< unsigned long >( bounds.y2 ) > cellHeight_ )
+		{
+			cellHeight_ = bounds.y2;
+		}
+		cellHeight_ = std::min( cellHeight_ + GLYPH_PADDING, PAGE_SIZE );
+
+		graphic_->SetText( ADVANCE_PROBE );
+		graphic_->GetTextBounds( &bounds );
+		probeRight_ = bounds.x2;
+	}
+
+	//-------------------------------------------------------------------------
+
+	GlyphCache::~GlyphCache()
+	{
+		graphic_->Destroy();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void GlyphCache::prepare( const std::string& text )
+	{
+		size_t index( 0 );
+		while ( index < text.length() )
+		{
+			const size_t start( index );
+			const unsigned long codepoint( nextCodepoint( text, index ) );
+			if ( '\n' != codepoint && 0 == findGlyph( codepoint ) )
+			{
+				rasterize( codepoint, text.substr( start, index - start ) );
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool GlyphCache::isPrepared( const std::string& text )const
+	{
+		size_t index( 0 );
+		while ( index < text.length() )
+		{
+			const unsigned long codepoint( nextCodepoint( text, index ) );
+			if ( '\n' != codepoint && 0 == findGlyph( codepoint ) )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool GlyphCache::addImage( const std::string& name )
+	{
+		if ( 0 != findImage( name ) )
+		{
+			return true;
+		}
+		TTextureRef image( TTexture::Get( name.c_str() ) );
+		if ( !image )
+		{
+			return false;
+		}
+		const unsigned long width( image->GetWidth() );
+		const unsigned long height( image->GetHeight() );
+		unsigned long x( 0 );
+		unsigned long y( 0 );
+		if ( !allocate( width, height, x, y ) )
+		{
+			return false;
+		}
+		image->CopyPixels( x, y, 0, pages_.back() );
+
+		Glyph& glyph( images_[ name ] );
+		glyph.page_ = static_cast< unsigned long >( pages_.size() - 1 );
+		glyph.width_ = static_cast< TReal >( width );
+		glyph.height_ = static_cast< TReal >( height );
+		glyph.advance_ = glyph.width_;
+		glyph.uv0_ = TVec2( static_cast< TReal >( x ) / PAGE_SIZE, static_cast< TReal >( y ) / PAGE_SIZE );
+		glyph.uv1_ = TVec2( static_cast< TReal >( x + width ) / PAGE_SIZE, static_cast< TReal >( y + height ) / PAGE_SIZE );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const TextLayout& GlyphCache::layout( const std::string& text, const unsigned long width )
+	{
+		const Layouts::key_type key( text, width );
+		Layouts::iterator it( layouts_.find( key ) );
+		if ( layouts_.end() != it )
+		{
+			return it->second;
+		}
+		if ( layouts_.size() >= MAX_LAYOUTS )
+		{
+			//HUD strings come and go with the numbers in them; starting
+			//over is cheaper than tracking which ones are still shown
+			layouts_.clear();
+		}
+		prepare( text );
+
+		TextLayout& result( layouts_[ key ] );
+		result.width_ = 0;
+		TReal x( 0 );
+		TReal y( 0 );
+		TextLayout::Line line = { 0, 0, 0 };
+		//first quad after the last space of the line, and the pen there
+		size_t breakQuad( 0 );
+		TReal breakX( 0 );
+		TReal breakWidth( 0 );
+
+		size_t index( 0 );
+		while ( index < text.length() )
+		{
+			const unsigned long codepoint( nextCodepoint( text, index ) );
+			if ( '\n' == codepoint )
+			{
+				line.width_ = x;
+				line.count_ = result.quads_.size() - line.first_;
+				result.lines_.push_back( line );
+				result.width_ = std::max( result.width_, line.width_ );
+				line.first_ = result.quads_.size();
+				breakQuad = line.first_;
+				x = 0;
+				y += lineHeight_;
+				continue;
+			}
+
+			const Glyph& glyph( *findGlyph( codepoint ) );
+			if ( 0 != width && ' ' != codepoint && x + glyph.advance_ > width && x > 0 )
+			{
+				//wrap at the last space, or before this glyph if the
+				//line has none
+				TReal shift( x );
+				if ( breakQuad > line.first_ )
+				{
+					line.width_ = breakWidth;
+					shift = breakX;
+				}
+				else
+				{
+					line.width_ = x;
+					breakQuad = result.quads_.size();
+				}
+				line.count_ = breakQuad - line.first_;
+				result.lines_.push_back( line );
+				result.width_ = std::max( result.width_, line.width_ );
+				y += lineHeight_;
+				for ( size_t i = breakQuad; i < result.quads_.size(); i++ )
+				{
+					result.quads_[ i ].x_ -= shift;
+					result.quads_[ i ].y_ = y;
+				}
+				x -= shift;
+				line.first_ = breakQuad;
+			}
+
+			if ( ' ' == codepoint )
+			{
+				breakWidth = x;
+				breakX = x + glyph.advance_;
+				breakQuad = result.quads_.size();
+			}
+			else if ( NO_PAGE != glyph.page_ )
+			{
+				const TextLayout::Quad quad = { codepoint, x, y };
+				result.quads_.push_back( quad );
+			}
+			x += glyph.advance_;
+		}
+
+		line.width_ = x;
+		line.count_ = result.quads_.size() - line.first_;
+		result.lines_.push_back( line );
+		result.width_ = std::max( result.width_, line.width_ );
+		result.height_ = y + cellHeight_;
+		return result;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long GlyphCache::nextCodepoint( const std::string& text, size_t& index )
+	{
+		assert( index < text.length() );
+		const unsigned char lead( static_cast< unsigned char >( text[ index++ ] ) );
+		size_t extra( 0 );
+		unsigned long codepoint( lead );
+		if ( lead >= 0xf0 )
+		{
+			extra = 3;
+			codepoint = lead & 0x07;
+		}
+		else if ( lead >= 0xe0 )
+		{
+			extra = 2;
+			codepoint = lead & 0x0f;
+		}
+		else if ( lead >= 0xc0 )
+		{
+			extra = 1;
+			codepoint = lead & 0x1f;
+		}
+		//a stray continuation byte stands for itself
+		for ( ; 0 != extra && index < text.length(); extra-- )
+		{
+			const unsigned char next( static_cast< unsigned char >( text[ index ] ) );
+			if ( 0x80 != ( next & 0xc0 ) )
+			{
+				break;
+			}
+			codepoint = ( codepoint << 6 ) | ( next & 0x3f );
+			index++;
+		}
+		return codepoint;
+	}
+
+	//-------------------------------------------------------------------------
+
+	uint16_t* GlyphCache::getQuadIndices()
+	{
+		if ( sQuadIndices.empty() )
+		{
+			sQuadIndices.resize( MAX_BATCH_QUADS * 6 );
+			for ( unsigned long i = 0; i < MAX_BATCH_QUADS; i++ )
+			{
+				const uint16_t first( static_cast< uint16_t >( i * 4 ) );
+				sQuadIndices[ i * 6 + 0 ] = first;
+				sQuadIndices[ i * 6 + 1 ] = first + 1;
+				sQuadIndices[ i * 6 + 2 ] = first + 2;
+				sQuadIndices[ i * 6 + 3 ] = first;
+				sQuadIndices[ i * 6 + 4 ] = first + 2;
+				sQuadIndices[ i * 6 + 5 ] = first + 3;
+			}
+		}
+		return &sQuadIndices[ 0 ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	void GlyphCache::rasterize( const unsigned long codepoint, const std::string& character )
+	{
+		Glyph glyph;
+		glyph.page_ = NO_PAGE;
+		glyph.width_ = 0;
+		glyph.height_ = static_cast< TReal >( cellHeight_ );
+		glyph.advance_ = measure( character );
+
+		graphic_->SetText( character.c_str() );
+		TRect bounds;
+		graphic_->GetTextBounds( &bounds );
+		const unsigned long cellWidth( std::min( static_cast< unsigned long >( std::max( bounds.x2, 0 ) ) + GLYPH_PADDING, PAGE_SIZE ) );
+
+		if ( ' ' != codepoint && bounds.x2 > bounds.x1 )
+		{
+			unsigned long x( 0 );
+			unsigned long y( 0 );
+			if ( allocate( cellWidth, cellHeight_, x, y ) )
+			{
+				graphic_->SetTextRect( cellWidth, cellHeight_ );
+				graphic_->Draw( TVec2( static_cast< TReal >( x ), static_cast< TReal >( y ) ),
+						cellHeight_, 1, 0, 1, pages_.back() );
+				graphic_->SetTextRect( PAGE_SIZE, PAGE_SIZE );
+
+				glyph.page_ = static_cast< unsigned long >( pages_.size() - 1 );
+				glyph.width_ = static_cast< TReal >( cellWidth );
+				glyph.uv0_ = TVec2( static_cast< TReal >( x ) / PAGE_SIZE,
+						static_cast< TReal >( y ) / PAGE_SIZE );
+				glyph.uv1_ = TVec2( static_cast< TReal >( x + cellWidth ) / PAGE_SIZE,
+						static_cast< TReal >( y + cellHeight_ ) / PAGE_SIZE );
+			}
+		}
+		glyphs_[ codepoint ] = glyph;
+	}
+
+	//-------------------------------------------------------------------------
+
+	//the pen advance of text: how far the probe drawn after it moves
+	const TReal GlyphCache::measure( const std::string& text )
+	{
+		TRect bounds;
+		graphic_->SetText( ( text + ADVANCE_PROBE ).c_str() );
+		graphic_->GetTextBounds( &bounds );
+		return static_cast< TReal >( std::max( bounds.x2 - probeRight_, 0L ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	//shelf packing: cells fill a row left to right, the row is as tall as
+	//its tallest cell, and a page is full when no new row fits
+	const bool GlyphCache::allocate( const unsigned long width,
+				const unsigned long height,
+				unsigned long& x,
+				unsigned long& y )
+	{
+		if ( width > PAGE_SIZE || height > PAGE_SIZE )
+		{
+			return false;
+		}
+		bool placed( !pages_.empty() );
+		if ( placed && penX_ + width > PAGE_SIZE )
+		{
+			penX_ = 0;
+			penY_ += shelfHeight_ + GLYPH_PADDING;
+			shelfHeight_ = 0;
+		}
+		if ( !placed || penY_ + height > PAGE_SIZE )
+		{
+			placed = addPage();
+		}
+		if ( !placed )
+		{
+			return false;
+		}
+		x = penX_;
+		y = penY_;
+		penX_ += width + GLYPH_PADDING;
+		shelfHeight_ = std::max( shelfHeight_, height );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool GlyphCache::addPage()
+	{
+		TTextureRef page( TTexture::Create( PAGE_SIZE, PAGE_SIZE, true ) );
+		TColor32* pixels( 0 );
+		uint32_t pitch( 0 );
+		if ( !page || !page->Lock( &pixels, &pitch ) )
+		{
+			return false;
+		}
+		//text is drawn without blending, so untouched texels must be clear
+		const TColor32 clear( 0, 0, 0, 0 );
+		for ( unsigned long row = 0; row < PAGE_SIZE; row++ )
+		{
+			std::fill( pixels + row * pitch, pixels + row * pitch + PAGE_SIZE, clear );
+		}
+		const TColor32 white( 255, 255, 255, 255 );
+		for ( unsigned long row = 0; row < SOLID_SIZE; row++ )
+		{
+			for ( unsigned long column = 0; column < SOLID_SIZE; column++ )
+			{
+				pixels[ row * pitch + column ] = white;
+			}
+		}
+		page->Unlock();
+
+		pages_.push_back( page );
+		penX_ = SOLID_SIZE + GLYPH_PADDING;
+		penY_ = 0;
+		shelfHeight_ = SOLID_SIZE;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
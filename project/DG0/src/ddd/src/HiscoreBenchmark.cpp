@@ -0,0 +1,144 @@
+#include "ddd/HiscoreBenchmark.h"
+
+#include <pf/file.h>
+#include <pf/random.h>
+#include "ddd/HiscoreClient.h"
+#include "ddd/HiscoreStandIn.h"
+
+#include <windows.h>
+
+namespace ddd
+{
+	//the stand-in turns away every FAIL_EVERY-th request
+	static const unsigned long FAIL_EVERY = 10;
+	//one submission in MEDAL_EVERY is a medal
+	static const unsigned long MEDAL_EVERY = 10;
+	static const unsigned long MODE_COUNT = 3;
+	static const unsigned long MEDAL_COUNT = 4;
+	static const char* const BENCHMARK_OUTBOX = "user:hiscorebench_outbox.txt";
+
+	//-------------------------------------------------------------------------
+
+	static const double getSeconds()
+	{
+		LARGE_INTEGER frequency;
+		LARGE_INTEGER counter;
+		QueryPerformanceFrequency( &frequency );
+		QueryPerformanceCounter( &counter );
+		return static_cast< double >( counter.QuadPart ) / static_cast< double >( frequency.QuadPart );
+	}
+
+	//-------------------------------------------------------------------------
+
+	HiscoreBenchmark::HiscoreBenchmark( const unsigned long submissions, const unsigned long players )
+		: submissions_( submissions )
+		, players_( players )
+		, queueSeconds_( 0 )
+		, drainSeconds_( 0 )
+		, coalesced_( 0 )
+		, requests_( 0 )
+		, retries_( 0 )
+		, accepted_( 0 )
+		, serverRequests_( 0 )
+		, serverFailures_( 0 )
+		, serverEntries_( 0 )
+	{
+		assert( 0 != players_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool HiscoreBenchmark::run()
+	{
+		HiscoreStandIn standIn;
+		if ( !standIn.start( 0, FAIL_EVERY ) )
+		{
+			return false;
+		}
+
+		//a previous run's leftovers would be sent along
+		TFile::DeleteFile( BENCHMARK_OUTBOX );
+		HiscoreClient client;
+		client.start( standIn.getUrl(), BENCHMARK_OUTBOX );
+
+		TRandom random;
+		random.Seed( 1 );
+		const double queueStart( getSeconds() );
+		for ( unsigned long i = 0; i < submissions_; i++ )
+		{
+			const std::string player( str::getFormatted( "player%lu", i % players_ ).c_str() );
+			const std::string mode( str::getFormatted( "mode%d", random.RandRange( 1, MODE_COUNT ) ).c_str() );
+			if ( 0 == i % MEDAL_EVERY )
+			{
+				const std::string medal( str::getFormatted( "medal%d", random.RandRange( 1, MEDAL_COUNT ) ).c_str() );
+				client.submitMedal( player, "", mode, medal );
+			}
+			else
+			{
+				client.submitScore( player, "", mode, random.RandRange( 0, 100000 ) );
+			}
+		}
+		queueSeconds_ = getSeconds() - queueStart;
+
+		const double drainStart( getSeconds() );
+		while ( !client.isIdle() && ( getSeconds() - drainStart ) * 1e3 < DRAIN_TIMEOUT )
+		{
+			client.update();
+			Sleep( 1 );
+		}
+		drainSeconds_ = getSeconds() - drainStart;
+		const bool drained( client.isIdle() );
+
+		coalesced_ = client.getCoalesced();
+		requests_ = client.getRequests();
+		retries_ = client.getRetries();
+		accepted_ = client.getAccepted();
+		client.stop();
+		standIn.stop();
+		serverRequests_ = standIn.getRequests();
+		serverFailures_ = standIn.getFailures();
+		serverEntries_ = standIn.getEntries();
+		TFile::DeleteFile( BENCHMARK_OUTBOX );
+		return drained;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool HiscoreBenchmark::write( const char* fileName )const
+	{
+		assert( 0 != fileName );
+		TFile file;
+		if ( !file.Open( fileName, kWriteText ) )
+		{
+			return false;
+		}
+
+		const str lines( str::getFormatted( "figure,value\n"
+				"submissions,%lu\n"
+				"players,%lu\n"
+				"queue_ms,%.3f\n"
+				"drain_ms,%.3f\n"
+				"coalesced,%lu\n"
+				"entries_accepted,%lu\n"
+				"requests,%lu\n"
+				"retries,%lu\n"
+				"server_requests,%lu\n"
+				"server_failures,%lu\n"
+				"server_entries,%lu\n",
+				submissions_,
+				players_,
+				queueSeconds_ * 1e3,
+				drainSeconds_ * 1e3,
+				coalesced_,
+				accepted_,
+				requests_,
+				retries_,
+				serverRequests_,
+				serverFailures_,
+				serverEntries_ ) );
+		file.Write( lines.c_str(), lines.length() );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
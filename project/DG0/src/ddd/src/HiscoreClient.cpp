@@ -0,0 +1,498 @@
+#include "ddd/HiscoreClient.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <pf/animtask.h>
+#include <pf/file.h>
+#include <pf/platform.h>
+#include <pf/simplehttp.h>
+#include <windows.h>
+
+namespace ddd
+{
+	static const char* const KIND_NAMES[] = { "score", "medal" };
+	static const char* const REPLY_OK = "ok";
+	static const char* const REPLY_REJECT = "reject";
+
+	//-------------------------------------------------------------------------
+
+	//tabs and line breaks separate the outbox fields
+	static std::string clean( const std::string& text )
+	{
+		std::string cleaned( text );
+		for ( size_t i = 0; i < cleaned.size(); i++ )
+		{
+			if ( '\t' == cleaned[ i ] || '\n' == cleaned[ i ] || '\r' == cleaned[ i ] )
+			{
+				cleaned[ i ] = ' ';
+			}
+		}
+		return cleaned;
+	}
+
+	//-------------------------------------------------------------------------
+
+	//true once tick count now has reached time, across the wrap
+	static const bool isDue( const unsigned long now, const unsigned long time )
+	{
+		return static_cast< long >( now - time ) >= 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	class HiscoreClient::Task
+		: public TAnimTask
+	{
+	public:
+		Task( HiscoreClient* owner )
+			: owner_( owner )
+		{
+		}
+
+		void detach()
+		{
+			owner_ = 0;
+		}
+
+		virtual bool Animate()
+		{
+			if ( 0 == owner_ )
+			{
+				return false;
+			}
+			owner_->update();
+			return true;
+		}
+
+	private:
+		HiscoreClient* owner_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	HiscoreClient::HiscoreClient()
+		: queuedCount_( 0 )
+		, dirty_( false )
+		, savedAt_( 0 )
+		, task_( 0 )
+		, submitted_( 0 )
+		, coalesced_( 0 )
+		, requestCount_( 0 )
+		, retries_( 0 )
+		, accepted_( 0 )
+		, rejected_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	HiscoreClient::~HiscoreClient()
+	{
+		stop();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::start( const std::string& url, const std::string& outbox )
+	{
+		assert( !isStarted() );
+		url_ = url;
+		outbox_ = outbox;
+		load();
+		savedAt_ = GetTickCount();
+		task_ = new Task( this );
+		TPlatform::GetInstance()->AdoptTask( task_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::stop()
+	{
+		if ( !isStarted() )
+		{
+			return;
+		}
+
+		//save() writes the entries in flight with the queue
+		save();
+		for ( size_t i = 0; i < requests_.size(); i++ )
+		{
+			delete requests_[ i ].http_;
+		}
+		requests_.clear();
+		players_.clear();
+		order_.clear();
+		queuedCount_ = 0;
+
+		//the platform owns the task and deletes it once it returns false
+		task_->detach();
+		task_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::submitScore( const std::string& player,
+				const std::string& password,
+				const std::string& mode,
+				const long score )
+	{
+		Entry entry;
+		entry.kind_ = K_SCORE;
+		entry.mode_ = clean( mode );
+		entry.value_ = str::getFormatted( "%ld", score ).c_str();
+		add( player, password, entry );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::submitMedal( const std::string& player,
+				const std::string& password,
+				const std::string& mode,
+				const std::string& medal )
+	{
+		Entry entry;
+		entry.kind_ = K_MEDAL;
+		entry.mode_ = clean( mode );
+		entry.value_ = clean( medal );
+		add( player, password, entry );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::update()
+	{
+		const unsigned long now( GetTickCount() );
+		poll( now );
+		send( now );
+		if ( dirty_ && isDue( now, savedAt_ + SAVE_DELAY ) )
+		{
+			save();
+			savedAt_ = now;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::add( const std::string& player, const std::string& password, const Entry& entry )
+	{
+		const std::string name( clean( player ) );
+		Players::iterator it( players_.find( name ) );
+		if ( players_.end() == it )
+		{
+			Player added;
+			added.failures_ = 0;
+			added.retryAt_ = 0;
+			added.inFlight_ = false;
+			it = players_.insert( Players::value_type( name, added ) ).first;
+		}
+		Player& p( it->second );
+		if ( !password.empty() )
+		{
+			p.password_ = password;
+		}
+
+		const bool waiting( !p.entries_.empty() || p.inFlight_ );
+		submitted_++;
+		if ( merge( p, entry ) )
+		{
+			queuedCount_++;
+		}
+		else
+		{
+			coalesced_++;
+		}
+		if ( !waiting )
+		{
+			order_.push_back( name );
+		}
+		dirty_ = true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool HiscoreClient::merge( Player& player, const Entry& entry )
+	{
+		for ( size_t i = 0; i < player.entries_.size(); i++ )
+		{
+			Entry& queued( player.entries_[ i ] );
+			if ( queued.kind_ != entry.kind_ || queued.mode_ != entry.mode_ )
+			{
+				continue;
+			}
+			if ( K_SCORE == entry.kind_ )
+			{
+				//only the best score of a mode counts
+				if ( atol( entry.value_.c_str() ) > atol( queued.value_.c_str() ) )
+				{
+					queued.value_ = entry.value_;
+				}
+				return false;
+			}
+			if ( queued.value_ == entry.value_ )
+			{
+				return false;
+			}
+		}
+		player.entries_.push_back( entry );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::send( const unsigned long now )
+	{
+		if ( url_.empty() )
+		{
+			return;
+		}
+
+		//each waiting player is looked at once per update
+		size_t count( order_.size() );
+		while ( 0 != count-- && requests_.size() < MAX_REQUESTS )
+		{
+			const std::string name( order_.front() );
+			order_.pop_front();
+			Player& p( players_[ name ] );
+			if ( !isDue( now, p.retryAt_ ) )
+			{
+				order_.push_back( name );
+				continue;
+			}
+
+			Request request;
+			request.player_ = name;
+			request.sentAt_ = now;
+			const size_t batch( std::min( p.entries_.size(), static_cast< size_t >( MAX_BATCH ) ) );
+			request.entries_.assign( p.entries_.begin(), p.entries_.begin() + batch );
+			p.entries_.erase( p.entries_.begin(), p.entries_.begin() + batch );
+			p.inFlight_ = true;
+			queuedCount_ -= static_cast< unsigned long >( batch );
+
+			request.http_ = new TSimpleHttp();
+			request.http_->Init( url_.c_str(), true );
+			request.http_->AddArg( "player", name.c_str() );
+			if ( !p.password_.empty() )
+			{
+				request.http_->AddArg( "password", p.password_.c_str() );
+			}
+			request.http_->AddArg( "count", static_cast< int32_t >( batch ) );
+			for ( size_t i = 0; i < batch; i++ )
+			{
+				const Entry& entry( request.entries_[ i ] );
+				const int index( static_cast< int >( i ) );
+				request.http_->AddArg( str::getFormatted( "kind%d", index ).c_str(), KIND_NAMES[ entry.kind_ ] );
+				request.http_->AddArg( str::getFormatted( "mode%d", index ).c_str(), entry.mode_.c_str() );
+				request.http_->AddArg( str::getFormatted( "value%d", index ).c_str(), entry.value_.c_str() );
+			}
+			request.http_->DoRequest( TSimpleHttp::eDoNotWriteCache );
+			requests_.push_back( request );
+			requestCount_++;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::poll( const unsigned long now )
+	{
+		size_t i( 0 );
+		while ( i < requests_.size() )
+		{
+			Request& request( requests_[ i ] );
+			const TSimpleHttp::EStatus status( request.http_->GetStatus() );
+			if ( TSimpleHttp::eNetWait == status && !isDue( now, request.sentAt_ + REQUEST_TIMEOUT ) )
+			{
+				i++;
+				continue;
+			}
+
+			finish( request, now, TSimpleHttp::eNetDone == status );
+			delete request.http_;
+			requests_[ i ] = requests_.back();
+			requests_.pop_back();
+			dirty_ = true;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreClient::finish( Request& request, const unsigned long now, const bool sent )
+	{
+		Player& p( players_[ request.player_ ] );
+		p.inFlight_ = false;
+
+		const char* reply( sent ? request.http_->GetContents() : 0 );
+		const unsigned long count( static_cast< unsigned long >( request.entries_.size() ) );
+		if ( 0 != reply && 0 == strncmp( reply, REPLY_OK, strlen( REPLY_OK ) ) )
+		{
+			accepted_ += count;
+			p.failures_ = 0;
+			p.retryAt_ = now;
+		}
+		else if ( 0 != reply && 0 == strncmp( reply, REPLY_REJECT, strlen( REPLY_REJECT ) ) )
+		{
+			rejected_ += count;
+			p.failures_ = 0;
+			p.retryAt_ = now;
+		}
+		else
+		{
+			//back in front of what came in meanwhile, folding into it
+			std::vector< Entry > later;
+			later.swap( p.entries_ );
+			p.entries_ = request.entries_;
+			queuedCount_ += count;
+			for ( size_t i = 0; i < later.size(); i++ )
+			{
+				if ( !merge( p, later[ i ] ) )
+				{
+					queuedCount_--;
+				}
+			}
+
+			const unsigned long shift( std::min( p.failures_, 16UL ) );
+			p.failures_++;
+			p.retryAt_ = now + std::min( RETRY_DELAY << shift, MAX_RETRY_DELAY );
+			retries_++;
+		}
+
+		if ( !p.entries_.empty() )
+		{
+			order_.push_back( request.player_ );
+		}
+		else
+		{
+			players_.erase( request.player_ );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool HiscoreClient::load()
+	{
+		TFile file;
+		if ( outbox_.empty() || !file.Open( outbox_.c_str(), kReadText ) )
+		{
+			return false;
+		}
+
+		std::string text( file.Size(), '\0' );
+		const long bytesRead( text.empty() ? 0 : file.Read( &text[ 0 ], static_cast< unsigned long >( text.size() ) ) );
+		if ( bytesRead < 0 )
+		{
+			return false;
+		}
+		text.resize( bytesRead );
+
+		//loaded entries are not new submissions
+		const unsigned long submitted( submitted_ );
+		const unsigned long coalesced( coalesced_ );
+
+		//kind, player, mode and value, tab separated
+		size_t lineStart( 0 );
+		while ( lineStart < text.size() )
+		{
+			size_t lineEnd( text.find( '\n', lineStart ) );
+			if ( std::string::npos == lineEnd )
+			{
+				lineEnd = text.size();
+			}
+			std::vector< std::string > fields;
+			size_t fieldStart( lineStart );
+			while ( fieldStart <= lineEnd )
+			{
+				size_t fieldEnd( text.find( '\t', fieldStart ) );
+				if ( std::string::npos == fieldEnd || fieldEnd > lineEnd )
+				{
+					fieldEnd = lineEnd;
+				}
+				fields.push_back( text.substr( fieldStart, fieldEnd - fieldStart ) );
+				fieldStart = fieldEnd + 1;
+			}
+			lineStart = lineEnd + 1;
+
+			if ( 4 != fields.size() )
+			{
+				continue;
+			}
+			Entry entry;
+			if ( fields[ 0 ] == KIND_NAMES[ K_SCORE ] )
+			{
+				entry.kind_ = K_SCORE;
+			}
+			else if ( fields[ 0 ] == KIND_NAMES[ K_MEDAL ] )
+			{
+				entry.kind_ = K_MEDAL;
+			}
+			else
+			{
+				continue;
+			}
+			entry.mode_ = fields[ 2 ];
+			entry.value_ = fields[ 3 ];
+			add( fields[ 1 ], "", entry );
+		}
+		submitted_ = submitted;
+		coalesced_ = coalesced;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool HiscoreClient::save()
+	{
+		if ( outbox_.empty() )
+		{
+			return false;
+		}
+
+		//written beside the outbox and moved over it, so a crash while
+		//writing leaves the last complete outbox
+		const std::string temporary( outbox_ + ".tmp" );
+		{
+			TFile file;
+			if ( !file.Open( temporary.c_str(), kWriteText ) )
+			{
+				return false;
+			}
+			for ( Players::const_iterator it = players_.begin(); it != players_.end(); ++it )
+			{
+				for ( size_t i = 0; i < it->second.entries_.size(); i++ )
+				{
+					const Entry& entry( it->second.entries_[ i ] );
+					const str line( str::getFormatted( "%s\t%s\t%s\t%s\n",
+							KIND_NAMES[ entry.kind_ ],
+							it->first.c_str(),
+							entry.mode_.c_str(),
+							entry.value_.c_str() ) );
+					file.Write( line.c_str(), line.length() );
+				}
+			}
+			for ( size_t r = 0; r < requests_.size(); r++ )
+			{
+				for ( size_t i = 0; i < requests_[ r ].entries_.size(); i++ )
+				{
+					const Entry& entry( requests_[ r ].entries_[ i ] );
+					const str line( str::getFormatted( "%s\t%s\t%s\t%s\n",
+							KIND_NAMES[ entry.kind_ ],
+							requests_[ r ].player_.c_str(),
+							entry.mode_.c_str(),
+							entry.value_.c_str() ) );
+					file.Write( line.c_str(), line.length() );
+				}
+			}
+			file.Close();
+		}
+
+		if ( !MoveFileExA( TFile::TranslateResource( temporary.c_str() ).c_str(),
+				TFile::TranslateResource( outbox_.c_str() ).c_str(),
+				MOVEFILE_REPLACE_EXISTING ) )
+		{
+			return false;
+		}
+		dirty_ = false;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
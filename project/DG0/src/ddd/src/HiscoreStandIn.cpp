@@ -0,0 +1,253 @@
+#include "ddd/HiscoreStandIn.h"
+
+//before anything pulls in windows.h and with it the old winsock.h
+#include <winsock2.h>
+#include <ctype.h>
+#include <process.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pf/str.h>
+
+#pragma comment( lib, "ws2_32.lib" )
+
+namespace ddd
+{
+	//ms a connection may take to send its request
+	static const int RECEIVE_TIMEOUT = 5000;
+	//a request larger than this is cut off and answered anyway
+	static const size_t MAX_REQUEST = 64 * 1024;
+
+	static const char* const REPLY_OK = "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+	static const char* const REPLY_BUSY = "HTTP/1.0 503 Service Unavailable\r\nContent-Type: text/plain\r\nContent-Length: 4\r\nConnection: close\r\n\r\nbusy";
+
+	//-------------------------------------------------------------------------
+
+	struct HiscoreStandIn::Impl
+	{
+		SOCKET listener_;
+		HANDLE thread_;
+		unsigned long failEvery_;
+		volatile LONG requests_;
+		volatile LONG failures_;
+		volatile LONG entries_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	//value of name in a form encoded body, 0 if it's not there
+	static const long getFormNumber( const std::string& body, const char* name )
+	{
+		const std::string key( std::string( name ) + "=" );
+		size_t at( 0 );
+		while ( std::string::npos != ( at = body.find( key, at ) ) )
+		{
+			if ( 0 == at || '&' == body[ at - 1 ] )
+			{
+				return atol( body.c_str() + at + key.length() );
+			}
+			at += key.length();
+		}
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	HiscoreStandIn::HiscoreStandIn()
+		: impl_( new Impl )
+		, port_( 0 )
+		, started_( false )
+	{
+		impl_->listener_ = INVALID_SOCKET;
+		impl_->thread_ = 0;
+		impl_->failEvery_ = 0;
+		impl_->requests_ = 0;
+		impl_->failures_ = 0;
+		impl_->entries_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	HiscoreStandIn::~HiscoreStandIn()
+	{
+		stop();
+		delete impl_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool HiscoreStandIn::start( const unsigned short port, const unsigned long failEvery )
+	{
+		assert( !isStarted() );
+		WSADATA data;
+		if ( 0 != WSAStartup( MAKEWORD( 2, 2 ), &data ) )
+		{
+			return false;
+		}
+
+		SOCKET listener( socket( AF_INET, SOCK_STREAM, IPPROTO_TCP ) );
+		sockaddr_in address;
+		memset( &address, 0, sizeof( address ) );
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+		address.sin_port = htons( port );
+		int addressSize( sizeof( address ) );
+		if ( INVALID_SOCKET == listener
+			|| SOCKET_ERROR == bind( listener, reinterpret_cast< sockaddr* >( &address ), sizeof( address ) )
+			|| SOCKET_ERROR == listen( listener, SOMAXCONN )
+			|| SOCKET_ERROR == getsockname( listener, reinterpret_cast< sockaddr* >( &address ), &addressSize ) )
+		{
+			if ( INVALID_SOCKET != listener )
+			{
+				closesocket( listener );
+			}
+			WSACleanup();
+			return false;
+		}
+
+		impl_->listener_ = listener;
+		impl_->failEvery_ = failEvery;
+		impl_->requests_ = 0;
+		impl_->failures_ = 0;
+		impl_->entries_ = 0;
+		port_ = ntohs( address.sin_port );
+
+		const uintptr_t thread( _beginthreadex( 0, 0, &HiscoreStandIn::threadProc, this, 0, 0 ) );
+		assert( 0 != thread );
+		impl_->thread_ = reinterpret_cast< HANDLE >( thread );
+		started_ = true;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreStandIn::stop()
+	{
+		if ( !isStarted() )
+		{
+			return;
+		}
+
+		//a closed listener fails the accept the thread is blocked in
+		closesocket( impl_->listener_ );
+		WaitForSingleObject( impl_->thread_, INFINITE );
+		CloseHandle( impl_->thread_ );
+		impl_->thread_ = 0;
+		impl_->listener_ = INVALID_SOCKET;
+		WSACleanup();
+		port_ = 0;
+		started_ = false;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const std::string HiscoreStandIn::getUrl()const
+	{
+		assert( isStarted() );
+		return str::getFormatted( "http://127.0.0.1:%u/submit", static_cast< unsigned int >( port_ ) ).c_str();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long HiscoreStandIn::getRequests()const
+	{
+		return static_cast< unsigned long >( impl_->requests_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long HiscoreStandIn::getFailures()const
+	{
+		return static_cast< unsigned long >( impl_->failures_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long HiscoreStandIn::getEntries()const
+	{
+		return static_cast< unsigned long >( impl_->entries_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	unsigned int __stdcall HiscoreStandIn::threadProc( void* param )
+	{
+		static_cast< HiscoreStandIn* >( param )->run();
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreStandIn::run()
+	{
+		while ( true )
+		{
+			const SOCKET connection( accept( impl_->listener_, 0, 0 ) );
+			if ( INVALID_SOCKET == connection )
+			{
+				return;
+			}
+			serve( static_cast< uintptr_t >( connection ) );
+			closesocket( connection );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HiscoreStandIn::serve( const uintptr_t connection )
+	{
+		const SOCKET s( static_cast< SOCKET >( connection ) );
+		setsockopt( s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast< const char* >( &RECEIVE_TIMEOUT ), sizeof( RECEIVE_TIMEOUT ) );
+
+		//headers, then as much body as Content-Length announces
+		std::string request;
+		size_t bodyStart( std::string::npos );
+		size_t length( 0 );
+		char buffer[ 4096 ];
+		while ( request.size() < MAX_REQUEST )
+		{
+			if ( std::string::npos != bodyStart && request.size() >= bodyStart + length )
+			{
+				break;
+			}
+			const int received( recv( s, buffer, sizeof( buffer ), 0 ) );
+			if ( received <= 0 )
+			{
+				break;
+			}
+			request.append( buffer, received );
+			if ( std::string::npos == bodyStart )
+			{
+				const size_t headersEnd( request.find( "\r\n\r\n" ) );
+				if ( std::string::npos != headersEnd )
+				{
+					bodyStart = headersEnd + 4;
+					std::string headers( request.substr( 0, headersEnd ) );
+					for ( size_t i = 0; i < headers.size(); i++ )
+					{
+						headers[ i ] = static_cast< char >( tolower( static_cast< unsigned char >( headers[ i ] ) ) );
+					}
+					const size_t field( headers.find( "content-length:" ) );
+					if ( std::string::npos != field )
+					{
+						length = static_cast< size_t >( atol( headers.c_str() + field + strlen( "content-length:" ) ) );
+					}
+				}
+			}
+		}
+
+		const LONG number( InterlockedIncrement( &impl_->requests_ ) );
+		const char* reply( REPLY_OK );
+		if ( 0 != impl_->failEvery_ && 0 == static_cast< unsigned long >( number ) % impl_->failEvery_ )
+		{
+			reply = REPLY_BUSY;
+			InterlockedIncrement( &impl_->failures_ );
+		}
+		else if ( std::string::npos != bodyStart )
+		{
+			InterlockedExchangeAdd( &impl_->entries_, getFormNumber( request.substr( bodyStart ), "count" ) );
+		}
+		send( s, reply, static_cast< int >( strlen( reply ) ), 0 );
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,300 @@
+#include "ddd/HudLayer.h"
+
+#include <algorithm>
+#include <pf/pflib.h>
+#include <pf/renderer.h>
+
+namespace ddd
+{
+	//what counters are made of, rasterized up front
+	static const char* const COUNTER_CHARACTERS = "0123456789+-x/%:.";
+	//the white square lives on every page; bars use the first
+	static const unsigned long SOLID_PAGE = 0;
+
+	//-------------------------------------------------------------------------
+
+	HudLayer::HudLayer()
+		: glyphs_( 0 )
+		, quadCount_( 0 )
+		, drawCount_( 0 )
+		, frameQuads_( 0 )
+		, frameDraws_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	HudLayer::~HudLayer()
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::init( const std::string& font, const unsigned long fontSize )
+	{
+		glyphs_ = &GlyphCache::get( font, fontSize );
+		glyphs_->prepare( COUNTER_CHARACTERS );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool HudLayer::addImage( const std::string& name )
+	{
+		assert( isInited() );
+		return glyphs_->addImage( name );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::update()
+	{
+		if ( !isInited() )
+		{
+			return;
+		}
+		for ( size_t i = 0; i < pending_.size(); i++ )
+		{
+			glyphs_->prepare( pending_[ i ] );
+		}
+		pending_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::release()
+	{
+		//the GlyphCache is shared and outlives the layer
+		glyphs_ = 0;
+		batches_.clear();
+		pending_.clear();
+		quadCount_ = 0;
+		drawCount_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::begin()
+	{
+		for ( size_t i = 0; i < batches_.size(); i++ )
+		{
+			batches_[ i ].clear();
+		}
+		frameQuads_ = 0;
+		frameDraws_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::image( const std::string& name, const TReal x, const TReal y, const TColor& color )
+	{
+		assert( isInited() );
+		const GlyphCache::Glyph* glyph( glyphs_->findImage( name ) );
+		if ( 0 == glyph )
+		{
+			return;
+		}
+		addQuad( glyph->page_, x, y, x + glyph->width_, y + glyph->height_, glyph->uv0_, glyph->uv1_, TColor32( color ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::rect( const TReal x, const TReal y, const TReal width, const TReal height, const TColor& color )
+	{
+		assert( isInited() );
+		if ( 0 == glyphs_->getPageCount() )
+		{
+			return;
+		}
+		const TVec2 uv( glyphs_->getSolidUV() );
+		addQuad( SOLID_PAGE, x, y, x + width, y + height, uv, uv, TColor32( color ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::bar( const TReal x,
+				const TReal y,
+				const TReal width,
+				const TReal height,
+				const TReal fraction,
+				const TColor& fill,
+				const TColor& back )
+	{
+		const TReal filled( width * std::max( static_cast< TReal >( 0 ), std::min( fraction, static_cast< TReal >( 1 ) ) ) );
+		rect( x, y, width, height, back );
+		if ( filled > 0 )
+		{
+			rect( x, y, filled, height, fill );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::bars( const size_t count,
+				const TReal* xs,
+				const TReal* ys,
+				const TReal* fractions,
+				const TReal width,
+				const TReal height,
+				const TColor& fill,
+				const TColor& back )
+	{
+		assert( isInited() );
+		if ( 0 == count || 0 == glyphs_->getPageCount() )
+		{
+			return;
+		}
+		assert( 0 != xs && 0 != ys && 0 != fractions );
+
+		const TVec2 uv( glyphs_->getSolidUV() );
+		const TColor32 fill32( fill );
+		const TColor32 back32( back );
+		const TReal halfWidth( width / 2 );
+		for ( size_t i = 0; i < count; i++ )
+		{
+			const TReal x( xs[ i ] - halfWidth );
+			const TReal y( ys[ i ] - height );
+			const TReal filled( width * std::max( static_cast< TReal >( 0 ), std::min( fractions[ i ], static_cast< TReal >( 1 ) ) ) );
+			addQuad( SOLID_PAGE, x, y, x + width, y + height, uv, uv, back32 );
+			if ( filled > 0 )
+			{
+				addQuad( SOLID_PAGE, x, y, x + filled, y + height, uv, uv, fill32 );
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::text( const TReal x, const TReal y, const std::string& text, const TColor& color, const Align align )
+	{
+		assert( isInited() );
+		if ( !glyphs_->isPrepared( text ) )
+		{
+			if ( pending_.end() == std::find( pending_.begin(), pending_.end(), text ) )
+			{
+				pending_.push_back( text );
+			}
+			return;
+		}
+
+		const TextLayout& layout( glyphs_->layout( text ) );
+		const TColor32 color32( color );
+		for ( size_t l = 0; l < layout.lines_.size(); l++ )
+		{
+			const TextLayout::Line& line( layout.lines_[ l ] );
+			TReal left( x );
+			if ( ALIGN_CENTER == align )
+			{
+				left -= line.width_ / 2;
+			}
+			else if ( ALIGN_RIGHT == align )
+			{
+				left -= line.width_;
+			}
+
+			for ( size_t i = line.first_; i < line.first_ + line.count_; i++ )
+			{
+				const TextLayout::Quad& quad( layout.quads_[ i ] );
+				const GlyphCache::Glyph& glyph( *glyphs_->findGlyph( quad.codepoint_ ) );
+				const TReal x0( left + quad.x_ );
+				const TReal y0( y + quad.y_ );
+				addQuad( glyph.page_, x0, y0, x0 + glyph.width_, y0 + glyph.height_, glyph.uv0_, glyph.uv1_, color32 );
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::number( const TReal x, const TReal y, const long number, const TColor& color, const Align align )
+	{
+		text( x, y, str::getFormatted( "%ld", number ).c_str(), color, align );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::end()
+	{
+		if ( 0 != frameQuads_ )
+		{
+			TBegin2d begin2d;
+			for ( size_t i = 0; i < batches_.size(); i++ )
+			{
+				flush( static_cast< unsigned long >( i ) );
+			}
+		}
+		quadCount_ = frameQuads_;
+		drawCount_ = frameDraws_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::addQuad( const unsigned long page,
+				const TReal x0,
+				const TReal y0,
+				const TReal x1,
+				const TReal y1,
+				const TVec2& uv0,
+				const TVec2& uv1,
+				const TColor32& color )
+	{
+		assert( GlyphCache::NO_PAGE != page );
+		if ( page >= batches_.size() )
+		{
+			batches_.resize( page + 1 );
+		}
+		std::vector< TTransformedLitVert >& batch( batches_[ page ] );
+		if ( batch.size() >= GlyphCache::MAX_BATCH_QUADS * 4 )
+		{
+			TBegin2d begin2d;
+			flush( page );
+		}
+
+		const TVec2 corners[ 4 ] =
+		{
+			TVec2( x0, y0 ),
+			TVec2( x1, y0 ),
+			TVec2( x1, y1 ),
+			TVec2( x0, y1 )
+		};
+		const TVec2 uvs[ 4 ] =
+		{
+			uv0,
+			TVec2( uv1.x, uv0.y ),
+			uv1,
+			TVec2( uv0.x, uv1.y )
+		};
+		const TColor32 black( 0, 0, 0, 0 );
+		for ( size_t i = 0; i < 4; i++ )
+		{
+			TTransformedLitVert vertex;
+			vertex.pos = TVec3( corners[ i ].x, corners[ i ].y, 0 );
+			vertex.rhw = 0.5f;
+			vertex.color = color;
+			vertex.specular = black;
+			vertex.uv = uvs[ i ];
+			batch.push_back( vertex );
+		}
+		frameQuads_++;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void HudLayer::flush( const unsigned long page )
+	{
+		std::vector< TTransformedLitVert >& batch( batches_[ page ] );
+		if ( batch.empty() )
+		{
+			return;
+		}
+		const uint32_t quads( static_cast< uint32_t >( batch.size() / 4 ) );
+		TRenderer* r( TRenderer::GetInstance() );
+		r->SetTexture( glyphs_->getPage( page ) );
+		r->DrawIndexedVertices( TRenderer::kDrawTriangles,
+				TVertexSet( &batch[ 0 ], quads * 4 ),
+				GlyphCache::getQuadIndices(),
+				quads * 6 );
+		batch.clear();
+		frameDraws_++;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,239 @@
+#include "ddd/LevelBenchmark.h"
+
+#include <pf/file.h>
+#include <pf/script.h>
+#include "ddd/CompiledLevel.h"
+#include "ddd/LevelCompiler.h"
+#include "ddd/LuaUtils.h"
+
+#include <windows.h>
+
+namespace ddd
+{
+	static const char* const BENCHMARK_SCRIPT = "user:levelbench.lua";
+	static const char* const BENCHMARK_LEVEL = "user:levelbench.lvl";
+
+	//tiles the Lua path's setTileGrid copies out, as Application::setTileGrid does
+	static std::vector< uint16_t > sTiles;
+
+	//-------------------------------------------------------------------------
+
+	static const double getSeconds()
+	{
+		LARGE_INTEGER frequency;
+		LARGE_INTEGER counter;
+		QueryPerformanceFrequency( &frequency );
+		QueryPerformanceCounter( &counter );
+		return static_cast< double >( counter.QuadPart ) / static_cast< double >( frequency.QuadPart );
+	}
+
+	//-------------------------------------------------------------------------
+
+	//the Lua path's stand-ins for the Application functions
+	static int addActorStandIn( lua_State* /*L*/ )
+	{
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	static int setTileGridStandIn( lua_State* L )
+	{
+		const unsigned long count( static_cast< unsigned long >( lua_tonumber( L, 1 ) * lua_tonumber( L, 2 ) ) );
+		sTiles.resize( count );
+		for ( unsigned long i = 0; i < count; i++ )
+		{
+			lua_rawgeti( L, 4, static_cast< int >( i + 1 ) );
+			sTiles[ i ] = static_cast< uint16_t >( lua_tonumber( L, -1 ) );
+			lua_pop( L, 1 );
+		}
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	static int addWaveStandIn( lua_State* L )
+	{
+		LevelWave wave;
+		wave.time_ = static_cast< unsigned long >( lua_tonumber( L, 1 ) );
+		wave.actorType_ = lua_tostring( L, 2 );
+		wave.count_ = static_cast< unsigned long >( lua_tonumber( L, 3 ) );
+		wave.interval_ = static_cast< unsigned long >( lua_tonumber( L, 4 ) );
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	LevelBenchmark::LevelBenchmark( const unsigned long actorCount, const unsigned long iterations )
+		: actorCount_( actorCount )
+		, iterations_( iterations )
+		, tileColumns_( 64 )
+		, tileRows_( 48 )
+		, waveCount_( 20 )
+	{
+		assert( 0 != iterations_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool LevelBenchmark::run()
+	{
+		results_.clear();
+
+		const std::string source( generate() );
+		TFile sourceFile;
+		if ( !sourceFile.Open( BENCHMARK_SCRIPT, kWriteText ) )
+		{
+			return false;
+		}
+		sourceFile.Write( source.c_str(), static_cast< unsigned long >( source.length() ) );
+		sourceFile.Close();
+
+		LevelCompiler compiler;
+		if ( !compiler.run( BENCHMARK_SCRIPT ) || 1 != compiler.getLevels().size() )
+		{
+			return false;
+		}
+		const str levelPath( TFile::TranslateResource( BENCHMARK_LEVEL ) );
+		if ( !LevelCompiler::write( compiler.getLevels()[ 0 ], levelPath.c_str() ) )
+		{
+			return false;
+		}
+
+		TScript* s( new TScript() );
+		lua_State* L( s->GetState() );
+		ScriptRegisterFunctor( s, "addActor", addActorStandIn );
+		ScriptRegisterFunctor( s, "setTileGrid", setTileGridStandIn );
+		ScriptRegisterFunctor( s, "addWave", addWaveStandIn );
+		if ( !s->RunScript( "scripts/ddd/Factory.lua" ) )
+		{
+			delete s;
+			return false;
+		}
+
+		//run the description: parse it, then one Lua call per placed object
+		double t = getSeconds();
+		for ( unsigned long n = 0; n < iterations_; n++ )
+		{
+			s->RunScript( BENCHMARK_SCRIPT );
+			s->DoLuaString( "describeLevel( 0, 0 )" );
+		}
+		add( "lua", t, static_cast< unsigned long >( source.length() ) );
+
+		//map the file and walk its records, as Application::loadCompiledLevel does
+		unsigned long bytes( 0 );
+		t = getSeconds();
+		for ( unsigned long n = 0; n < iterations_; n++ )
+		{
+			CompiledLevel compiled;
+			if ( !compiled.open( BENCHMARK_LEVEL ) )
+			{
+				break;
+			}
+			bytes = compiled.getHeader().size_;
+
+			const CompiledLevel::Header& header( compiled.getHeader() );
+			sTiles.assign( compiled.getTiles(), compiled.getTiles() + header.tileColumns_ * header.tileRows_ );
+			const CompiledLevel::WaveRecord* waves( compiled.getWaves() );
+			for ( unsigned long i = 0; i < compiled.getWaveCount(); i++ )
+			{
+				LevelWave wave;
+				wave.time_ = waves[ i ].time_;
+				wave.actorType_ = compiled.getString( waves[ i ].type_ );
+				wave.count_ = waves[ i ].count_;
+				wave.interval_ = waves[ i ].interval_;
+			}
+
+			lua_getglobal( L, "Actor" );
+			const int prototype( lua_gettop( L ) );
+			const CompiledLevel::ActorRecord* actors( compiled.getActors() );
+			for ( unsigned long i = 0; i < compiled.getActorCount(); i++ )
+			{
+				cloneTable( L, prototype );
+				TLuaTable actorTable( L );
+				setULong( actorTable, "ID_", actors[ i ].id_ );
+				actorTable.Assign( "type_", str( compiled.getString( actors[ i ].type_ ) ) );
+			}
+			lua_pop( L, 1 );
+		}
+		add( "compiled", t, bytes );
+
+		delete s;
+		std::vector< uint16_t >().swap( sTiles );
+		return 0 != bytes;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const std::string LevelBenchmark::generate()const
+	{
+		std::string source( "levelDescriptions = { [ 0 ] = { [ 0 ] = function( gameID, levelID )\n" );
+
+		source += str::getFormatted( "\tsetTileGrid( %lu, %lu, 32, {", tileColumns_, tileRows_ ).c_str();
+		for ( unsigned long i = 0; i < tileColumns_ * tileRows_; i++ )
+		{
+			source += str::getFormatted( 0 == i ? " %lu" : ", %lu", ( i * 7 ) % 13 ).c_str();
+		}
+		source += " }, gameID, levelID );\n";
+
+		for ( unsigned long i = 0; i < waveCount_; i++ )
+		{
+			source += str::getFormatted( "\taddWave( %lu, \"actor\", %lu, 500, gameID, levelID );\n",
+					i * 10000, 5 + i ).c_str();
+		}
+		for ( unsigned long i = 0; i < actorCount_; i++ )
+		{
+			source += str::getFormatted( "\tcreateActor( %lu, \"actor\", gameID, levelID );\n", i ).c_str();
+		}
+
+		source += "end } }\n"
+			"function describeLevel( gameID, levelID )\n"
+			"\tlevelDescriptions[ gameID ][ levelID ]( gameID, levelID );\n"
+			"end\n";
+		return source;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LevelBenchmark::add( const char* path, const double start, const unsigned long bytes )
+	{
+		Result result;
+		result.path_ = path;
+		result.seconds_ = getSeconds() - start;
+		result.bytes_ = bytes;
+		results_.push_back( result );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool LevelBenchmark::write( const char* fileName )const
+	{
+		assert( 0 != fileName );
+		TFile file;
+		if ( !file.Open( fileName, kWriteText ) )
+		{
+			return false;
+		}
+
+		const str header( "path,actors,tiles,waves,iterations,seconds,ms_per_load,bytes\n" );
+		file.Write( header.c_str(), header.length() );
+
+		for ( size_t i = 0; i < results_.size(); i++ )
+		{
+			const Result& result( results_[ i ] );
+			const str line( str::getFormatted( "%s,%lu,%lu,%lu,%lu,%.6f,%.3f,%lu\n",
+					result.path_.c_str(),
+					actorCount_,
+					tileColumns_ * tileRows_,
+					waveCount_,
+					iterations_,
+					result.seconds_,
+					result.seconds_ * 1e3 / iterations_,
+					result.bytes_ ) );
+			file.Write( line.c_str(), line.length() );
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
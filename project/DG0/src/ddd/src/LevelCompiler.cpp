@@ -0,0 +1,278 @@
+#include "ddd/LevelCompiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <pf/file.h>
+#include <pf/script.h>
+#include "ddd/CompiledLevel.h"
+
+namespace ddd
+{
+	//stack index of the tiles table passed to setTileGrid
+	static const int TILES_ARGUMENT = 4;
+
+	//-------------------------------------------------------------------------
+
+	static const uint32_t alignSize( const size_t size )
+	{
+		return static_cast< uint32_t >( ( size + sizeof( uint32_t ) - 1 ) & ~( sizeof( uint32_t ) - 1 ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	//adds a string to the pool once and returns its offset
+	static const uint32_t poolString( std::vector< char >& pool,
+				std::map< std::string, uint32_t >& offsets,
+				const std::string& value )
+	{
+		std::map< std::string, uint32_t >::const_iterator it( offsets.find( value ) );
+		if ( offsets.end() != it )
+		{
+			return it->second;
+		}
+		const uint32_t offset( static_cast< uint32_t >( pool.size() ) );
+		pool.insert( pool.end(), value.begin(), value.end() );
+		pool.push_back( '\0' );
+		offsets[ value ] = offset;
+		return offset;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool LevelCompiler::run( const char* script )
+	{
+		assert( 0 != script );
+		levels_.clear();
+
+		uint32_t sourceHash( 0 );
+		if ( !CompiledLevel::hashSource( script, sourceHash ) )
+		{
+			return false;
+		}
+
+		TScript* s( new TScript() );
+		lua_State* L( s->GetState() );
+		ScriptRegisterFunctor( s, "createActor", LevelCompiler::recordActor );
+		ScriptRegisterFunctor( s, "setTileGrid", LevelCompiler::recordTileGrid );
+		ScriptRegisterFunctor( s, "addWave", LevelCompiler::recordWave );
+
+		bool success( s->RunScript( script ) );
+		if ( success )
+		{
+			lua_getglobal( L, "levelDescriptions" );
+			success = lua_istable( L, -1 );
+		}
+
+		//the stack is dropped with the script, so failures just stop
+		const int games( lua_gettop( L ) );
+		lua_pushnil( L );
+		while ( success && 0 != lua_next( L, games ) )
+		{
+			if ( !lua_istable( L, -1 ) )
+			{
+				lua_pop( L, 1 );
+				continue;
+			}
+
+			const unsigned long gameID( static_cast< unsigned long >( lua_tonumber( L, -2 ) ) );
+			const int levels( lua_gettop( L ) );
+			lua_pushnil( L );
+			while ( success && 0 != lua_next( L, levels ) )
+			{
+				Level level;
+				level.gameID_ = gameID;
+				level.levelID_ = static_cast< unsigned long >( lua_tonumber( L, -2 ) );
+				level.sourceHash_ = sourceHash;
+				level.tileColumns_ = 0;
+				level.tileRows_ = 0;
+				level.tileSize_ = 0;
+				levels_.push_back( level );
+
+				lua_pushlightuserdata( L, &levels_.back() );
+				lua_setglobal( L, "gLevel" );
+				lua_pushnumber( L, static_cast< lua_Number >( level.gameID_ ) );
+				lua_pushnumber( L, static_cast< lua_Number >( level.levelID_ ) );
+				//the call pops the description, lua_next needs the key left
+				success = 0 == s->RunFunction( 2, 0 );
+			}
+			lua_pop( L, 1 );
+		}
+
+		delete s;
+		if ( !success )
+		{
+			levels_.clear();
+		}
+		return success;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long LevelCompiler::writeAll( const char* script )const
+	{
+		assert( 0 != script );
+		//the script's native path minus its resource name is the asset folder
+		const str scriptPath( TFile::TranslateResource( script, true ) );
+		const size_t scriptLength( strlen( script ) );
+		if ( scriptPath.length() < scriptLength )
+		{
+			return 0;
+		}
+		const std::string root( scriptPath.c_str(), scriptPath.length() - scriptLength );
+
+		unsigned long written( 0 );
+		for ( size_t i = 0; i < levels_.size(); i++ )
+		{
+			const Level& level( levels_[ i ] );
+			const std::string path( root + CompiledLevel::getFileName( level.gameID_, level.levelID_ ) );
+			if ( write( level, path.c_str() ) )
+			{
+				written++;
+			}
+		}
+		return written;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool LevelCompiler::write( const Level& level, const char* path )
+	{
+		assert( 0 != path );
+		std::vector< char > image;
+		build( level, image );
+
+		FILE* file( fopen( path, "wb" ) );
+		if ( 0 == file )
+		{
+			return false;
+		}
+		const bool success( image.size() == fwrite( &image[ 0 ], 1, image.size(), file ) );
+		return 0 == fclose( file ) && success;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LevelCompiler::build( const Level& level, std::vector< char >& image )
+	{
+		std::vector< char > pool;
+		std::map< std::string, uint32_t > offsets;
+
+		std::vector< CompiledLevel::ActorRecord > actors( level.actors_.size() );
+		for ( size_t i = 0; i < actors.size(); i++ )
+		{
+			actors[ i ].id_ = static_cast< uint32_t >( level.actors_[ i ].id_ );
+			actors[ i ].type_ = poolString( pool, offsets, level.actors_[ i ].type_ );
+		}
+		std::vector< CompiledLevel::WaveRecord > waves( level.waves_.size() );
+		for ( size_t i = 0; i < waves.size(); i++ )
+		{
+			const LevelWave& wave( level.waves_[ i ] );
+			waves[ i ].time_ = static_cast< uint32_t >( wave.time_ );
+			waves[ i ].type_ = poolString( pool, offsets, wave.actorType_ );
+			waves[ i ].count_ = static_cast< uint32_t >( wave.count_ );
+			waves[ i ].interval_ = static_cast< uint32_t >( wave.interval_ );
+		}
+
+		CompiledLevel::Header header;
+		memset( &header, 0, sizeof( header ) );
+		header.magic_ = CompiledLevel::MAGIC;
+		header.version_ = CompiledLevel::VERSION;
+		header.sourceHash_ = level.sourceHash_;
+		header.gameID_ = static_cast< uint32_t >( level.gameID_ );
+		header.levelID_ = static_cast< uint32_t >( level.levelID_ );
+		header.actorOffset_ = sizeof( header );
+		header.actorCount_ = static_cast< uint32_t >( actors.size() );
+		header.tileOffset_ = header.actorOffset_ + header.actorCount_ * sizeof( CompiledLevel::ActorRecord );
+		header.tileColumns_ = static_cast< uint32_t >( level.tileColumns_ );
+		header.tileRows_ = static_cast< uint32_t >( level.tileRows_ );
+		header.tileSize_ = static_cast< uint32_t >( level.tileSize_ );
+		header.waveOffset_ = header.tileOffset_ + alignSize( level.tiles_.size() * sizeof( uint16_t ) );
+		header.waveCount_ = static_cast< uint32_t >( waves.size() );
+		header.stringOffset_ = header.waveOffset_ + header.waveCount_ * sizeof( CompiledLevel::WaveRecord );
+		header.stringSize_ = static_cast< uint32_t >( pool.size() );
+		header.size_ = header.stringOffset_ + header.stringSize_;
+
+		image.assign( header.size_, '\0' );
+		if ( !actors.empty() )
+		{
+			memcpy( &image[ header.actorOffset_ ], &actors[ 0 ], actors.size() * sizeof( CompiledLevel::ActorRecord ) );
+		}
+		if ( !level.tiles_.empty() )
+		{
+			memcpy( &image[ header.tileOffset_ ], &level.tiles_[ 0 ], level.tiles_.size() * sizeof( uint16_t ) );
+		}
+		if ( !waves.empty() )
+		{
+			memcpy( &image[ header.waveOffset_ ], &waves[ 0 ], waves.size() * sizeof( CompiledLevel::WaveRecord ) );
+		}
+		if ( !pool.empty() )
+		{
+			memcpy( &image[ header.stringOffset_ ], &pool[ 0 ], pool.size() );
+		}
+		header.checksum_ = CompiledLevel::checksum( &image[ 0 ] + sizeof( header ), header.size_ - sizeof( header ) );
+		memcpy( &image[ 0 ], &header, sizeof( header ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	LevelCompiler::Level& LevelCompiler::getRecordedLevel( lua_State* L )
+	{
+		lua_getglobal( L, "gLevel" );
+		Level* level( static_cast< Level* >( lua_touserdata( L, -1 ) ) );
+		lua_pop( L, 1 );
+		assert( 0 != level );
+		return *level;
+	}
+
+	//-------------------------------------------------------------------------
+
+	//createActor( actorID, actorType, gameID, levelID )
+	int LevelCompiler::recordActor( lua_State* L )
+	{
+		ActorEntry actor;
+		actor.id_ = static_cast< unsigned long >( luaL_checknumber( L, 1 ) );
+		actor.type_ = luaL_checkstring( L, 2 );
+		getRecordedLevel( L ).actors_.push_back( actor );
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	//setTileGrid( columns, rows, tileSize, tiles, gameID, levelID ), tiles
+	//being a row major array of columns * rows tile numbers
+	int LevelCompiler::recordTileGrid( lua_State* L )
+	{
+		Level& level( getRecordedLevel( L ) );
+		level.tileColumns_ = static_cast< unsigned long >( luaL_checknumber( L, 1 ) );
+		level.tileRows_ = static_cast< unsigned long >( luaL_checknumber( L, 2 ) );
+		level.tileSize_ = static_cast< unsigned long >( luaL_checknumber( L, 3 ) );
+		luaL_checktype( L, TILES_ARGUMENT, LUA_TTABLE );
+
+		const unsigned long count( level.tileColumns_ * level.tileRows_ );
+		level.tiles_.resize( count );
+		for ( unsigned long i = 0; i < count; i++ )
+		{
+			lua_rawgeti( L, TILES_ARGUMENT, static_cast< int >( i + 1 ) );
+			level.tiles_[ i ] = static_cast< uint16_t >( lua_tonumber( L, -1 ) );
+			lua_pop( L, 1 );
+		}
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	//addWave( time, actorType, count, interval, gameID, levelID )
+	int LevelCompiler::recordWave( lua_State* L )
+	{
+		LevelWave wave;
+		wave.time_ = static_cast< unsigned long >( luaL_checknumber( L, 1 ) );
+		wave.actorType_ = luaL_checkstring( L, 2 );
+		wave.count_ = static_cast< unsigned long >( luaL_checknumber( L, 3 ) );
+		wave.interval_ = static_cast< unsigned long >( luaL_checknumber( L, 4 ) );
+		getRecordedLevel( L ).waves_.push_back( wave );
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+}
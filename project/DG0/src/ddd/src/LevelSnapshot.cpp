@@ -0,0 +1,450 @@
+#include "ddd/LevelSnapshot.h"
+
+#include <set>
+#include <pf/file.h>
+#include <pf/random.h>
+#include <pf/script.h>
+#include <pf/windowmanager.h>
+#include "ddd/Application.h"
+#include "ddd/CompiledLevel.h"
+#include "ddd/Factory.h"
+#include "ddd/LevelWindow.h"
+#include "ddd/LuaUtils.h"
+#include "ddd/SnapshotArchive.h"
+
+namespace ddd
+{
+	//value tags of the actor tables; a table is its key, value pairs
+	//closed by TAG_END
+	static const unsigned char TAG_END = 0;
+	static const unsigned char TAG_BOOLEAN = 1;
+	static const unsigned char TAG_NUMBER = 2;
+	static const unsigned char TAG_STRING = 3;
+	static const unsigned char TAG_TABLE = 4;
+
+	typedef std::set< const void* > VisitedTables;
+
+	//-------------------------------------------------------------------------
+
+	static const bool isSaved( lua_State* L, const int index, const unsigned long depth, const VisitedTables& visited )
+	{
+		switch ( lua_type( L, index ) )
+		{
+		case LUA_TBOOLEAN:
+		case LUA_TNUMBER:
+		case LUA_TSTRING:
+			return true;
+		case LUA_TTABLE:
+			return depth < LevelSnapshot::MAX_DEPTH && visited.end() == visited.find( lua_topointer( L, index ) );
+		default:
+			return false;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	static void saveTable( lua_State* L, SnapshotWriter& writer, const int index, const unsigned long depth, VisitedTables& visited );
+
+	//the value at index, which isSaved() accepted
+	static void saveValue( lua_State* L, SnapshotWriter& writer, const int index, const unsigned long depth, VisitedTables& visited )
+	{
+		switch ( lua_type( L, index ) )
+		{
+		case LUA_TBOOLEAN:
+			writer.put( TAG_BOOLEAN );
+			writer.put( static_cast< unsigned char >( lua_toboolean( L, index ) ? 1 : 0 ) );
+			break;
+		case LUA_TNUMBER:
+			writer.put( TAG_NUMBER );
+			writer.put( static_cast< lua_Number >( lua_tonumber( L, index ) ) );
+			break;
+		case LUA_TSTRING:
+			writer.put( TAG_STRING );
+			writer.put( static_cast< uint32_t >( lua_strlen( L, index ) ) );
+			writer.putBytes( lua_tostring( L, index ), lua_strlen( L, index ) );
+			break;
+		case LUA_TTABLE:
+			writer.put( TAG_TABLE );
+			saveTable( L, writer, index, depth + 1, visited );
+			break;
+		default:
+			assert( false );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	static void saveTable( lua_State* L, SnapshotWriter& writer, const int index, const unsigned long depth, VisitedTables& visited )
+	{
+		const int table( index > 0 ? index : lua_gettop( L ) + index + 1 );
+		visited.insert( lua_topointer( L, table ) );
+		lua_pushnil( L );
+		while ( 0 != lua_next( L, table ) )
+		{
+			const int keyType( lua_type( L, -2 ) );
+			if ( ( LUA_TNUMBER == keyType || LUA_TSTRING == keyType )
+				&& isSaved( L, -1, depth, visited ) )
+			{
+				saveValue( L, writer, -2, depth, visited );
+				saveValue( L, writer, -1, depth, visited );
+			}
+			lua_pop( L, 1 );
+		}
+		writer.put( TAG_END );
+	}
+
+	//-------------------------------------------------------------------------
+
+	//pushes a boolean, number or string; false on anything else
+	static const bool loadScalar( lua_State* L, SnapshotReader& reader, const unsigned char tag )
+	{
+		switch ( tag )
+		{
+		case TAG_BOOLEAN:
+			{
+				unsigned char value( 0 );
+				if ( !reader.get( value ) )
+				{
+					return false;
+				}
+				lua_pushboolean( L, 0 != value );
+				return true;
+			}
+		case TAG_NUMBER:
+			{
+				lua_Number value( 0 );
+				if ( !reader.get( value ) )
+				{
+					return false;
+				}
+				lua_pushnumber( L, value );
+				return true;
+			}
+		case TAG_STRING:
+			{
+				std::string value;
+				if ( !reader.getString( value ) )
+				{
+					return false;
+				}
+				lua_pushlstring( L, value.data(), value.length() );
+				return true;
+			}
+		default:
+			return false;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	//sets the saved pairs on the table at index; nested tables are merged
+	//into the tables already there, so what the prototype gave them stays
+	static const bool loadTable( lua_State* L, SnapshotReader& reader, const int index )
+	{
+		const int table( index > 0 ? index : lua_gettop( L ) + index + 1 );
+		while ( true )
+		{
+			unsigned char tag( TAG_END );
+			if ( !reader.get( tag ) )
+			{
+				return false;
+			}
+			if ( TAG_END == tag )
+			{
+				return true;
+			}
+			if ( !loadScalar( L, reader, tag ) )
+			{
+				return false;
+			}
+
+			if ( !reader.get( tag ) )
+			{
+				lua_pop( L, 1 );
+				return false;
+			}
+			if ( TAG_TABLE != tag )
+			{
+				if ( !loadScalar( L, reader, tag ) )
+				{
+					lua_pop( L, 1 );
+					return false;
+				}
+				lua_settable( L, table );
+				continue;
+			}
+
+			lua_pushvalue( L, -1 );
+			lua_gettable( L, table );
+			if ( !lua_istable( L, -1 ) )
+			{
+				lua_pop( L, 1 );
+				lua_newtable( L );
+				lua_pushvalue( L, -2 );
+				lua_pushvalue( L, -2 );
+				lua_settable( L, table );
+			}
+			const bool loaded( loadTable( L, reader, -1 ) );
+			lua_pop( L, 2 );
+			if ( !loaded )
+			{
+				return false;
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	LevelSnapshot::LevelSnapshot()
+		: time_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LevelSnapshot::capture( LevelWindow& level )
+	{
+		assert( level.isInited() );
+		data_.clear();
+		SnapshotWriter writer( data_ );
+
+		time_ = level.getRenderComponent().getTime();
+		Header header;
+		header.magic_ = MAGIC;
+		header.version_ = VERSION;
+		header.gameID_ = level.getGameID();
+		header.levelID_ = level.getID();
+		header.time_ = time_;
+		writer.put( header );
+
+		const uint32_t randomSize( level.random_.SaveState( 0, 0 ) );
+		std::vector< char > random( randomSize );
+		if ( 0 != randomSize )
+		{
+			level.random_.SaveState( &random[ 0 ], randomSize );
+		}
+		writer.putVector( random );
+
+		LogicLevelComponent& logic( level.getLogicComponent() );
+		logic.save( writer );
+
+		lua_State* L( TWindowManager::GetInstance()->GetScript()->GetState() );
+		VisitedTables visited;
+		writer.put( static_cast< uint32_t >( logic.getActorCount() ) );
+		for ( size_t i = 0; i < logic.getActorCount(); i++ )
+		{
+			logic.getActor( static_cast< unsigned long >( i ) ).getLuaTable().Push();
+			visited.clear();
+			saveTable( L, writer, -1, 0, visited );
+			lua_pop( L, 1 );
+		}
+
+		level.getRenderComponent().save( writer );
+
+		const bool picking( level.pickingGrid_.isInited() );
+		writer.put( picking );
+		if ( picking )
+		{
+			level.pickingGrid_.save( writer );
+			writer.putVector( level.actorPickItems_ );
+			writer.putVector( level.pickItemActors_ );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool LevelSnapshot::restore( LevelWindow& level )const
+	{
+		assert( level.isInited() );
+		if ( isEmpty() )
+		{
+			return false;
+		}
+		SnapshotReader reader( &data_[ 0 ], data_.size() );
+
+		Header header;
+		if ( !reader.get( header )
+			|| MAGIC != header.magic_
+			|| VERSION != header.version_
+			|| level.getGameID() != header.gameID_
+			|| level.getID() != header.levelID_ )
+		{
+			return false;
+		}
+
+		//everything is parsed before the level is touched, so a blob
+		//that doesn't fit leaves it as it was
+		std::vector< char > random;
+		if ( !reader.getVector( random ) )
+		{
+			return false;
+		}
+
+		LogicLevelComponent logic;
+		if ( !logic.load( reader ) )
+		{
+			return false;
+		}
+
+		//each actor gets the table Actor:new() would have made for it,
+		//then its saved fields on top; kept in an array until the old
+		//actors are gone
+		uint32_t actorCount( 0 );
+		if ( !reader.get( actorCount ) )
+		{
+			return false;
+		}
+		lua_State* L( TWindowManager::GetInstance()->GetScript()->GetState() );
+		lua_getglobal( L, "Actor" );
+		assert( lua_istable( L, -1 ) );
+		const int prototype( lua_gettop( L ) );
+		lua_newtable( L );
+		const int actorTables( lua_gettop( L ) );
+		for ( uint32_t i = 0; i < actorCount; i++ )
+		{
+			cloneTable( L, prototype );
+			if ( !loadTable( L, reader, -1 ) )
+			{
+				lua_settop( L, prototype - 1 );
+				return false;
+			}
+			lua_rawseti( L, actorTables, static_cast< int >( i + 1 ) );
+		}
+
+		RenderLevelComponent::Loaded render;
+		bool picking( false );
+		PickingGrid pickingGrid;
+		std::vector< unsigned long > actorPickItems;
+		std::vector< unsigned long > pickItemActors;
+		if ( !level.getRenderComponent().read( reader, render )
+			|| !reader.get( picking )
+			|| ( picking && !level.pickingGrid_.isInited() ) )
+		{
+			lua_settop( L, prototype - 1 );
+			return false;
+		}
+		if ( picking )
+		{
+			//the copy keeps the bounds and masks the items refer to
+			pickingGrid = level.pickingGrid_;
+			bool valid( pickingGrid.load( reader )
+				&& reader.getVector( actorPickItems )
+				&& reader.getVector( pickItemActors ) );
+			for ( size_t i = 0; valid && i < actorPickItems.size(); i++ )
+			{
+				valid = MAX_UNSIGN_LONG == actorPickItems[ i ] || actorPickItems[ i ] < pickItemActors.size();
+			}
+			if ( !valid )
+			{
+				lua_settop( L, prototype - 1 );
+				return false;
+			}
+		}
+		if ( !reader.isAtEnd() )
+		{
+			lua_settop( L, prototype - 1 );
+			return false;
+		}
+
+		if ( !random.empty() )
+		{
+			level.random_.RestoreState( &random[ 0 ] );
+		}
+		LogicLevelComponent& levelLogic( level.getLogicComponent() );
+		levelLogic.swapState( logic );
+		levelLogic.destroyAllActors();
+		Factory* factory( Application::get_mutable_instance().getFactory() );
+		levelLogic.reserveActors( actorCount );
+		for ( uint32_t i = 0; i < actorCount; i++ )
+		{
+			lua_rawgeti( L, actorTables, static_cast< int >( i + 1 ) );
+			TLuaTable actorTable( L );
+
+			Actor* actor = factory->createActor( actorTable.GetString( "type_" ).c_str() );
+			assert( 0 != actor );
+			actor->init( &actorTable );
+			levelLogic.addActor( *actor );
+		}
+		lua_settop( L, prototype - 1 );
+
+		//after the actors, whose onInit may have added nodes and items
+		level.getRenderComponent().commit( render );
+		if ( picking )
+		{
+			level.pickingGrid_ = pickingGrid;
+			level.actorPickItems_.swap( actorPickItems );
+			level.pickItemActors_.swap( pickItemActors );
+		}
+		level.hoverItemID_ = MAX_UNSIGN_LONG;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LevelSnapshot::clear()
+	{
+		data_.clear();
+		time_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool LevelSnapshot::save( const char* fileName )const
+	{
+		assert( 0 != fileName );
+		if ( isEmpty() )
+		{
+			return false;
+		}
+		TFile file;
+		if ( !file.Open( fileName, kWriteBinary ) )
+		{
+			return false;
+		}
+		const uint32_t checksum( CompiledLevel::checksum( &data_[ 0 ], static_cast< unsigned long >( data_.size() ) ) );
+		file.Write( &data_[ 0 ], static_cast< unsigned long >( data_.size() ) );
+		file.Write( &checksum, sizeof( checksum ) );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool LevelSnapshot::load( const char* fileName )
+	{
+		assert( 0 != fileName );
+		clear();
+		TFile file;
+		if ( !file.Open( fileName ) )
+		{
+			return false;
+		}
+		const unsigned long size( file.Size() );
+		if ( size < sizeof( Header ) + sizeof( uint32_t ) )
+		{
+			return false;
+		}
+		data_.resize( size );
+		if ( static_cast< long >( size ) != file.Read( &data_[ 0 ], size ) )
+		{
+			clear();
+			return false;
+		}
+
+		uint32_t checksum( 0 );
+		memcpy( &checksum, &data_[ size - sizeof( checksum ) ], sizeof( checksum ) );
+		data_.resize( size - sizeof( checksum ) );
+		Header header;
+		memcpy( &header, &data_[ 0 ], sizeof( header ) );
+		if ( checksum != CompiledLevel::checksum( &data_[ 0 ], static_cast< unsigned long >( data_.size() ) )
+			|| MAGIC != header.magic_
+			|| VERSION != header.version_ )
+		{
+			clear();
+			return false;
+		}
+		time_ = header.time_;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
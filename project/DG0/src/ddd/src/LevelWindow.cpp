@@ -1,6 +1,7 @@
 #include "ddd/LevelWindow.h"
 
 #include <pf/pflib.h>
+#include <pf/windowstyle.h>
 #include "pf/debug.h"
 
 #include "ddd/Application.h"
@@ -8,6 +9,14 @@
 
 namespace ddd
 {
+	//side of a picking grid cell in pixels
+	static const unsigned long PICKING_CELL_SIZE = 64;
+	//per-actor progress bars, in pixels
+	static const TReal PROGRESS_BAR_WIDTH = 32;
+	static const TReal PROGRESS_BAR_HEIGHT = 4;
+	static const TColor PROGRESS_BAR_FILL( 0.35f, 0.85f, 0.25f, 1 );
+	static const TColor PROGRESS_BAR_BACK( 0, 0, 0, 0.5f );
+
 	//-------------------------------------------------------------------------
 
 	PFTYPEIMPL_DC(LevelWindow);
@@ -15,6 +24,7 @@ namespace ddd
 	//-------------------------------------------------------------------------
 
 	LevelWindow::LevelWindow()
+		: hoverItemID_( MAX_UNSIGN_LONG )
 	{
 	}
 
@@ -24,6 +34,7 @@ namespace ddd
 	{
 		if ( isInited() )
 		{
+			ddd::Application::get_mutable_instance().getMetrics().record( MetricsLog::EVENT_LEVEL_END, "", static_cast< long >( getID() ) );
 			ddd::Application::get_mutable_instance().getEntity( getGameID() ).removeEntity( getID() );
 			release();
 		}
@@ -31,8 +42,16 @@ namespace ddd
 
 	//-------------------------------------------------------------------------
 
-	void LevelWindow::Init(TWindowStyle &/*style*/)
+	void LevelWindow::Init(TWindowStyle &style)
 	{
+		//no HUD without a font to draw its text in
+		const str hudFont( style.GetString( "hudfont", "" ) );
+		if ( !hudFont.empty() )
+		{
+			hudLayer_.init( hudFont.c_str(),
+					static_cast< unsigned long >( style.GetNumber( "hudfontsize", 16 ) ) );
+		}
+
 		// Start the window animation
 		StartWindowAnimation( 16 );
 
@@ -47,11 +66,15 @@ namespace ddd
 			const unsigned long gameID )
 	{
 		LevelWindow::Init(style);
+		//Init has sized the window; the grid is ready before Level:onInit
+		//adds items and before the first mouse message
+		initPickingGrid();
 		getLogicComponent().create();
 		getLogicComponent().init();
 		getRenderComponent().create();
 		getRenderComponent().init();
 		ddd::Application::get_mutable_instance().createLevelTable(this, levelID, gameID);
+		ddd::Application::get_mutable_instance().getMetrics().record( MetricsLog::EVENT_LEVEL_BEGIN, "", static_cast< long >( levelID ) );
 	}
 
 	//-------------------------------------------------------------------------
@@ -59,6 +82,22 @@ namespace ddd
 	void LevelWindow::Draw()
 	{
 		getRenderComponent().render(this);
+
+		if ( hudLayer_.isInited() )
+		{
+			const LogicLevelComponent& logic( getLogicComponent() );
+			hudLayer_.begin();
+			hudLayer_.bars( logic.getProgressCount(),
+					logic.getProgressXs(),
+					logic.getProgressYs(),
+					logic.getProgressValues(),
+					PROGRESS_BAR_WIDTH,
+					PROGRESS_BAR_HEIGHT,
+					PROGRESS_BAR_FILL,
+					PROGRESS_BAR_BACK );
+			drawHud( hudLayer_ );
+			hudLayer_.end();
+		}
 	}
 
 	//-------------------------------------------------------------------------
@@ -66,14 +105,58 @@ namespace ddd
 	bool LevelWindow::OnTaskAnimate()
 	{
 		getLogicComponent().update(this);
+		if ( isInited() )
+		{
+			snapshots_.update( *this );
+		}
+		//glyphs the HUD met in the last Draw() can only be made here
+		hudLayer_.update();
 		return true;
 	}
 
 	//-------------------------------------------------------------------------
 
+	void LevelWindow::drawHud( HudLayer& /*hud*/ )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	bool LevelWindow::OnMouseDown( const TPoint& point )
+	{
+		if ( isInited() )
+		{
+			executePickFunction( 1, point, getPickingGrid().pick( point ) );
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	bool LevelWindow::OnMouseMove( const TPoint& point )
+	{
+		if ( !isInited() )
+		{
+			return false;
+		}
+
+		//Lua only hears about changes
+		const unsigned long itemID( getPickingGrid().pick( point ) );
+		if ( itemID != hoverItemID_ )
+		{
+			hoverItemID_ = itemID;
+			executePickFunction( 2, point, itemID );
+		}
+		return false;
+	}
+
+	//-------------------------------------------------------------------------
+
 	void LevelWindow::onInit()
 	{
 		initLuaFunction( 0, "onInit" );
+		initLuaFunction( 1, "onMouseDown" );
+		initLuaFunction( 2, "onHover" );
 		ddd::Application::get_mutable_instance().getEntity( getGameID() ).addEntity( *this );
 
 		executeLuaFunction( 0 );
@@ -84,8 +167,111 @@ namespace ddd
 	void LevelWindow::onRelease()
 	{
 		releaseLuaFunction( 0 );
+		releaseLuaFunction( 1 );
+		releaseLuaFunction( 2 );
 		getLogicComponent().release();
 		getRenderComponent().release();
+		pickingGrid_.release();
+		actorPickItems_.clear();
+		pickItemActors_.clear();
+		hudLayer_.release();
+		snapshots_.clear();
+		hoverItemID_ = MAX_UNSIGN_LONG;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LevelWindow::initPickingGrid()
+	{
+		TRect rect;
+		GetClientRect( &rect );
+		//a window without a size yet keeps its items until it gets one
+		if ( rect.GetWidth() > 0 && rect.GetHeight() > 0 )
+		{
+			pickingGrid_.init( rect, PICKING_CELL_SIZE );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LevelWindow::updateActorPick( const unsigned long actorID )
+	{
+		TRect rect;
+		long layer( 0 );
+		if ( !getRenderComponent().getActorBounds( actorID, rect, layer ) )
+		{
+			removeActorPick( actorID );
+			return;
+		}
+
+		if ( actorID >= actorPickItems_.size() )
+		{
+			actorPickItems_.resize( actorID + 1, MAX_UNSIGN_LONG );
+		}
+		unsigned long& itemID( actorPickItems_[ actorID ] );
+		//actors on higher layers are drawn over, and picked before, the rest
+		if ( MAX_UNSIGN_LONG == itemID )
+		{
+			itemID = getPickingGrid().addItem( rect, layer );
+			if ( itemID >= pickItemActors_.size() )
+			{
+				pickItemActors_.resize( itemID + 1, MAX_UNSIGN_LONG );
+			}
+			pickItemActors_[ itemID ] = actorID;
+		}
+		else
+		{
+			pickingGrid_.moveItem( itemID, rect );
+			pickingGrid_.setPriority( itemID, layer );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LevelWindow::removeActorPick( const unsigned long actorID )
+	{
+		if ( actorID >= actorPickItems_.size() || MAX_UNSIGN_LONG == actorPickItems_[ actorID ] )
+		{
+			return;
+		}
+		const unsigned long itemID( actorPickItems_[ actorID ] );
+		pickingGrid_.removeItem( itemID );
+		pickItemActors_[ itemID ] = MAX_UNSIGN_LONG;
+		actorPickItems_[ actorID ] = MAX_UNSIGN_LONG;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LevelWindow::executePickFunction( const unsigned long functionID,
+			const TPoint& point,
+			const unsigned long itemID )
+	{
+		//{ x, y, column, row, item, actor }; column and row are left out
+		//off the grid, item when nothing was hit and actor when the item
+		//isn't an actor's
+		TScript* script( TWindowManager::GetInstance()->GetScript() );
+		TLuaTable* parameters( TLuaTable::Create( script->GetState() ) );
+		parameters->Assign( "x", static_cast< lua_Number >( point.x ) );
+		parameters->Assign( "y", static_cast< lua_Number >( point.y ) );
+
+		unsigned long column( 0 );
+		unsigned long row( 0 );
+		if ( getPickingGrid().getCell( point, column, row ) )
+		{
+			parameters->Assign( "column", static_cast< lua_Number >( column ) );
+			parameters->Assign( "row", static_cast< lua_Number >( row ) );
+		}
+		if ( MAX_UNSIGN_LONG != itemID )
+		{
+			parameters->Assign( "item", static_cast< lua_Number >( itemID ) );
+			if ( itemID < pickItemActors_.size() && MAX_UNSIGN_LONG != pickItemActors_[ itemID ] )
+			{
+				parameters->Assign( "actor", static_cast< lua_Number >( pickItemActors_[ itemID ] ) );
+			}
+		}
+
+		executeLuaFunction( functionID, parameters );
+		delete parameters;
 	}
 
 	//-------------------------------------------------------------------------
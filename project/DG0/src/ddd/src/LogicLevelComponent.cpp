@@ -1,4 +1,7 @@
 #include "ddd/LogicLevelComponent.h"
+
+#include <algorithm>
+#include "ddd/SnapshotArchive.h"
 #include "ddd/Actor.h"
 
 namespace ddd
@@ -6,6 +9,9 @@ namespace ddd
 	//-------------------------------------------------------------------------
 
 	LogicLevelComponent::LogicLevelComponent()
+		: tileColumns_( 0 )
+		, tileRows_( 0 )
+		, tileSize_( 0 )
 	{
 	}
 	
@@ -39,6 +45,13 @@ namespace ddd
 	void LogicLevelComponent::onRelease()
 	{
 		destroyAllActors();
+		setTileGrid( 0, 0, 0, 0 );
+		waves_.clear();
+		progressActors_.clear();
+		progressValues_.clear();
+		progressXs_.clear();
+		progressYs_.clear();
+		progressSlots_.clear();
 	}
 
 	//-------------------------------------------------------------------------
@@ -64,5 +77,155 @@ namespace ddd
 		removeAllActors();
 	}
 
+	//-------------------------------------------------------------------------
+	void LogicLevelComponent::setTileGrid( const unsigned long columns,
+				const unsigned long rows,
+				const unsigned long tileSize,
+				const uint16_t* tiles )
+	{
+		assert( 0 != tiles || 0 == columns * rows );
+		tileColumns_ = columns;
+		tileRows_ = rows;
+		tileSize_ = tileSize;
+		tiles_.assign( tiles, tiles + columns * rows );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LogicLevelComponent::setProgress( const unsigned long actorID,
+				const TReal progress,
+				const TReal x,
+				const TReal y )
+	{
+		if ( actorID >= progressSlots_.size() )
+		{
+			progressSlots_.resize( actorID + 1, MAX_UNSIGN_LONG );
+		}
+		unsigned long& slot( progressSlots_[ actorID ] );
+		if ( MAX_UNSIGN_LONG == slot )
+		{
+			slot = static_cast< unsigned long >( progressActors_.size() );
+			progressActors_.push_back( actorID );
+			progressValues_.push_back( progress );
+			progressXs_.push_back( x );
+			progressYs_.push_back( y );
+			return;
+		}
+		progressValues_[ slot ] = progress;
+		progressXs_[ slot ] = x;
+		progressYs_[ slot ] = y;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LogicLevelComponent::removeProgress( const unsigned long actorID )
+	{
+		if ( actorID >= progressSlots_.size() || MAX_UNSIGN_LONG == progressSlots_[ actorID ] )
+		{
+			return;
+		}
+		//the last bar takes the freed slot
+		const unsigned long slot( progressSlots_[ actorID ] );
+		const unsigned long last( static_cast< unsigned long >( progressActors_.size() - 1 ) );
+		progressActors_[ slot ] = progressActors_[ last ];
+		progressValues_[ slot ] = progressValues_[ last ];
+		progressXs_[ slot ] = progressXs_[ last ];
+		progressYs_[ slot ] = progressYs_[ last ];
+		progressSlots_[ progressActors_[ slot ] ] = slot;
+		progressSlots_[ actorID ] = MAX_UNSIGN_LONG;
+
+		progressActors_.pop_back();
+		progressValues_.pop_back();
+		progressXs_.pop_back();
+		progressYs_.pop_back();
+	}
+
+	//-------------------------------------------------------------------------
+	void LogicLevelComponent::save( SnapshotWriter& writer )const
+	{
+		writer.put( tileColumns_ );
+		writer.put( tileRows_ );
+		writer.put( tileSize_ );
+		writer.putVector( tiles_ );
+
+		writer.put( static_cast< uint32_t >( waves_.size() ) );
+		for ( size_t i = 0; i < waves_.size(); i++ )
+		{
+			const LevelWave& wave( waves_[ i ] );
+			writer.put( wave.time_ );
+			writer.putString( wave.actorType_ );
+			writer.put( wave.count_ );
+			writer.put( wave.interval_ );
+		}
+
+		writer.putVector( progressActors_ );
+		writer.putVector( progressValues_ );
+		writer.putVector( progressXs_ );
+		writer.putVector( progressYs_ );
+		writer.putVector( progressSlots_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool LogicLevelComponent::load( SnapshotReader& reader )
+	{
+		reader.get( tileColumns_ );
+		reader.get( tileRows_ );
+		reader.get( tileSize_ );
+		reader.getVector( tiles_ );
+
+		uint32_t waveCount( 0 );
+		reader.get( waveCount );
+		waves_.resize( reader.isFailed() ? 0 : waveCount );
+		for ( size_t i = 0; i < waves_.size() && !reader.isFailed(); i++ )
+		{
+			LevelWave& wave( waves_[ i ] );
+			reader.get( wave.time_ );
+			reader.getString( wave.actorType_ );
+			reader.get( wave.count_ );
+			reader.get( wave.interval_ );
+		}
+
+		reader.getVector( progressActors_ );
+		reader.getVector( progressValues_ );
+		reader.getVector( progressXs_ );
+		reader.getVector( progressYs_ );
+		reader.getVector( progressSlots_ );
+
+		const size_t count( progressActors_.size() );
+		if ( reader.isFailed()
+			|| tiles_.size() != tileColumns_ * tileRows_
+			|| count != progressValues_.size()
+			|| count != progressXs_.size()
+			|| count != progressYs_.size() )
+		{
+			setTileGrid( 0, 0, 0, 0 );
+			waves_.clear();
+			progressActors_.clear();
+			progressValues_.clear();
+			progressXs_.clear();
+			progressYs_.clear();
+			progressSlots_.clear();
+			return false;
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void LogicLevelComponent::swapState( LogicLevelComponent& other )
+	{
+		tiles_.swap( other.tiles_ );
+		std::swap( tileColumns_, other.tileColumns_ );
+		std::swap( tileRows_, other.tileRows_ );
+		std::swap( tileSize_, other.tileSize_ );
+		waves_.swap( other.waves_ );
+		progressActors_.swap( other.progressActors_ );
+		progressValues_.swap( other.progressValues_ );
+		progressXs_.swap( other.progressXs_ );
+		progressYs_.swap( other.progressYs_ );
+		progressSlots_.swap( other.progressSlots_ );
+	}
+
 	//-------------------------------------------------------------------------
 }
\ No newline at end of file
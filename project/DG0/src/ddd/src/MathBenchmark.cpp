@@ -0,0 +1,150 @@
+#include "ddd/MathBenchmark.h"
+
+#include <pf/file.h>
+#include "ddd/Math.h"
+
+#include <windows.h>
+
+namespace ddd
+{
+	static const double getSeconds()
+	{
+		LARGE_INTEGER frequency;
+		LARGE_INTEGER counter;
+		QueryPerformanceFrequency( &frequency );
+		QueryPerformanceCounter( &counter );
+		return static_cast< double >( counter.QuadPart ) / static_cast< double >( frequency.QuadPart );
+	}
+
+	//-------------------------------------------------------------------------
+
+	MathBenchmark::MathBenchmark( const unsigned long pointCount, const unsigned long iterations )
+		: pointCount_( pointCount )
+		, iterations_( iterations )
+	{
+		assert( 0 != pointCount_ );
+		assert( 0 != iterations_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void MathBenchmark::run()
+	{
+		results_.clear();
+
+		std::vector< TVec2 > points( pointCount_ );
+		std::vector< TVec2 > velocities( pointCount_ );
+		std::vector< TVec2 > out( pointCount_ );
+		std::vector< TReal > dots( pointCount_ );
+		for ( unsigned long i = 0; i < pointCount_; i++ )
+		{
+			points[ i ] = TVec2( static_cast< TReal >( i % 800 ), static_cast< TReal >( i % 600 ) );
+			velocities[ i ] = TVec2( static_cast< TReal >( i % 7 ) - 3, static_cast< TReal >( i % 5 ) - 2 );
+		}
+		const std::vector< TVec2 > start( points );
+
+		const Mat3 m( Mat3::translation( Vec2( 12, 34 ) ) * Mat3::rotation( 0.5f ) * Mat3::scale( 2, 3 ) );
+		const TReal seconds( 0.016f );
+
+		//position += velocity * seconds
+		double t = getSeconds();
+		for ( unsigned long n = 0; n < iterations_; n++ )
+		{
+			for ( unsigned long i = 0; i < pointCount_; i++ )
+			{
+				points[ i ] = points[ i ] + velocities[ i ] * seconds;
+			}
+		}
+		add( "add_scaled", "pf", t, points[ pointCount_ - 1 ].x + points[ pointCount_ - 1 ].y );
+
+		points = start;
+		t = getSeconds();
+		for ( unsigned long n = 0; n < iterations_; n++ )
+		{
+			addScaled( fromPf( &points[ 0 ] ), fromPf( &velocities[ 0 ] ), seconds, pointCount_ );
+		}
+		add( "add_scaled", "ddd", t, points[ pointCount_ - 1 ].x + points[ pointCount_ - 1 ].y );
+
+		//out = m * point
+		points = start;
+		t = getSeconds();
+		for ( unsigned long n = 0; n < iterations_; n++ )
+		{
+			for ( unsigned long i = 0; i < pointCount_; i++ )
+			{
+				out[ i ] = toPf( m ) * points[ i ];
+			}
+		}
+		add( "transform_points", "pf", t, out[ pointCount_ - 1 ].x + out[ pointCount_ - 1 ].y );
+
+		t = getSeconds();
+		for ( unsigned long n = 0; n < iterations_; n++ )
+		{
+			transformPoints( m, fromPf( &points[ 0 ] ), fromPf( &out[ 0 ] ), pointCount_ );
+		}
+		add( "transform_points", "ddd", t, out[ pointCount_ - 1 ].x + out[ pointCount_ - 1 ].y );
+
+		//dot = point . velocity
+		t = getSeconds();
+		for ( unsigned long n = 0; n < iterations_; n++ )
+		{
+			for ( unsigned long i = 0; i < pointCount_; i++ )
+			{
+				dots[ i ] = DotProduct( points[ i ], velocities[ i ] );
+			}
+		}
+		add( "dot", "pf", t, dots[ pointCount_ - 1 ] );
+
+		t = getSeconds();
+		for ( unsigned long n = 0; n < iterations_; n++ )
+		{
+			dot( fromPf( &points[ 0 ] ), fromPf( &velocities[ 0 ] ), &dots[ 0 ], pointCount_ );
+		}
+		add( "dot", "ddd", t, dots[ pointCount_ - 1 ] );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void MathBenchmark::add( const char* op, const char* backend, const double start, const double sum )
+	{
+		Result result;
+		result.op_ = op;
+		result.backend_ = backend;
+		result.seconds_ = getSeconds() - start;
+		result.sum_ = sum;
+		results_.push_back( result );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool MathBenchmark::write( const char* fileName )const
+	{
+		assert( 0 != fileName );
+		TFile file;
+		if ( !file.Open( fileName, kWriteText ) )
+		{
+			return false;
+		}
+
+		const str header( "op,backend,points,iterations,seconds,ns_per_point,checksum\n" );
+		file.Write( header.c_str(), header.length() );
+
+		const double points( static_cast< double >( pointCount_ ) * iterations_ );
+		for ( size_t i = 0; i < results_.size(); i++ )
+		{
+			const Result& result( results_[ i ] );
+			const str line( str::getFormatted( "%s,%s,%lu,%lu,%.6f,%.3f,%.3f\n",
+					result.op_.c_str(),
+					result.backend_.c_str(),
+					pointCount_,
+					iterations_,
+					result.seconds_,
+					result.seconds_ * 1e9 / points,
+					result.sum_ ) );
+			file.Write( line.c_str(), line.length() );
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
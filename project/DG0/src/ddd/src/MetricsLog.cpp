@@ -0,0 +1,281 @@
+#include "ddd/MetricsLog.h"
+
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <process.h>
+#include <pf/file.h>
+
+#include <windows.h>
+
+namespace ddd
+{
+	static const char METRICS_HEADER[] = { 'D', 'G', 'M', '1' };
+
+	//-------------------------------------------------------------------------
+
+	struct MetricsLog::Event
+	{
+		unsigned long tick_;
+		long value_;
+		unsigned char type_;
+		unsigned char nameLength_;
+		char name_[ MAX_NAME ];
+	};
+
+	//-------------------------------------------------------------------------
+
+	struct MetricsLog::Impl
+	{
+		Event events_[ CAPACITY ];
+		//next event to write out, only the writer thread moves it
+		volatile LONG read_;
+		//next free slot, only the game thread moves it
+		volatile LONG write_;
+		volatile LONG stopping_;
+		volatile LONG written_;
+		volatile LONG batches_;
+		//auto reset, wakes the writer before WRITE_DELAY is up
+		HANDLE wake_;
+		HANDLE thread_;
+		HANDLE file_;
+		DWORD startTick_;
+		//the writer thread's encoding buffer
+		std::vector< char > buffer_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	static void putLong( std::vector< char >& buffer, const unsigned long value )
+	{
+		buffer.push_back( static_cast< char >( value & 0xff ) );
+		buffer.push_back( static_cast< char >( ( value >> 8 ) & 0xff ) );
+		buffer.push_back( static_cast< char >( ( value >> 16 ) & 0xff ) );
+		buffer.push_back( static_cast< char >( ( value >> 24 ) & 0xff ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	MetricsLog::MetricsLog()
+		: impl_( new Impl )
+		, started_( false )
+		, recorded_( 0 )
+		, dropped_( 0 )
+		, unreported_( 0 )
+	{
+		impl_->read_ = 0;
+		impl_->write_ = 0;
+		impl_->stopping_ = 0;
+		impl_->written_ = 0;
+		impl_->batches_ = 0;
+		impl_->wake_ = CreateEvent( 0, FALSE, FALSE, 0 );
+		impl_->thread_ = 0;
+		impl_->file_ = INVALID_HANDLE_VALUE;
+		impl_->startTick_ = 0;
+		assert( 0 != impl_->wake_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	MetricsLog::~MetricsLog()
+	{
+		stop();
+		CloseHandle( impl_->wake_ );
+		delete impl_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void MetricsLog::start( const char* fileName )
+	{
+		assert( !isStarted() );
+		assert( 0 != fileName );
+		impl_->file_ = CreateFileA( TFile::TranslateResource( fileName ).c_str(),
+				GENERIC_WRITE,
+				FILE_SHARE_READ,
+				0,
+				OPEN_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL,
+				0 );
+		if ( INVALID_HANDLE_VALUE == impl_->file_ )
+		{
+			//events recorded while stopped are ignored
+			return;
+		}
+
+		DWORD done( 0 );
+		if ( 0 == GetFileSize( impl_->file_, 0 ) )
+		{
+			WriteFile( impl_->file_, METRICS_HEADER, sizeof( METRICS_HEADER ), &done, 0 );
+		}
+		else
+		{
+			SetFilePointer( impl_->file_, 0, 0, FILE_END );
+		}
+
+		impl_->read_ = 0;
+		impl_->write_ = 0;
+		impl_->stopping_ = 0;
+		impl_->startTick_ = GetTickCount();
+		const uintptr_t thread( _beginthreadex( 0, 0, &MetricsLog::threadProc, this, 0, 0 ) );
+		assert( 0 != thread );
+		impl_->thread_ = reinterpret_cast< HANDLE >( thread );
+		started_ = true;
+
+		record( EVENT_SESSION, "", static_cast< long >( time( 0 ) ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void MetricsLog::stop()
+	{
+		if ( !isStarted() )
+		{
+			return;
+		}
+
+		if ( 0 != unreported_ )
+		{
+			push( EVENT_DROPPED, "", static_cast< long >( unreported_ ) );
+			unreported_ = 0;
+		}
+
+		//the writer drains the ring once more before it returns
+		InterlockedExchange( &impl_->stopping_, 1 );
+		SetEvent( impl_->wake_ );
+		WaitForSingleObject( impl_->thread_, INFINITE );
+		CloseHandle( impl_->thread_ );
+		impl_->thread_ = 0;
+		CloseHandle( impl_->file_ );
+		impl_->file_ = INVALID_HANDLE_VALUE;
+		started_ = false;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool MetricsLog::record( const EventType type, const char* name, const long value )
+	{
+		assert( 0 != name );
+		if ( !isStarted() )
+		{
+			return false;
+		}
+
+		if ( 0 != unreported_ && push( EVENT_DROPPED, "", static_cast< long >( unreported_ ) ) )
+		{
+			unreported_ = 0;
+		}
+		if ( !push( type, name, value ) )
+		{
+			dropped_++;
+			unreported_++;
+			return false;
+		}
+		recorded_++;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long MetricsLog::getWritten()const
+	{
+		return static_cast< unsigned long >( impl_->written_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long MetricsLog::getBatches()const
+	{
+		return static_cast< unsigned long >( impl_->batches_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool MetricsLog::push( const EventType type, const char* name, const long value )
+	{
+		const LONG write( impl_->write_ );
+		const LONG read( InterlockedCompareExchange( &impl_->read_, 0, 0 ) );
+		const unsigned long used( static_cast< unsigned long >( write - read ) );
+		if ( used >= CAPACITY )
+		{
+			return false;
+		}
+
+		Event& event( impl_->events_[ static_cast< unsigned long >( write ) & ( CAPACITY - 1 ) ] );
+		size_t length( strlen( name ) );
+		if ( length > MAX_NAME )
+		{
+			length = MAX_NAME;
+		}
+		event.tick_ = GetTickCount() - impl_->startTick_;
+		event.value_ = value;
+		event.type_ = static_cast< unsigned char >( type );
+		event.nameLength_ = static_cast< unsigned char >( length );
+		memcpy( event.name_, name, length );
+
+		//publishes the slot to the writer
+		InterlockedExchange( &impl_->write_, write + 1 );
+		if ( WAKE_COUNT == used + 1 )
+		{
+			SetEvent( impl_->wake_ );
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	unsigned int __stdcall MetricsLog::threadProc( void* param )
+	{
+		static_cast< MetricsLog* >( param )->run();
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void MetricsLog::run()
+	{
+		while ( true )
+		{
+			WaitForSingleObject( impl_->wake_, WRITE_DELAY );
+			const bool stopping( 0 != InterlockedCompareExchange( &impl_->stopping_, 0, 0 ) );
+			drain();
+			if ( stopping )
+			{
+				return;
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void MetricsLog::drain()
+	{
+		const LONG read( impl_->read_ );
+		const LONG write( InterlockedCompareExchange( &impl_->write_, 0, 0 ) );
+		if ( read == write )
+		{
+			return;
+		}
+
+		std::vector< char >& buffer( impl_->buffer_ );
+		buffer.clear();
+		for ( LONG i = read; i != write; i++ )
+		{
+			const Event& event( impl_->events_[ static_cast< unsigned long >( i ) & ( CAPACITY - 1 ) ] );
+			putLong( buffer, event.tick_ );
+			buffer.push_back( static_cast< char >( event.type_ ) );
+			buffer.push_back( static_cast< char >( event.nameLength_ ) );
+			putLong( buffer, static_cast< unsigned long >( event.value_ ) );
+			buffer.insert( buffer.end(), event.name_, event.name_ + event.nameLength_ );
+		}
+		//the slots are copied out, the game thread may reuse them
+		InterlockedExchange( &impl_->read_, write );
+
+		DWORD done( 0 );
+		WriteFile( impl_->file_, &buffer[ 0 ], static_cast< DWORD >( buffer.size() ), &done, 0 );
+		InterlockedExchangeAdd( &impl_->written_, write - read );
+		InterlockedIncrement( &impl_->batches_ );
+	}
+
+	//-------------------------------------------------------------------------
+}
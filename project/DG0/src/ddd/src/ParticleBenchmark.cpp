@@ -0,0 +1,194 @@
+#include "ddd/ParticleBenchmark.h"
+
+#include <pf/file.h>
+#include <pf/luaparticlesystem.h>
+
+#include "pf/addons/fxsprite/fxparticlekernel.h"
+
+#include <windows.h>
+#include <psapi.h>
+#pragma comment( lib, "psapi.lib" )
+
+namespace ddd
+{
+	static const char* const sShippedSpecs[] =
+	{
+		"fx/fire.lua",
+		"fx/particle.lua",
+		"fx/particle2.lua",
+		"fx/particle3.lua",
+		"fx/particlespin.lua",
+		"fx/simpleparticle.lua",
+		"fx/spinshine.lua",
+		"fx/spinstars.lua",
+		"fx/spinstars2.lua"
+	};
+
+	//-------------------------------------------------------------------------
+
+	ParticleBenchmark::ParticleBenchmark( const unsigned long instanceCount,
+			const unsigned long duration,
+			const unsigned long msPerFrame )
+		: instanceCount_( instanceCount )
+		, frameCount_( duration / msPerFrame )
+		, msPerFrame_( msPerFrame )
+	{
+		assert( 0 != instanceCount_ );
+		assert( 0 != msPerFrame_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void ParticleBenchmark::addSpec( const char* spec )
+	{
+		assert( 0 != spec );
+		specs_.push_back( spec );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void ParticleBenchmark::addShippedSpecs()
+	{
+		for ( size_t i = 0; i < sizeof( sShippedSpecs ) / sizeof( sShippedSpecs[ 0 ] ); i++ )
+		{
+			addSpec( sShippedSpecs[ i ] );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void ParticleBenchmark::run()
+	{
+		results_.clear();
+		for ( size_t i = 0; i < specs_.size(); i++ )
+		{
+			Result result;
+			result.spec_ = specs_[ i ];
+
+			{
+				result.native_ = false;
+				std::vector< TLuaParticleSystem* > systems;
+				runSystems( systems, result );
+				results_.push_back( result );
+			}
+
+			{
+				result.native_ = true;
+				std::vector< TFxParticleKernel* > kernels;
+				runSystems( kernels, result );
+				results_.push_back( result );
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	template< class System >
+	void ParticleBenchmark::runSystems( std::vector< System* >& systems, Result& result )
+	{
+		result.supported_ = true;
+		result.frames_ = 0;
+		result.seconds_ = 0;
+		result.particleUpdates_ = 0;
+		result.peakLive_ = 0;
+		result.memory_ = 0;
+
+		const unsigned long memoryBefore( getPrivateBytes() );
+		for ( unsigned long i = 0; i < instanceCount_ && result.supported_; i++ )
+		{
+			systems.push_back( new System( &renderer_ ) );
+			result.supported_ = systems.back()->Init( result.spec_.c_str() );
+		}
+
+		if ( result.supported_ )
+		{
+			const double start( getSeconds() );
+			for ( unsigned long frame = 0; frame < frameCount_; frame++ )
+			{
+				for ( size_t i = 0; i < systems.size(); i++ )
+				{
+					systems[ i ]->Update( msPerFrame_ );
+					const unsigned long live( systems[ i ]->GetParticleCount() );
+					result.particleUpdates_ += live;
+					if ( live > result.peakLive_ )
+					{
+						result.peakLive_ = live;
+					}
+				}
+			}
+			result.seconds_ = getSeconds() - start;
+			result.frames_ = frameCount_;
+
+			const unsigned long memoryAfter( getPrivateBytes() );
+			result.memory_ = memoryAfter > memoryBefore ? memoryAfter - memoryBefore : 0;
+		}
+
+		for ( size_t i = 0; i < systems.size(); i++ )
+		{
+			delete systems[ i ];
+		}
+		systems.clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const double ParticleBenchmark::getSeconds()
+	{
+		LARGE_INTEGER frequency;
+		LARGE_INTEGER counter;
+		QueryPerformanceFrequency( &frequency );
+		QueryPerformanceCounter( &counter );
+		return static_cast< double >( counter.QuadPart ) / static_cast< double >( frequency.QuadPart );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long ParticleBenchmark::getPrivateBytes()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		counters.cb = sizeof( counters );
+		if ( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+		{
+			return 0;
+		}
+		return static_cast< unsigned long >( counters.PagefileUsage );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ParticleBenchmark::write( const char* fileName )const
+	{
+		assert( 0 != fileName );
+		TFile file;
+		if ( !file.Open( fileName, kWriteText ) )
+		{
+			return false;
+		}
+
+		const str header( "spec,backend,supported,instances,frames,ms_per_frame,seconds,"
+				"particle_updates,particles_per_sec,ns_per_particle_update,peak_live,memory_bytes\n" );
+		file.Write( header.c_str(), header.length() );
+
+		for ( size_t i = 0; i < results_.size(); i++ )
+		{
+			const Result& result( results_[ i ] );
+			const str line( str::getFormatted( "%s,%s,%d,%lu,%lu,%lu,%.6f,%.0f,%.0f,%.2f,%lu,%lu\n",
+					result.spec_.c_str(),
+					result.native_ ? "native" : "vm",
+					result.supported_ ? 1 : 0,
+					instanceCount_,
+					result.frames_,
+					msPerFrame_,
+					result.seconds_,
+					result.particleUpdates_,
+					result.getParticlesPerSecond(),
+					result.getNanosecondsPerParticle(),
+					result.peakLive_,
+					result.memory_ ) );
+			file.Write( line.c_str(), line.length() );
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,391 @@
+#include "ddd/PickingGrid.h"
+#include "ddd/SnapshotArchive.h"
+
+namespace ddd
+{
+	//-------------------------------------------------------------------------
+
+	PickingGrid::PickingGrid()
+		: cellSize_( 0 )
+		, columns_( 0 )
+		, rows_( 0 )
+		, itemCount_( 0 )
+		, nextOrder_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	PickingGrid::~PickingGrid()
+	{
+		release();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void PickingGrid::init( const TRect& bounds, const unsigned long cellSize )
+	{
+		assert( 0 != cellSize );
+		assert( bounds.GetWidth() > 0 );
+		assert( bounds.GetHeight() > 0 );
+
+		bounds_ = bounds;
+		cellSize_ = cellSize;
+		columns_ = ( static_cast< unsigned long >( bounds.GetWidth() ) + cellSize - 1 ) / cellSize;
+		rows_ = ( static_cast< unsigned long >( bounds.GetHeight() ) + cellSize - 1 ) / cellSize;
+		cells_.clear();
+		cells_.resize( columns_ * rows_ );
+
+		//items already added go into the new cells
+		for ( unsigned long i = 0; i < used_.size(); i++ )
+		{
+			if ( used_[ i ] )
+			{
+				insert( i );
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long PickingGrid::addMask( TTextureRef texture, const unsigned long threshold )
+	{
+		assert( texture );
+
+		Mask mask;
+		mask.width_ = texture->GetWidth();
+		mask.height_ = texture->GetHeight();
+		mask.wordsPerRow_ = ( mask.width_ + 31 ) / 32;
+		mask.bits_.assign( mask.wordsPerRow_ * mask.height_, 0 );
+
+		TColor32* pixels( 0 );
+		uint32_t pitch( 0 );
+		if ( texture->Lock( &pixels, &pitch ) )
+		{
+			for ( unsigned long y = 0; y < mask.height_; y++ )
+			{
+				const TColor32* row( pixels + y * pitch );
+				uint32_t* bits( &mask.bits_[ y * mask.wordsPerRow_ ] );
+				for ( unsigned long x = 0; x < mask.width_; x++ )
+				{
+					if ( row[ x ].Alpha() >= threshold )
+					{
+						bits[ x / 32 ] |= 1u << ( x % 32 );
+					}
+				}
+			}
+			texture->Unlock();
+		}else
+		{
+			//nothing to read; the whole rect counts
+			mask.bits_.assign( mask.bits_.size(), 0xFFFFFFFF );
+		}
+
+		masks_.push_back( mask );
+		return static_cast< unsigned long >( masks_.size() - 1 );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long PickingGrid::addItem( const TRect& rect,
+			const long priority,
+			const unsigned long maskID )
+	{
+		assert( MAX_UNSIGN_LONG == maskID || maskID < masks_.size() );
+
+		unsigned long itemID( 0 );
+		if ( freeItemIDs_.empty() )
+		{
+			itemID = static_cast< unsigned long >( used_.size() );
+			rects_.push_back( rect );
+			priorities_.push_back( priority );
+			maskIDs_.push_back( maskID );
+			orders_.push_back( nextOrder_++ );
+			used_.push_back( 1 );
+		}else
+		{
+			itemID = freeItemIDs_.back();
+			freeItemIDs_.pop_back();
+			rects_[ itemID ] = rect;
+			priorities_[ itemID ] = priority;
+			maskIDs_[ itemID ] = maskID;
+			orders_[ itemID ] = nextOrder_++;
+			used_[ itemID ] = 1;
+		}
+		itemCount_++;
+
+		if ( isInited() )
+		{
+			insert( itemID );
+		}
+		return itemID;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void PickingGrid::removeItem( const unsigned long itemID )
+	{
+		assert( isItem( itemID ) );
+		if ( isInited() )
+		{
+			erase( itemID );
+		}
+		used_[ itemID ] = 0;
+		freeItemIDs_.push_back( itemID );
+		itemCount_--;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void PickingGrid::removeAllItems()
+	{
+		for ( size_t i = 0; i < cells_.size(); i++ )
+		{
+			cells_[ i ].clear();
+		}
+		rects_.clear();
+		priorities_.clear();
+		maskIDs_.clear();
+		orders_.clear();
+		used_.clear();
+		freeItemIDs_.clear();
+		itemCount_ = 0;
+		nextOrder_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void PickingGrid::moveItem( const unsigned long itemID, const TRect& rect )
+	{
+		assert( isItem( itemID ) );
+		if ( !isInited() )
+		{
+			rects_[ itemID ] = rect;
+			return;
+		}
+
+		unsigned long oldColumn1, oldRow1, oldColumn2, oldRow2;
+		unsigned long newColumn1, newRow1, newColumn2, newRow2;
+		getCellRange( rects_[ itemID ], oldColumn1, oldRow1, oldColumn2, oldRow2 );
+		getCellRange( rect, newColumn1, newRow1, newColumn2, newRow2 );
+		if ( oldColumn1 == newColumn1 && oldRow1 == newRow1 && oldColumn2 == newColumn2 && oldRow2 == newRow2 )
+		{
+			//same cells, nothing to relink
+			rects_[ itemID ] = rect;
+			return;
+		}
+
+		erase( itemID );
+		rects_[ itemID ] = rect;
+		insert( itemID );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool PickingGrid::getCell( const TPoint& point, unsigned long& column, unsigned long& row )const
+	{
+		if ( !isInited() || !bounds_.Contains( point ) )
+		{
+			return false;
+		}
+		column = static_cast< unsigned long >( point.x - bounds_.x1 ) / cellSize_;
+		row = static_cast< unsigned long >( point.y - bounds_.y1 ) / cellSize_;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long PickingGrid::pick( const TPoint& point )const
+	{
+		unsigned long column( 0 );
+		unsigned long row( 0 );
+		if ( !getCell( point, column, row ) )
+		{
+			return MAX_UNSIGN_LONG;
+		}
+
+		unsigned long best( MAX_UNSIGN_LONG );
+		const std::vector< unsigned long >& cell( cells_[ row * columns_ + column ] );
+		for ( size_t i = 0; i < cell.size(); i++ )
+		{
+			const unsigned long itemID( cell[ i ] );
+			if ( MAX_UNSIGN_LONG != best
+					&& ( priorities_[ itemID ] < priorities_[ best ]
+						|| ( priorities_[ itemID ] == priorities_[ best ] && orders_[ itemID ] < orders_[ best ] ) ) )
+			{
+				continue;
+			}
+			if ( hitTest( itemID, point ) )
+			{
+				best = itemID;
+			}
+		}
+		return best;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void PickingGrid::release()
+	{
+		removeAllItems();
+		masks_.clear();
+		cells_.clear();
+		cellSize_ = 0;
+		columns_ = 0;
+		rows_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool PickingGrid::hitTest( const unsigned long itemID, const TPoint& point )const
+	{
+		const TRect& rect( rects_[ itemID ] );
+		if ( !rect.Contains( point ) )
+		{
+			return false;
+		}
+
+		const unsigned long maskID( maskIDs_[ itemID ] );
+		if ( MAX_UNSIGN_LONG == maskID )
+		{
+			return true;
+		}
+
+		//the mask stretches over the rect
+		const Mask& mask( masks_[ maskID ] );
+		const unsigned long x( static_cast< unsigned long >( point.x - rect.x1 ) * mask.width_ / static_cast< unsigned long >( rect.GetWidth() ) );
+		const unsigned long y( static_cast< unsigned long >( point.y - rect.y1 ) * mask.height_ / static_cast< unsigned long >( rect.GetHeight() ) );
+		return 0 != ( mask.bits_[ y * mask.wordsPerRow_ + x / 32 ] & ( 1u << ( x % 32 ) ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void PickingGrid::getCellRange( const TRect& rect,
+			unsigned long& column1, unsigned long& row1,
+			unsigned long& column2, unsigned long& row2 )const
+	{
+		//clamped to the grid; rects are half open
+		const int32_t x1( rect.x1 > bounds_.x1 ? rect.x1 : bounds_.x1 );
+		const int32_t y1( rect.y1 > bounds_.y1 ? rect.y1 : bounds_.y1 );
+		const int32_t x2( rect.x2 < bounds_.x2 ? rect.x2 : bounds_.x2 );
+		const int32_t y2( rect.y2 < bounds_.y2 ? rect.y2 : bounds_.y2 );
+		if ( x1 >= x2 || y1 >= y2 )
+		{
+			//outside the grid: an empty range
+			column1 = row1 = 1;
+			column2 = row2 = 0;
+			return;
+		}
+
+		column1 = static_cast< unsigned long >( x1 - bounds_.x1 ) / cellSize_;
+		row1 = static_cast< unsigned long >( y1 - bounds_.y1 ) / cellSize_;
+		column2 = static_cast< unsigned long >( x2 - 1 - bounds_.x1 ) / cellSize_;
+		row2 = static_cast< unsigned long >( y2 - 1 - bounds_.y1 ) / cellSize_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void PickingGrid::insert( const unsigned long itemID )
+	{
+		unsigned long column1, row1, column2, row2;
+		getCellRange( rects_[ itemID ], column1, row1, column2, row2 );
+		for ( unsigned long row = row1; row <= row2; row++ )
+		{
+			for ( unsigned long column = column1; column <= column2; column++ )
+			{
+				cells_[ row * columns_ + column ].push_back( itemID );
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void PickingGrid::erase( const unsigned long itemID )
+	{
+		unsigned long column1, row1, column2, row2;
+		getCellRange( rects_[ itemID ], column1, row1, column2, row2 );
+		for ( unsigned long row = row1; row <= row2; row++ )
+		{
+			for ( unsigned long column = column1; column <= column2; column++ )
+			{
+				//cell order doesn't matter, orders_ breaks ties
+				std::vector< unsigned long >& cell( cells_[ row * columns_ + column ] );
+				for ( size_t i = 0; i < cell.size(); i++ )
+				{
+					if ( cell[ i ] == itemID )
+					{
+						cell[ i ] = cell.back();
+						cell.pop_back();
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	void PickingGrid::save( SnapshotWriter& writer )const
+	{
+		//masks come from textures and are set up with the level; the
+		//cells follow from the rects and are rebuilt on load, so they
+		//fit the grid's bounds then
+		writer.put( static_cast< uint32_t >( masks_.size() ) );
+		writer.putVector( rects_ );
+		writer.putVector( priorities_ );
+		writer.putVector( maskIDs_ );
+		writer.putVector( orders_ );
+		writer.putVector( used_ );
+		writer.putVector( freeItemIDs_ );
+		writer.put( static_cast< uint32_t >( itemCount_ ) );
+		writer.put( nextOrder_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool PickingGrid::load( SnapshotReader& reader )
+	{
+		assert( isInited() );
+		removeAllItems();
+
+		uint32_t maskCount( 0 );
+		uint32_t itemCount( 0 );
+		reader.get( maskCount );
+		reader.getVector( rects_ );
+		reader.getVector( priorities_ );
+		reader.getVector( maskIDs_ );
+		reader.getVector( orders_ );
+		reader.getVector( used_ );
+		reader.getVector( freeItemIDs_ );
+		reader.get( itemCount );
+		reader.get( nextOrder_ );
+		itemCount_ = itemCount;
+
+		const size_t size( used_.size() );
+		bool valid( !reader.isFailed()
+			&& masks_.size() == maskCount
+			&& size == rects_.size()
+			&& size == priorities_.size()
+			&& size == maskIDs_.size()
+			&& size == orders_.size() );
+		for ( size_t i = 0; valid && i < size; i++ )
+		{
+			valid = MAX_UNSIGN_LONG == maskIDs_[ i ] || maskIDs_[ i ] < masks_.size();
+		}
+		if ( !valid )
+		{
+			removeAllItems();
+			return false;
+		}
+
+		for ( size_t i = 0; i < size; i++ )
+		{
+			if ( 0 != used_[ i ] )
+			{
+				insert( static_cast< unsigned long >( i ) );
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
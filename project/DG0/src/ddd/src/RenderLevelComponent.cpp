@@ -1,5 +1,10 @@
 #include "ddd/RenderLevelComponent.h"
 
+#include <algorithm>
+#include <pf/luatable.h>
+#include <pf/str.h>
+#include "ddd/SnapshotArchive.h"
+
 namespace ddd
 {
 	//-------------------------------------------------------------------------
@@ -18,6 +23,225 @@ namespace ddd
 
 	void RenderLevelComponent::render( LevelWindow* /*owner*/ )
 	{
+		//only nodes that moved since the last frame are recomputed
+		transformSystem_.update();
+		//one shared clock drives the frames of every animated instance
+		animationSystem_.update( getTime() );
+
+		//back to front; the list is only rebuilt when a layer changed
+		const std::vector< unsigned long >& drawList( drawOrder_.getDrawList() );
+		TDrawSpec drawSpec;
+		for ( size_t item = 0; item < drawList.size(); item++ )
+		{
+			const unsigned long itemID( drawList[ item ] );
+			if ( itemID >= itemActors_.size() || MAX_UNSIGN_LONG == itemActors_[ itemID ] )
+			{
+				continue;
+			}
+			const unsigned long i( itemActors_[ itemID ] );
+			if ( MAX_UNSIGN_LONG != actorInstances_[ i ] )
+			{
+				transformSystem_.getDrawSpec( actorNodes_[ i ], drawSpec );
+				animationSystem_.draw( actorInstances_[ i ], drawSpec );
+			}
+			//reads the same cached transform, see TFxSprite::SetTransformNode
+			if ( actorFx_[ i ] )
+			{
+				actorFx_[ i ]->Draw();
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::addActor( const unsigned long actorID, TLuaTable& actorTable )
+	{
+		setActorLayer( actorID, static_cast< long >( actorTable.GetNumber( "layer_" ) ) );
+		setActorPosition( actorID, Vec2( static_cast< TReal >( actorTable.GetNumber( "x_" ) ),
+				static_cast< TReal >( actorTable.GetNumber( "y_" ) ) ) );
+		setActorAnimation( actorID,
+				actorTable.GetString( "animation_" ).c_str(),
+				static_cast< unsigned long >( actorTable.GetNumber( "msPerFrame_" ) ),
+				actorTable.GetBoolean( "loop_" ) );
+		setActorFx( actorID, actorTable.GetString( "fx_" ).c_str() );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::removeActor( const unsigned long actorID )
+	{
+		if ( actorID >= actorInstances_.size() )
+		{
+			return;
+		}
+		setActorAnimation( actorID, "", 0, false );
+		setActorFx( actorID, "" );
+		if ( MAX_UNSIGN_LONG != actorNodes_[ actorID ] )
+		{
+			transformSystem_.removeNode( actorNodes_[ actorID ] );
+			actorNodes_[ actorID ] = MAX_UNSIGN_LONG;
+			drawOrder_.removeItem( actorItems_[ actorID ] );
+			itemActors_[ actorItems_[ actorID ] ] = MAX_UNSIGN_LONG;
+			actorItems_[ actorID ] = MAX_UNSIGN_LONG;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::setActorAnimation( const unsigned long actorID,
+			const char* animationName,
+			const unsigned long msPerFrame,
+			const bool loop )
+	{
+		assert( 0 != animationName );
+		growActors( actorID );
+		unsigned long& instanceID( actorInstances_[ actorID ] );
+		if ( '\0' == *animationName )
+		{
+			if ( MAX_UNSIGN_LONG != instanceID )
+			{
+				animationSystem_.removeInstance( instanceID );
+				instanceID = MAX_UNSIGN_LONG;
+			}
+			return;
+		}
+
+		//drawn from the actor's node
+		getActorNode( actorID );
+		const unsigned long clipID( getClip( animationName, msPerFrame, loop ) );
+		if ( MAX_UNSIGN_LONG == instanceID )
+		{
+			instanceID = animationSystem_.addInstance( clipID, getTime() );
+		}
+		else
+		{
+			animationSystem_.setClip( instanceID, clipID, getTime() );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::setActorFx( const unsigned long actorID, const char* spec )
+	{
+		assert( 0 != spec );
+		growActors( actorID );
+		TFxSpriteRef& fx( actorFx_[ actorID ] );
+		if ( fx )
+		{
+			fx->SetTransformNode( 0, 0 );
+			fx.reset();
+		}
+		if ( '\0' == *spec )
+		{
+			return;
+		}
+
+		fx = TFxSprite::Create( 0, spec );
+		fx->SetTransformNode( &transformSystem_, getActorNode( actorID ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::setActorPosition( const unsigned long actorID, const Vec2& position )
+	{
+		//only the moved node and what hangs below it is recomputed
+		transformSystem_.setPosition( getActorNode( actorID ), position );
+		//re-sorts the actor's layer on the next render if it's y-sorted
+		drawOrder_.setY( actorItems_[ actorID ], position.y );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::setActorLayer( const unsigned long actorID, const long layer )
+	{
+		getActorNode( actorID );
+		drawOrder_.setLayer( actorItems_[ actorID ], layer );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool RenderLevelComponent::getActorBounds( const unsigned long actorID, TRect& rect, long& layer )const
+	{
+		if ( actorID >= actorInstances_.size() || MAX_UNSIGN_LONG == actorInstances_[ actorID ] )
+		{
+			return false;
+		}
+		const unsigned long instanceID( actorInstances_[ actorID ] );
+		const TRect& frame( animationSystem_.getFrameRect( instanceID ) );
+		const TPoint& registration( animationSystem_.getRegistrationPoint( instanceID ) );
+		const Vec2 position( transformSystem_.getPosition( actorNodes_[ actorID ] ) );
+		const int32_t x( static_cast< int32_t >( position.x ) - registration.x );
+		const int32_t y( static_cast< int32_t >( position.y ) - registration.y );
+		rect = TRect( x, y, x + frame.GetWidth(), y + frame.GetHeight() );
+		layer = drawOrder_.getLayer( actorItems_[ actorID ] );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::growActors( const unsigned long actorID )
+	{
+		if ( actorID >= actorInstances_.size() )
+		{
+			actorInstances_.resize( actorID + 1, MAX_UNSIGN_LONG );
+			actorNodes_.resize( actorID + 1, MAX_UNSIGN_LONG );
+			actorFx_.resize( actorID + 1 );
+			actorItems_.resize( actorID + 1, MAX_UNSIGN_LONG );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long RenderLevelComponent::getActorNode( const unsigned long actorID )
+	{
+		growActors( actorID );
+		unsigned long& nodeID( actorNodes_[ actorID ] );
+		if ( MAX_UNSIGN_LONG == nodeID )
+		{
+			nodeID = transformSystem_.addNode();
+
+			const unsigned long itemID( drawOrder_.addItem( 0 ) );
+			actorItems_[ actorID ] = itemID;
+			if ( itemID >= itemActors_.size() )
+			{
+				itemActors_.resize( itemID + 1, MAX_UNSIGN_LONG );
+			}
+			itemActors_[ itemID ] = actorID;
+		}
+		return nodeID;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::releaseActorFx()
+	{
+		for ( size_t i = 0; i < actorFx_.size(); i++ )
+		{
+			if ( actorFx_[ i ] )
+			{
+				actorFx_[ i ]->SetTransformNode( 0, 0 );
+				actorFx_[ i ].reset();
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long RenderLevelComponent::getClip( const char* animationName,
+			const unsigned long msPerFrame,
+			const bool loop )
+	{
+		//a frame time of 0 would never advance
+		const unsigned long frameTime( 0 != msPerFrame ? msPerFrame : 1 );
+		const std::string key( str::getFormatted( "%s|%lu|%d", animationName, frameTime, loop ? 1 : 0 ).c_str() );
+		std::map< std::string, unsigned long >::const_iterator it( clipIDs_.find( key ) );
+		if ( clipIDs_.end() != it )
+		{
+			return it->second;
+		}
+		const unsigned long clipID( animationSystem_.addClip( animationName, frameTime, loop ) );
+		clipIDs_[ key ] = clipID;
+		return clipID;
 	}
 
 	//-------------------------------------------------------------------------
@@ -30,12 +254,109 @@ namespace ddd
 
 	void RenderLevelComponent::onInit()
 	{
+		clock_.Reset();
+		clock_.Start();
 	}
 	
 	//-------------------------------------------------------------------------
 
 	void RenderLevelComponent::onRelease()
 	{
+		releaseActorFx();
+		animationSystem_.release();
+		transformSystem_.release();
+		drawOrder_.release();
+		actorInstances_.clear();
+		actorNodes_.clear();
+		actorFx_.clear();
+		actorItems_.clear();
+		itemActors_.clear();
+		clipIDs_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+	void RenderLevelComponent::save( SnapshotWriter& writer )
+	{
+		writer.put( static_cast< uint32_t >( getTime() ) );
+		animationSystem_.save( writer );
+		transformSystem_.save( writer );
+		drawOrder_.save( writer );
+		writer.putVector( actorInstances_ );
+		writer.putVector( actorNodes_ );
+		writer.putVector( actorItems_ );
+		writer.putVector( itemActors_ );
+		for ( size_t i = 0; i < actorFx_.size(); i++ )
+		{
+			writer.putString( actorFx_[ i ] ? std::string( actorFx_[ i ]->GetSpecName().c_str() ) : std::string() );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool RenderLevelComponent::load( SnapshotReader& reader )
+	{
+		Loaded loaded;
+		if ( !read( reader, loaded ) )
+		{
+			return false;
+		}
+		commit( loaded );
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool RenderLevelComponent::read( SnapshotReader& reader, Loaded& loaded )const
+	{
+		//the copy keeps the clips the instances are checked against
+		loaded.time_ = 0;
+		loaded.animationSystem_ = animationSystem_;
+		const bool time( reader.get( loaded.time_ ) );
+		const bool animations( time && loaded.animationSystem_.load( reader ) );
+		const bool transforms( animations && loaded.transformSystem_.load( reader ) );
+		const bool drawOrder( transforms && loaded.drawOrder_.load( reader ) );
+		reader.getVector( loaded.actorInstances_ );
+		reader.getVector( loaded.actorNodes_ );
+		reader.getVector( loaded.actorItems_ );
+		reader.getVector( loaded.itemActors_ );
+
+		const size_t count( loaded.actorInstances_.size() );
+		const bool actors( count == loaded.actorNodes_.size() && count == loaded.actorItems_.size() );
+		loaded.actorFx_.resize( reader.isFailed() || !actors ? 0 : count );
+		for ( size_t i = 0; i < loaded.actorFx_.size(); i++ )
+		{
+			reader.getString( loaded.actorFx_[ i ] );
+		}
+		return !reader.isFailed() && actors && drawOrder;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void RenderLevelComponent::commit( Loaded& loaded )
+	{
+		//particles can't be saved; the actors' specs start over on the
+		//restored nodes
+		releaseActorFx();
+
+		//animations started before the snapshot pick up where they were
+		clock_.SetTime( loaded.time_ );
+		std::swap( animationSystem_, loaded.animationSystem_ );
+		std::swap( transformSystem_, loaded.transformSystem_ );
+		std::swap( drawOrder_, loaded.drawOrder_ );
+		actorInstances_.swap( loaded.actorInstances_ );
+		actorNodes_.swap( loaded.actorNodes_ );
+		actorItems_.swap( loaded.actorItems_ );
+		itemActors_.swap( loaded.itemActors_ );
+
+		const size_t count( actorInstances_.size() );
+		actorFx_.assign( count, TFxSpriteRef() );
+		for ( size_t i = 0; i < count; i++ )
+		{
+			if ( !loaded.actorFx_[ i ].empty() )
+			{
+				setActorFx( static_cast< unsigned long >( i ), loaded.actorFx_[ i ].c_str() );
+			}
+		}
 	}
 
 	//-------------------------------------------------------------------------
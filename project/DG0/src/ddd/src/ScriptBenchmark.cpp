@@ -0,0 +1,126 @@
+#include "ddd/ScriptBenchmark.h"
+
+#include <pf/file.h>
+#include <pf/script.h>
+#include "ddd/ScriptBundle.h"
+
+#include <windows.h>
+
+namespace ddd
+{
+	static const double getSeconds()
+	{
+		LARGE_INTEGER frequency;
+		LARGE_INTEGER counter;
+		QueryPerformanceFrequency( &frequency );
+		QueryPerformanceCounter( &counter );
+		return static_cast< double >( counter.QuadPart ) / static_cast< double >( frequency.QuadPart );
+	}
+
+	//-------------------------------------------------------------------------
+
+	static const double timeLoad( lua_State* L,
+				const std::vector< char >& chunk,
+				const char* name,
+				const unsigned long iterations )
+	{
+		const double start( getSeconds() );
+		for ( unsigned long n = 0; n < iterations; n++ )
+		{
+			luaL_loadbuffer( L, chunk.empty() ? "" : &chunk[ 0 ], chunk.size(), name );
+			lua_pop( L, 1 );
+		}
+		return getSeconds() - start;
+	}
+
+	//-------------------------------------------------------------------------
+
+	ScriptBenchmark::ScriptBenchmark( const unsigned long iterations )
+		: iterations_( iterations )
+	{
+		assert( 0 != iterations_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptBenchmark::run( const char* folder )
+	{
+		assert( 0 != folder );
+		results_.clear();
+
+		std::vector< std::string > names;
+		std::vector< std::string > paths;
+		ScriptBundle::listScripts( folder, names, paths );
+
+		TScript* s( new TScript() );
+		lua_State* L( s->GetState() );
+		bool success( true );
+		for ( size_t i = 0; success && i < names.size(); i++ )
+		{
+			std::vector< char > source;
+			std::vector< char > bytecode;
+			success = ScriptBundle::readFile( paths[ i ].c_str(), source )
+				&& ScriptBundle::compile( L, names[ i ].c_str(), source, bytecode );
+			if ( !success )
+			{
+				break;
+			}
+
+			const std::string chunkName( "@" + names[ i ] );
+			Result result;
+			result.script_ = names[ i ];
+			result.sourceBytes_ = static_cast< unsigned long >( source.size() );
+			result.bytecodeBytes_ = static_cast< unsigned long >( bytecode.size() );
+			result.sourceSeconds_ = timeLoad( L, source, chunkName.c_str(), iterations_ );
+			result.bytecodeSeconds_ = timeLoad( L, bytecode, chunkName.c_str(), iterations_ );
+			results_.push_back( result );
+		}
+		delete s;
+		return success;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptBenchmark::write( const char* fileName )const
+	{
+		assert( 0 != fileName );
+		TFile file;
+		if ( !file.Open( fileName, kWriteText ) )
+		{
+			return false;
+		}
+
+		const str header( "script,source_bytes,bytecode_bytes,iterations,source_ms,bytecode_ms\n" );
+		file.Write( header.c_str(), header.length() );
+
+		Result total;
+		total.script_ = "total";
+		total.sourceBytes_ = 0;
+		total.bytecodeBytes_ = 0;
+		total.sourceSeconds_ = 0;
+		total.bytecodeSeconds_ = 0;
+		for ( size_t i = 0; i <= results_.size(); i++ )
+		{
+			const Result& result( i < results_.size() ? results_[ i ] : total );
+			const str line( str::getFormatted( "%s,%lu,%lu,%lu,%.4f,%.4f\n",
+					result.script_.c_str(),
+					result.sourceBytes_,
+					result.bytecodeBytes_,
+					iterations_,
+					result.sourceSeconds_ * 1e3 / iterations_,
+					result.bytecodeSeconds_ * 1e3 / iterations_ ) );
+			file.Write( line.c_str(), line.length() );
+
+			if ( i < results_.size() )
+			{
+				total.sourceBytes_ += result.sourceBytes_;
+				total.bytecodeBytes_ += result.bytecodeBytes_;
+				total.sourceSeconds_ += result.sourceSeconds_;
+				total.bytecodeSeconds_ += result.bytecodeSeconds_;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
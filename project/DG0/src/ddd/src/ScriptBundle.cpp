@@ -0,0 +1,293 @@
+#include "ddd/ScriptBundle.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <pf/file.h>
+#include <pf/script.h>
+#include <pf/str.h>
+#include "ddd/CompiledLevel.h"
+
+#include <windows.h>
+
+namespace ddd
+{
+	static const char* const SCRIPT_EXTENSION = ".lua";
+
+	//-------------------------------------------------------------------------
+
+	static int appendChunk( lua_State* /*L*/, const void* p, size_t size, void* data )
+	{
+		std::vector< char >& bytecode( *static_cast< std::vector< char >* >( data ) );
+		bytecode.insert( bytecode.end(), static_cast< const char* >( p ), static_cast< const char* >( p ) + size );
+		return 1;
+	}
+
+	//-------------------------------------------------------------------------
+
+	static void listFolder( const std::string& name,
+				const std::string& path,
+				std::vector< std::string >& names,
+				std::vector< std::string >& paths )
+	{
+		WIN32_FIND_DATAA found;
+		HANDLE find( FindFirstFileA( ( path + "\\*" ).c_str(), &found ) );
+		if ( INVALID_HANDLE_VALUE == find )
+		{
+			return;
+		}
+		do
+		{
+			const std::string file( found.cFileName );
+			if ( '.' == file[ 0 ] )
+			{
+				continue;
+			}
+			if ( 0 != ( found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+			{
+				listFolder( name + "/" + file, path + "\\" + file, names, paths );
+			}
+			else if ( file.length() > strlen( SCRIPT_EXTENSION )
+				&& 0 == _stricmp( file.c_str() + file.length() - strlen( SCRIPT_EXTENSION ), SCRIPT_EXTENSION ) )
+			{
+				names.push_back( name + "/" + file );
+				paths.push_back( path + "\\" + file );
+			}
+		}
+		while ( FindNextFileA( find, &found ) );
+		FindClose( find );
+	}
+
+	//-------------------------------------------------------------------------
+
+	ScriptBundle::ScriptBundle()
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	ScriptBundle::~ScriptBundle()
+	{
+		unmount();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptBundle::mount( const char* fileName )
+	{
+		assert( 0 != fileName );
+		unmount();
+
+		TFile file;
+		if ( !file.Open( fileName ) )
+		{
+			return false;
+		}
+		data_.resize( file.Size() );
+		if ( data_.empty() || static_cast< long >( data_.size() ) != file.Read( &data_[ 0 ], static_cast< unsigned long >( data_.size() ) )
+			|| !validate() || !isCurrent() )
+		{
+			std::vector< char >().swap( data_ );
+			return false;
+		}
+
+		//the memory files point into data_, which stays put until unmount
+		const Header& header( *reinterpret_cast< const Header* >( &data_[ 0 ] ) );
+		const Entry* entries( reinterpret_cast< const Entry* >( &data_[ 0 ] + sizeof( Header ) ) );
+		names_.reserve( header.count_ );
+		for ( uint32_t i = 0; i < header.count_; i++ )
+		{
+			names_.push_back( &data_[ entries[ i ].name_ ] );
+			TFile::AddMemoryFile( names_.back().c_str(), &data_[ entries[ i ].offset_ ], entries[ i ].size_ );
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void ScriptBundle::unmount()
+	{
+		for ( size_t i = 0; i < names_.size(); i++ )
+		{
+			TFile::AddMemoryFile( names_[ i ].c_str(), 0, 0 );
+		}
+		names_.clear();
+		std::vector< char >().swap( data_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptBundle::validate()const
+	{
+		const unsigned long size( static_cast< unsigned long >( data_.size() ) );
+		if ( size < sizeof( Header ) )
+		{
+			return false;
+		}
+		const Header& header( *reinterpret_cast< const Header* >( &data_[ 0 ] ) );
+		if ( MAGIC != header.magic_ || VERSION != header.version_ || size != header.size_
+			|| header.count_ > ( size - sizeof( Header ) ) / sizeof( Entry ) )
+		{
+			return false;
+		}
+
+		const Entry* entries( reinterpret_cast< const Entry* >( &data_[ 0 ] + sizeof( Header ) ) );
+		for ( uint32_t i = 0; i < header.count_; i++ )
+		{
+			const Entry& entry( entries[ i ] );
+			if ( entry.name_ >= size || 0 == memchr( &data_[ entry.name_ ], '\0', size - entry.name_ )
+				|| entry.offset_ > size || entry.size_ > size - entry.offset_ )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptBundle::isCurrent()const
+	{
+		const Header& header( *reinterpret_cast< const Header* >( &data_[ 0 ] ) );
+		const Entry* entries( reinterpret_cast< const Entry* >( &data_[ 0 ] + sizeof( Header ) ) );
+		std::vector< char > source;
+		for ( uint32_t i = 0; i < header.count_; i++ )
+		{
+			//a release may ship the bundle without the sources
+			const str path( TFile::TranslateResource( &data_[ entries[ i ].name_ ], true ) );
+			if ( path.empty() || !readFile( path.c_str(), source ) )
+			{
+				continue;
+			}
+			if ( entries[ i ].sourceHash_ != CompiledLevel::checksum( source.empty() ? 0 : &source[ 0 ], static_cast< unsigned long >( source.size() ) ) )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long ScriptBundle::build( lua_State* L, const char* folder, const char* path )
+	{
+		assert( 0 != L );
+		assert( 0 != folder );
+		assert( 0 != path );
+
+		std::vector< std::string > names;
+		std::vector< std::string > paths;
+		listScripts( folder, names, paths );
+		if ( names.empty() )
+		{
+			return 0;
+		}
+
+		std::vector< std::vector< char > > chunks( names.size() );
+		std::vector< Entry > entries( names.size() );
+		for ( size_t i = 0; i < names.size(); i++ )
+		{
+			std::vector< char > source;
+			if ( !readFile( paths[ i ].c_str(), source ) || !compile( L, names[ i ].c_str(), source, chunks[ i ] ) )
+			{
+				return 0;
+			}
+			entries[ i ].sourceHash_ = CompiledLevel::checksum( source.empty() ? 0 : &source[ 0 ], static_cast< unsigned long >( source.size() ) );
+		}
+
+		uint32_t offset( static_cast< uint32_t >( sizeof( Header ) + entries.size() * sizeof( Entry ) ) );
+		for ( size_t i = 0; i < names.size(); i++ )
+		{
+			entries[ i ].name_ = offset;
+			offset += static_cast< uint32_t >( names[ i ].length() + 1 );
+		}
+		for ( size_t i = 0; i < names.size(); i++ )
+		{
+			entries[ i ].offset_ = offset;
+			entries[ i ].size_ = static_cast< uint32_t >( chunks[ i ].size() );
+			offset += entries[ i ].size_;
+		}
+
+		Header header;
+		header.magic_ = MAGIC;
+		header.version_ = VERSION;
+		header.count_ = static_cast< uint32_t >( entries.size() );
+		header.size_ = offset;
+
+		FILE* file( fopen( path, "wb" ) );
+		if ( 0 == file )
+		{
+			return 0;
+		}
+		bool success( 1 == fwrite( &header, sizeof( header ), 1, file )
+			&& entries.size() == fwrite( &entries[ 0 ], sizeof( Entry ), entries.size(), file ) );
+		for ( size_t i = 0; success && i < names.size(); i++ )
+		{
+			success = names[ i ].length() + 1 == fwrite( names[ i ].c_str(), 1, names[ i ].length() + 1, file );
+		}
+		for ( size_t i = 0; success && i < chunks.size(); i++ )
+		{
+			success = chunks[ i ].empty() || chunks[ i ].size() == fwrite( &chunks[ i ][ 0 ], 1, chunks[ i ].size(), file );
+		}
+		success = 0 == fclose( file ) && success;
+		return success ? static_cast< unsigned long >( names.size() ) : 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void ScriptBundle::listScripts( const char* folder,
+				std::vector< std::string >& names,
+				std::vector< std::string >& paths )
+	{
+		assert( 0 != folder );
+		//sources are read from disk, past any bundle that is mounted
+		const str path( TFile::TranslateResource( folder ) );
+		listFolder( folder, path.c_str(), names, paths );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptBundle::readFile( const char* path, std::vector< char >& data )
+	{
+		assert( 0 != path );
+		data.clear();
+		FILE* file( fopen( path, "rb" ) );
+		if ( 0 == file )
+		{
+			return false;
+		}
+		char buffer[ 4096 ];
+		size_t bytesRead( 0 );
+		while ( 0 != ( bytesRead = fread( buffer, 1, sizeof( buffer ), file ) ) )
+		{
+			data.insert( data.end(), buffer, buffer + bytesRead );
+		}
+		const bool success( 0 == ferror( file ) );
+		fclose( file );
+		return success;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptBundle::compile( lua_State* L,
+				const char* name,
+				const std::vector< char >& source,
+				std::vector< char >& bytecode )
+	{
+		assert( 0 != name );
+		bytecode.clear();
+
+		//"@name" makes error messages read name:line, as for a script run from disk
+		const std::string chunkName( std::string( "@" ) + name );
+		const int top( lua_gettop( L ) );
+		if ( 0 != luaL_loadbuffer( L, source.empty() ? "" : &source[ 0 ], source.size(), chunkName.c_str() ) )
+		{
+			lua_settop( L, top );
+			return false;
+		}
+		lua_dump( L, appendChunk, &bytecode );
+		lua_settop( L, top );
+		return !bytecode.empty();
+	}
+
+	//-------------------------------------------------------------------------
+}
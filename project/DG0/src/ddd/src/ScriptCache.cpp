@@ -0,0 +1,128 @@
+#include "ddd/ScriptCache.h"
+
+#include <pf/pflua.h>
+#include <pf/script.h>
+
+namespace ddd
+{
+	ScriptCache::ScriptCache()
+		: state_( 0 )
+		, hits_( 0 )
+		, misses_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	ScriptCache::~ScriptCache()
+	{
+		clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptCache::doString( TScript* script, const std::string& source )
+	{
+		assert( 0 != script );
+		lua_State* L( script->GetState() );
+		TLuaFunction* chunk( findChunk( L, source ) );
+		if ( 0 == chunk )
+		{
+			//syntax error or a full cache: Playground runs and reports it
+			script->DoLuaString( source.c_str() );
+			return false;
+		}
+
+		//the same protected call DoLuaString makes, _ALERT reporting errors
+		const int top( lua_gettop( L ) );
+		lua_getglobal( L, "_ALERT" );
+		chunk->Push();
+		const bool success( 0 == lua_pcall( L, 0, 0, top + 1 ) );
+		lua_settop( L, top );
+		return success;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool ScriptCache::runScript( TScript* script, const char* fileName )
+	{
+		assert( 0 != script );
+		retain( fileName );
+		return script->RunScript( fileName );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void ScriptCache::retain( const char* fileName )
+	{
+		assert( 0 != fileName );
+		if ( codes_.end() != codes_.find( fileName ) )
+		{
+			hits_++;
+			return;
+		}
+		misses_++;
+		TScriptCodeRef code( TScriptCode::Get( fileName ) );
+		if ( code )
+		{
+			codes_[ fileName ] = code;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void ScriptCache::clear()
+	{
+		releaseChunks();
+		codes_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void ScriptCache::releaseChunks()
+	{
+		for ( Chunks::iterator it = chunks_.begin(); it != chunks_.end(); ++it )
+		{
+			delete it->second;
+		}
+		chunks_.clear();
+		state_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	TLuaFunction* ScriptCache::findChunk( lua_State* L, const std::string& source )
+	{
+		if ( L != state_ )
+		{
+			//chunks of another state can't be called from this one
+			releaseChunks();
+			state_ = L;
+		}
+
+		Chunks::const_iterator it( chunks_.find( source ) );
+		if ( chunks_.end() != it )
+		{
+			hits_++;
+			return it->second;
+		}
+
+		misses_++;
+		if ( chunks_.size() >= MAX_CHUNKS )
+		{
+			return 0;
+		}
+		//named by its source, as DoLuaString names its chunks
+		if ( 0 != luaL_loadbuffer( L, source.c_str(), source.length(), source.c_str() ) )
+		{
+			lua_pop( L, 1 );
+			return 0;
+		}
+		//takes the chunk off the stack into the registry
+		TLuaFunction* chunk( new TLuaFunction( L ) );
+		chunks_[ source ] = chunk;
+		return chunk;
+	}
+
+	//-------------------------------------------------------------------------
+}
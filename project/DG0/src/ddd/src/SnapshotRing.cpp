@@ -0,0 +1,87 @@
+#include "ddd/SnapshotRing.h"
+
+#include "ddd/LevelWindow.h"
+
+namespace ddd
+{
+	//-------------------------------------------------------------------------
+
+	SnapshotRing::SnapshotRing()
+		: slots_( SLOT_COUNT )
+		, next_( 0 )
+		, count_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	void SnapshotRing::update( LevelWindow& level )
+	{
+		const unsigned long time( level.getTime() );
+		//a clock set back by a rewind elsewhere counts as time passed
+		if ( 0 != count_ )
+		{
+			const unsigned long newest( slots_[ getSlot( 0 ) ].getTime() );
+			if ( time >= newest && time - newest < INTERVAL )
+			{
+				return;
+			}
+		}
+
+		slots_[ next_ ].capture( level );
+		next_ = ( next_ + 1 ) % SLOT_COUNT;
+		if ( count_ < SLOT_COUNT )
+		{
+			count_++;
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool SnapshotRing::rewind( LevelWindow& level, const unsigned long ms )
+	{
+		if ( 0 == count_ )
+		{
+			return false;
+		}
+
+		const unsigned long time( level.getTime() );
+		size_t back( 0 );
+		while ( back + 1 < count_ && time - slots_[ getSlot( back ) ].getTime() < ms )
+		{
+			back++;
+		}
+
+		const size_t slot( getSlot( back ) );
+		if ( !slots_[ slot ].restore( level ) )
+		{
+			clear();
+			return false;
+		}
+		//the restored snapshot stays the newest
+		next_ = ( slot + 1 ) % SLOT_COUNT;
+		count_ -= back;
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void SnapshotRing::clear()
+	{
+		for ( size_t i = 0; i < slots_.size(); i++ )
+		{
+			slots_[ i ].clear();
+		}
+		next_ = 0;
+		count_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const LevelSnapshot* SnapshotRing::getNewest()const
+	{
+		return 0 == count_ ? 0 : &slots_[ getSlot( 0 ) ];
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,130 @@
+#include "ddd/StartupProfiler.h"
+
+#include <pf/file.h>
+
+#include <windows.h>
+
+namespace ddd
+{
+	StartupProfiler::StartupProfiler()
+		: origin_( 0.0 )
+		, recording_( false )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	void StartupProfiler::start()
+	{
+		phases_.clear();
+		open_.clear();
+		origin_ = 0.0;
+		origin_ = getMilliseconds();
+		recording_ = true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void StartupProfiler::beginPhase( const char* name )
+	{
+		assert( 0 != name );
+		if ( !recording_ )
+		{
+			return;
+		}
+		Phase phase;
+		phase.name_ = name;
+		phase.depth_ = static_cast< unsigned long >( open_.size() );
+		phase.start_ = getMilliseconds();
+		phase.length_ = -1.0;
+		open_.push_back( phases_.size() );
+		phases_.push_back( phase );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void StartupProfiler::endPhase()
+	{
+		if ( !recording_ || open_.empty() )
+		{
+			return;
+		}
+		Phase& phase( phases_[ open_.back() ] );
+		phase.length_ = getMilliseconds() - phase.start_;
+		open_.pop_back();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void StartupProfiler::mark( const char* name )
+	{
+		assert( 0 != name );
+		if ( !recording_ )
+		{
+			return;
+		}
+		Phase phase;
+		phase.name_ = name;
+		phase.depth_ = static_cast< unsigned long >( open_.size() );
+		phase.start_ = getMilliseconds();
+		phase.length_ = 0.0;
+		phases_.push_back( phase );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void StartupProfiler::finish( const char* name, const char* fileName )
+	{
+		if ( !recording_ )
+		{
+			return;
+		}
+		mark( name );
+		while ( !open_.empty() )
+		{
+			endPhase();
+		}
+		recording_ = false;
+		write( fileName );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool StartupProfiler::write( const char* fileName )const
+	{
+		assert( 0 != fileName );
+		TFile file;
+		if ( !file.Open( fileName, kWriteText ) )
+		{
+			return false;
+		}
+
+		const str header( "phase,depth,start_ms,length_ms\n" );
+		file.Write( header.c_str(), header.length() );
+
+		for ( size_t i = 0; i < phases_.size(); i++ )
+		{
+			const Phase& phase( phases_[ i ] );
+			const str line( str::getFormatted( "%s,%lu,%.3f,%.3f\n",
+					phase.name_.c_str(),
+					phase.depth_,
+					phase.start_,
+					phase.length_ ) );
+			file.Write( line.c_str(), line.length() );
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const double StartupProfiler::getMilliseconds()const
+	{
+		LARGE_INTEGER frequency;
+		LARGE_INTEGER counter;
+		QueryPerformanceFrequency( &frequency );
+		QueryPerformanceCounter( &counter );
+		return static_cast< double >( counter.QuadPart ) * 1e3 / static_cast< double >( frequency.QuadPart ) - origin_;
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -0,0 +1,301 @@
+#include "ddd/TransformSystem.h"
+#include "ddd/SnapshotArchive.h"
+
+namespace ddd
+{
+	//-------------------------------------------------------------------------
+
+	TransformSystem::TransformSystem()
+		: nodeCount_( 0 )
+		, dirtyCount_( 0 )
+	{
+	}
+
+	//-------------------------------------------------------------------------
+
+	TransformSystem::~TransformSystem()
+	{
+		release();
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long TransformSystem::addNode( const unsigned long parentID,
+			const Mat3& local,
+			const TReal alpha )
+	{
+		assert( MAX_UNSIGN_LONG == parentID || isNode( parentID ) );
+
+		unsigned long nodeID( 0 );
+		if ( freeNodeIDs_.empty() )
+		{
+			nodeID = static_cast< unsigned long >( used_.size() );
+			locals_.push_back( local );
+			worlds_.push_back( local );
+			alphas_.push_back( alpha );
+			worldAlphas_.push_back( alpha );
+			parents_.push_back( MAX_UNSIGN_LONG );
+			firstChildren_.push_back( MAX_UNSIGN_LONG );
+			nextSiblings_.push_back( MAX_UNSIGN_LONG );
+			dirty_.push_back( 0 );
+			used_.push_back( 1 );
+		}else
+		{
+			nodeID = freeNodeIDs_.back();
+			freeNodeIDs_.pop_back();
+			locals_[ nodeID ] = local;
+			alphas_[ nodeID ] = alpha;
+			parents_[ nodeID ] = MAX_UNSIGN_LONG;
+			firstChildren_[ nodeID ] = MAX_UNSIGN_LONG;
+			nextSiblings_[ nodeID ] = MAX_UNSIGN_LONG;
+			dirty_[ nodeID ] = 0;
+			used_[ nodeID ] = 1;
+		}
+		nodeCount_++;
+
+		link( nodeID, parentID );
+		markDirty( nodeID );
+		return nodeID;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::removeNode( const unsigned long nodeID )
+	{
+		assert( isNode( nodeID ) );
+		assert( MAX_UNSIGN_LONG == firstChildren_[ nodeID ] );
+
+		unlink( nodeID );
+		if ( dirty_[ nodeID ] )
+		{
+			//a stale entry in dirtyRoots_ is skipped by update()
+			dirty_[ nodeID ] = 0;
+			dirtyCount_--;
+		}
+		used_[ nodeID ] = 0;
+		freeNodeIDs_.push_back( nodeID );
+		nodeCount_--;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::removeAllNodes()
+	{
+		locals_.clear();
+		worlds_.clear();
+		alphas_.clear();
+		worldAlphas_.clear();
+		parents_.clear();
+		firstChildren_.clear();
+		nextSiblings_.clear();
+		dirty_.clear();
+		used_.clear();
+		dirtyRoots_.clear();
+		freeNodeIDs_.clear();
+		nodeCount_ = 0;
+		dirtyCount_ = 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::setParent( const unsigned long nodeID, const unsigned long parentID )
+	{
+		assert( isNode( nodeID ) );
+		assert( MAX_UNSIGN_LONG == parentID || isNode( parentID ) );
+		assert( nodeID != parentID );
+
+		if ( parents_[ nodeID ] == parentID )
+		{
+			return;
+		}
+		unlink( nodeID );
+		link( nodeID, parentID );
+
+		//the whole subtree has a new world
+		if ( !dirty_[ nodeID ] )
+		{
+			markDirty( nodeID );
+		}else if ( MAX_UNSIGN_LONG == parentID || !dirty_[ parentID ] )
+		{
+			dirtyRoots_.push_back( nodeID );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::getDrawSpec( const unsigned long nodeID, TDrawSpec& drawSpec )
+	{
+		fromPf( drawSpec.mMatrix ) = getWorld( nodeID );
+		drawSpec.mAlpha = worldAlphas_[ nodeID ];
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::update()
+	{
+		//resolving a node queues its children, so this sweeps every dirty
+		//subtree top down; entries of removed or already resolved nodes
+		//are skipped
+		for ( size_t i = 0; i < dirtyRoots_.size(); i++ )
+		{
+			const unsigned long nodeID( dirtyRoots_[ i ] );
+			if ( isNode( nodeID ) )
+			{
+				resolve( nodeID );
+			}
+		}
+		dirtyRoots_.clear();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::release()
+	{
+		removeAllNodes();
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::markDirty( const unsigned long nodeID )
+	{
+		//a dirty node always has a dirty subtree, so there's nothing to do
+		if ( dirty_[ nodeID ] )
+		{
+			return;
+		}
+
+		const unsigned long parentID( parents_[ nodeID ] );
+		if ( MAX_UNSIGN_LONG == parentID || !dirty_[ parentID ] )
+		{
+			dirtyRoots_.push_back( nodeID );
+		}
+
+		dirty_[ nodeID ] = 1;
+		dirtyCount_++;
+		for ( unsigned long child = firstChildren_[ nodeID ]; MAX_UNSIGN_LONG != child; child = nextSiblings_[ child ] )
+		{
+			markDirty( child );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::resolve( const unsigned long nodeID )
+	{
+		if ( !dirty_[ nodeID ] )
+		{
+			return;
+		}
+
+		const unsigned long parentID( parents_[ nodeID ] );
+		if ( MAX_UNSIGN_LONG == parentID )
+		{
+			worlds_[ nodeID ] = locals_[ nodeID ];
+			worldAlphas_[ nodeID ] = alphas_[ nodeID ];
+		}else
+		{
+			resolve( parentID );
+			worlds_[ nodeID ] = worlds_[ parentID ] * locals_[ nodeID ];
+			worldAlphas_[ nodeID ] = worldAlphas_[ parentID ] * alphas_[ nodeID ];
+		}
+		dirty_[ nodeID ] = 0;
+		dirtyCount_--;
+
+		//the children are still dirty under a now clean parent
+		for ( unsigned long child = firstChildren_[ nodeID ]; MAX_UNSIGN_LONG != child; child = nextSiblings_[ child ] )
+		{
+			dirtyRoots_.push_back( child );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::link( const unsigned long nodeID, const unsigned long parentID )
+	{
+		parents_[ nodeID ] = parentID;
+		if ( MAX_UNSIGN_LONG == parentID )
+		{
+			return;
+		}
+		nextSiblings_[ nodeID ] = firstChildren_[ parentID ];
+		firstChildren_[ parentID ] = nodeID;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void TransformSystem::unlink( const unsigned long nodeID )
+	{
+		const unsigned long parentID( parents_[ nodeID ] );
+		if ( MAX_UNSIGN_LONG != parentID )
+		{
+			unsigned long* slot( &firstChildren_[ parentID ] );
+			while ( *slot != nodeID )
+			{
+				assert( MAX_UNSIGN_LONG != *slot );
+				slot = &nextSiblings_[ *slot ];
+			}
+			*slot = nextSiblings_[ nodeID ];
+		}
+		parents_[ nodeID ] = MAX_UNSIGN_LONG;
+		nextSiblings_[ nodeID ] = MAX_UNSIGN_LONG;
+	}
+
+	//-------------------------------------------------------------------------
+	void TransformSystem::save( SnapshotWriter& writer )const
+	{
+		writer.putVector( locals_ );
+		writer.putVector( worlds_ );
+		writer.putVector( alphas_ );
+		writer.putVector( worldAlphas_ );
+		writer.putVector( parents_ );
+		writer.putVector( firstChildren_ );
+		writer.putVector( nextSiblings_ );
+		writer.putVector( dirty_ );
+		writer.putVector( used_ );
+		writer.putVector( dirtyRoots_ );
+		writer.putVector( freeNodeIDs_ );
+		writer.put( static_cast< uint32_t >( nodeCount_ ) );
+		writer.put( static_cast< uint32_t >( dirtyCount_ ) );
+	}
+
+	//-------------------------------------------------------------------------
+
+	const bool TransformSystem::load( SnapshotReader& reader )
+	{
+		uint32_t nodeCount( 0 );
+		uint32_t dirtyCount( 0 );
+		reader.getVector( locals_ );
+		reader.getVector( worlds_ );
+		reader.getVector( alphas_ );
+		reader.getVector( worldAlphas_ );
+		reader.getVector( parents_ );
+		reader.getVector( firstChildren_ );
+		reader.getVector( nextSiblings_ );
+		reader.getVector( dirty_ );
+		reader.getVector( used_ );
+		reader.getVector( dirtyRoots_ );
+		reader.getVector( freeNodeIDs_ );
+		reader.get( nodeCount );
+		reader.get( dirtyCount );
+		nodeCount_ = nodeCount;
+		dirtyCount_ = dirtyCount;
+
+		const size_t size( used_.size() );
+		if ( reader.isFailed()
+			|| size != locals_.size()
+			|| size != worlds_.size()
+			|| size != alphas_.size()
+			|| size != worldAlphas_.size()
+			|| size != parents_.size()
+			|| size != firstChildren_.size()
+			|| size != nextSiblings_.size()
+			|| size != dirty_.size() )
+		{
+			removeAllNodes();
+			return false;
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+}
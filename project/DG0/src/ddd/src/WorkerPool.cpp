@@ -0,0 +1,170 @@
+#include "ddd/WorkerPool.h"
+
+#include <deque>
+#include <vector>
+#include <process.h>
+#include <windows.h>
+
+namespace ddd
+{
+	struct WorkerPool::Impl
+	{
+		CRITICAL_SECTION lock_;
+		//counts queued jobs plus one wake up per thread on stop
+		HANDLE jobPosted_;
+		//manual reset, signaled while nothing is pending
+		HANDLE jobsDone_;
+		std::vector< HANDLE > threads_;
+		std::deque< Job > jobs_;
+		unsigned long pending_;
+		bool stopping_;
+	};
+
+	//-------------------------------------------------------------------------
+
+	WorkerPool::WorkerPool()
+		: impl_( new Impl )
+		, threadCount_( 0 )
+	{
+		InitializeCriticalSection( &impl_->lock_ );
+		impl_->jobPosted_ = CreateSemaphore( 0, 0, MAXLONG, 0 );
+		impl_->jobsDone_ = CreateEvent( 0, TRUE, TRUE, 0 );
+		impl_->pending_ = 0;
+		impl_->stopping_ = false;
+		assert( 0 != impl_->jobPosted_ );
+		assert( 0 != impl_->jobsDone_ );
+	}
+
+	//-------------------------------------------------------------------------
+
+	WorkerPool::~WorkerPool()
+	{
+		stop();
+		CloseHandle( impl_->jobsDone_ );
+		CloseHandle( impl_->jobPosted_ );
+		DeleteCriticalSection( &impl_->lock_ );
+		delete impl_;
+	}
+
+	//-------------------------------------------------------------------------
+
+	const unsigned long WorkerPool::getDefaultThreadCount()
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo( &info );
+		const unsigned long cores( info.dwNumberOfProcessors );
+		return cores > 1 ? cores - 1 : 1;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void WorkerPool::start( const unsigned long threadCount )
+	{
+		assert( !isStarted() );
+		const unsigned long count( 0 != threadCount ? threadCount : getDefaultThreadCount() );
+
+		impl_->stopping_ = false;
+		for ( unsigned long i = 0; i < count; i++ )
+		{
+			const uintptr_t thread( _beginthreadex( 0, 0, &WorkerPool::threadProc, this, 0, 0 ) );
+			assert( 0 != thread );
+			impl_->threads_.push_back( reinterpret_cast< HANDLE >( thread ) );
+		}
+		threadCount_ = count;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void WorkerPool::stop()
+	{
+		if ( !isStarted() )
+		{
+			return;
+		}
+
+		EnterCriticalSection( &impl_->lock_ );
+		impl_->stopping_ = true;
+		LeaveCriticalSection( &impl_->lock_ );
+		ReleaseSemaphore( impl_->jobPosted_, static_cast< LONG >( threadCount_ ), 0 );
+
+		WaitForMultipleObjects( static_cast< DWORD >( impl_->threads_.size() ), &impl_->threads_[ 0 ], TRUE, INFINITE );
+		for ( size_t i = 0; i < impl_->threads_.size(); i++ )
+		{
+			CloseHandle( impl_->threads_[ i ] );
+		}
+		impl_->threads_.clear();
+		threadCount_ = 0;
+
+		//jobs nobody picked up are dropped
+		impl_->jobs_.clear();
+		impl_->pending_ = 0;
+		SetEvent( impl_->jobsDone_ );
+		//drain wake ups left over from dropped jobs
+		while ( WAIT_OBJECT_0 == WaitForSingleObject( impl_->jobPosted_, 0 ) )
+		{
+		}
+	}
+
+	//-------------------------------------------------------------------------
+
+	void WorkerPool::post( const Job& job )
+	{
+		assert( isStarted() );
+		EnterCriticalSection( &impl_->lock_ );
+		impl_->jobs_.push_back( job );
+		if ( 0 == impl_->pending_++ )
+		{
+			ResetEvent( impl_->jobsDone_ );
+		}
+		LeaveCriticalSection( &impl_->lock_ );
+		ReleaseSemaphore( impl_->jobPosted_, 1, 0 );
+	}
+
+	//-------------------------------------------------------------------------
+
+	void WorkerPool::wait()
+	{
+		WaitForSingleObject( impl_->jobsDone_, INFINITE );
+	}
+
+	//-------------------------------------------------------------------------
+
+	unsigned int __stdcall WorkerPool::threadProc( void* param )
+	{
+		static_cast< WorkerPool* >( param )->run();
+		return 0;
+	}
+
+	//-------------------------------------------------------------------------
+
+	void WorkerPool::run()
+	{
+		while ( true )
+		{
+			WaitForSingleObject( impl_->jobPosted_, INFINITE );
+
+			Job job;
+			EnterCriticalSection( &impl_->lock_ );
+			if ( impl_->stopping_ )
+			{
+				LeaveCriticalSection( &impl_->lock_ );
+				return;
+			}
+			assert( !impl_->jobs_.empty() );
+			job = impl_->jobs_.front();
+			impl_->jobs_.pop_front();
+			LeaveCriticalSection( &impl_->lock_ );
+
+			job();
+
+			EnterCriticalSection( &impl_->lock_ );
+			if ( 0 == --impl_->pending_ )
+			{
+				SetEvent( impl_->jobsDone_ );
+			}
+			LeaveCriticalSection( &impl_->lock_ );
+		}
+	}
+
+	//-------------------------------------------------------------------------
+}
@@ -3,6 +3,7 @@
 #include "settings.h"
 
 #include "dg/DGTypes.h"
+#include "ddd/Application.h"
 
 #include <pf/pflib.h>
 
@@ -13,6 +14,7 @@ PFTYPEIMPL_DC(GameWindow);
 GameWindow::GameWindow()
 {
 	TGameState::GetInstance()->SetState("++PlayedSimpleGame");
+	ddd::Application::get_mutable_instance().getMetrics().count("PlayedSimpleGame");
 
 	TPlatform::SetConfig( "vsync", "1" );
 }
@@ -22,6 +24,8 @@ GameWindow::~GameWindow()
 	TGameState::GetInstance()->SetState("begin-status","SimpleGameComplete");
 	TGameState::GetInstance()->SetState("add-state","LastGameHiScore");
 	TGameState::GetInstance()->SetState("end-status","SimpleGameComplete");
+	const long score = atol(TGameState::GetInstance()->GetState("LastGameHiScore").c_str());
+	ddd::Application::get_mutable_instance().getMetrics().status("SimpleGameComplete", score);
 
 	ScriptUnregisterFunction(TWindowManager::GetInstance()->GetScript(),"SendGameMessage");
 }
@@ -53,9 +57,10 @@ void GameWindow::Init(TWindowStyle &style)
  * @return true if message was handled, false to keep searching
  *         for a handler.
  */
-bool GameWindow::OnMouseDown(const TPoint & /*point*/)
+bool GameWindow::OnMouseDown(const TPoint & point)
 {
-    return true;
+	// Clicks are picked through the level's grid and handed to Level:onMouseDown.
+	return ddd::LevelWindow::OnMouseDown( point );
 }
 
 
@@ -85,6 +90,8 @@ bool GameWindow::OnChar(char key)
 {
 	if (key == TEvent::kEscape)
 	{
+		// DoModal loads pause.lua through TScriptCode; keep it compiled.
+		ddd::Application::get_mutable_instance().getScriptCache().retain("scripts/pause.lua");
 		TWindowManager::GetInstance()->DoLuaString(this,"DoModal('scripts/pause.lua')");
 		return true;
 	}
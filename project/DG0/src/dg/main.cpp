@@ -42,8 +42,18 @@
 #include <pf/prefsdb.h>
 
 #include "ddd/Application.h"
+#include "ddd/HiscoreBenchmark.h"
+#include "ddd/LevelBenchmark.h"
+#include "ddd/CompiledLevel.h"
+#include "ddd/LevelCompiler.h"
+#include "ddd/MathBenchmark.h"
+#include "ddd/ScriptBenchmark.h"
+#include "ddd/ScriptBundle.h"
+#include "ddd/ParticleBenchmark.h"
 #include "dg/GameWindow.h"
 
+#include <string.h>
+
 void ddd::Application::initGameStates()
 {
 	TGameState * gs = TGameState::GetInstance();
@@ -87,6 +97,7 @@ void ddd::Application::initGameStates()
 
 void ddd::Application::initWindows( TPlatform* pPlatform )
 {
+	startupProfiler_.beginPhase("renderer options");
 	// Default to the new subtractive renderer behavior, which is
 	// correctly cross-platform to the Mac.
 	TRenderer::GetInstance()->SetOption("new_subtractive","1");
@@ -108,14 +119,24 @@ void ddd::Application::initWindows( TPlatform* pPlatform )
 
 	// Set the application name
 	pPlatform->SetWindowTitle(pPlatform->GetStringTable()->GetString("windowtitle"));
+	startupProfiler_.endPhase();
 
+	// The hiscore client and its medal data are created by the first
+	// TSettings::GetHiscores() call, not here.
+	startupProfiler_.beginPhase("settings");
 	TSettings::CreateSettings();
 	TSettings::GetInstance()->InitGameToSettings();
+	startupProfiler_.endPhase();
 
+	startupProfiler_.beginPhase("cursors");
 	pPlatform->SetCursor( TTexture::GetSimple("cursor/cursor"), TPoint(1,1) );
 
 	pPlatform->SetCursor( TTexture::Get("cursor/thumb.png"), TPoint(12,2), true );
+	startupProfiler_.endPhase();
 
+	// Registering a window type only records its class id; the credits,
+	// hiscore and submit windows load their data when first pushed.
+	startupProfiler_.beginPhase("window types");
 	TWindowManager * wm = TWindowManager::GetInstance();
 	wm->AddWindowType("GameWindow",TGameWindow::ClassId());
 	wm->AddWindowType("DGGameWindow",GameWindow::ClassId());
@@ -131,6 +152,7 @@ void ddd::Application::initWindows( TPlatform* pPlatform )
 
     // Overriding the default TTextEdit window.
 	wm->AddWindowType("TextEdit",TCustomTextEdit::ClassId());
+	startupProfiler_.endPhase();
 }
 
 // Early initialization of Playground values. TPlatform has not yet
@@ -188,10 +210,98 @@ void PlaygroundInit()
 }
 
 /// Playfirst main application entry point
-/// Uncomment cmdLine below if you need to process the command line
-void Main(TPlatform* pPlatform, const char* /*cmdLine*/ )
+/// -fxbench runs the shipped particle specs headless under both particle
+/// backends, writes user:fxbench.csv and quits.
+/// -mathbench times ddd/Math.h against the pflib.dll vector operators,
+/// writes user:mathbench.csv and quits.
+/// -compilelevels writes levels/level_*.lvl into the assets folder from
+/// the descriptions in scripts/levels.lua and quits; the Debug and Release
+/// builds run it after linking.
+/// -levelbench times a generated level loaded from Lua and from its
+/// compiled file, writes user:levelbench.csv and quits.
+/// -bundlescripts compiles scripts/**/*.lua into scripts.luab in the
+/// assets folder and quits; the Release build runs it after linking.
+/// -scriptbench times loading each script from source and from bytecode,
+/// writes user:scriptbench.csv and quits.
+/// -hiscorebench pushes thousands of queued hiscore submissions through a
+/// local stand-in server, writes user:hiscorebench.csv and quits.
+/// A normal run writes the startup timeline, from here to the first
+/// frame of the main menu, to user:startup.csv.
+void Main(TPlatform* pPlatform, const char* cmdLine )
 {
+	ddd::Application::get_mutable_instance().getStartupProfiler().start();
 	ddd::Application::get_mutable_instance().initPlayground(pPlatform);
+
+	if (cmdLine && strstr(cmdLine,"-fxbench"))
+	{
+		ddd::ParticleBenchmark benchmark;
+		benchmark.addShippedSpecs();
+		benchmark.run();
+		benchmark.write("user:fxbench.csv");
+		TSettings::DeleteSettings();
+		return;
+	}
+
+	if (cmdLine && strstr(cmdLine,"-mathbench"))
+	{
+		ddd::MathBenchmark benchmark;
+		benchmark.run();
+		benchmark.write("user:mathbench.csv");
+		TSettings::DeleteSettings();
+		return;
+	}
+
+	if (cmdLine && strstr(cmdLine,"-compilelevels"))
+	{
+		ddd::LevelCompiler compiler;
+		if (compiler.run(ddd::CompiledLevel::DESCRIPTION_SCRIPT))
+		{
+			compiler.writeAll(ddd::CompiledLevel::DESCRIPTION_SCRIPT);
+		}
+		TSettings::DeleteSettings();
+		return;
+	}
+
+	if (cmdLine && strstr(cmdLine,"-levelbench"))
+	{
+		ddd::LevelBenchmark benchmark;
+		if (benchmark.run())
+		{
+			benchmark.write("user:levelbench.csv");
+		}
+		TSettings::DeleteSettings();
+		return;
+	}
+
+	if (cmdLine && strstr(cmdLine,"-bundlescripts"))
+	{
+		TScript * s = new TScript();
+		ddd::ScriptBundle::build(s->GetState(), "scripts", TFile::TranslateResource("scripts.luab").c_str());
+		delete s;
+		TSettings::DeleteSettings();
+		return;
+	}
+
+	if (cmdLine && strstr(cmdLine,"-scriptbench"))
+	{
+		ddd::ScriptBenchmark benchmark;
+		if (benchmark.run("scripts"))
+		{
+			benchmark.write("user:scriptbench.csv");
+		}
+		TSettings::DeleteSettings();
+		return;
+	}
+
+	if (cmdLine && strstr(cmdLine,"-hiscorebench"))
+	{
+		ddd::HiscoreBenchmark benchmark;
+		benchmark.run();
+		benchmark.write("user:hiscorebench.csv");
+		TSettings::DeleteSettings();
+		return;
+	}
+
 	ddd::Application::get_mutable_instance().run(pPlatform);
 }
 
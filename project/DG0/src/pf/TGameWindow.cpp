@@ -12,6 +12,7 @@
 #include "TGameWindow.h"
 #include "globaldefines.h"
 #include "settings.h"
+#include "ddd/Application.h"
 
 #include <pf/pflib.h>
 
@@ -22,6 +23,7 @@ PFTYPEIMPL_DC(TGameWindow);
 TGameWindow::TGameWindow()
 {
 	TGameState::GetInstance()->SetState("++PlayedSimpleGame");
+	ddd::Application::get_mutable_instance().getMetrics().count("PlayedSimpleGame");
 
 	mBigTex = TTexture::Get("backgrounds/bigtex");
 	mOffset =0;
@@ -34,6 +36,8 @@ TGameWindow::~TGameWindow()
 	TGameState::GetInstance()->SetState("begin-status","SimpleGameComplete");
 	TGameState::GetInstance()->SetState("add-state","LastGameHiScore");
 	TGameState::GetInstance()->SetState("end-status","SimpleGameComplete");
+	const long score = atol(TGameState::GetInstance()->GetState("LastGameHiScore").c_str());
+	ddd::Application::get_mutable_instance().getMetrics().status("SimpleGameComplete", score);
 
 	ScriptUnregisterFunction(TWindowManager::GetInstance()->GetScript(),"SendGameMessage");
 }
@@ -164,6 +168,8 @@ bool TGameWindow::OnChar(char key)
 {
 	if (key == TEvent::kEscape)
 	{
+		// DoModal loads pause.lua through TScriptCode; keep it compiled.
+		ddd::Application::get_mutable_instance().getScriptCache().retain("scripts/pause.lua");
 		TWindowManager::GetInstance()->DoLuaString(this,"DoModal('scripts/pause.lua')");
 		return true;
 	}
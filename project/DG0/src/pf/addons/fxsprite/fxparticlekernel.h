@@ -0,0 +1,311 @@
+/**
+ * @file
+ * Interface for class TFxParticleKernel
+ */
+
+
+#ifndef FXPARTICLEKERNEL_H_INCLUDED
+#define FXPARTICLEKERNEL_H_INCLUDED
+
+#ifndef LUAPARTICLESYSTEM_H_INCLUDED
+#include <pf/luaparticlesystem.h>
+#endif
+
+#ifndef PARTICLERENDERER_H_INCLUDED
+#include <pf/particlerenderer.h>
+#endif
+
+#include <vector>
+
+#ifndef TAGGING_IGNORE
+class T2dParticleRenderer;
+struct TFxKernelProgram;
+#endif
+
+/// A reference to a compiled spec; see TFxParticleKernel::GetProgram().
+typedef shared_ptr<TFxKernelProgram> TFxKernelProgramRef ;
+
+/**
+ * A native backend for Lua particle specs.
+ *
+ * The spec runs once, against the stand-ins in scripts/fxkernel.lua,
+ * which lower its Init and Anim rules into flat instruction streams.
+ * Particles are stored as one column per particle value, and each
+ * instruction sweeps a whole column with SSE instead of going through
+ * the TParticleMachineState stack once per particle.
+ *
+ * Only the built-in functions used by the shipped specs are known
+ * (fTimeScale, fAge, fRange, fPick, fFade, fGreater, fExpire,
+ * f2dRotation, and the +, - and * operators). Init() fails for a spec
+ * that uses anything else; run it with a TLuaParticleSystem instead.
+ */
+class TFxParticleKernel
+{
+public:
+	/// Instruction opcodes; keep in sync with scripts/fxkernel.lua.
+	enum EOp
+	{
+		kOpUniConst=1,
+		kOpUniTime,
+		kOpUniSource,
+		kOpUniAdd,
+		kOpUniSub,
+		kOpUniMul,
+		kOpUniNeg,
+		kOpFill,
+		kOpCopy,
+		kOpAdd,
+		kOpSub,
+		kOpMul,
+		kOpAddUni,
+		kOpSubUni,
+		kOpUniSubCol,
+		kOpMulUni,
+		kOpNeg,
+		kOpRange,
+		kOpPickIndex,
+		kOpSelect,
+		kOpFade,
+		kOpGreater,
+		kOpGreaterUni,
+		kOpUniGreater,
+		kOpSin,
+		kOpCos,
+		kOpExpire,
+		kOpCount
+	};
+
+	/// Number of TVec2 data sources: dLocus and dUp.
+	static const uint32_t kNumSources = 2;
+
+	/**
+	 * Constructor
+	 *
+	 * @param r      Particle renderer to use. If NULL, will create a
+	 *               T2dParticleRenderer.
+	 */
+	TFxParticleKernel( TParticleRenderer * r=NULL );
+
+	/// Destructor
+	~TFxParticleKernel();
+
+	/**
+	 * Compile a particle spec.
+	 *
+	 * @param spec   Either a Lua string or a .lua filename.
+	 *
+	 * @return True on success; false if the spec failed to run or uses
+	 *         something the kernel can't execute. GetUnsupported() tells
+	 *         which.
+	 */
+	bool Init( str spec );
+
+	/**
+	 * Run a spec another kernel already compiled. Only this instance's
+	 * particle storage is allocated; the instruction streams are
+	 * shared. A spec with an Update() function still gets its own
+	 * script to run it in, set up from the cached chunks.
+	 *
+	 * @param spec    The spec passed to the Init() that compiled it.
+	 * @param program That kernel's GetProgram().
+	 *
+	 * @return True on success.
+	 */
+	bool Init( str spec, const TFxKernelProgramRef & program );
+
+	/**
+	 * Get the compiled spec, for Init() of later kernels running it.
+	 *
+	 * @return The program; empty until an Init() succeeded.
+	 */
+	TFxKernelProgramRef GetProgram() { return mProgram; }
+
+	/**
+	 * Start over as if the spec had just been compiled: drop all
+	 * particles, queue the ones the spec created while it ran, and
+	 * clear the done flag. The spec's Lua globals are left as they
+	 * are.
+	 */
+	void Restart();
+
+	/**
+	 * Get why the last Init() or Update() failed.
+	 *
+	 * @return A description of the first unsupported construct, or the
+	 *         error the spec raised.
+	 */
+	str GetUnsupported() { return mUnsupported; }
+
+	/**
+	 * Advance the particles and let the spec's Update() create new ones.
+	 *
+	 * @param ms     Number of milliseconds to advance.
+	 *
+	 * @return False if the spec's Update() raised an error; GetUnsupported()
+	 *         has the message. The particles have still moved.
+	 */
+	bool Update( int ms );
+
+	/**
+	 * Draw the particles.
+	 *
+	 * @param at     Where to draw them.
+	 */
+	void Draw( const TVec3 & at );
+
+	/**
+	 * Set a data source read by the rules.
+	 *
+	 * @param source Source index: 0 for dLocus, 1 for dUp.
+	 * @param value  The new value.
+	 */
+	void SetSource( uint32_t source, const TVec2 & value );
+
+	/**
+	 * Queue particles for creation on the next update.
+	 *
+	 * @param num    Number of particles; fractions carry over.
+	 */
+	void CreateParticles( TReal num );
+
+	/**
+	 * Get number of current active particles.
+	 *
+	 * @return The number of live particles.
+	 */
+	uint32_t GetParticleCount() { return mCount; }
+
+	/**
+	 * Get the maximum number of particles.
+	 *
+	 * @return The value the spec passed to SetNumParticles().
+	 */
+	uint32_t GetCapacity();
+
+	/**
+	 * Get the memory used by particle storage.
+	 *
+	 * @return Bytes held by the particle columns and draw buffer.
+	 */
+	uint32_t GetMemoryUsage();
+
+	/**
+	 * Get the script the spec ran in.
+	 *
+	 * @return The kernel's script; NULL for a kernel that shares a
+	 *         compiled spec without an Update() function.
+	 */
+	TScript * GetScript() { return mScript; }
+
+	/// @return True once SetDone() was called.
+	bool IsDone() { return mDone; }
+	/// Flag the particle system as done.
+	void SetDone() { mDone = true; }
+	/// Not done any more!
+	void ResetDone() { mDone = false; }
+
+	/**
+	 * Set the alpha the particles are drawn with.
+	 *
+	 * @param a      Alpha; 0 is transparent, 1 opaque.
+	 */
+	void SetAlpha( TReal a ) { mAlpha = a; }
+
+private:
+	TFxParticleKernel( const TFxParticleKernel & );
+	const TFxParticleKernel & operator=( const TFxParticleKernel & );
+
+	friend struct TFxKernelProgram;
+
+	struct TInstruction
+	{
+		uint32_t	mOp ;
+		uint32_t	mDst ;
+		uint32_t	mA ;
+		uint32_t	mB ;
+		TReal		mValue ;
+		/// Variadic operands start at mArgs in mArgList.
+		uint32_t	mCount ;
+		uint32_t	mArgs ;
+	};
+	typedef std::vector<TInstruction> Program ;
+
+	void Reset();
+	bool RunSpec( str spec );
+	bool ReadProgram( str name, TFxKernelProgram & compiled, Program & program );
+	void Start();
+	bool Fail( str reason );
+
+	void RunUniforms( int ms );
+	void Run( const Program & program, uint32_t begin, uint32_t & end );
+	void Expire( TReal * mask, uint32_t begin, uint32_t & end );
+	void Spawn();
+
+	TReal * Column( uint32_t column ) { return &mColumns[column*mStride]; }
+	inline TReal Random();
+
+	int LuaCreateParticles( lua_State * L );
+
+	TScript * mScript ;
+	TParticleRenderer * mRenderer ;
+	/// The renderer we created, if none was passed in.
+	T2dParticleRenderer * m2dRenderer ;
+	str mUnsupported ;
+
+	/// The compiled spec, shared with every kernel running it.
+	TFxKernelProgramRef mProgram ;
+
+	std::vector<TReal> mUniforms ;
+	TReal mSources[kNumSources*2] ;
+
+	/// Particle values, one column of mStride entries per value.
+	std::vector<TReal> mColumns ;
+	uint32_t mStride ;
+
+	uint32_t mCount ;
+	TReal mSpawn ;
+	/// Particles the spec queued while it ran, for Restart().
+	TReal mInitialSpawn ;
+	uint32_t mRandom ;
+	TReal mAlpha ;
+	bool mDone ;
+
+	/// Interleaved copy of the renderer's values for Draw().
+	std::vector<TReal> mDrawBuffer ;
+	ParticleList mDrawList ;
+};
+
+/**
+ * A spec as compiled by TFxParticleKernel::Init(): everything that's
+ * the same for every instance of it. Read-only once compiled.
+ */
+struct TFxKernelProgram
+{
+	TFxParticleKernel::Program	mUniformProgram ;
+	TFxParticleKernel::Program	mInitProgram ;
+	TFxParticleKernel::Program	mAnimProgram ;
+	std::vector<uint32_t>		mArgList ;
+
+	uint32_t	mMembers ;
+	uint32_t	mTemps ;
+	uint32_t	mUniforms ;
+	uint32_t	mCapacity ;
+	uint32_t	mPrototypeSize ;
+	std::vector<TReal>	mPrototype ;
+
+	TTextureRef	mTexture ;
+	int			mBlendMode ;
+	/// Particles the spec created while it ran.
+	TReal		mInitialSpawn ;
+	/// The spec has an Update() function, which needs a script per instance.
+	bool		mUpdate ;
+
+	/// Hold the compiled chunks, so per-instance scripts don't load
+	/// and compile them again.
+	TScriptCodeRef	mKernelCode ;
+	TScriptCodeRef	mSpecCode ;
+
+	uint32_t MapColumn( uint32_t column );
+};
+
+#endif // FXPARTICLEKERNEL_H_INCLUDED
@@ -26,15 +26,21 @@
 #include <pf/luaparticlesystem.h>
 #endif
 
+#include <vector>
+#include <map>
 #include <set>
 
 #ifndef TAGGING_IGNORE
 class TFxSprite;
 class TAnimTask;
 class TFxSpriteAnimTask;
+class TFxParticleKernel;
+struct TFxKernelProgram;
+namespace ddd { class WorkerPool; class TransformSystem; }
 #endif
 
 typedef shared_ptr<TFxSprite> TFxSpriteRef ;
+typedef shared_ptr<TFxKernelProgram> TFxKernelProgramRef ;
 
 class TEmitterLocus : public TParticleFunction
 {
@@ -73,6 +79,23 @@ public:
 class TFxSprite : public TSprite
 {
 	PFSHAREDTYPEDEF(TSprite);
+public:
+	/**
+	 * How a sprite's particle system advances on each anim task tick.
+	 *
+	 * A particle spec selects its policy by setting the global
+	 * gUpdatePolicy to "fixed", "variable" or "budgeted".
+	 */
+	enum EUpdatePolicy
+	{
+		/// Run the particle program in fixed FX_PARTICLE_MS_PER_FRAME steps.
+		kUpdateFixed,
+		/// Run the particle program once with the elapsed time.
+		kUpdateVariable,
+		/// Run fixed steps while the anim task's update budget lasts,
+		/// then fold the remaining time into a single step.
+		kUpdateBudgeted
+	};
 protected:
 /// Default Constructor
 	TFxSprite( int32_t layer );
@@ -90,6 +113,9 @@ public:
      *               sprite. You can pass NULL, in which case a
      *               global (static) TFxSpriteAnimTask will update
      *               this sprite.
+	 *
+	 * The spec can set the global gUpdatePolicy to pick how the
+	 * sprite is updated; see EUpdatePolicy.
 	 *
 	 * @return True on success.
 	 */
@@ -116,10 +142,39 @@ public:
 	 *
 	 *               CreateFX{ layer=[spritelayer], x=[x position], y=[y position], spec=[particle spec] };
 	 *
+	 *               Specs are relative to the batch's top folder.
+	 *
+	 * The batch script only runs the first time it's used; its
+	 * CreateFx calls are recorded and cached, and later batches are
+	 * created from the records without creating a Lua state.
+	 *
 	 * @return True on success.
 	 */
 	static bool CreateBatch( TSpriteRef parent, str particlebatch );
 
+	/**
+	 * Run a particle batch script and cache its records without
+	 * creating any sprites.
+	 *
+	 * @param particlebatch
+	 *               The batch's .lua filename.
+	 *
+	 * @return True on success.
+	 */
+	static bool PreloadBatch( str particlebatch );
+
+	/**
+	 * Drop all cached particle batches.
+	 */
+	static void FlushBatchCache() { mBatchCache.clear(); }
+
+	/**
+	 * Get the number of cached particle batches.
+	 *
+	 * @return The number of batches in the cache.
+	 */
+	static uint32_t GetBatchCacheSize() { return (uint32_t)mBatchCache.size(); }
+
 	/// Destructor
 	virtual ~TFxSprite();
 
@@ -146,12 +201,67 @@ public:
 	 */
 	virtual void Draw(const TDrawSpec &environmentSpec=TDrawSpec(), int32_t depth=-1);
 
+	/**
+	 * Take this sprite's world transform from a node of a
+	 * ddd::TransformSystem. Draw() then ignores environmentSpec and
+	 * GetDrawSpec() and reads the node's cached world matrix and
+	 * alpha, which are only recomputed when the node or one of its
+	 * parents moved. Children are still drawn relative to it.
+	 *
+	 * @param transforms The system holding the node, or NULL to go back
+	 *                   to composing the draw specs every frame. It
+	 *                   must outlive the sprite or be unset first.
+	 * @param nodeID     The node.
+	 */
+	void SetTransformNode( ddd::TransformSystem * transforms, uint32_t nodeID );
+
 	/**
 	 * Get the encapsulated Lua Particle System.
 	 *
 	 * @return A pointer to the TLuaParticleSystem associated with this sprite.
 	 */
 	TLuaParticleSystem * GetLPS() { return &mLPS;}
+
+	/**
+	 * Get the native kernel running this sprite's spec, if any.
+	 *
+	 * @return A pointer to the TFxParticleKernel, or NULL when the
+	 *         spec runs in the TLuaParticleSystem.
+	 */
+	TFxParticleKernel * GetKernel() { return mKernel; }
+
+	/**
+	 * Is the sprite's particle system done?
+	 *
+	 * @return True if done; false otherwise.
+	 */
+	bool IsDone();
+
+	/**
+	 * Get number of current active particles.
+	 *
+	 * @return The current number of particles, from whichever backend
+	 *         runs the spec.
+	 */
+	uint32_t GetParticleCount();
+
+	/**
+	 * Run specs in a TFxParticleKernel when they only use functions the
+	 * kernel knows. Specs using anything else, and sprites initialized
+	 * before the switch, keep using TLuaParticleSystem. A sprite whose
+	 * spec raises an error in the kernel moves to TLuaParticleSystem on
+	 * the next tick, and later sprites of that spec start there.
+	 *
+	 * @param native True to compile specs to native kernels.
+	 */
+	static void SetNativeKernels( bool native ) { mNativeKernels = native; }
+
+	/**
+	 * Whether new sprites try the native kernel.
+	 *
+	 * @return True if specs are compiled to native kernels.
+	 */
+	static bool GetNativeKernels() { return mNativeKernels; }
 	/**
 	 * Get the name of the spec used to create this particle system.
 	 *
@@ -159,6 +269,21 @@ public:
 	 */
 	str GetSpecName() { return mName; }
 
+	/**
+	 * Get the update policy of this sprite.
+	 *
+	 * @return The current update policy.
+	 */
+	EUpdatePolicy GetUpdatePolicy() { return mUpdatePolicy; }
+
+	/**
+	 * Set the update policy of this sprite. Overrides the policy read
+	 * from the particle spec.
+	 *
+	 * @param policy Policy to set.
+	 */
+	void SetUpdatePolicy( EUpdatePolicy policy ) { mUpdatePolicy = policy; }
+
 	/**
 	 * Get the current render origin for the particle system.
 	 *
@@ -190,26 +315,206 @@ public:
 	 */
 	static TFxSpriteAnimTask * GetAnimTask();
 
+	/**
+	 * Load a particle spec into the spec cache ahead of its first
+	 * use, so the first instance doesn't pay for loading and
+	 * compiling it.
+	 *
+	 * Every spec loaded from a file is cached the first time it's
+	 * used: the cache keeps a reference to the compiled chunk, so
+	 * later instances find it in the asset system instead of
+	 * reading and compiling the file again, and it remembers the
+	 * spec-level settings (such as the update policy) read after
+	 * the first run.
+	 *
+	 * @param particleSystem
+	 *               The .lua filename of the spec.
+	 *
+	 * @return True on success.
+	 */
+	static bool PreloadSpec( str particleSystem );
+
+	/**
+	 * Drop all cached particle specs, and forget which ones failed in
+	 * the native kernel. Live sprites keep their own reference to their
+	 * compiled chunk.
+	 */
+	static void FlushSpecCache();
+
+	/**
+	 * Get the number of cached particle specs.
+	 *
+	 * @return The number of specs in the cache.
+	 */
+	static uint32_t GetSpecCacheSize() { return (uint32_t)mSpecCache.size(); }
+
+	/**
+	 * Keep finished sprites of a spec for reuse.
+	 *
+	 * When a pooled sprite's particle system is done and nothing but
+	 * its anim task holds a reference to it, the task parks it
+	 * instead of letting it be destroyed, and the next Create() of the
+	 * same spec picks it up again. A reused sprite keeps its particle
+	 * renderer and task slot; a native kernel also keeps its compiled
+	 * programs and restarts without running any Lua, while a
+	 * TLuaParticleSystem gets a fresh script and runs the cached spec
+	 * chunk in it.
+	 *
+	 * Pools are off by default.
+	 *
+	 * @param particleSystem
+	 *               The spec, exactly as passed to Create().
+	 * @param count  Maximum number of parked sprites; 0 disables
+	 *               pooling for the spec and releases its parked
+	 *               sprites.
+	 */
+	static void SetPoolSize( str particleSystem, uint32_t count );
+
+	/**
+	 * Get the pool size of a spec.
+	 *
+	 * @param particleSystem
+	 *               The spec, exactly as passed to Create().
+	 *
+	 * @return Maximum number of parked sprites; 0 when not pooled.
+	 */
+	static uint32_t GetPoolSize( str particleSystem );
+
+	/**
+	 * Get the number of parked sprites of a spec.
+	 *
+	 * @param particleSystem
+	 *               The spec, exactly as passed to Create().
+	 *
+	 * @return The number of sprites waiting for reuse.
+	 */
+	static uint32_t GetParkedCount( str particleSystem );
+
+	/**
+	 * Cap the memory held by parked sprites across all pools. A
+	 * finished sprite that would go over the cap is destroyed as
+	 * usual.
+	 *
+	 * @param bytes  Cap in bytes; defaults to 4MB.
+	 */
+	static void SetPoolMemoryLimit( uint32_t bytes ) { mPoolMemoryLimit = bytes; }
+
+	/**
+	 * Get the memory cap for parked sprites.
+	 *
+	 * @return Cap in bytes.
+	 */
+	static uint32_t GetPoolMemoryLimit() { return mPoolMemoryLimit; }
+
+	/**
+	 * Get the memory held by parked sprites. Each sprite is counted
+	 * as its own size plus its script's Lua heap and, when it has
+	 * one, its kernel's particle storage.
+	 *
+	 * @return Estimated bytes held by all pools.
+	 */
+	static uint32_t GetPoolMemory() { return mPoolMemory; }
+
+	/**
+	 * Destroy all parked sprites. Pool sizes are kept.
+	 */
+	static void FlushPools();
+
+	/**
+	 * Release what TFxSprite keeps between effects: the parked
+	 * sprites, the spec cache and the batch cache, and stop the
+	 * global task's worker threads. The global anim task keeps running while no sprite is
+	 * live, so none of it is dropped in a lull; call this once when
+	 * the application shuts down, while the asset system is still up.
+	 */
+	static void Shutdown();
+
 	TFxSpriteRef GetRef()
 	{
 		return shared_from_this()->GetCast<TFxSprite>();
 	}
 private:
 	void Update(int);
+	void Step(uint32_t ms, TFxSpriteAnimTask * task);
+	void ReadUpdatePolicy();
+	void BindScript();
+	void DropKernel();
+	uint32_t GetMemoryUsage();
+	bool Restart( int32_t layer, TFxSpriteAnimTask * task );
+
+	static bool Park( const TFxSpriteRef & sprite );
+
+	static int RecordBatchEntry( lua_State * L );
+	static TFxSpriteRef Unpark( str particleSystem );
 
 	TVec3	mRenderOrigin ;
+	/// Where Draw() gets the world transform, if not from GetRelative.
+	ddd::TransformSystem * mTransforms ;
+	uint32_t	mTransformNode ;
 	TEmitterLocus mEmitterLocus;
 	TEmitterUp mEmitterUp;
 
 	int CreateFx( lua_State * L );
 	TLuaParticleSystem 	mLPS;
+	TFxParticleKernel	*mKernel;
+	/// Set by Update() when the kernel's spec raised an error.
+	bool				mKernelFailed ;
 	str					mName;
 	str					mContainerFolder;
 
 	bool				mDrawnOnce ;
 
+	EUpdatePolicy		mUpdatePolicy ;
+
+	/// The task we're registered with, if any.
+	TFxSpriteAnimTask	*mUpdateTask ;
+	/// Our slot in mUpdateTask's sprite list.
+	uint32_t			mUpdateIndex ;
+	/// What we count for in GetPoolMemory() while parked.
+	uint32_t			mPoolBytes ;
+
+	/// What's kept of a particle spec between instances.
+	struct TFxSpec
+	{
+		/// Holds the compiled chunk in the asset cache.
+		TScriptCodeRef	mCode ;
+		/// The spec compiled for TFxParticleKernel, if it was.
+		TFxKernelProgramRef	mKernelProgram ;
+		EUpdatePolicy	mUpdatePolicy ;
+	};
+	typedef std::map< str, TFxSpec > FxSpecMap ;
+	typedef std::set< str > FxSpecSet ;
+
+	/// Finished sprites of one spec waiting for reuse.
+	struct TFxPool
+	{
+		TFxPool() : mSize(0) {}
+		uint32_t					mSize ;
+		std::vector< TFxSpriteRef >	mParked ;
+	};
+	typedef std::map< str, TFxPool > FxPoolMap ;
+
+	/// One CreateFx call of a particle batch script.
+	struct TFxBatchEntry
+	{
+		/// Spec name, already prefixed with the batch's folder.
+		str		mSpec ;
+		TVec3	mPosition ;
+		int32_t	mLayer ;
+	};
+	typedef std::vector< TFxBatchEntry > FxBatch ;
+	typedef std::map< str, FxBatch > FxBatchMap ;
+
 	friend class TFxSpriteAnimTask;
 	static TFxSpriteAnimTask	*mAnimTask;
+	static FxSpecMap			mSpecCache;
+	static bool					mNativeKernels;
+	/// Specs that raised an error in the kernel; they run in Lua.
+	static FxSpecSet			mKernelFailures;
+	static FxPoolMap			mPools;
+	static uint32_t				mPoolMemory;
+	static uint32_t				mPoolMemoryLimit;
+	static FxBatchMap			mBatchCache;
 };
 
 class TFxSpriteAnimTask : public TAnimTask
@@ -220,21 +525,117 @@ class TFxSpriteAnimTask : public TAnimTask
 	 * @return True to continue, false when we're done.
 	 */
 public:
-	typedef std::set< weak_ptr<TFxSprite> > WeakFxSpriteList ;
+	/**
+	 * A dense list of the sprites this task updates. Sprites
+	 * unregister themselves on destruction, so the list holds raw
+	 * pointers and is updated without touching reference counts.
+	 */
+	typedef std::vector< TFxSprite* > FxSpriteList ;
 
 	TFxSpriteAnimTask()
 	{
 		mLastMS = GetTime();
+		mUpdateBudget = 0;
+		mUpdateStart = 0;
+		mNextUpdate = 0;
+		mWorkers = NULL;
+		mStepping = false;
+		mSteppingOverBudget = false;
 	}
-	~TFxSpriteAnimTask()
-	{
-		TFxSprite::mAnimTask = NULL;
-	}
+	~TFxSpriteAnimTask();
 
 	virtual bool Animate();
 
-	WeakFxSpriteList mSpriteList ;
+	/**
+	 * Set the wall-clock time particle updates may take per tick.
+	 * Once it's spent, the remaining sprites each get a single
+	 * update step for the tick, and they're served first on the
+	 * next tick.
+	 *
+	 * @param ms     Budget in milliseconds; 0 disables the budget.
+	 */
+	void SetUpdateBudget( uint32_t ms ) { mUpdateBudget = ms; }
+
+	/**
+	 * Get the per-tick particle update budget.
+	 *
+	 * @return Budget in milliseconds; 0 when disabled.
+	 */
+	uint32_t GetUpdateBudget() { return mUpdateBudget; }
+
+	/**
+	 * Whether this tick's update budget has been spent.
+	 *
+	 * @return True when over budget.
+	 */
+	bool IsOverBudget();
+
+	/**
+	 * Spread the updates of sprites running a TFxParticleKernel over
+	 * worker threads. Off by default. A kernel has its own script and
+	 * random generator, so those sprites are cut into contiguous
+	 * ranges that are stepped concurrently, and the tick waits for all
+	 * of them. Sprites running a TLuaParticleSystem share
+	 * TLuaParticleSystem::GetRandom() and may call CreateFx, so they
+	 * are always stepped on the main thread afterwards.
+	 *
+	 * @param threadCount
+	 *               Number of worker threads; 0 picks one per core
+	 *               beside the main thread.
+	 */
+	void StartWorkers( uint32_t threadCount=0 );
+
+	/**
+	 * Stop the worker threads and go back to serial updates.
+	 */
+	void StopWorkers();
+
+	/**
+	 * Get the number of worker threads.
+	 *
+	 * @return Worker thread count; 0 when updating serially.
+	 */
+	uint32_t GetWorkerCount();
+
+	/**
+	 * Start updating a sprite. A sprite registered with another
+	 * task is moved to this one.
+	 *
+	 * @param sprite Sprite to add.
+	 */
+	void Add( TFxSprite * sprite );
+
+	/**
+	 * Stop updating a sprite. Swaps the last sprite in the list
+	 * into the freed slot.
+	 *
+	 * @param sprite Sprite to remove.
+	 */
+	void Remove( TFxSprite * sprite );
+
+	FxSpriteList mSpriteList ;
 	uint32_t mLastMS ;
+
+private:
+	void StepRange( uint32_t begin, uint32_t end, uint32_t ms );
+
+	uint32_t mUpdateBudget ;
+	/// Platform time when the current tick's updates started.
+	uint32_t mUpdateStart ;
+	/// First sprite to update on the next tick.
+	uint32_t mNextUpdate ;
+
+	/// Finished sprites waiting to be detached from their parents.
+	std::vector< TFxSpriteRef > mFinishedList ;
+
+	/// Threads stepping sprite ranges, or NULL to update serially.
+	ddd::WorkerPool * mWorkers ;
+	/// This tick's kernel sprites, cut into ranges for the workers.
+	FxSpriteList mParallelList ;
+	/// True while workers step sprites; the list must not change.
+	bool mStepping ;
+	/// IsOverBudget() while stepping; workers don't read the timer.
+	bool mSteppingOverBudget ;
 };
 
 #endif // FXSPRITE_H_INCLUDED
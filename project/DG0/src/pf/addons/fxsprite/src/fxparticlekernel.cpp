@@ -0,0 +1,729 @@
+/**
+ * @file
+ * Implementation for class TFxParticleKernel
+ */
+
+#include "../fxparticlekernel.h"
+#include <pf/2dparticlerenderer.h>
+#include <pf/random.h>
+#include <pf/texture.h>
+#include <xmmintrin.h>
+#include <math.h>
+#include <string.h>
+
+#define FX_KERNEL_SCRIPT "scripts/fxkernel.lua"
+// Temporary columns are numbered from here in the compiled streams.
+#define FX_KERNEL_TEMP_BASE 1000
+
+namespace
+{
+	// Column operations, in a four-wide SSE and a scalar flavor.
+	struct TOpAdd
+	{
+		static __m128 Apply( __m128 a, __m128 b ) { return _mm_add_ps(a,b); }
+		static TReal Apply( TReal a, TReal b ) { return a+b; }
+	};
+	struct TOpSub
+	{
+		static __m128 Apply( __m128 a, __m128 b ) { return _mm_sub_ps(a,b); }
+		static TReal Apply( TReal a, TReal b ) { return a-b; }
+	};
+	struct TOpSubReversed
+	{
+		static __m128 Apply( __m128 a, __m128 b ) { return _mm_sub_ps(b,a); }
+		static TReal Apply( TReal a, TReal b ) { return b-a; }
+	};
+	struct TOpMul
+	{
+		static __m128 Apply( __m128 a, __m128 b ) { return _mm_mul_ps(a,b); }
+		static TReal Apply( TReal a, TReal b ) { return a*b; }
+	};
+	struct TOpGreater
+	{
+		static __m128 Apply( __m128 a, __m128 b ) { return _mm_and_ps( _mm_cmpgt_ps(a,b), _mm_set1_ps(1) ); }
+		static TReal Apply( TReal a, TReal b ) { return a>b ? (TReal)1 : (TReal)0; }
+	};
+	struct TOpLess
+	{
+		static __m128 Apply( __m128 a, __m128 b ) { return _mm_and_ps( _mm_cmplt_ps(a,b), _mm_set1_ps(1) ); }
+		static TReal Apply( TReal a, TReal b ) { return a<b ? (TReal)1 : (TReal)0; }
+	};
+
+	// d = a op b over [begin,end).
+	template<class Op>
+	void ColumnOp( TReal * d, const TReal * a, const TReal * b, uint32_t begin, uint32_t end )
+	{
+		uint32_t i=begin;
+		for ( ; i+4<=end; i+=4)
+		{
+			_mm_storeu_ps( d+i, Op::Apply( _mm_loadu_ps(a+i), _mm_loadu_ps(b+i) ) );
+		}
+		for ( ; i<end; ++i)
+		{
+			d[i] = Op::Apply( a[i], b[i] );
+		}
+	}
+
+	// d = a op u over [begin,end).
+	template<class Op>
+	void UniformOp( TReal * d, const TReal * a, TReal u, uint32_t begin, uint32_t end )
+	{
+		__m128 u4 = _mm_set1_ps(u);
+		uint32_t i=begin;
+		for ( ; i+4<=end; i+=4)
+		{
+			_mm_storeu_ps( d+i, Op::Apply( _mm_loadu_ps(a+i), u4 ) );
+		}
+		for ( ; i<end; ++i)
+		{
+			d[i] = Op::Apply( a[i], u );
+		}
+	}
+
+	void Fill( TReal * d, TReal u, uint32_t begin, uint32_t end )
+	{
+		__m128 u4 = _mm_set1_ps(u);
+		uint32_t i=begin;
+		for ( ; i+4<=end; i+=4)
+		{
+			_mm_storeu_ps( d+i, u4 );
+		}
+		for ( ; i<end; ++i)
+		{
+			d[i] = u;
+		}
+	}
+}
+
+TFxParticleKernel::TFxParticleKernel( TParticleRenderer * r ) :
+	mScript(NULL),
+	mRenderer(r),
+	m2dRenderer(NULL),
+	mStride(0),
+	mCount(0),
+	mSpawn(0),
+	mInitialSpawn(0),
+	mRandom(1),
+	mAlpha(1),
+	mDone(false)
+{
+	if (!mRenderer)
+	{
+		m2dRenderer = new T2dParticleRenderer();
+		mRenderer = m2dRenderer;
+	}
+	for (uint32_t i=0; i<kNumSources*2; ++i)
+	{
+		mSources[i] = 0;
+	}
+}
+
+TFxParticleKernel::~TFxParticleKernel()
+{
+	delete mScript;
+	delete m2dRenderer;
+}
+
+bool TFxParticleKernel::Fail( str reason )
+{
+	if (mUnsupported.empty())
+	{
+		mUnsupported = reason;
+	}
+	return false;
+}
+
+void TFxParticleKernel::Reset()
+{
+	delete mScript;
+	mScript = NULL;
+	mProgram.reset();
+	mUnsupported = "";
+	mCount = 0;
+	mSpawn = 0;
+	mInitialSpawn = 0;
+	mDone = false;
+	mRandom = (uint32_t)TLuaParticleSystem::GetRandom()->Rand32() | 1;
+}
+
+bool TFxParticleKernel::RunSpec( str spec )
+{
+	mScript = new TScript();
+	ScriptRegisterMemberFunctor(mScript,"CreateParticles",this,TFxParticleKernel::LuaCreateParticles);
+	if (!mScript->RunScript(FX_KERNEL_SCRIPT))
+	{
+		return Fail("can't run " FX_KERNEL_SCRIPT);
+	}
+
+	// Let the renderer allocate its members (pPosition, pColor...) first,
+	// just as TLuaParticleSystem does.
+	mScript->DoLuaString(mRenderer->GetLuaInitString());
+	if ((uint32_t)mScript->GetGlobalNumber("gKernelMembers") != mRenderer->GetPrototypeParticleSize())
+	{
+		return Fail("renderer prototype size");
+	}
+
+	bool ran;
+	if (spec.find(".lua", str::kCaseInsensitive) != str::npos)
+	{
+		ran = mScript->RunScript(spec);
+	}
+	else
+	{
+		mScript->DoLuaString(spec);
+		ran = true;
+	}
+	mScript->DoLuaString("gKernelFinish()");
+	if (!ran)
+	{
+		return Fail("spec failed to run");
+	}
+	return true;
+}
+
+bool TFxParticleKernel::Init( str spec )
+{
+	Reset();
+	if (!RunSpec(spec))
+	{
+		return false;
+	}
+
+	str unsupported = mScript->GetGlobalString("gKernelUnsupported");
+	if (!unsupported.empty())
+	{
+		return Fail(unsupported);
+	}
+
+	TFxKernelProgramRef program( new TFxKernelProgram() );
+	program->mPrototypeSize = mRenderer->GetPrototypeParticleSize();
+	program->mPrototype.assign( mRenderer->GetPrototypeParticle(), mRenderer->GetPrototypeParticle()+program->mPrototypeSize );
+	program->mMembers = (uint32_t)mScript->GetGlobalNumber("gKernelMembers");
+	program->mTemps = (uint32_t)mScript->GetGlobalNumber("gKernelTemps");
+	program->mUniforms = (uint32_t)mScript->GetGlobalNumber("gKernelUniforms");
+	program->mCapacity = (uint32_t)mScript->GetGlobalNumber("gKernelParticles");
+	if (!program->mCapacity)
+	{
+		return Fail("no particles");
+	}
+
+	if (!ReadProgram("gKernelUniformProgram",*program,program->mUniformProgram) ||
+		!ReadProgram("gKernelInitProgram",*program,program->mInitProgram) ||
+		!ReadProgram("gKernelAnimProgram",*program,program->mAnimProgram))
+	{
+		return false;
+	}
+
+	str texture = mScript->GetGlobalString("gKernelTexture");
+	if (!texture.empty())
+	{
+		// Spec textures are relative to the spec's folder.
+		int32_t slash = spec.find('/',str::kReverse);
+		if (slash != str::npos)
+		{
+			texture = spec.substr(0,slash+1) + texture;
+		}
+		program->mTexture = TTexture::Get(texture);
+	}
+	program->mBlendMode = (int)mScript->GetGlobalNumber("gKernelBlendMode");
+	program->mInitialSpawn = mSpawn;
+
+	lua_State * L = mScript->GetState();
+	lua_getglobal(L,"Update");
+	program->mUpdate = lua_isfunction(L,-1) != 0;
+	lua_pop(L,1);
+
+	// RunScript() just loaded both; the references keep them compiled in
+	// the asset cache.
+	program->mKernelCode = TScriptCode::Get(FX_KERNEL_SCRIPT);
+	if (spec.find(".lua", str::kCaseInsensitive) != str::npos)
+	{
+		program->mSpecCode = TScriptCode::Get(spec);
+	}
+
+	mProgram = program;
+	Start();
+	return true;
+}
+
+bool TFxParticleKernel::Init( str spec, const TFxKernelProgramRef & program )
+{
+	Reset();
+	if (program->mPrototypeSize != mRenderer->GetPrototypeParticleSize())
+	{
+		return Fail("renderer prototype size");
+	}
+	mProgram = program;
+
+	// Only Update() needs Lua; running the spec again in a script of our
+	// own gives it the globals it expects. The particles it creates at
+	// the top level are already counted in mInitialSpawn.
+	if (mProgram->mUpdate)
+	{
+		if (!RunSpec(spec))
+		{
+			return false;
+		}
+		mSpawn = 0;
+	}
+
+	Start();
+	return true;
+}
+
+void TFxParticleKernel::Start()
+{
+	// Round the columns up so every column starts 16-byte aligned relative
+	// to the first one.
+	mStride = (mProgram->mCapacity+3)&~3;
+	mColumns.assign( (mProgram->mMembers+mProgram->mTemps)*mStride, 0 );
+	mUniforms.assign( mProgram->mUniforms, 0 );
+	mDrawBuffer.assign( mProgram->mCapacity*mProgram->mPrototypeSize, 0 );
+
+	if (mProgram->mTexture)
+	{
+		mRenderer->SetTexture( mProgram->mTexture );
+	}
+	if (m2dRenderer)
+	{
+		m2dRenderer->SetBlendMode( (TRenderer::EBlendMode)mProgram->mBlendMode );
+	}
+
+	mInitialSpawn = mProgram->mInitialSpawn;
+	Restart();
+}
+
+void TFxParticleKernel::Restart()
+{
+	mCount = 0;
+	mSpawn = mInitialSpawn;
+	mDone = false;
+	RunUniforms(0);
+	Spawn();
+}
+
+uint32_t TFxParticleKernel::GetCapacity()
+{
+	return mProgram ? mProgram->mCapacity : 0;
+}
+
+uint32_t TFxParticleKernel::GetMemoryUsage()
+{
+	return (uint32_t)((mColumns.capacity()+mDrawBuffer.capacity())*sizeof(TReal));
+}
+
+uint32_t TFxKernelProgram::MapColumn( uint32_t column )
+{
+	if (column >= FX_KERNEL_TEMP_BASE)
+	{
+		return mMembers + column - FX_KERNEL_TEMP_BASE;
+	}
+	return column;
+}
+
+bool TFxParticleKernel::ReadProgram( str name, TFxKernelProgram & compiled, Program & program )
+{
+	program.clear();
+
+	TLuaTable * table = mScript->GetGlobalTable(name);
+	if (!table)
+	{
+		return Fail(name + " missing");
+	}
+
+	std::vector<uint32_t> & argList = compiled.mArgList;
+	uint32_t columns = compiled.mMembers + compiled.mTemps;
+	uint32_t uniforms = compiled.mUniforms;
+
+	uint32_t size = (uint32_t)table->GetNumber("n");
+	uint32_t at = 1;
+	bool valid = true;
+
+#define FX_NEXT()	(at<=size ? (uint32_t)table->GetNumber((lua_Number)at++) : (valid=false,0))
+#define FX_VALUE()	(at<=size ? (TReal)table->GetNumber((lua_Number)at++) : (valid=false,0))
+#define FX_COLUMN(x)	do { x = compiled.MapColumn(x); valid = valid && x<columns; } while (0)
+#define FX_UNIFORM(x)	do { valid = valid && x<uniforms; } while (0)
+
+	while (valid && at<=size)
+	{
+		TInstruction in;
+		in.mOp = FX_NEXT();
+		in.mDst = in.mA = in.mB = 0;
+		in.mValue = 0;
+		in.mCount = 0;
+		in.mArgs = (uint32_t)argList.size();
+
+		switch (in.mOp)
+		{
+		case kOpUniConst:
+		case kOpUniTime:
+			in.mDst = FX_NEXT(); FX_UNIFORM(in.mDst);
+			in.mValue = FX_VALUE();
+			break;
+		case kOpUniSource:
+			in.mDst = FX_NEXT(); FX_UNIFORM(in.mDst);
+			in.mA = FX_NEXT(); valid = valid && in.mA<kNumSources*2;
+			break;
+		case kOpUniAdd:
+		case kOpUniSub:
+		case kOpUniMul:
+			in.mDst = FX_NEXT(); FX_UNIFORM(in.mDst);
+			in.mA = FX_NEXT(); FX_UNIFORM(in.mA);
+			in.mB = FX_NEXT(); FX_UNIFORM(in.mB);
+			break;
+		case kOpUniNeg:
+			in.mDst = FX_NEXT(); FX_UNIFORM(in.mDst);
+			in.mA = FX_NEXT(); FX_UNIFORM(in.mA);
+			break;
+		case kOpFill:
+			in.mDst = FX_NEXT(); FX_COLUMN(in.mDst);
+			in.mA = FX_NEXT(); FX_UNIFORM(in.mA);
+			break;
+		case kOpCopy:
+		case kOpNeg:
+		case kOpSin:
+		case kOpCos:
+			in.mDst = FX_NEXT(); FX_COLUMN(in.mDst);
+			in.mA = FX_NEXT(); FX_COLUMN(in.mA);
+			break;
+		case kOpAdd:
+		case kOpSub:
+		case kOpMul:
+		case kOpGreater:
+			in.mDst = FX_NEXT(); FX_COLUMN(in.mDst);
+			in.mA = FX_NEXT(); FX_COLUMN(in.mA);
+			in.mB = FX_NEXT(); FX_COLUMN(in.mB);
+			break;
+		case kOpAddUni:
+		case kOpSubUni:
+		case kOpMulUni:
+		case kOpGreaterUni:
+			in.mDst = FX_NEXT(); FX_COLUMN(in.mDst);
+			in.mA = FX_NEXT(); FX_COLUMN(in.mA);
+			in.mB = FX_NEXT(); FX_UNIFORM(in.mB);
+			break;
+		case kOpUniSubCol:
+		case kOpUniGreater:
+			in.mDst = FX_NEXT(); FX_COLUMN(in.mDst);
+			in.mA = FX_NEXT(); FX_UNIFORM(in.mA);
+			in.mB = FX_NEXT(); FX_COLUMN(in.mB);
+			break;
+		case kOpRange:
+			in.mDst = FX_NEXT(); FX_COLUMN(in.mDst);
+			in.mA = FX_NEXT(); FX_UNIFORM(in.mA);
+			in.mB = FX_NEXT(); FX_UNIFORM(in.mB);
+			break;
+		case kOpPickIndex:
+			in.mDst = FX_NEXT(); FX_COLUMN(in.mDst);
+			in.mCount = FX_NEXT(); valid = valid && in.mCount>0;
+			break;
+		case kOpSelect:
+		case kOpFade:
+			in.mDst = FX_NEXT(); FX_COLUMN(in.mDst);
+			in.mA = FX_NEXT(); FX_COLUMN(in.mA);
+			in.mCount = FX_NEXT(); valid = valid && in.mCount>0;
+			// Select takes one uniform per choice; Fade a (time, value) pair per key.
+			for (uint32_t i=0; valid && i<(in.mOp==kOpFade ? in.mCount*2 : in.mCount); ++i)
+			{
+				uint32_t u = FX_NEXT(); FX_UNIFORM(u);
+				argList.push_back(u);
+			}
+			break;
+		case kOpExpire:
+			in.mA = FX_NEXT(); FX_COLUMN(in.mA);
+			break;
+		default:
+			valid = false;
+			break;
+		}
+
+		program.push_back(in);
+	}
+
+#undef FX_NEXT
+#undef FX_VALUE
+#undef FX_COLUMN
+#undef FX_UNIFORM
+
+	delete table;
+	if (!valid)
+	{
+		return Fail(name + " is malformed");
+	}
+	return true;
+}
+
+inline TReal TFxParticleKernel::Random()
+{
+	// xorshift; each kernel has its own so updates can run on any thread.
+	mRandom ^= mRandom << 13;
+	mRandom ^= mRandom >> 17;
+	mRandom ^= mRandom << 5;
+	return (TReal)(mRandom >> 8) * (TReal)(1.0/16777216.0);
+}
+
+void TFxParticleKernel::SetSource( uint32_t source, const TVec2 & value )
+{
+	ASSERT(source < kNumSources);
+	mSources[source*2] = value.x;
+	mSources[source*2+1] = value.y;
+}
+
+void TFxParticleKernel::CreateParticles( TReal num )
+{
+	mSpawn += num;
+}
+
+int TFxParticleKernel::LuaCreateParticles( lua_State * L )
+{
+	CreateParticles( (TReal)lua_tonumber(L,1) );
+	return 0;
+}
+
+void TFxParticleKernel::RunUniforms( int ms )
+{
+	TReal * u = mUniforms.empty() ? NULL : &mUniforms[0];
+	const Program & uniformProgram = mProgram->mUniformProgram;
+	for (Program::const_iterator i=uniformProgram.begin(); i!=uniformProgram.end(); ++i)
+	{
+		switch (i->mOp)
+		{
+		case kOpUniConst:	u[i->mDst] = i->mValue; break;
+		case kOpUniTime:	u[i->mDst] = i->mValue*(TReal)ms; break;
+		case kOpUniSource:	u[i->mDst] = mSources[i->mA]; break;
+		case kOpUniAdd:		u[i->mDst] = u[i->mA]+u[i->mB]; break;
+		case kOpUniSub:		u[i->mDst] = u[i->mA]-u[i->mB]; break;
+		case kOpUniMul:		u[i->mDst] = u[i->mA]*u[i->mB]; break;
+		case kOpUniNeg:		u[i->mDst] = -u[i->mA]; break;
+		}
+	}
+}
+
+void TFxParticleKernel::Run( const Program & program, uint32_t begin, uint32_t & end )
+{
+	const TReal * u = mUniforms.empty() ? NULL : &mUniforms[0];
+	const std::vector<uint32_t> & argList = mProgram->mArgList;
+	const uint32_t * args = argList.empty() ? NULL : &argList[0];
+
+	for (Program::const_iterator in=program.begin(); in!=program.end() && begin<end; ++in)
+	{
+		TReal * d = Column(in->mDst);
+		switch (in->mOp)
+		{
+		case kOpFill:
+			Fill( d, u[in->mA], begin, end );
+			break;
+		case kOpCopy:
+			if (in->mDst != in->mA)
+			{
+				memcpy( d+begin, Column(in->mA)+begin, (end-begin)*sizeof(TReal) );
+			}
+			break;
+		case kOpAdd:		ColumnOp<TOpAdd>( d, Column(in->mA), Column(in->mB), begin, end ); break;
+		case kOpSub:		ColumnOp<TOpSub>( d, Column(in->mA), Column(in->mB), begin, end ); break;
+		case kOpMul:		ColumnOp<TOpMul>( d, Column(in->mA), Column(in->mB), begin, end ); break;
+		case kOpGreater:	ColumnOp<TOpGreater>( d, Column(in->mA), Column(in->mB), begin, end ); break;
+		case kOpAddUni:		UniformOp<TOpAdd>( d, Column(in->mA), u[in->mB], begin, end ); break;
+		case kOpSubUni:		UniformOp<TOpSub>( d, Column(in->mA), u[in->mB], begin, end ); break;
+		case kOpMulUni:		UniformOp<TOpMul>( d, Column(in->mA), u[in->mB], begin, end ); break;
+		case kOpGreaterUni:	UniformOp<TOpGreater>( d, Column(in->mA), u[in->mB], begin, end ); break;
+		case kOpUniSubCol:	UniformOp<TOpSubReversed>( d, Column(in->mB), u[in->mA], begin, end ); break;
+		case kOpUniGreater:	UniformOp<TOpLess>( d, Column(in->mB), u[in->mA], begin, end ); break;
+		case kOpNeg:		UniformOp<TOpMul>( d, Column(in->mA), -1, begin, end ); break;
+
+		case kOpSin:
+		{
+			const TReal * a = Column(in->mA);
+			for (uint32_t i=begin; i<end; ++i)
+				d[i] = sinf(a[i]);
+			break;
+		}
+		case kOpCos:
+		{
+			const TReal * a = Column(in->mA);
+			for (uint32_t i=begin; i<end; ++i)
+				d[i] = cosf(a[i]);
+			break;
+		}
+		case kOpRange:
+		{
+			TReal lo = u[in->mA];
+			TReal span = u[in->mB]-lo;
+			for (uint32_t i=begin; i<end; ++i)
+				d[i] = lo + span*Random();
+			break;
+		}
+		case kOpPickIndex:
+		{
+			TReal count = (TReal)in->mCount;
+			for (uint32_t i=begin; i<end; ++i)
+			{
+				TReal pick = floorf(Random()*count);
+				d[i] = pick < count ? pick : count-1;
+			}
+			break;
+		}
+		case kOpSelect:
+		{
+			const TReal * index = Column(in->mA);
+			const uint32_t * choices = args+in->mArgs;
+			for (uint32_t i=begin; i<end; ++i)
+				d[i] = u[choices[(uint32_t)index[i]]];
+			break;
+		}
+		case kOpFade:
+		{
+			// Keys are (start time, value) pairs in ascending time; hold the
+			// last value once its time has passed.
+			const TReal * age = Column(in->mA);
+			const uint32_t * keys = args+in->mArgs;
+			uint32_t last = in->mCount-1;
+			for (uint32_t i=begin; i<end; ++i)
+			{
+				TReal t = age[i];
+				uint32_t k=0;
+				while (k<last && t>=u[keys[(k+1)*2]])
+					++k;
+				if (k==last)
+				{
+					d[i] = u[keys[k*2+1]];
+					continue;
+				}
+				TReal t0 = u[keys[k*2]];
+				TReal t1 = u[keys[(k+1)*2]];
+				TReal f = t1>t0 ? (t-t0)/(t1-t0) : 1;
+				if (f<0) f=0;
+				d[i] = u[keys[k*2+1]] + (u[keys[(k+1)*2+1]]-u[keys[k*2+1]])*f;
+			}
+			break;
+		}
+		case kOpExpire:
+			Expire( Column(in->mA), begin, end );
+			break;
+		}
+	}
+}
+
+void TFxParticleKernel::Expire( TReal * mask, uint32_t begin, uint32_t & end )
+{
+	// Move the last live particle into each expired slot. Only members
+	// are moved; temporaries don't outlive the rule that wrote them. The
+	// mask usually is a temporary, so it's moved along as well.
+	TReal * m = mask;
+	uint32_t i=begin;
+	while (i<end)
+	{
+		if (m[i]==0)
+		{
+			++i;
+			continue;
+		}
+		--end;
+		if (i!=end)
+		{
+			for (uint32_t c=0; c<mProgram->mMembers; ++c)
+			{
+				TReal * column = Column(c);
+				column[i] = column[end];
+			}
+			m[i] = m[end];
+		}
+	}
+}
+
+void TFxParticleKernel::Spawn()
+{
+	uint32_t num = (uint32_t)mSpawn;
+	mSpawn -= (TReal)num;
+	if (num > mProgram->mCapacity-mCount)
+	{
+		num = mProgram->mCapacity-mCount;
+	}
+	if (!num)
+	{
+		return;
+	}
+
+	const TFxKernelProgram & program = *mProgram;
+	uint32_t first = mCount;
+	uint32_t end = mCount+num;
+	for (uint32_t c=0; c<program.mMembers; ++c)
+	{
+		Fill( Column(c), c<program.mPrototypeSize ? program.mPrototype[c] : 0, first, end );
+	}
+	Run( program.mInitProgram, first, end );
+	mCount = end;
+}
+
+bool TFxParticleKernel::Update( int ms )
+{
+	RunUniforms(ms);
+
+	uint32_t end = mCount;
+	Run( mProgram->mAnimProgram, 0, end );
+	mCount = end;
+
+	if (!mScript)
+	{
+		Spawn();
+		return true;
+	}
+
+	// The spec's Update() creates particles. A plain pcall, so an error
+	// comes back to the caller instead of going to the script's error
+	// handler; this may be running on a worker.
+	lua_State * L = mScript->GetState();
+	lua_getglobal(L,"Update");
+	if (!lua_isfunction(L,-1))
+	{
+		lua_pop(L,1);
+		Spawn();
+		return true;
+	}
+	lua_pushnumber(L,(lua_Number)ms/1000);
+	if (lua_pcall(L,1,0,0) != 0)
+	{
+		mUnsupported = lua_isstring(L,-1) ? str(lua_tostring(L,-1)) : str("Update() failed");
+		lua_pop(L,1);
+		return false;
+	}
+	Spawn();
+	return true;
+}
+
+void TFxParticleKernel::Draw( const TVec3 & at )
+{
+	if (!mCount)
+	{
+		return;
+	}
+
+	// The renderer wants one interleaved particle per pointer.
+	uint32_t prototypeSize = mProgram->mPrototypeSize;
+	TReal * buffer = &mDrawBuffer[0];
+	for (uint32_t c=0; c<prototypeSize; ++c)
+	{
+		const TReal * column = Column(c);
+		TReal * out = buffer+c;
+		for (uint32_t i=0; i<mCount; ++i, out+=prototypeSize)
+		{
+			*out = column[i];
+		}
+	}
+
+	while (mDrawList.size() < mCount)
+	{
+		mDrawList.push_back(NULL);
+	}
+	while (mDrawList.size() > mCount)
+	{
+		mDrawList.pop_back();
+	}
+	TReal * particle = buffer;
+	for (ParticleList::iterator p=mDrawList.begin(); p!=mDrawList.end(); ++p, particle+=prototypeSize)
+	{
+		*p = particle;
+	}
+
+	mRenderer->Draw( at, mAlpha, mDrawList, (int)mCount );
+}
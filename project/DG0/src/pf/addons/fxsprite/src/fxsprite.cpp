@@ -15,24 +15,56 @@
  */
 
 #include "../fxsprite.h"
+#include "../fxparticlekernel.h"
 #include <pf/animtask.h>
 #include <pf/texture.h>
+#include "ddd/TransformSystem.h"
+#include "ddd/WorkerPool.h"
+#include "boost/bind.hpp"
 
 PFTYPEIMPL(TFxSprite);
 
+#define FX_PARTICLE_MS_PER_FRAME 12
+#define FX_PARTICLE_MAX_FRAMES 4
+#define FX_PARTICLE_UPDATE_BUDGET 8
+// Fewer live kernel sprites than this are stepped on the main thread;
+// the hand-off to the workers costs more than it saves.
+#define FX_PARTICLE_PARALLEL_MIN 8
+#define FX_POOL_MEMORY_LIMIT (4*1024*1024)
+
 TFxSpriteAnimTask	*TFxSprite::mAnimTask=NULL;
+TFxSprite::FxSpecMap	TFxSprite::mSpecCache;
+bool				TFxSprite::mNativeKernels=false;
+TFxSprite::FxSpecSet	TFxSprite::mKernelFailures;
+TFxSprite::FxPoolMap	TFxSprite::mPools;
+uint32_t			TFxSprite::mPoolMemory=0;
+uint32_t			TFxSprite::mPoolMemoryLimit=FX_POOL_MEMORY_LIMIT;
+TFxSprite::FxBatchMap	TFxSprite::mBatchCache;
 
 PFTYPEIMPL_DC(TEmitterLocus);
 PFTYPEIMPL_DC(TEmitterUp);
 
 TFxSprite::TFxSprite( int32_t layer ) :
 	TSprite(layer),
-	mDrawnOnce(false)
+	mTransforms(NULL),
+	mTransformNode(0),
+	mKernel(NULL),
+	mKernelFailed(false),
+	mDrawnOnce(false),
+	mUpdatePolicy(kUpdateFixed),
+	mUpdateTask(NULL),
+	mUpdateIndex(0),
+	mPoolBytes(0)
 {
 }
 
 TFxSprite::~TFxSprite()
 {
+	if (mUpdateTask)
+	{
+		mUpdateTask->Remove(this);
+	}
+	delete mKernel;
 }
 
 TFxSpriteAnimTask * TFxSprite::GetAnimTask()
@@ -42,6 +74,7 @@ TFxSpriteAnimTask * TFxSprite::GetAnimTask()
 		mAnimTask = new TFxSpriteAnimTask();
 		TPlatform::GetInstance()->AdoptTask(mAnimTask);
 		mAnimTask->SetDelay(15);
+		mAnimTask->SetUpdateBudget(FX_PARTICLE_UPDATE_BUDGET);
 	}
 	return mAnimTask;
 }
@@ -53,7 +86,15 @@ void TFxSprite::Draw(const TDrawSpec &environmentSpec, int32_t depth)
 		return;
 	}
 
-	TDrawSpec localSpec = GetDrawSpec().GetRelative(environmentSpec);
+	TDrawSpec localSpec;
+	if (mTransforms)
+	{
+		mTransforms->getDrawSpec( mTransformNode, localSpec );
+	}
+	else
+	{
+		localSpec = GetDrawSpec().GetRelative(environmentSpec);
+	}
 
 	mEmitterLocus.mPosition = TVec2(localSpec.mMatrix[2]);
 	mEmitterUp.mUp = TVec2(localSpec.mMatrix[1].x, -localSpec.mMatrix[1].y);
@@ -79,7 +120,16 @@ void TFxSprite::Draw(const TDrawSpec &environmentSpec, int32_t depth)
 	if (GetTexture())
 		GetTexture()->DrawSprite(localSpec);
 
-	mLPS.Draw( mRenderOrigin );
+	if (mKernel)
+	{
+		mKernel->SetSource( 0, mEmitterLocus.mPosition );
+		mKernel->SetSource( 1, mEmitterUp.mUp );
+		mKernel->Draw( mRenderOrigin );
+	}
+	else
+	{
+		mLPS.Draw( mRenderOrigin );
+	}
 
 	if (depth!=0)
 	{
@@ -92,19 +142,33 @@ void TFxSprite::Draw(const TDrawSpec &environmentSpec, int32_t depth)
 	}
 }
 
+void TFxSprite::SetTransformNode( ddd::TransformSystem * transforms, uint32_t nodeID )
+{
+	mTransforms = transforms;
+	mTransformNode = nodeID;
+}
+
 TFxSpriteRef TFxSprite::Create(int32_t layer, str particleSystem, TFxSpriteAnimTask * task )
 {
-	TFxSpriteRef s= TFxSpriteRef( new TFxSprite(layer) );
+	TFxSpriteRef s = Unpark(particleSystem);
+	if (s)
+	{
+		if (s->Restart(layer,task))
+		{
+			return s;
+		}
+		s.reset();
+	}
+
+	s= TFxSpriteRef( new TFxSprite(layer) );
 
-	ScriptRegisterMemberFunctor(s->GetLPS()->GetScript(),"CreateFx",s.get(),TFxSprite::CreateFx);
 	s->mContainerFolder = particleSystem;
 	int lastSlash = s->mContainerFolder.find("/");
 	if (lastSlash != str::npos)
 	{
 		s->mContainerFolder.erase(lastSlash);
 	}
-	lua_pushlightuserdata(s->GetLPS()->GetScript()->GetState(),s.get());
-	lua_setglobal(s->GetLPS()->GetScript()->GetState(),"gParent");
+	s->BindScript();
 
 	if (particleSystem.length())
 	{
@@ -121,44 +185,341 @@ bool TFxSprite::Init(str particleSystem, TFxSpriteAnimTask * task, bool reset )
 	{
 		mDrawnOnce = false;
 		s->GetLPS()->NewScript();
+		BindScript();
 	}
+	delete mKernel;
+	mKernel = NULL;
+	mKernelFailed = false;
 
 	if (particleSystem.length())
 	{
-		s->GetLPS()->RegisterDataSource("dLocus",&s->mEmitterLocus);
-		s->GetLPS()->RegisterDataSource("dUp",&s->mEmitterUp);
+		FxSpecMap::iterator cached = mSpecCache.find(particleSystem);
+		if (mNativeKernels && mKernelFailures.find(particleSystem) == mKernelFailures.end())
+		{
+			// A spec is compiled for the kernel once; later instances only
+			// allocate their particles.
+			mKernel = new TFxParticleKernel();
+			bool compiled = cached != mSpecCache.end() && cached->second.mKernelProgram;
+			if (compiled ? mKernel->Init(particleSystem,cached->second.mKernelProgram) : mKernel->Init(particleSystem))
+			{
+				if (!compiled)
+				{
+					// A cache entry made by the Lua path, or a new one below.
+					TFxSpec & spec = mSpecCache[particleSystem];
+					spec.mKernelProgram = mKernel->GetProgram();
+					if (cached == mSpecCache.end())
+					{
+						s->ReadUpdatePolicy();
+						spec.mUpdatePolicy = s->mUpdatePolicy;
+						cached = mSpecCache.find(particleSystem);
+					}
+				}
+			}
+			else
+			{
+				DEBUG_WRITE(("%s: %s; using TLuaParticleSystem", particleSystem.c_str(), mKernel->GetUnsupported().c_str()));
+				mKernelFailures.insert(particleSystem);
+				delete mKernel;
+				mKernel = NULL;
+			}
+		}
 
-		if( !s->GetLPS()->Init(particleSystem) )
+		if (!mKernel)
 		{
-			return false;
+			s->GetLPS()->RegisterDataSource("dLocus",&s->mEmitterLocus);
+			s->GetLPS()->RegisterDataSource("dUp",&s->mEmitterUp);
+
+			if( !s->GetLPS()->Init(particleSystem) )
+			{
+				return false;
+			}
 		}
 		s->mName = particleSystem ;
+
+		if (cached != mSpecCache.end())
+		{
+			s->mUpdatePolicy = cached->second.mUpdatePolicy;
+		}
+		else
+		{
+			s->ReadUpdatePolicy();
+
+			// Only specs loaded from a file have a chunk to keep.
+			TScriptCodeRef code = s->GetLPS()->GetScriptCode();
+			if (code)
+			{
+				TFxSpec & spec = mSpecCache[particleSystem];
+				spec.mCode = code;
+				spec.mUpdatePolicy = s->mUpdatePolicy;
+			}
+		}
 		if (!task)
 		{
 			task = ((TFxSpriteAnimTask*)GetAnimTask());
 		}
-		task->mSpriteList.insert( s );
+		task->Add( this );
 	}
 	return true;
 }
 
+bool TFxSprite::PreloadSpec( str particleSystem )
+{
+	if (mSpecCache.find(particleSystem) != mSpecCache.end())
+	{
+		return true;
+	}
+
+	// Initializing a throwaway instance fills the cache entry; the
+	// sprite unregisters from its task when it goes out of scope.
+	TFxSpriteRef s = Create(0,particleSystem);
+	return mSpecCache.find(particleSystem) != mSpecCache.end();
+}
+
+void TFxSprite::FlushSpecCache()
+{
+	mSpecCache.clear();
+	mKernelFailures.clear();
+}
+
+void TFxSprite::DropKernel()
+{
+	DEBUG_WRITE(("%s: %s; using TLuaParticleSystem", mName.c_str(), mKernel->GetUnsupported().c_str()));
+	mKernelFailures.insert(mName);
+	delete mKernel;
+	mKernel = NULL;
+	mKernelFailed = false;
+
+	// The sprite's own script hasn't run the spec yet, and CreateFx is
+	// already bound to it.
+	GetLPS()->RegisterDataSource("dLocus",&mEmitterLocus);
+	GetLPS()->RegisterDataSource("dUp",&mEmitterUp);
+	if (!GetLPS()->Init(mName))
+	{
+		GetLPS()->SetDone();
+	}
+}
+
+void TFxSprite::BindScript()
+{
+	ScriptRegisterMemberFunctor(GetLPS()->GetScript(),"CreateFx",this,TFxSprite::CreateFx);
+	lua_pushlightuserdata(GetLPS()->GetScript()->GetState(),this);
+	lua_setglobal(GetLPS()->GetScript()->GetState(),"gParent");
+}
+
+void TFxSprite::SetPoolSize( str particleSystem, uint32_t count )
+{
+	TFxPool & pool = mPools[particleSystem];
+	pool.mSize = count;
+	while (pool.mParked.size() > count)
+	{
+		mPoolMemory -= pool.mParked.back()->mPoolBytes;
+		pool.mParked.pop_back();
+	}
+	if (!count)
+	{
+		mPools.erase(particleSystem);
+	}
+}
+
+uint32_t TFxSprite::GetPoolSize( str particleSystem )
+{
+	FxPoolMap::iterator pool = mPools.find(particleSystem);
+	return pool != mPools.end() ? pool->second.mSize : 0;
+}
+
+uint32_t TFxSprite::GetParkedCount( str particleSystem )
+{
+	FxPoolMap::iterator pool = mPools.find(particleSystem);
+	return pool != mPools.end() ? (uint32_t)pool->second.mParked.size() : 0;
+}
+
+void TFxSprite::Shutdown()
+{
+	if (mAnimTask)
+	{
+		mAnimTask->StopWorkers();
+	}
+	FlushPools();
+	FlushSpecCache();
+	FlushBatchCache();
+}
+
+void TFxSprite::FlushPools()
+{
+	for (FxPoolMap::iterator pool=mPools.begin(); pool!=mPools.end(); ++pool)
+	{
+		pool->second.mParked.clear();
+	}
+	mPoolMemory = 0;
+}
+
+uint32_t TFxSprite::GetMemoryUsage()
+{
+	TScript * script = mKernel ? mKernel->GetScript() : GetLPS()->GetScript();
+	uint32_t bytes = sizeof(TFxSprite);
+	if (script)
+	{
+		bytes += (uint32_t)lua_getgccount(script->GetState())*1024;
+	}
+	if (mKernel)
+	{
+		bytes += sizeof(TFxParticleKernel) + mKernel->GetMemoryUsage();
+	}
+	return bytes;
+}
+
+bool TFxSprite::Park( const TFxSpriteRef & sprite )
+{
+	// Someone else still holds it, or it's not ours to reuse.
+	if (sprite.use_count() > 1 || sprite->mUpdateTask || sprite->GetParent())
+	{
+		return false;
+	}
+
+	FxPoolMap::iterator pool = mPools.find(sprite->mName);
+	if (pool == mPools.end() || pool->second.mParked.size() >= pool->second.mSize)
+	{
+		return false;
+	}
+
+	uint32_t bytes = sprite->GetMemoryUsage();
+	if (mPoolMemory+bytes > mPoolMemoryLimit)
+	{
+		return false;
+	}
+
+	sprite->RemoveChildren();
+	if (!sprite->mKernel)
+	{
+		sprite->GetLPS()->ResetDone();
+	}
+	sprite->mPoolBytes = bytes;
+	mPoolMemory += bytes;
+	pool->second.mParked.push_back(sprite);
+	return true;
+}
+
+TFxSpriteRef TFxSprite::Unpark( str particleSystem )
+{
+	FxPoolMap::iterator pool = mPools.find(particleSystem);
+	if (pool == mPools.end() || pool->second.mParked.empty())
+	{
+		return TFxSpriteRef();
+	}
+
+	TFxSpriteRef s = pool->second.mParked.back();
+	pool->second.mParked.pop_back();
+	mPoolMemory -= s->mPoolBytes;
+	s->mPoolBytes = 0;
+	return s;
+}
+
+bool TFxSprite::Restart( int32_t layer, TFxSpriteAnimTask * task )
+{
+	SetLayer(layer);
+	SetVisible(true);
+	GetDrawSpec() = TDrawSpec();
+	mRenderOrigin = TVec3();
+	SetTransformNode( NULL, 0 );
+
+	if (!mKernel)
+	{
+		// Running a spec allocates its particle members, so it can't
+		// run twice in one script.
+		return Init(mName,task,true);
+	}
+
+	mDrawnOnce = false;
+	mKernel->Restart();
+	if (!task)
+	{
+		task = GetAnimTask();
+	}
+	task->Add( this );
+	return true;
+}
 
 bool TFxSprite::CreateBatch( TSpriteRef parent, str particlebatch )
 {
-	bool success = true;
+	if (!PreloadBatch(particlebatch))
+	{
+		return false;
+	}
+
+	const FxBatch & batch = mBatchCache[particlebatch];
+	for (FxBatch::const_iterator e=batch.begin(); e!=batch.end(); ++e)
+	{
+		TFxSpriteRef fxSprite = Create(e->mLayer,e->mSpec);
+		fxSprite->GetDrawSpec().mMatrix[2]=e->mPosition ;
+
+		parent->AddChild(fxSprite);
+	}
+	return true;
+}
+
+bool TFxSprite::PreloadBatch( str particlebatch )
+{
+	if (mBatchCache.find(particlebatch) != mBatchCache.end())
+	{
+		return true;
+	}
+
+	FxBatch batch;
+	str folder = particlebatch;
+	int lastSlash = folder.find("/");
+	if (lastSlash != str::npos)
+	{
+		folder.erase(lastSlash);
+	}
+	else
+	{
+		folder = "";
+	}
+
 	TScript * s = new TScript();
 
-	lua_pushlightuserdata(s->GetState(),parent.get());
-	lua_setglobal(s->GetState(),"gParent");
+	lua_pushlightuserdata(s->GetState(),&batch);
+	lua_setglobal(s->GetState(),"gBatch");
+	lua_pushstring(s->GetState(),folder.c_str());
+	lua_setglobal(s->GetState(),"gBatchFolder");
 
-	ScriptRegisterMemberFunctor(s,"CreateFx",(TFxSprite*)NULL,TFxSprite::CreateFx);
+	ScriptRegisterFunctor(s,"CreateFx",TFxSprite::RecordBatchEntry);
 
-	success = s->RunScript(particlebatch);
+	bool success = s->RunScript(particlebatch);
 
 	delete s;
+
+	if (success)
+	{
+		mBatchCache[particlebatch].swap(batch);
+	}
 	return success;
 }
 
+int TFxSprite::RecordBatchEntry( lua_State * L )
+{
+	LuaAutoBlock lab(L);
+
+	TLuaTable t(L);
+
+	lua_getglobal(L,"gBatch");
+	FxBatch * batch = (FxBatch*)lua_touserdata(L,-1);
+	lua_getglobal(L,"gBatchFolder");
+	str folder = lua_tostring(L,-1);
+
+	TFxBatchEntry entry;
+	entry.mPosition = TVec3( (TReal)t.GetNumber("x"), (TReal)t.GetNumber("y"),1);
+	entry.mLayer = (int32_t)t.GetNumber("layer");
+	entry.mSpec = t.GetString("spec");
+	if (folder.empty() == false)
+	{
+		entry.mSpec = folder + "/" + entry.mSpec;
+	}
+	batch->push_back(entry);
+
+	return 0;
+}
+
 int TFxSprite::CreateFx( lua_State * L )
 {
 	LuaAutoBlock lab(L);
@@ -187,48 +548,195 @@ int TFxSprite::CreateFx( lua_State * L )
 	return 0;
 }
 
-#define FX_PARTICLE_MS_PER_FRAME 12
-#define FX_PARTICLE_MAX_FRAMES 4
+TFxSpriteAnimTask::~TFxSpriteAnimTask()
+{
+	StopWorkers();
+	for (FxSpriteList::iterator i=mSpriteList.begin(); i!=mSpriteList.end(); ++i)
+	{
+		(*i)->mUpdateTask = NULL;
+	}
+	if (TFxSprite::mAnimTask == this)
+	{
+		TFxSprite::mAnimTask = NULL;
+	}
+}
+
+void TFxSpriteAnimTask::StartWorkers( uint32_t threadCount )
+{
+	StopWorkers();
+	mWorkers = new ddd::WorkerPool();
+	mWorkers->start( threadCount );
+}
+
+void TFxSpriteAnimTask::StopWorkers()
+{
+	ASSERT(!mStepping);
+	delete mWorkers;
+	mWorkers = NULL;
+}
+
+uint32_t TFxSpriteAnimTask::GetWorkerCount()
+{
+	return mWorkers ? (uint32_t)mWorkers->getThreadCount() : 0;
+}
+
+void TFxSpriteAnimTask::Add( TFxSprite * sprite )
+{
+	ASSERT(!mStepping);
+	if (sprite->mUpdateTask == this)
+	{
+		return;
+	}
+	if (sprite->mUpdateTask)
+	{
+		sprite->mUpdateTask->Remove(sprite);
+	}
+	sprite->mUpdateTask = this;
+	sprite->mUpdateIndex = (uint32_t)mSpriteList.size();
+	mSpriteList.push_back(sprite);
+}
+
+void TFxSpriteAnimTask::Remove( TFxSprite * sprite )
+{
+	ASSERT(!mStepping);
+	ASSERT(sprite->mUpdateTask == this);
+	ASSERT(mSpriteList[sprite->mUpdateIndex] == sprite);
+
+	TFxSprite * last = mSpriteList.back();
+	mSpriteList[sprite->mUpdateIndex] = last;
+	last->mUpdateIndex = sprite->mUpdateIndex;
+	mSpriteList.pop_back();
+
+	sprite->mUpdateTask = NULL;
+}
+
+bool TFxSpriteAnimTask::IsOverBudget()
+{
+	// Workers don't touch the platform timer; they get the state the
+	// main thread saw before handing the ranges out.
+	if (mStepping)
+	{
+		return mSteppingOverBudget;
+	}
+	return mUpdateBudget && (TPlatform::GetInstance()->Timer()-mUpdateStart) >= mUpdateBudget;
+}
 
 bool TFxSpriteAnimTask::Animate()
 {
 	uint32_t newms = GetTime();
 	uint32_t ms = newms-mLastMS ;
-	uint32_t times = ms / FX_PARTICLE_MS_PER_FRAME;
 
-	if (times > FX_PARTICLE_MAX_FRAMES)
-		times = FX_PARTICLE_MAX_FRAMES ;
+	if (ms > FX_PARTICLE_MS_PER_FRAME*FX_PARTICLE_MAX_FRAMES)
+		ms = FX_PARTICLE_MS_PER_FRAME*FX_PARTICLE_MAX_FRAMES ;
 
-	for (WeakFxSpriteList::iterator i =mSpriteList.begin();
-		  i!=mSpriteList.end();
-		  /*donothing*/)
+	// Retire finished sprites first.
+	for (uint32_t i=0; i<mSpriteList.size(); /*donothing*/)
 	{
-		WeakFxSpriteList::iterator thisFx = i++;
+		TFxSprite * fxSprite = mSpriteList[i];
+		if ( fxSprite->mKernelFailed )
+		{
+			// Not from Update(); that may run on a worker.
+			fxSprite->DropKernel();
+		}
+		if ( fxSprite->IsDone() )
+		{
+			// Hold a reference until the sprite has been detached below;
+			// Remove() swaps the next sprite to process into slot i.
+			mFinishedList.push_back( fxSprite->GetRef() );
+			Remove( fxSprite );
+			continue;
+		}
+		++i;
+	}
 
-		TFxSpriteRef fxSprite = thisFx->lock();
-		if ( !fxSprite || fxSprite->GetLPS()->IsDone() )
+	// Update the live ones, starting where the budget ran out last tick so
+	// the same sprites aren't always the ones that get degraded. Sprites
+	// created by a particle script during the sweep wait for the next tick.
+	uint32_t count = (uint32_t)mSpriteList.size();
+	uint32_t start = count ? mNextUpdate % count : 0;
+	bool overBudget = false;
+	mUpdateStart = TPlatform::GetInstance()->Timer();
+	mNextUpdate = start;
+
+	// Only sprites running a native kernel go to the workers: each has
+	// its own script and random generator, and its script can't call
+	// CreateFx. TLuaParticleSystem specs draw from the shared
+	// TLuaParticleSystem::GetRandom() and may add sprites to this list,
+	// so they're stepped on this thread once the workers are done.
+	mParallelList.clear();
+	if (mWorkers)
+	{
+		for (uint32_t i=0; i<count; ++i)
 		{
-			mSpriteList.erase(thisFx);
-			if ( fxSprite && fxSprite->GetLPS()->IsDone())
+			if (mSpriteList[i]->mKernel)
 			{
-//				DEBUG_WRITE(("Time to get rid of child %s from parent", fxSprite->GetSpecName().c_str()));
-  				TSprite * parent = fxSprite->GetParent();
-				
-  				if ( parent )
-  				{
-   					parent->RemoveChild( fxSprite );
-  				}
-			}	
+				mParallelList.push_back(mSpriteList[i]);
+			}
+		}
+		if (mParallelList.size() < FX_PARTICLE_PARALLEL_MIN)
+		{
+			mParallelList.clear();
+		}
+	}
+
+	if (!mParallelList.empty())
+	{
+		uint32_t parallel = (uint32_t)mParallelList.size();
+		mSteppingOverBudget = IsOverBudget();
+		mStepping = true;
+		// One contiguous range per worker plus one for this thread. The
+		// budget is sampled once, so every range degrades alike and
+		// there's no rotation to keep.
+		uint32_t ranges = (uint32_t)mWorkers->getThreadCount()+1;
+		uint32_t size = (parallel+ranges-1)/ranges;
+		uint32_t begin = 0;
+		for ( ; begin+size < parallel; begin += size)
+		{
+			mWorkers->post( boost::bind( &TFxSpriteAnimTask::StepRange, this, begin, begin+size, ms ) );
+		}
+		StepRange( begin, parallel, ms );
+		mWorkers->wait();
+		mStepping = false;
+	}
+
+	for (uint32_t n=0; n<count; ++n)
+	{
+		uint32_t i = (start+n) % count;
+		if (i >= mSpriteList.size())
+			continue;
+
+		TFxSprite * fxSprite = mSpriteList[i];
+		if (!mParallelList.empty() && fxSprite->mKernel)
 			continue;
+
+		if (!overBudget && IsOverBudget())
+		{
+			overBudget = true;
+			mNextUpdate = i;
 		}
-		
-		for (uint32_t i=0; i<times; ++i)
-			fxSprite->Update( FX_PARTICLE_MS_PER_FRAME );
+
+		fxSprite->Step( ms, this );
 	}
 
+	// Only detach finished sprites once every range has been joined.
+	for (std::vector<TFxSpriteRef>::iterator f=mFinishedList.begin(); f!=mFinishedList.end(); ++f)
+	{
+//		DEBUG_WRITE(("Time to get rid of child %s from parent", (*f)->GetSpecName().c_str()));
+		TSprite * parent = (*f)->GetParent();
+
+		if ( parent )
+		{
+			parent->RemoveChild( *f );
+		}
+		TFxSprite::Park( *f );
+	}
+	mFinishedList.clear();
+
 	mLastMS=newms;
 
-	if (mSpriteList.empty())
+	// The global task stays up while idle: the pools and caches outlive
+	// any one burst of effects, and TFxSprite::Shutdown() releases them.
+	if (mSpriteList.empty() && TFxSprite::mAnimTask != this)
 	{
 		return false;
 	}
@@ -236,11 +744,98 @@ bool TFxSpriteAnimTask::Animate()
 	return true;
 }
 
+void TFxSpriteAnimTask::StepRange( uint32_t begin, uint32_t end, uint32_t ms )
+{
+	for (uint32_t i=begin; i<end; ++i)
+	{
+		mParallelList[i]->Step( ms, this );
+	}
+}
+
+void TFxSprite::Step(uint32_t ms, TFxSpriteAnimTask * task)
+{
+	uint32_t times = ms / FX_PARTICLE_MS_PER_FRAME;
+
+	switch (mUpdatePolicy)
+	{
+	case kUpdateVariable:
+		Update( ms );
+		break;
+
+	case kUpdateBudgeted:
+		while (times && !task->IsOverBudget())
+		{
+			Update( FX_PARTICLE_MS_PER_FRAME );
+			--times;
+		}
+		if (times)
+		{
+			Update( times*FX_PARTICLE_MS_PER_FRAME );
+		}
+		break;
+
+	case kUpdateFixed:
+	default:
+		if (task->IsOverBudget())
+		{
+			// Over budget: collapse the steps into one.
+			if (times)
+			{
+				Update( times*FX_PARTICLE_MS_PER_FRAME );
+			}
+			break;
+		}
+		for (uint32_t i=0; i<times; ++i)
+			Update( FX_PARTICLE_MS_PER_FRAME );
+		break;
+	}
+}
+
+void TFxSprite::ReadUpdatePolicy()
+{
+	TScript * script = mKernel ? mKernel->GetScript() : GetLPS()->GetScript();
+	str policy = script->GetGlobalString("gUpdatePolicy");
+	if (policy == "variable")
+	{
+		mUpdatePolicy = kUpdateVariable;
+	}
+	else if (policy == "budgeted")
+	{
+		mUpdatePolicy = kUpdateBudgeted;
+	}
+	else
+	{
+		mUpdatePolicy = kUpdateFixed;
+	}
+}
+
 void TFxSprite::Update(int ms)
 {
 	// No updates until we've been drawn once.
 	if (mDrawnOnce)
 	{
-		GetLPS()->Update( ms );
+		if (mKernel)
+		{
+			// The sprite holds still until the task swaps in the Lua
+			// system at the start of the next tick.
+			if (!mKernelFailed && !mKernel->Update( ms ))
+			{
+				mKernelFailed = true;
+			}
+		}
+		else
+		{
+			GetLPS()->Update( ms );
+		}
 	}
 }
+
+bool TFxSprite::IsDone()
+{
+	return mKernel ? mKernel->IsDone() : mLPS.IsDone();
+}
+
+uint32_t TFxSprite::GetParticleCount()
+{
+	return mKernel ? mKernel->GetParticleCount() : mLPS.GetParticleCount();
+}
@@ -0,0 +1,139 @@
+/**
+ * @file
+ * Implementation for class TBufferedPrefs, preferences saved write-behind.
+ */
+
+#include "bufferedprefs.h"
+
+#include <pf/animtask.h>
+#include <pf/platform.h>
+
+#include <windows.h>
+
+/**
+ * Calls TBufferedPrefs::Update every frame until detached.
+ */
+class TBufferedPrefs::TTask : public TAnimTask
+{
+public:
+	TTask(TBufferedPrefs * owner) : mOwner(owner) {}
+
+	void Detach() { mOwner = NULL; }
+
+	virtual bool Animate()
+	{
+		if (!mOwner)
+		{
+			return false;
+		}
+		mOwner->Update();
+		return true;
+	}
+
+private:
+	TBufferedPrefs * mOwner ;
+};
+
+TBufferedPrefs::TBufferedPrefs() :
+	mPrefs(new TPrefsDB()),
+	mTask(new TTask(this)),
+	mDirty(false),
+	mFirstChange(0),
+	mLastChange(0),
+	mSaveCount(0)
+{
+	TPlatform::GetInstance()->AdoptTask(mTask);
+}
+
+TBufferedPrefs::~TBufferedPrefs()
+{
+	// The platform owns the task and deletes it once it returns false.
+	mTask->Detach();
+	Flush();
+	delete mPrefs;
+}
+
+uint32_t TBufferedPrefs::GetNumUsers()
+{
+	return mPrefs->GetNumUsers();
+}
+
+void TBufferedPrefs::DeleteUser(uint32_t userNum)
+{
+	mPrefs->DeleteUser(userNum);
+	// Leaves the file with the other pending changes in it too.
+	Save();
+}
+
+int32_t TBufferedPrefs::GetInt(str prefName, int32_t defaultValue, int32_t userIndex)
+{
+	return mPrefs->GetInt(prefName, defaultValue, userIndex);
+}
+
+void TBufferedPrefs::SetInt(str prefName, int32_t value, int32_t userIndex)
+{
+	// A default that differs from value tells a missing pref from an
+	// equal one.
+	if (mPrefs->GetInt(prefName, value+1, userIndex)==value)
+	{
+		return;
+	}
+	mPrefs->SetInt(prefName, value, userIndex, false);
+	Changed();
+}
+
+str TBufferedPrefs::GetStr(str prefName, str defaultValue, int32_t userIndex)
+{
+	return mPrefs->GetStr(prefName, defaultValue, userIndex);
+}
+
+void TBufferedPrefs::SetStr(str prefName, str value, int32_t userIndex)
+{
+	if (mPrefs->GetStr(prefName, value+"\x01", userIndex)==value)
+	{
+		return;
+	}
+	mPrefs->SetStr(prefName, value, userIndex, false);
+	Changed();
+}
+
+void TBufferedPrefs::Flush()
+{
+	if (mDirty)
+	{
+		Save();
+	}
+}
+
+void TBufferedPrefs::Update()
+{
+	if (!mDirty)
+	{
+		return;
+	}
+
+	const unsigned long now = GetTickCount();
+	if (now-mLastChange < kIdleDelay && now-mFirstChange < kMaxDelay)
+	{
+		return;
+	}
+	Save();
+}
+
+void TBufferedPrefs::Changed()
+{
+	const unsigned long now = GetTickCount();
+	if (!mDirty)
+	{
+		mDirty = true;
+		mFirstChange = now;
+	}
+	mLastChange = now;
+}
+
+void TBufferedPrefs::Save()
+{
+	mPrefs->SavePrefs();
+	mSaveCount++;
+	mDirty = false;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file
+ * Interface for class TBufferedPrefs
+ */
+
+
+#ifndef BUFFEREDPREFS_H_INCLUDED
+#define BUFFEREDPREFS_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/prefsdb.h>
+
+/**
+ * Preferences with write-behind saving.
+ *
+ * TPrefsDB::SetInt and SetStr save the preferences file on every
+ * call by default, so dragging a volume slider would hit the disk
+ * several times a second. TBufferedPrefs changes the values in
+ * memory only and saves the file later, once for all the changes
+ * made in between:
+ *
+ * - when no preference changed for kIdleDelay ms, so a slider drag
+ *   is saved once it stops;
+ * - when the oldest unsaved change is kMaxDelay ms old, so a steady
+ *   stream of changes still reaches the disk;
+ * - on Flush(), and when the object is destroyed at shutdown.
+ *
+ * Setting a preference to the value it already has changes nothing.
+ * Saves happen on the main thread, from a task the object adopts to
+ * the platform; TPrefsDB is never touched from another thread.
+ */
+class TBufferedPrefs
+{
+public:
+	/// ms without a change before the preferences are saved
+	static const unsigned long kIdleDelay = 500;
+	/// ms an unsaved change may wait at most
+	static const unsigned long kMaxDelay = 5000;
+
+	/// Default Constructor; loads the preferences file.
+	TBufferedPrefs();
+
+	/// Destructor; saves what is still unsaved.
+	~TBufferedPrefs();
+
+	/// @see TPrefsDB::GetNumUsers
+	uint32_t GetNumUsers();
+	/// Deletes the user and saves at once, as TPrefsDB does.
+	void DeleteUser(uint32_t userNum);
+
+	/// @see TPrefsDB::GetInt
+	int32_t GetInt(str prefName, int32_t defaultValue, int32_t userIndex = TPrefsDB::kGlobalIndex);
+	/// Change an int in memory; it's saved later.
+	void SetInt(str prefName, int32_t value, int32_t userIndex = TPrefsDB::kGlobalIndex);
+
+	/// @see TPrefsDB::GetStr
+	str GetStr(str prefName, str defaultValue, int32_t userIndex = TPrefsDB::kGlobalIndex);
+	/// Change a str in memory; it's saved later.
+	void SetStr(str prefName, str value, int32_t userIndex = TPrefsDB::kGlobalIndex);
+
+	/**
+	 * Save the preferences file now if anything changed.
+	 */
+	void Flush();
+
+	/// @return True if there are changes not saved yet.
+	bool IsDirty() const { return mDirty; }
+
+	/// @return Number of times the file was saved.
+	unsigned long GetSaveCount() const { return mSaveCount; }
+
+	/**
+	 * Save if the idle or the maximum delay ran out. Called every
+	 * frame by a task the object adopts to the platform.
+	 */
+	void Update();
+
+private:
+	class TTask;
+
+	TBufferedPrefs(const TBufferedPrefs &);
+	TBufferedPrefs & operator=(const TBufferedPrefs &);
+
+	void Changed();
+	void Save();
+
+	/**
+	 * The preferences themselves.
+	 */
+	TPrefsDB *		mPrefs ;
+
+	/**
+	 * Our per-frame task; owned by the platform.
+	 */
+	TTask *			mTask ;
+
+	/**
+	 * Whether something changed since the last save.
+	 */
+	bool			mDirty ;
+
+	/**
+	 * Tick counts of the first and the last unsaved change.
+	 */
+	unsigned long	mFirstChange ;
+	unsigned long	mLastChange ;
+
+	unsigned long	mSaveCount ;
+};
+
+#endif // BUFFEREDPREFS_H_INCLUDED
@@ -103,7 +103,18 @@ void TCustomTextEdit::TestEnable(int count)
 {
 	if ( (mEnableWindow.length()) > 0 )
 	{
-		TWindow * window = FindParentModal()->GetChildWindow(mEnableWindow,-1);
+		TWindow * modal = FindParentModal();
+		if (mModalIndex.GetRoot()!=modal)
+		{
+			mModalIndex.SetRoot(modal);
+		}
+		else
+		{
+			// The modal isn't ours; windows may have come or gone since
+			// the last key.
+			mModalIndex.Refresh();
+		}
+		TWindow * window = mModalIndex.FindChild(mEnableWindow);
 		if (window)
 		{
 			if (((int)GetText().length()+count)>0)
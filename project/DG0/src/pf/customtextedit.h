@@ -21,6 +21,7 @@
 #include <pf/textedit.h>
 #include <pf/assetmap.h>
 #include <pf/random.h>
+#include "windowindex.h"
 
 /**
  * A customized text edit window that knows how to:
@@ -109,6 +110,13 @@ private:
 	 * The name of our associated enable window.
 	 */
 	str			mEnableWindow ;
+
+	/**
+	 * Names of the windows in our parent modal, so looking up the
+	 * enable window on every key is a map lookup after a pointer
+	 * walk of the modal, instead of a name compare per window.
+	 */
+	TWindowIndex	mModalIndex ;
 };
 
 #endif // CUSTOMTEXTEDIT_H_INCLUDED
@@ -13,6 +13,7 @@
 #include "globaldefines.h"
 #include "settings.h"
 #include "serversubmit.h"
+#include "ddd/Application.h"
 
 #include <pf/pflib.h>
 
@@ -30,6 +31,7 @@ THiscore::THiscore() :
 	mScoreOffset(0)
 {
 	mpPFHiscores = TSettings::GetInstance()->GetHiscores();
+	mIndex.SetRoot(this);
 
 	TScript * s = TWindowManager::GetInstance()->GetScript();
 	ScriptRegisterMemberDirect(s,"GetState",this,THiscore::GetState);
@@ -55,6 +57,7 @@ THiscore::~THiscore()
 void THiscore::PostChildrenInit(TWindowStyle & style )
 {
 	TWindow::PostChildrenInit(style);
+	mIndex.Build();
 
 	StartWindowAnimation(20);
 
@@ -63,25 +66,25 @@ void THiscore::PostChildrenInit(TWindowStyle & style )
 		TWindow *window;
 		str buf;
 		buf.format("name%d", i+1);
-		window = GetChildWindow(buf, -1);
+		window = mIndex.FindChild(buf);
 		if (window)
 		{
 			mNames[i] = window->GetCast<TText>();
 		}
 		buf.format("score%d", i+1);
-		window = GetChildWindow(buf, -1);
+		window = mIndex.FindChild(buf);
 		if (window)
 		{
 			mScores[i] = window->GetCast<TText>();
 		}
 		buf.format("%d", i+1);
-		window = GetChildWindow(buf, -1);
+		window = mIndex.FindChild(buf);
 		if (window)
 		{
 			mNumbers[i] = window->GetCast<TText>();
 		}
 		buf.format("p1_%d", i+1);
-		window = GetChildWindow(buf, -1);
+		window = mIndex.FindChild(buf);
 		if (window)
 		{
 			mP1s[i] = window->GetCast<TImage>();
@@ -91,7 +94,7 @@ void THiscore::PostChildrenInit(TWindowStyle & style )
 
 	if (TPlatform::GetInstance()->IsEnabled( TPlatform::kHiscoreLocalOnly))
 	{
-		TWindow *panel = GetChildWindow("leftpanel", -1);
+		TWindow *panel = mIndex.FindChild("leftpanel");
 
 		TRect rect;
 		panel->GetWindowRect(&rect);
@@ -100,7 +103,7 @@ void THiscore::PostChildrenInit(TWindowStyle & style )
 	}
 
 
-	TWindow *gameModeWindow = GetChildWindow("gamemode", -1);
+	TWindow *gameModeWindow = mIndex.FindChild("gamemode");
 	if (gameModeWindow)
 	{
 		mGameMode = gameModeWindow->GetCast<TText>();
@@ -110,9 +113,21 @@ void THiscore::PostChildrenInit(TWindowStyle & style )
 
 }
 
+bool THiscore::AdoptChild(TWindow * child, bool initWindow)
+{
+	mIndex.Invalidate();
+	return TWindow::AdoptChild(child,initWindow);
+}
+
+void THiscore::OrphanChild(TWindow * child)
+{
+	mIndex.Invalidate();
+	TWindow::OrphanChild(child);
+}
+
 void THiscore::UpdateButtons()
 {
-	TWindowManager::GetInstance()->GetScript()->DoLuaString("UpdateButtons();");
+	ddd::Application::get_mutable_instance().getScriptCache().doString(TWindowManager::GetInstance()->GetScript(), "UpdateButtons();");
 }
 
 void THiscore::HideAllText()
@@ -126,55 +141,55 @@ void THiscore::HideAllText()
 		mP1s[i]->SetFlags(mP1s[i]->GetFlags() & ~TWindow::kEnabled);
 	}
 
-	text = GetChildWindow("eligible", -1);
+	text = mIndex.FindChild("eligible");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("eligibleasterisk", -1);
+	text = mIndex.FindChild("eligibleasterisk");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("server", -1);
+	text = mIndex.FindChild("server");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("error", -1);
+	text = mIndex.FindChild("error");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("info", -1);
+	text = mIndex.FindChild("info");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("category", -1);
+	text = mIndex.FindChild("category");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("local", -1);
+	text = mIndex.FindChild("local");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("global", -1);
+	text = mIndex.FindChild("global");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("topplayers", -1);
+	text = mIndex.FindChild("topplayers");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("congratulations", -1);
+	text = mIndex.FindChild("congratulations");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("dnq", -1);
+	text = mIndex.FindChild("dnq");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("yourrank", -1);
+	text = mIndex.FindChild("yourrank");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("yourrankglobalinfo", -1);
+	text = mIndex.FindChild("yourrankglobalinfo");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-	text = GetChildWindow("rankvalue", -1);
+	text = mIndex.FindChild("rankvalue");
 	if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
 
 	// These are really buttons, but associated with text
 	TWindow *button;
-	button = GetChildWindow("scrollup", -1);
+	button = mIndex.FindChild("scrollup");
 	if (button) button->SetFlags(button->GetFlags() & ~TWindow::kEnabled);
 
-	button = GetChildWindow("scrolldown", -1);
+	button = mIndex.FindChild("scrolldown");
 	if (button) button->SetFlags(button->GetFlags() & ~TWindow::kEnabled);
 }
 
@@ -197,26 +212,26 @@ void THiscore::UpdateText()
 
 	if ( TPlatform::GetInstance()->IsEnabled( TPlatform::kHiscoreLocalOnly ) )
 	{
-		TWindow *panel = GetChildWindow("rightpanel", -1);
+		TWindow *panel = mIndex.FindChild("rightpanel");
 		panel->SetFlags(panel->GetFlags() & ~kEnabled);
-		panel = GetChildWindow("rightpanelsmall", -1);
+		panel = mIndex.FindChild("rightpanelsmall");
 		panel->SetFlags(panel->GetFlags() & ~kEnabled);
 	}
 	else
 	{
 		if (mState == eLocalView)
 		{
-			TWindow *panel = GetChildWindow("rightpanel", -1);
+			TWindow *panel = mIndex.FindChild("rightpanel");
 			panel->SetFlags(panel->GetFlags() | kEnabled);
-			panel = GetChildWindow("rightpanelsmall", -1);
+			panel = mIndex.FindChild("rightpanelsmall");
 			panel->SetFlags(panel->GetFlags() & ~kEnabled);
 
 		}
 		else
 		{
-			TWindow *panel = GetChildWindow("rightpanel", -1);
+			TWindow *panel = mIndex.FindChild("rightpanel");
 			panel->SetFlags(panel->GetFlags() & ~kEnabled);
-			panel = GetChildWindow("rightpanelsmall", -1);
+			panel = mIndex.FindChild("rightpanelsmall");
 			panel->SetFlags(panel->GetFlags() | kEnabled);
 
 		}
@@ -235,14 +250,14 @@ void THiscore::UpdateText()
 		{
 
 
-			text = GetChildWindow("eligible", -1);
+			text = mIndex.FindChild("eligible");
 			if (text) text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 
-			text = GetChildWindow("eligibleasterisk", -1);
+			text = mIndex.FindChild("eligibleasterisk");
 			if (text) text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 		}
 
-		text = GetChildWindow("info", -1);
+		text = mIndex.FindChild("info");
 		if (text) text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 	}
 
@@ -250,7 +265,7 @@ void THiscore::UpdateText()
 	{
 		TText *text;
 
-		TWindow *childWindow = GetChildWindow("category", -1);
+		TWindow *childWindow = mIndex.FindChild("category");
 		if (childWindow)
 		{
 			text = childWindow->GetCast<TText>();
@@ -263,7 +278,7 @@ void THiscore::UpdateText()
 			}
 		}
 
-		childWindow = GetChildWindow("yourrankglobalinfo", -1);
+		childWindow = mIndex.FindChild("yourrankglobalinfo");
 		if (childWindow) childWindow->SetFlags(childWindow->GetFlags() | TWindow::kEnabled);
 
 		int myRank;
@@ -271,32 +286,32 @@ void THiscore::UpdateText()
 
 		if (mSubmitState == eSuccess)
 		{
-			childWindow = GetChildWindow("congratulations", -1);
+			childWindow = mIndex.FindChild("congratulations");
 			if (childWindow)
 			{
 				text = childWindow->GetCast<TText>();
 				text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 			}
 
-			childWindow = GetChildWindow("yourrankglobalinfo", -1);
+			childWindow = mIndex.FindChild("yourrankglobalinfo");
 			if (childWindow) childWindow->SetFlags(childWindow->GetFlags() & ~TWindow::kEnabled);
 		}
 		else if (mSubmitState == eDNQ)
 		{
-			childWindow = GetChildWindow("dnq", -1);
+			childWindow = mIndex.FindChild("dnq");
 			if (childWindow)
 			{
 				text = childWindow->GetCast<TText>();
 				text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 			}
-			childWindow = GetChildWindow("yourrankglobalinfo", -1);
+			childWindow = mIndex.FindChild("yourrankglobalinfo");
 			if (childWindow) childWindow->SetFlags(childWindow->GetFlags() & ~TWindow::kEnabled);
 
 		}
 
 		if (globalBest)
 		{
-			childWindow = GetChildWindow("yourrank", -1);
+			childWindow = mIndex.FindChild("yourrank");
 			if (childWindow)
 			{
 				text = childWindow->GetCast<TText>();
@@ -308,7 +323,7 @@ void THiscore::UpdateText()
 				text->SetText(rankValue);
 			}
 
-			childWindow = GetChildWindow("yourrankglobalinfo", -1);
+			childWindow = mIndex.FindChild("yourrankglobalinfo");
 			if (childWindow) childWindow->SetFlags(childWindow->GetFlags() & ~TWindow::kEnabled);
 		}
 
@@ -320,14 +335,14 @@ void THiscore::UpdateText()
 		mState == eSubmitting)
 	{
 		TWindow *text;
-		text = GetChildWindow("server", -1);
+		text = mIndex.FindChild("server");
 		if (text) text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 	}
 
 	if (mState == eError)
 	{
 		TText *text;
-		TWindow *childWindow = GetChildWindow("error", -1);
+		TWindow *childWindow = mIndex.FindChild("error");
 		if (childWindow)
 		{
 			text = childWindow->GetCast<TText>();
@@ -341,13 +356,13 @@ void THiscore::UpdateText()
 	if ( TPlatform::GetInstance()->IsEnabled( TPlatform::kHiscoreLocalOnly ) )
 	{
 		TWindow *text;
-		text = GetChildWindow("info", -1);
+		text = mIndex.FindChild("info");
 		if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-		text = GetChildWindow("eligible", -1);
+		text = mIndex.FindChild("eligible");
 		if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 
-		text = GetChildWindow("eligibleasterisk", -1);
+		text = mIndex.FindChild("eligibleasterisk");
 		if (text) text->SetFlags(text->GetFlags() & ~TWindow::kEnabled);
 	}
 
@@ -362,7 +377,7 @@ void THiscore::UpdateScoresTable()
 	{
 		numScores = mpPFHiscores->GetScoreCount(false);
 		TWindow *text;
-		text = GetChildWindow("global", -1);
+		text = mIndex.FindChild("global");
 		if ( text && !TPlatform::GetInstance()->IsEnabled( TPlatform::kHiscoreLocalOnly ) ) text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 		local = false;
 		if (mScoreOffset > numScores - 5)
@@ -379,26 +394,26 @@ void THiscore::UpdateScoresTable()
 		if (mScoreOffset > 0)
 		{
 			TWindow *scroll;
-			scroll = GetChildWindow("scrollup", -1);
+			scroll = mIndex.FindChild("scrollup");
 			scroll->SetFlags(scroll->GetFlags() | kEnabled);
 		}
 		else
 		{
 			TWindow *scroll;
-			scroll = GetChildWindow("scrollup", -1);
+			scroll = mIndex.FindChild("scrollup");
 			scroll->SetFlags(scroll->GetFlags() & ~kEnabled);
 		}
 
 		if (mScoreOffset + NUM_SCORES_ON_SCREEN < numScores)
 		{
 			TWindow *scroll;
-			scroll = GetChildWindow("scrolldown", -1);
+			scroll = mIndex.FindChild("scrolldown");
 			scroll->SetFlags(scroll->GetFlags() | kEnabled);
 		}
 		else
 		{
 			TWindow *scroll;
-			scroll = GetChildWindow("scrolldown", -1);
+			scroll = mIndex.FindChild("scrolldown");
 			scroll->SetFlags(scroll->GetFlags() & ~kEnabled);
 		}
 	}
@@ -406,17 +421,17 @@ void THiscore::UpdateScoresTable()
 	{
 		numScores = mpPFHiscores->GetScoreCount(true);
 		TWindow *text;
-		text = GetChildWindow("local", -1);
+		text = mIndex.FindChild("local");
 		if (text && !TPlatform::GetInstance()->IsEnabled( TPlatform::kHiscoreLocalOnly ) ) text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 
-		text = GetChildWindow("topplayers", -1);
+		text = mIndex.FindChild("topplayers");
 		if (text && TPlatform::GetInstance()->IsEnabled( TPlatform::kHiscoreLocalOnly )) text->SetFlags(text->GetFlags() | TWindow::kEnabled);
 
 		TWindow *scroll;
-		scroll = GetChildWindow("scrollup", -1);
+		scroll = mIndex.FindChild("scrollup");
 		scroll->SetFlags(scroll->GetFlags() & ~kEnabled);
 
-		scroll = GetChildWindow("scrolldown", -1);
+		scroll = mIndex.FindChild("scrolldown");
 		scroll->SetFlags(scroll->GetFlags() & ~kEnabled);
 		mScoreOffset = 0;
 	}
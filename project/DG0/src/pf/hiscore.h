@@ -15,6 +15,7 @@
 
 #include "TGameWindow.h"
 #include "settings.h"
+#include "windowindex.h"
 
 #include <pf/pflib.h>
 
@@ -33,6 +34,8 @@ public:
 
 	virtual void PostChildrenInit(TWindowStyle & style);
 	virtual bool OnMessage(TMessage * message);
+	virtual bool AdoptChild(TWindow * child, bool initWindow=true);
+	virtual void OrphanChild(TWindow * child);
 	void SubmissionDone(bool qualified);
 
 	/**
@@ -66,6 +69,7 @@ private:
 	TText					*mNumbers[NUM_SCORES_ON_SCREEN];
 	TImage					*mP1s[NUM_SCORES_ON_SCREEN];
 	TText					*mGameMode;
+	TWindowIndex			mIndex;
 };
 
 
@@ -17,6 +17,8 @@
 #include <pf/windowmanager.h>
 #include <pf/script.h>
 
+#include "ddd/Application.h"
+
 PFTYPEIMPL_DC(TMainMenu);
 
 TMainMenu::TMainMenu()
@@ -43,6 +45,16 @@ void TMainMenu::PostChildrenInit(TWindowStyle & style)
 }
 
 
+void TMainMenu::Draw()
+{
+	TWindow::Draw();
+
+	// The first main menu frame ends the startup timeline; later
+	// frames find the profiler finished and return at once.
+	ddd::Application::get_mutable_instance().getStartupProfiler().finish("main menu frame", "user:startup.csv");
+}
+
+
 void TMainMenu::SetWelcomeName()
 {
 	if(TSettings::GetInstance()->GetNumUsers() == 0)
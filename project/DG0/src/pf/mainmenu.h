@@ -21,6 +21,7 @@ public:
 	~TMainMenu();
 
 	virtual void PostChildrenInit(TWindowStyle & style);
+	virtual void Draw();
 	
 private:
 	void SetWelcomeName();
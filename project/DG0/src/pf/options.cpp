@@ -23,6 +23,8 @@ PFTYPEIMPL_DC(TOptions);
 
 TOptions::TOptions()
 {
+	mIndex.SetRoot(this);
+
 	TWindowManager *wm = TPlatform::GetInstance()->GetWindowManager();
 
 	ScriptRegisterMemberDirect( wm->GetScript(), "SaveVolumes", this, TOptions::SaveVolumes );
@@ -35,7 +37,9 @@ TOptions::~TOptions()
 
 void TOptions::PostChildrenInit(TWindowStyle & /*style*/)
 {
-	TWindow *window = GetChildWindow("fullscreen", -1);
+	mIndex.Build();
+
+	TWindow *window = mIndex.FindChild("fullscreen");
 	if (window)
 	{
 		TButton *button = window->GetCast<TButton>();
@@ -52,7 +56,7 @@ void TOptions::PostChildrenInit(TWindowStyle & /*style*/)
 		}
 	}
 
-	window = GetChildWindow("mutebox", -1);
+	window = mIndex.FindChild("mutebox");
 	if (window)
 	{
 		TButton *button = window->GetCast<TButton>();
@@ -71,7 +75,7 @@ void TOptions::PostChildrenInit(TWindowStyle & /*style*/)
 		}
 	}
 
-	window = GetChildWindow("sfxlevelslider", -1);
+	window = mIndex.FindChild("sfxlevelslider");
 	if (window)
 	{	
 		TSlider *slider = window->GetCast<TSlider>();
@@ -83,7 +87,7 @@ void TOptions::PostChildrenInit(TWindowStyle & /*style*/)
 		}
 	}
 
-	window = GetChildWindow("musiclevelslider", -1);
+	window = mIndex.FindChild("musiclevelslider");
 	if (window)
 	{	
 		TSlider *slider = window->GetCast<TSlider>();
@@ -96,12 +100,24 @@ void TOptions::PostChildrenInit(TWindowStyle & /*style*/)
 	}
 }
 
+bool TOptions::AdoptChild(TWindow * child, bool initWindow)
+{
+	mIndex.Invalidate();
+	return TWindow::AdoptChild(child,initWindow);
+}
+
+void TOptions::OrphanChild(TWindow * child)
+{
+	mIndex.Invalidate();
+	TWindow::OrphanChild(child);
+}
+
 void TOptions::SaveVolumes()
 {
 	TWindow *window;
 
 
-	window = GetChildWindow("sfxlevelslider", -1);
+	window = mIndex.FindChild("sfxlevelslider");
 	if (window)
 	{	
 		TSlider *slider = window->GetCast<TSlider>();
@@ -113,7 +129,7 @@ void TOptions::SaveVolumes()
 		}
 	}
 
-	window = GetChildWindow("musiclevelslider", -1);
+	window = mIndex.FindChild("musiclevelslider");
 	if (window)
 	{	
 		TSlider *slider = window->GetCast<TSlider>();
@@ -135,7 +151,7 @@ bool TOptions::OnMessage(TMessage * message)
 	{
 		if (message->mName == "sfxlevelslider")
 		{
-			TWindow *window = GetChildWindow("sfxlevelslider", -1);
+			TWindow *window = mIndex.FindChild("sfxlevelslider");
 			if (window)
 			{
 				TSlider *slider = window->GetCast<TSlider>();
@@ -144,6 +160,9 @@ bool TOptions::OnMessage(TMessage * message)
 					float val = slider->GetValue();
 					TPlatform::GetInstance()->GetSoundManager()->SetTypeVolume(kSFXSoundGroup, val);
 					TPlatform::GetInstance()->GetSoundManager()->SetTypeVolume(TSound::kButtonSound, val);
+					// Only changes the preferences in memory; they're
+					// saved once the slider stops.
+					SaveVolumes();
 					handled = true;
 				}
 				
@@ -151,7 +170,7 @@ bool TOptions::OnMessage(TMessage * message)
 		}
 		else if (message->mName == "musiclevelslider")
 		{
-			TWindow *window = GetChildWindow("musiclevelslider", -1);
+			TWindow *window = mIndex.FindChild("musiclevelslider");
 			if (window)
 			{
 				TSlider *slider = window->GetCast<TSlider>();
@@ -159,6 +178,7 @@ bool TOptions::OnMessage(TMessage * message)
 				{
 					float val = slider->GetValue();
 					TPlatform::GetInstance()->GetSoundManager()->SetTypeVolume(kMusicSoundGroup, val);
+					SaveVolumes();
 					handled = true;
 				}
 			}
@@ -12,6 +12,7 @@
 #define OPTIONS_H_INCLUDED
 
 #include <pf/pflib.h>
+#include "windowindex.h"
 
 class TOptions : public TWindow
 {
@@ -24,6 +25,11 @@ public:
 
 	void SaveVolumes();
 	virtual bool OnMessage(TMessage * message);
+	virtual bool AdoptChild(TWindow * child, bool initWindow=true);
+	virtual void OrphanChild(TWindow * child);
+
+private:
+	TWindowIndex mIndex;
 };
 
 #endif
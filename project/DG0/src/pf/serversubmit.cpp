@@ -10,6 +10,7 @@
 
 
 #include "serversubmit.h"
+#include "ddd/Application.h"
 
 PFTYPEIMPL_DC(TServerSubmit);
 
@@ -17,6 +18,7 @@ PFTYPEIMPL_DC(TServerSubmit);
 TServerSubmit::TServerSubmit()
 {
 	mpPFHiscores = TSettings::GetInstance()->GetHiscores();
+	mIndex.SetRoot(this);
 
 	TScript * s = TWindowManager::GetInstance()->GetScript();
 	ScriptRegisterMemberDirect(s,"SubmitToServer",this,TServerSubmit::SubmitToServer);
@@ -35,13 +37,48 @@ void TServerSubmit::Register()
 
 }
 
+bool TServerSubmit::AdoptChild(TWindow * child, bool initWindow)
+{
+	mIndex.Invalidate();
+	return TWindow::AdoptChild(child,initWindow);
+}
+
+void TServerSubmit::OrphanChild(TWindow * child)
+{
+	mIndex.Invalidate();
+	TWindow::OrphanChild(child);
+}
+
 void TServerSubmit::SwitchModes( bool submit )
 {
-	TWindowManager::GetInstance()->GetScript()->DoLuaString( str::getFormatted("SwitchModes(%s)",submit?"true":"false") );
+	ddd::Application::get_mutable_instance().getScriptCache().doString( TWindowManager::GetInstance()->GetScript(), submit ? "SwitchModes(true)" : "SwitchModes(false)" );
 }
 
 void TServerSubmit::SubmitToServer(str name, str account, str pass, bool remember, bool medalsOnly)
 {
+	ddd::HiscoreClient & client = ddd::Application::get_mutable_instance().getHiscoreClient();
+	if (client.hasUrl())
+	{
+		// Our own server: queue the submission and close at once, the
+		// client sends it in the background and retries until it's in.
+		if (account.length() > 0)
+		{
+			if (remember)
+			{
+				mpPFHiscores->SetRememberedUserInfo(account, pass);
+			}
+			QueueSubmission(&client, account, pass, medalsOnly);
+		}
+		else
+		{
+			TSettings::GetInstance()->GetPreferences()->SetStr("_anonusername", name, TSettings::GetInstance()->GetCurrentUser() );
+			QueueSubmission(&client, name, "", medalsOnly);
+		}
+		ddd::Application::get_mutable_instance().getScriptCache().doString(TWindowManager::GetInstance()->GetScript(), "gReturnValue='success'");
+		TPlatform::GetInstance()->GetWindowManager()->PopModal( FindParentModal()->GetID());
+		return;
+	}
+
 	bool success;
 	TPfHiscores::ESubmitMode mode = TPfHiscores::kSubmitAll;
 	if (medalsOnly)
@@ -54,7 +91,7 @@ void TServerSubmit::SubmitToServer(str name, str account, str pass, bool remembe
 	}
 	else
 	{
-		TSettings::GetInstance()->GetPreferences()->SetStr("_anonusername", name, TSettings::GetInstance()->GetCurrentUser(), true );
+		TSettings::GetInstance()->GetPreferences()->SetStr("_anonusername", name, TSettings::GetInstance()->GetCurrentUser() );
 		success=mpPFHiscores->SubmitData(name.c_str(), NULL, false, mode);
 	}
 
@@ -64,6 +101,24 @@ void TServerSubmit::SubmitToServer(str name, str account, str pass, bool remembe
 	StartWindowAnimation(20);
 }
 
+void TServerSubmit::QueueSubmission(ddd::HiscoreClient * client, str player, str pass, bool medalsOnly)
+{
+	TSettings * settings = TSettings::GetInstance();
+	const str mode = settings->GetPFGameModeName(settings->GetCurrentGameMode());
+	if (!medalsOnly)
+	{
+		int score = 0;
+		if (mpPFHiscores->GetUserBestScore(TPfHiscores::eLocalBest, &score, NULL, NULL, 0))
+		{
+			client->submitScore(player.c_str(), pass.c_str(), mode.c_str(), score);
+		}
+	}
+	for (int i = 0; i < settings->NumEarnedMedals(); i++)
+	{
+		client->submitMedal(player.c_str(), pass.c_str(), settings->GetMedalGameMode(i).c_str(), settings->GetMedalName(i).c_str());
+	}
+}
+
 str TServerSubmit::GetLuaSetupVars(bool medalsMode)
 {
 	str setupString;
@@ -110,16 +165,16 @@ bool TServerSubmit::OnMessage(TMessage * message)
 		//
 		// We can't use the magic TCustomTextEdit enable window feature here because
 		// either of the two edit fields can have text to enable the button.
-		TTextEdit *textEdit = GetChildWindow("nameedit", -1)->GetCast<TTextEdit>();
-		TTextEdit *textEdit2 = GetChildWindow("accountedit", -1)->GetCast<TTextEdit>();
+		TTextEdit *textEdit = mIndex.FindChild("nameedit")->GetCast<TTextEdit>();
+		TTextEdit *textEdit2 = mIndex.FindChild("accountedit")->GetCast<TTextEdit>();
 		if (textEdit->GetText().length() > 0 || textEdit2->GetText().length() > 0)
 		{
-			TWindow *okwindow = GetChildWindow("submittoserver", -1);
+			TWindow *okwindow = mIndex.FindChild("submittoserver");
 			okwindow->SetFlags(okwindow->GetFlags() | kEnabled);
 		}
 		else
 		{
-			TWindow *okwindow = GetChildWindow("submittoserver", -1);
+			TWindow *okwindow = mIndex.FindChild("submittoserver");
 			okwindow->SetFlags(okwindow->GetFlags() & ~kEnabled);
 			TButton *button = okwindow->GetCast<TButton>();
 			button->OnMouseLeave();
@@ -140,7 +195,7 @@ bool TServerSubmit::OnTaskAnimate()
 	{
 		TWindow *childWindow;
 
-		childWindow = GetChildWindow("submiterror", -1);
+		childWindow = mIndex.FindChild("submiterror");
 		if (childWindow)
 		{
 			TText *text = childWindow->GetCast<TText>();
@@ -149,10 +204,10 @@ bool TServerSubmit::OnTaskAnimate()
 		}
 
 		TWindow *button;
-		button = GetChildWindow("submitconnect", -1);
+		button = mIndex.FindChild("submitconnect");
 		if (button) button->SetFlags(button->GetFlags() & ~TWindow::kEnabled);
 
-		button = GetChildWindow("submiterrorok", -1);
+		button = mIndex.FindChild("submiterrorok");
 		if (button) button->SetFlags(button->GetFlags() | TWindow::kEnabled);
 
 		return false;
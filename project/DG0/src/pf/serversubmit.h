@@ -14,6 +14,12 @@
 
 #include <pf/pflib.h>
 #include "hiscore.h"
+#include "windowindex.h"
+
+namespace ddd
+{
+	class HiscoreClient;
+}
 
 class TServerSubmit : public TWindow
 {
@@ -33,14 +39,21 @@ public:
 
 	virtual bool OnMessage(TMessage * message);
 	virtual bool OnTaskAnimate();
+	virtual bool AdoptChild(TWindow * child, bool initWindow=true);
+	virtual void OrphanChild(TWindow * child);
 
 
 private:
 	
+	// Hands the best local score, unless medalsOnly, and the earned
+	// medals of the current user to our own hiscore client.
+	void QueueSubmission(ddd::HiscoreClient * client, str player, str pass, bool medalsOnly);
+
 	TServerSubmit(TServerSubmit &rhs);
 	TServerSubmit& operator= (const TServerSubmit& f);
 
 	TPfHiscores *mpPFHiscores;
+	TWindowIndex mIndex;
 	
 };
 
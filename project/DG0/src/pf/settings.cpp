@@ -18,6 +18,7 @@
 #include <pf/stringtable.h>
 
 #include "key.h"
+#include "ddd/Application.h"
 
 
 
@@ -75,9 +76,9 @@ TSettings::TSettings()
 
 
 
-	// Load in saved preferences file
-	mPreferences = new TPrefsDB();
-	mHiscores = new TPfHiscores();
+	// Load in saved preferences file; changes are saved write-behind.
+	mPreferences = new TBufferedPrefs();
+	mHiscores = NULL;
 
 	SetCurrentGameMode(0);
 	SetCurrentUser(GetCurrentUser());
@@ -96,6 +97,20 @@ TSettings::~TSettings()
 #define DEFAULT_FULLSCREEN 0
 #endif
 
+TPfHiscores *TSettings::GetHiscores()
+{
+	if (!mHiscores)
+	{
+		mHiscores = new TPfHiscores();
+		mHiscores->SetProperty(TPfHiscores::eGameMode, PFGAMEMODENAMES[mGameMode]);
+		if (GetCurrentUser() >= 0 && GetCurrentUser() < GetNumUsers())
+		{
+			mHiscores->SetProperty(TPfHiscores::ePlayerName, GetCurrentUserName() );
+		}
+	}
+	return mHiscores;
+}
+
 void TSettings::InitGameToSettings()
 {
 	// Set up the application display
@@ -190,7 +205,11 @@ void TSettings::SetCurrentGameMode(int gameMode)
 
 	mGameMode = (eGameMode)gameMode;
 
-	mHiscores->SetProperty(TPfHiscores::eGameMode, PFGAMEMODENAMES[mGameMode]);
+	// A client created later picks the mode up in GetHiscores()
+	if (mHiscores)
+	{
+		mHiscores->SetProperty(TPfHiscores::eGameMode, PFGAMEMODENAMES[mGameMode]);
+	}
 }
 
 
@@ -238,7 +257,10 @@ void TSettings::SetCurrentUser(int userNum)
 	mPreferences->SetInt("curuser", userNum, TPrefsDB::kGlobalIndex);
 	if (userNum >= 0)
 	{
-		mHiscores->SetProperty(TPfHiscores::ePlayerName, GetCurrentUserName() );
+		if (mHiscores)
+		{
+			mHiscores->SetProperty(TPfHiscores::ePlayerName, GetCurrentUserName() );
+		}
 		SetSoundForCurrentUser();
 	}
 
@@ -279,7 +301,7 @@ void TSettings::SetSoundForCurrentUser()
 
 void TSettings::DeleteUser(int userNum)
 {
-	mHiscores->ClearPlayerData(GetUserName(userNum));
+	GetHiscores()->ClearPlayerData(GetUserName(userNum));
 	mPreferences->DeleteUser(userNum);
 	userNum--;
 	if (userNum < 0)
@@ -333,6 +355,7 @@ void TSettings::LogHighScore(int score, bool medal1, bool medal2)
 		GetHiscores()->KeepMedal(PFGAMEMEDALNAMES[1], TPfHiscores::eMedalType_Mode, "12345");
 	}
 	TGameState::GetInstance()->SetState("LastGameHiScore",score);
+	ddd::Application::get_mutable_instance().getMetrics().value("LastGameHiScore",score);
 
 }
 
@@ -363,38 +386,38 @@ str TSettings::GetPFMedalName(int index)
 
 int TSettings::NumMedalsToSubmit()
 {
-	return mHiscores->GetNumMedalsToSubmit();
+	return GetHiscores()->GetNumMedalsToSubmit();
 }
 
 int TSettings::NumEarnedMedals()
 {
-	return mHiscores->GetNumMedalsEarned();
+	return GetHiscores()->GetNumMedalsEarned();
 }
 
 str TSettings::GetMedalName(int index)
 {
 	str name;
-	mHiscores->GetEarnedMedalInfo(index, &name, NULL, NULL, NULL);
+	GetHiscores()->GetEarnedMedalInfo(index, &name, NULL, NULL, NULL);
 	return name;
 }
 
 int TSettings::GetMedalType(int index)
 {
 	TPfHiscores::EMedalType type;
-	mHiscores->GetEarnedMedalInfo(index, NULL, &type, NULL, NULL);
+	GetHiscores()->GetEarnedMedalInfo(index, NULL, &type, NULL, NULL);
 	return type;
 }
 
 str TSettings::GetMedalGameMode(int index)
 {
 	str mode;
-	mHiscores->GetEarnedMedalInfo(index, NULL, NULL, &mode, NULL);
+	GetHiscores()->GetEarnedMedalInfo(index, NULL, NULL, &mode, NULL);
 	return mode;
 }
 
 str TSettings::GetMedalGameData(int index)
 {
 	str data;
-	mHiscores->GetEarnedMedalInfo(index, NULL, NULL, NULL, &data);
+	GetHiscores()->GetEarnedMedalInfo(index, NULL, NULL, NULL, &data);
 	return data;
 }
\ No newline at end of file
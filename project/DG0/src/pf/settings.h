@@ -13,6 +13,7 @@
 
 
 #include <pf/prefsdb.h>
+#include "bufferedprefs.h"
 #include <pf/pfhiscores.h>
 
 class TSettings
@@ -50,8 +51,10 @@ public:
 
 	void LogHighScore(int score, bool medal1, bool medal2);
 
-	TPrefsDB *GetPreferences() {return mPreferences;}
-	TPfHiscores *GetHiscores() {return mHiscores;}
+	TBufferedPrefs *GetPreferences() {return mPreferences;}
+	/// The hiscore client, created on first use so startup does not
+	/// wait for it to load the score and medal tables.
+	TPfHiscores *GetHiscores();
 
 	str GetPFGameModeName(int index);
 	str GetPFMedalName(int index);
@@ -69,7 +72,7 @@ private:
 
 	void SetSoundForCurrentUser();
 
-	TPrefsDB		*mPreferences;
+	TBufferedPrefs	*mPreferences;
 	TPfHiscores		*mHiscores;
 
 	eGameMode		mGameMode;
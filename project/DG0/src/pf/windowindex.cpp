@@ -0,0 +1,129 @@
+/**
+ * @file
+ * Implementation for class TWindowIndex, a name to window lookup table.
+ */
+
+#include "windowindex.h"
+
+/**
+ * Lists every window of a subtree, depth first.
+ */
+class TWindowIndexSpider : public TWindowSpider
+{
+public:
+	TWindowIndexSpider(std::vector<TWindow*> * windows) : mWindows(windows) {}
+
+	virtual bool Process(TWindow * window)
+	{
+		mWindows->push_back(window);
+		window->ForEachChild(this);
+		return true ;
+	}
+
+private:
+	std::vector<TWindow*> *	mWindows ;
+};
+
+TWindowIndex::TWindowIndex() :
+	mRoot(NULL),
+	mValid(false)
+{
+}
+
+void TWindowIndex::SetRoot(TWindow * root)
+{
+	mRoot = root ;
+	Invalidate();
+}
+
+void TWindowIndex::Build()
+{
+	Collect(mWindows);
+	mEntries.clear();
+	for (TWindowVector::iterator w=mWindows.begin(); w!=mWindows.end(); ++w)
+	{
+		Add(*w);
+	}
+	mValid = true ;
+}
+
+void TWindowIndex::Invalidate()
+{
+	mEntries.clear();
+	mWindows.clear();
+	mValid = false ;
+}
+
+void TWindowIndex::Refresh()
+{
+	if (!mValid)
+	{
+		return;
+	}
+	Collect(mCurrent);
+	if (mCurrent!=mWindows)
+	{
+		Invalidate();
+	}
+}
+
+void TWindowIndex::Collect(TWindowVector & windows)
+{
+	windows.clear();
+	if (mRoot)
+	{
+		TWindowIndexSpider spider(&windows);
+		mRoot->ForEachChild(&spider);
+	}
+}
+
+TWindow * TWindowIndex::FindChild(const str & name)
+{
+	if (!mRoot)
+	{
+		return NULL;
+	}
+	if (!mValid)
+	{
+		Build();
+	}
+
+	TEntryMap::iterator it = mEntries.find(name.c_str());
+	if (it==mEntries.end())
+	{
+		// Not a descendant when the index was built; remember that.
+		TWindow * window = mRoot->GetChildWindow(name,-1);
+		TEntry entry = { window, false };
+		mEntries[name.c_str()] = entry;
+		return window;
+	}
+	if (it->second.mAmbiguous)
+	{
+		// Let Playground pick which of the namesakes wins.
+		return mRoot->GetChildWindow(name,-1);
+	}
+	TWindow * window = it->second.mWindow;
+	if (window && window->GetName()!=name)
+	{
+		// Renamed, or a new window where a destroyed one used to be.
+		Invalidate();
+		return FindChild(name);
+	}
+	return window;
+}
+
+void TWindowIndex::Add(TWindow * window)
+{
+	const str name = window->GetName();
+	if (name.length()==0)
+	{
+		return;
+	}
+
+	TEntry entry = { window, false };
+	std::pair<TEntryMap::iterator,bool> result = mEntries.insert(TEntryMap::value_type(name.c_str(),entry));
+	if (!result.second)
+	{
+		result.first->second.mAmbiguous = true ;
+	}
+}
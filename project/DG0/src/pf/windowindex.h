@@ -0,0 +1,119 @@
+/**
+ * @file
+ * Interface for class TWindowIndex
+ */
+
+
+#ifndef WINDOWINDEX_H_INCLUDED
+#define WINDOWINDEX_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * A name to window lookup table for the descendants of one window.
+ *
+ * TWindow::GetChildWindow walks the whole subtree and compares names
+ * on every call; screens like the hiscore table call it dozens of times
+ * per update. The index walks the subtree once, after
+ * PostChildrenInit, and answers FindChild from a sorted table.
+ *
+ * - Names used by more than one descendant are not indexed; FindChild
+ *   falls back to GetChildWindow for them so the result is the same.
+ * - Names not found are remembered as missing until the next build.
+ * - The owner invalidates the index from its AdoptChild and
+ *   OrphanChild overrides. Windows added or removed deeper in the tree
+ *   don't pass through the owner, so code that does that must call
+ *   Invalidate() itself. An invalid index is rebuilt on the next
+ *   FindChild.
+ * - An index of a window you don't own, whose children you can't
+ *   watch, calls Refresh() before its lookups instead.
+ */
+class TWindowIndex
+{
+public:
+	/// Default Constructor
+	TWindowIndex();
+
+	/**
+	 * Set the window whose descendants are indexed. Invalidates the
+	 * index.
+	 *
+	 * @param root   Window to index, or NULL.
+	 */
+	void SetRoot(TWindow * root);
+
+	/// @return The indexed window, or NULL.
+	TWindow * GetRoot() const { return mRoot; }
+
+	/**
+	 * Walk the descendants of the root and fill the index.
+	 */
+	void Build();
+
+	/**
+	 * Drop the index; it's rebuilt on the next FindChild.
+	 */
+	void Invalidate();
+
+	/**
+	 * Rebuild the index if the descendants of the root aren't the
+	 * ones it was built from. Walks the subtree comparing window
+	 * pointers only, so it's cheaper than a GetChildWindow, and the
+	 * windows FindChild returns afterwards are known to be alive.
+	 */
+	void Refresh();
+
+	/// @return True if the index is up to date.
+	bool IsValid() const { return mValid; }
+
+	/**
+	 * Find a descendant of the root by name. Same result as
+	 * GetRoot()->GetChildWindow(name,-1).
+	 *
+	 * @param name   Name of the window.
+	 *
+	 * @return The window, or NULL if there's none of that name.
+	 */
+	TWindow * FindChild(const str & name);
+
+private:
+	struct TEntry
+	{
+		TWindow *	mWindow ;
+		bool		mAmbiguous ;
+	};
+	typedef std::map<std::string,TEntry> TEntryMap;
+
+	typedef std::vector<TWindow*> TWindowVector;
+
+	void Collect(TWindowVector & windows);
+	void Add(TWindow * window);
+
+	/**
+	 * The indexed window.
+	 */
+	TWindow *	mRoot ;
+
+	/**
+	 * Names of the descendants, plus names that were looked up and
+	 * not found, with a NULL window.
+	 */
+	TEntryMap	mEntries ;
+
+	/**
+	 * The descendants the index was built from, depth first, and the
+	 * ones Refresh found.
+	 */
+	TWindowVector	mWindows ;
+	TWindowVector	mCurrent ;
+
+	/**
+	 * Whether mEntries matches the window tree.
+	 */
+	bool		mValid ;
+};
+
+#endif // WINDOWINDEX_H_INCLUDED